@@ -1,38 +1,315 @@
 /**
   * append_volumes.cpp
-  * Merges two volumes into one. Volumes are
+  * Merges volumes into one. Volumes are
   * connected via the 3rd dimension.
-  * Final vol size is max(x1,x2),max(y1,y2), z1+z2.
+  * Final vol size is max(x),max(y), sum(z).
+  * Uncompressed MetaImage volumes of the same type and x/y size are
+  * appended by copying their raw data into a new MetaImage file, through
+  * a buffer of APPEND_BUFFER_SIZE bytes. Other volumes of the same x/y
+  * size are streamed APPEND_SLAB_SLICES slices at a time. Volumes of
+  * different x/y sizes are tiled in memory.
   * @author M.A. Zuluga
   */
 
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageIOFactory.h>
 #include <itkTileImageFilter.h>
-#include <itkChangeInformationImageFilter.h>
+#include "itkVolumeStackImageSource.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <vector>
 
+#define APPEND_SLAB_SLICES 32 //Slices read and written at a time
+#define APPEND_BUFFER_SIZE (4 << 20) //Bytes of raw data copied at a time
 
 
 void Usage(char *exec)
 {
     std::cout << " " << std::endl;
-    std::cout << "Piles two volumes" << std::endl;
+    std::cout << "Piles volumes" << std::endl;
     std::cout << " " << std::endl;
-    std::cout << " " << exec << " [-i1 file 1 -i2 file 2 -o outputimage <options>  ]" << std::endl;
+    std::cout << " " << exec << " [-i file 1 -i file 2 ... -o outputimage <options>  ]" << std::endl;
     std::cout << "**********************************************************" <<std::endl;
+    std::cout << "-i1 <file> and -i2 <file> are also accepted for the first two volumes" << std::endl;
     std::cout << "Options:" <<std::endl;
     std::cout << "-v <float> \t Isotropic voxel spacing (default 1.0)" << std::endl;
 }
 
+/**
+ * Where the voxels of an uncompressed MetaImage volume are, and the
+ * header fields that must agree to append it to others.
+ */
+struct MetaImageData
+{
+    std::vector<std::string> Header;
+    std::string DataFile;
+    std::streamoff Offset;
+    std::streamoff Size;
+    std::string Format;
+    unsigned long Slices;
+};
+
+std::string GetExtension(const std::string & fileName)
+{
+    const std::string::size_type dot = fileName.find_last_of('.');
+    if (dot == std::string::npos || fileName.find('/', dot) != std::string::npos)
+        return std::string();
+    return fileName.substr(dot);
+}
+
+std::string GetFolder(const std::string & fileName)
+{
+    const std::string::size_type slash = fileName.find_last_of('/');
+    return slash == std::string::npos ? std::string() : fileName.substr(0, slash + 1);
+}
+
+std::string GetKey(const std::string & line)
+{
+    std::string key = line.substr(0, line.find('='));
+    key.erase(key.find_last_not_of(" \t\r") + 1);
+    return key.substr(std::min(key.size(), key.find_first_not_of(" \t")));
+}
+
+std::string GetValue(const std::string & line)
+{
+    const std::string::size_type equal = line.find('=');
+    if (equal == std::string::npos)
+        return std::string();
+    std::string value = line.substr(equal + 1);
+    value.erase(value.find_last_not_of(" \t\r") + 1);
+    return value.substr(std::min(value.size(), value.find_first_not_of(" \t")));
+}
+
+/**
+ * @brief ReadMetaImageData Finds the raw data of a .mhd or .mha volume.
+ * @return false if the file is not a 3D MetaImage whose data is stored
+ *         uncompressed in a single file
+ */
+bool ReadMetaImageData(const std::string & fileName, MetaImageData & data)
+{
+    const std::string extension = GetExtension(fileName);
+    if (extension != ".mhd" && extension != ".mha")
+        return false;
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+
+    std::map<std::string,std::string> fields;
+    std::string line;
+    data.Header.clear();
+    while (std::getline(file, line))
+    {
+        const std::string key = GetKey(line);
+        fields[key] = GetValue(line);
+        if (key == "ElementDataFile")
+            break;
+        data.Header.push_back(line);
+    }
+
+    //Bytes per element of the MetaIO types
+    std::map<std::string,unsigned int> elementSizes;
+    elementSizes["MET_CHAR"] = elementSizes["MET_UCHAR"] = 1;
+    elementSizes["MET_SHORT"] = elementSizes["MET_USHORT"] = 2;
+    elementSizes["MET_INT"] = elementSizes["MET_UINT"] = elementSizes["MET_FLOAT"] = 4;
+    elementSizes["MET_DOUBLE"] = elementSizes["MET_LONG_LONG"] = elementSizes["MET_ULONG_LONG"] = 8;
+
+    std::istringstream dimSize(fields["DimSize"]);
+    unsigned long size[3];
+    dimSize >> size[0] >> size[1] >> size[2];
+    const std::string & dataFile = fields["ElementDataFile"];
+    if (fields["NDims"] != "3" || dimSize.fail() || fields["BinaryData"] != "True" ||
+            fields["CompressedData"] == "True" || elementSizes.count(fields["ElementType"]) == 0 ||
+            dataFile.empty() || dataFile.compare(0, 4, "LIST") == 0 ||
+            dataFile.find('%') != std::string::npos)
+        return false;
+
+    const unsigned int channels = fields.count("ElementNumberOfChannels") ?
+                atoi(fields["ElementNumberOfChannels"].c_str()) : 1;
+    data.Size = static_cast<std::streamoff>(size[0]) * size[1] * size[2] * channels *
+            elementSizes[fields["ElementType"]];
+    data.Slices = size[2];
+    std::ostringstream format;
+    format << fields["ElementType"] << " " << channels << " " << fields["ElementByteOrderMSB"]
+           << fields["BinaryDataByteOrderMSB"] << " " << size[0] << " " << size[1];
+    data.Format = format.str();
+
+    if (dataFile == "LOCAL")
+    {
+        data.DataFile = fileName;
+        data.Offset = file.tellg();
+        return data.Offset >= 0;
+    }
+    data.DataFile = dataFile[0] == '/' ? dataFile : GetFolder(fileName) + dataFile;
+    const long headerSize = fields.count("HeaderSize") ? atol(fields["HeaderSize"].c_str()) : 0;
+    data.Offset = headerSize;
+    if (headerSize == -1)
+    {
+        //The data is at the end of the file
+        std::ifstream raw(data.DataFile.c_str(), std::ios::binary | std::ios::ate);
+        data.Offset = static_cast<std::streamoff>(raw.tellg()) - data.Size;
+    }
+    return data.Offset >= 0;
+}
+
+/**
+ * @brief AppendMetaImages Writes the raw data of the volumes one after the
+ *        other into outputFileName (.mhd or .mha), with the header of the
+ *        first volume
+ */
+int AppendMetaImages(const std::vector<MetaImageData> & volumes, const std::string & outputFileName,
+                     bool change_spacing, float scalingFactor)
+{
+    unsigned long slices = 0;
+    for (unsigned int v = 0; v < volumes.size(); ++v)
+        slices += volumes[v].Slices;
+
+    const bool local = GetExtension(outputFileName) == ".mha";
+    std::string dataFile = outputFileName.substr(0, outputFileName.find_last_of('.')) + ".raw";
+    for (unsigned int v = 0; v < volumes.size(); ++v)
+        if (volumes[v].DataFile == (local ? outputFileName : dataFile))
+        {
+            std::cerr << "Error: " << outputFileName << " would overwrite the volumes" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+    //-v adds ElementSpacing before DimSize, as MetaImageIO writes it, when
+    //the header has none
+    bool hasSpacing = false;
+    for (unsigned int l = 0; l < volumes[0].Header.size(); ++l)
+        hasSpacing = hasSpacing || GetKey(volumes[0].Header[l]) == "ElementSpacing";
+
+    std::ofstream header(outputFileName.c_str(), std::ios::binary);
+    for (unsigned int l = 0; l < volumes[0].Header.size(); ++l)
+    {
+        const std::string key = GetKey(volumes[0].Header[l]);
+        if (key == "HeaderSize" || key == "CompressedData" || key == "CompressedDataSize")
+            continue;
+        if (key == "DimSize" && change_spacing && !hasSpacing)
+            header << "ElementSpacing = " << scalingFactor << " " << scalingFactor << " " << scalingFactor << "\n";
+        if (key == "DimSize")
+        {
+            std::istringstream dimSize(GetValue(volumes[0].Header[l]));
+            unsigned long size[2];
+            dimSize >> size[0] >> size[1];
+            header << "DimSize = " << size[0] << " " << size[1] << " " << slices << "\n";
+        }
+        else if (key == "ElementSpacing" && change_spacing)
+            header << "ElementSpacing = " << scalingFactor << " " << scalingFactor << " " << scalingFactor << "\n";
+        else
+            header << volumes[0].Header[l] << "\n";
+    }
+    header << "ElementDataFile = " << (local ? std::string("LOCAL") : dataFile.substr(dataFile.find_last_of('/') + 1)) << "\n";
+
+    //The data follows the header of a .mha
+    std::ofstream rawFile;
+    if (!local)
+        rawFile.open(dataFile.c_str(), std::ios::binary);
+    std::ofstream & raw = local ? header : rawFile;
+
+    std::vector<char> buffer(APPEND_BUFFER_SIZE);
+    for (unsigned int v = 0; v < volumes.size() && raw; ++v)
+    {
+        std::ifstream in(volumes[v].DataFile.c_str(), std::ios::binary);
+        in.seekg(volumes[v].Offset);
+        std::streamoff left = volumes[v].Size;
+        while (left > 0 && in && raw)
+        {
+            const std::streamsize count = static_cast<std::streamsize>(
+                        std::min<std::streamoff>(left, buffer.size()));
+            in.read(&buffer[0], count);
+            raw.write(&buffer[0], in.gcount());
+            left -= in.gcount();
+        }
+        if (left > 0)
+        {
+            std::cerr << "Error: cannot read the data of volume " << v + 1 << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!raw || !header)
+    {
+        std::cerr << "Error: cannot write " << outputFileName << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+template<typename PixelType>
+int AppendFunction(const std::vector<std::string> & inputFileNames, const std::string & outputFileName,
+                   bool sameSize, bool change_spacing, float scalingFactor)
+{
+    typedef itk::Image<PixelType,3> ImageType;
+    typedef itk::ImageFileWriter<ImageType> WriterType;
+
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetFileName( outputFileName );
+
+    try
+    {
+        if (sameSize)
+        {
+            //Only the slices of the slab being written are read
+            typedef itk::VolumeStackImageSource<ImageType> SourceType;
+            typename SourceType::Pointer source = SourceType::New();
+            source->SetFileNames( inputFileNames );
+            if (change_spacing == true)
+                source->SetVoxelSpacing( scalingFactor );
+            source->UpdateOutputInformation();
+
+            const unsigned int slices = source->GetOutput()->GetLargestPossibleRegion().GetSize(2);
+            writer->SetInput( source->GetOutput() );
+            writer->SetNumberOfStreamDivisions( (slices + APPEND_SLAB_SLICES - 1) / APPEND_SLAB_SLICES );
+            writer->Update();
+        }
+        else
+        {
+            typedef itk::ImageFileReader<ImageType> ImageReaderType;
+            typedef itk::TileImageFilter<ImageType, ImageType> JoinSeriesFilterType;
+
+            typename JoinSeriesFilterType::Pointer joinSeries = JoinSeriesFilterType::New();
+            itk::FixedArray< unsigned int, 3> layout;
+            layout[0] = 1;
+            layout[1] = 1;
+            layout[2] = 0;
+            joinSeries->SetLayout( layout );
+            for (unsigned int v = 0; v < inputFileNames.size(); ++v)
+            {
+                typename ImageReaderType::Pointer reader = ImageReaderType::New();
+                reader->SetFileName( inputFileNames[v] );
+                joinSeries->SetInput( v, reader->GetOutput() );
+            }
+            joinSeries->Update();
+
+            //Check if spacing info needs to be updated
+            typename ImageType::Pointer volume = joinSeries->GetOutput();
+            volume->DisconnectPipeline();
+            if (change_spacing == true)
+            {
+                typename ImageType::SpacingType spacing = ( scalingFactor );
+                volume->SetSpacing( spacing );
+            }
+            writer->SetInput( volume );
+            writer->Update();
+        }
+    }
+    catch( itk::ExceptionObject & error )
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[] )
 {
-    std::string inputFileName1;
-    std::string inputFileName2;
+    std::vector<std::string> inputFileNames;
     std::string outputFileName;
     float scalingFactor = 1.0;
     bool change_spacing = false;
@@ -46,15 +323,11 @@ int main(int argc, char *argv[] )
             Usage(argv[0]);
             return EXIT_FAILURE;
         }
-        else if(strcmp(argv[i], "-i1") == 0)
-        {
-            inputFileName1=argv[++i];
-            std::cout << "Set --i1=" << inputFileName1 << std::endl;
-        }
-        else if(strcmp(argv[i], "-i2") == 0)
+        else if(strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "-i1") == 0 ||
+                strcmp(argv[i], "-i2") == 0)
         {
-            inputFileName2=argv[++i];
-            std::cout << "Set --i2=" << inputFileName2 << std::endl;
+            inputFileNames.push_back(argv[++i]);
+            std::cout << "Set --i=" << inputFileNames.back() << std::endl;
         }
         else if(strcmp(argv[i], "-o") == 0)
         {
@@ -76,71 +349,79 @@ int main(int argc, char *argv[] )
     }
 
     // Validate command line args
-    if (inputFileName1.length() == 0 || inputFileName2.length() == 0 ||
-            outputFileName.length() == 0)
+    if (inputFileNames.size() < 2 || outputFileName.length() == 0)
     {
         std::cout << "Missing required files" << std::endl;
         Usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    //Two image types even if the same, justin case there is need for changing
-    typedef itk::Image<unsigned char,3> ImageType;
-    typedef itk::Image<unsigned char,3> OutImageType;
-    typedef itk::ImageFileReader<ImageType> ImageReaderType;
-    typedef itk::ImageFileWriter<OutImageType> WriterType;
-    typedef itk::TileImageFilter<ImageType, OutImageType>
-            JoinSeriesFilterType;
-    typedef itk::ChangeInformationImageFilter< OutImageType > FilterType;
-
-    ImageReaderType::Pointer reader1 = ImageReaderType::New();
-    ImageReaderType::Pointer reader2 = ImageReaderType::New();
-    JoinSeriesFilterType::Pointer joinSeries = JoinSeriesFilterType::New();
-    FilterType::Pointer changeInfo = FilterType::New();
-
-    itk::FixedArray< unsigned int, 3> layout;
-    layout[0] = 1;
-    layout[1] = 1;
-    layout[2] = 0;
-
-    reader1->SetFileName(inputFileName1);
-    reader2->SetFileName(inputFileName2);
-    reader1->Update();
-    reader2->Update();
-
-    joinSeries->SetInput( 0, reader1->GetOutput());
-    joinSeries->SetInput( 1, reader2->GetOutput());
-    joinSeries->SetLayout( layout );
-    joinSeries->Update();
-
-    typedef itk::ImageFileWriter< OutImageType > WriterType;
-    WriterType::Pointer writer = WriterType::New();
-    writer->SetFileName( outputFileName );
+    //Uncompressed MetaImage volumes in the same format are appended as raw data
+    const std::string outputExtension = GetExtension(outputFileName);
+    bool raw = outputExtension == ".mhd" || outputExtension == ".mha";
+    std::vector<MetaImageData> volumes(inputFileNames.size());
+    for (unsigned int v = 0; v < inputFileNames.size() && raw; ++v)
+        raw = ReadMetaImageData(inputFileNames[v], volumes[v]) && volumes[v].Format == volumes[0].Format;
+    if (raw)
+        return AppendMetaImages(volumes, outputFileName, change_spacing, scalingFactor);
 
-    //Check if spacing info needs to be updated
-    if (change_spacing == true)
+    //The others are read through ITK, in the pixel type of the first volume
+    itk::ImageIOBase::IOComponentType componentType = itk::ImageIOBase::UNKNOWNCOMPONENTTYPE;
+    bool sameSize = true;
+    unsigned long size[2] = { 0, 0 };
+    for (unsigned int v = 0; v < inputFileNames.size(); ++v)
     {
-        OutImageType::SpacingType spacing = ( scalingFactor );
-        changeInfo->SetOutputSpacing( spacing );
-        changeInfo->ChangeSpacingOn();
-        changeInfo->SetInput( joinSeries->GetOutput() );
-        changeInfo->UpdateOutputInformation();
-        writer->SetInput( changeInfo->GetOutput() );
-    }
-    else
-    {
-        writer->SetInput( joinSeries->GetOutput() );
+        itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+                    inputFileNames[v].c_str(), itk::ImageIOFactory::ReadMode);
+        if ( !imageIO )
+        {
+            std::cout << "Could not read the image information of " << inputFileNames[v] << std::endl;
+            return EXIT_FAILURE;
+        }
+        try
+        {
+            imageIO->SetFileName(inputFileNames[v]);
+            imageIO->ReadImageInformation();
+        }
+        catch( itk::ExceptionObject & error )
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (imageIO->GetNumberOfDimensions() != 3 || imageIO->GetNumberOfComponents() != 1)
+        {
+            std::cout << inputFileNames[v] << " is not a 3D scalar volume" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (v == 0)
+        {
+            componentType = imageIO->GetComponentType();
+            size[0] = imageIO->GetDimensions(0);
+            size[1] = imageIO->GetDimensions(1);
+        }
+        sameSize = sameSize && size[0] == imageIO->GetDimensions(0) && size[1] == imageIO->GetDimensions(1);
     }
 
-    try
+    switch( componentType )
     {
-        writer->Update();
-    }
-    catch( itk::ExceptionObject & error )
-    {
-        std::cerr << "Error: " << error << std::endl;
+    case itk::ImageIOBase::UCHAR:
+        return AppendFunction<unsigned char>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::CHAR:
+        return AppendFunction<char>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::USHORT:
+        return AppendFunction<unsigned short>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::SHORT:
+        return AppendFunction<short>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::UINT:
+        return AppendFunction<unsigned int>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::INT:
+        return AppendFunction<int>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::FLOAT:
+        return AppendFunction<float>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    case itk::ImageIOBase::DOUBLE:
+        return AppendFunction<double>(inputFileNames, outputFileName, sameSize, change_spacing, scalingFactor);
+    default:
+        std::cerr << "Unknown and unsupported component type!" << std::endl;
         return EXIT_FAILURE;
     }
-
-    return EXIT_SUCCESS;
 }
@@ -1 +1,254 @@
+/**
+  * cast_image.cpp
+  * Casts an image to another pixel type, clamping the values to the
+  * range of the new type or rescaling them to a given range.
+  * The input is read in its own pixel type and streamed to the output
+  * SLAB_SLICES slices at a time, so memory does not grow with the volume
+  * when the formats allow reading and writing in parts.
+  */
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageIOFactory.h>
+#include "itkSaturatingCastImageFilter.h"
+#include "itkTemporaryImageFile.h"
 
+#define SLAB_SLICES 32 //Slices read and written at a time
+
+void Usage(char *exec)
+{
+  std::cout << " " << std::endl;
+  std::cout << "Casts a 2D or 3D image to another pixel type" << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << " " << exec << " [-i inputimage -o outputimage -t <type> <options> ]" << std::endl;
+  std::cout << "**********************************************************" <<std::endl;
+  std::cout << "<type> is uchar, char, ushort, short, uint, int, float or double." << std::endl;
+  std::cout << "Values outside the range of <type> are clamped to it. NaN becomes 0, or <min> with --rescale." << std::endl;
+  std::cout << "Options:" <<std::endl;
+  std::cout << "--rescale <min> <max> \t Rescales the input linearly to [min, max]" << std::endl;
+  std::cout << "-r <min> <max> \t Range of the input for --rescale. By default the range of the image," << std::endl;
+  std::cout << "\t\t found in a first pass" << std::endl;
+  std::cout << "When -i and -o are the same file, it is replaced once the output is written" << std::endl;
+  std::cout << " " << std::endl;
+}
+
+/**
+ * Options of the cast, as given in the command line.
+ */
+struct CastOptions
+{
+  std::string InputImageName;
+  std::string OutputImageName;
+  bool Rescale;
+  double OutputMinimum;
+  double OutputMaximum;
+  bool UseRange;
+  double InputMinimum;
+  double InputMaximum;
+
+  CastOptions() : Rescale(false), OutputMinimum(0), OutputMaximum(0),
+    UseRange(false), InputMinimum(0), InputMaximum(0) {}
+};
+
+template<int Dim, typename InputPixelType, typename OutputPixelType>
+int CastFunction( const CastOptions & options )
+{
+  typedef itk::Image< InputPixelType, Dim >         InputImageType;
+  typedef itk::Image< OutputPixelType, Dim >        OutputImageType;
+
+  typedef itk::ImageFileReader< InputImageType >  ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( options.InputImageName );
+
+  typedef itk::SaturatingCastImageFilter< InputImageType, OutputImageType > FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( reader->GetOutput() );
+  filter->SetRescale( options.Rescale );
+  filter->SetNumberOfSlicesPerSlab( SLAB_SLICES );
+
+  //Reading and writing the same file in parts would overwrite the slabs
+  //not read yet, so the output goes to a temporary file replacing the
+  //input at the end
+  itk::TemporaryImageFile::Pointer temporary = itk::TemporaryImageFile::New();
+  temporary->SetFileName( options.OutputImageName );
+  const bool inPlace = options.InputImageName == options.OutputImageName;
+  const std::string writeImageName = inPlace ? temporary->GetTemporaryFileName() : options.OutputImageName;
+
+  typedef itk::ImageFileWriter< OutputImageType > WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName( writeImageName );
+  writer->SetInput( filter->GetOutput() );
+
+  try
+  {
+    reader->UpdateOutputInformation();
+    if (options.Rescale)
+    {
+      filter->SetOutputMinimum( static_cast< OutputPixelType >(options.OutputMinimum) );
+      filter->SetOutputMaximum( static_cast< OutputPixelType >(options.OutputMaximum) );
+      if (options.UseRange)
+      {
+        filter->SetInputMinimum( static_cast< InputPixelType >(options.InputMinimum) );
+        filter->SetInputMaximum( static_cast< InputPixelType >(options.InputMaximum) );
+      }
+      else
+        filter->ComputeInputRange();
+    }
+
+    const unsigned int slices = reader->GetOutput()->GetLargestPossibleRegion().GetSize(Dim - 1);
+    writer->SetNumberOfStreamDivisions( (slices + SLAB_SLICES - 1) / SLAB_SLICES );
+    writer->Update();
+    if (inPlace)
+      temporary->Replace();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    if (inPlace)
+      temporary->Remove();
+    std::cerr << "Error: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+template<int Dim, typename InputPixelType>
+int CastOutputFunction( const std::string & outputType, const CastOptions & options )
+{
+  if (outputType == "uchar")
+    return CastFunction<Dim, InputPixelType, unsigned char>(options);
+  if (outputType == "char")
+    return CastFunction<Dim, InputPixelType, char>(options);
+  if (outputType == "ushort")
+    return CastFunction<Dim, InputPixelType, unsigned short>(options);
+  if (outputType == "short")
+    return CastFunction<Dim, InputPixelType, short>(options);
+  if (outputType == "uint")
+    return CastFunction<Dim, InputPixelType, unsigned int>(options);
+  if (outputType == "int")
+    return CastFunction<Dim, InputPixelType, int>(options);
+  if (outputType == "float")
+    return CastFunction<Dim, InputPixelType, float>(options);
+  if (outputType == "double")
+    return CastFunction<Dim, InputPixelType, double>(options);
+  std::cerr << "Unknown output type " << outputType << std::endl;
+  return EXIT_FAILURE;
+}
+
+template<int Dim>
+int CastComponentFunction( itk::ImageIOBase::IOComponentType componentType,
+                           const std::string & outputType, const CastOptions & options )
+{
+  switch( componentType )
+  {
+  case itk::ImageIOBase::UCHAR:
+    return CastOutputFunction<Dim, unsigned char>(outputType, options);
+  case itk::ImageIOBase::CHAR:
+    return CastOutputFunction<Dim, char>(outputType, options);
+  case itk::ImageIOBase::USHORT:
+    return CastOutputFunction<Dim, unsigned short>(outputType, options);
+  case itk::ImageIOBase::SHORT:
+    return CastOutputFunction<Dim, short>(outputType, options);
+  case itk::ImageIOBase::UINT:
+    return CastOutputFunction<Dim, unsigned int>(outputType, options);
+  case itk::ImageIOBase::INT:
+    return CastOutputFunction<Dim, int>(outputType, options);
+  case itk::ImageIOBase::FLOAT:
+    return CastOutputFunction<Dim, float>(outputType, options);
+  case itk::ImageIOBase::DOUBLE:
+    return CastOutputFunction<Dim, double>(outputType, options);
+  default:
+    std::cerr << "Unknown and unsupported component type!" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+int main(int argc, char *argv[] )
+{
+  CastOptions options;
+  std::string outputType;
+
+  for(int i=1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 ||
+       strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 ||
+       strcmp(argv[i], "--h")==0)
+    {
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-i") == 0)
+    {
+      options.InputImageName=argv[++i];
+      std::cout << "Set -i=" << options.InputImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "-o") == 0)
+    {
+      options.OutputImageName=argv[++i];
+      std::cout << "Set -o=" << options.OutputImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "-t") == 0)
+    {
+      outputType=argv[++i];
+      std::cout << "Set -t=" << outputType << std::endl;
+    }
+    else if(strcmp(argv[i], "--rescale") == 0)
+    {
+      options.Rescale = true;
+      options.OutputMinimum = atof(argv[++i]);
+      options.OutputMaximum = atof(argv[++i]);
+      std::cout << "Set --rescale=" << options.OutputMinimum << " " << options.OutputMaximum << std::endl;
+    }
+    else if(strcmp(argv[i], "-r") == 0)
+    {
+      options.UseRange = true;
+      options.InputMinimum = atof(argv[++i]);
+      options.InputMaximum = atof(argv[++i]);
+      std::cout << "Set -r=" << options.InputMinimum << " " << options.InputMaximum << std::endl;
+    }
+    else
+    {
+      std::cerr << argv[0] << ":\tParameter " << argv[i] << " unknown."
+                           << std::endl;
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Validate command line args
+  if (options.InputImageName.length() == 0 || options.OutputImageName.length() == 0 ||
+      outputType.length() == 0)
+  {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+        options.InputImageName.c_str(), itk::ImageIOFactory::ReadMode);
+  if ( !imageIO )
+  {
+    std::cerr << "Could not read the image information of " << options.InputImageName << std::endl;
+    return EXIT_FAILURE;
+  }
+  try
+  {
+    imageIO->SetFileName(options.InputImageName);
+    imageIO->ReadImageInformation();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "Error: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  switch ( imageIO->GetNumberOfDimensions() )
+  {
+  case 2:
+    return CastComponentFunction<2>(imageIO->GetComponentType(), outputType, options);
+  case 3:
+    return CastComponentFunction<3>(imageIO->GetComponentType(), outputType, options);
+  default:
+    std::cerr << "Unsupported dimension" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
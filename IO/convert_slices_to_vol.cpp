@@ -16,8 +16,10 @@ void Usage(char *exec)
     std::cout << " " << std::endl;
     std::cout << "Generates volume from a set of slices" << std::endl;
     std::cout << " " << std::endl;
-    std::cout << " " << exec << " [-p pattern -s first slice value -e last slice value -o outputimage -v verbose ON]" << std::endl;
+    std::cout << " " << exec << " [-p pattern -s first slice value -e last slice value -o outputimage -v verbose ON <options>]" << std::endl;
     std::cout << "**********************************************************" <<std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "-sp <float> \t Isotropic voxel spacing (default: that of the slices)" << std::endl;
 }
 
 int main( int argc, char * argv[] )
@@ -27,6 +29,8 @@ int main( int argc, char * argv[] )
     unsigned int lastslice = 0;
     bool verbose = false;
     std::string outputFileName;
+    float scalingFactor = 1.0;
+    bool change_spacing = false;
 
     for(int i=1; i < argc; i++)
     {
@@ -63,6 +67,12 @@ int main( int argc, char * argv[] )
             verbose = true;
             std::cout << "Set --verbose=ON" << std::endl;
         }
+        else if(strcmp(argv[i], "-sp") == 0)
+        {
+            scalingFactor=atof(argv[++i]);
+            change_spacing = true;
+            std::cout << "Set --sp=" << scalingFactor << std::endl;
+        }
         else
         {
             std::cout << "Error in arguments" << std::endl;
@@ -112,9 +122,17 @@ int main( int argc, char * argv[] )
     reader->SetFileNames( names  );
 
      writer->SetFileName( outputFileName );
-     writer->SetInput( reader->GetOutput() );
      try
      {
+         reader->Update();
+         ImageType::Pointer volume = reader->GetOutput();
+         volume->DisconnectPipeline();
+         if (change_spacing)
+         {
+             ImageType::SpacingType spacing = ( scalingFactor );
+             volume->SetSpacing( spacing );
+         }
+         writer->SetInput( volume );
          writer->Update();
      }
      catch( itk::ExceptionObject & err )
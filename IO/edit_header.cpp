@@ -0,0 +1,175 @@
+/**
+  * edit_header.cpp
+  * Changes the spacing, origin or direction of an image by rewriting
+  * its header only, without reading or writing the voxels.
+  * Works on MetaImage .mhd headers with a separate data file and on
+  * uncompressed NIfTI (.nii, .hdr/.img) files.
+  */
+#include <itkImageIOBase.h>
+#include <itkImageIOFactory.h>
+#include "itkImageHeaderEditor.h"
+
+void Usage(char *exec)
+{
+    std::cout << " " << std::endl;
+    std::cout << "Changes the geometry in the header of an image, in place" << std::endl;
+    std::cout << " " << std::endl;
+    std::cout << " " << exec << " [-i image <options>  ]" << std::endl;
+    std::cout << "**********************************************************" <<std::endl;
+    std::cout << "The image must be a .mhd header with a separate data file or an uncompressed NIfTI" << std::endl;
+    std::cout << "file (.nii, .hdr). Values are given in the physical space of ITK (LPS)." << std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "-v <float> \t Isotropic voxel spacing" << std::endl;
+    std::cout << "-s <float>... \t Voxel spacing, one value per dimension" << std::endl;
+    std::cout << "-or <float>... \t Origin, one value per dimension" << std::endl;
+    std::cout << "-t <float>... \t Translation added to the origin, one value per dimension" << std::endl;
+    std::cout << "-d <float>... \t Direction matrix, row by row" << std::endl;
+}
+
+/**
+ * @brief ReadValues Reads count numbers following argv[i] and moves i to
+ * the last of them.
+ * @return false if there are not enough arguments
+ */
+bool ReadValues(int argc, char *argv[], int & i, unsigned int count,
+                itk::ImageHeaderEditor::ArrayType & values)
+{
+    values.clear();
+    for (unsigned int k = 0; k < count; ++k)
+    {
+        if (++i >= argc)
+            return false;
+        values.push_back(atof(argv[i]));
+    }
+    return true;
+}
+
+int main(int argc, char *argv[] )
+{
+    std::string inputFileName;
+
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0
+                || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0
+                || strcmp(argv[i], "--h")==0)
+        {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            inputFileName=argv[++i];
+        }
+    }
+
+    if (inputFileName.length() == 0)
+    {
+        std::cout << "Missing required files" << std::endl;
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //The number of values of every option depends on the dimension
+    itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+                inputFileName.c_str(), itk::ImageIOFactory::ReadMode);
+    if ( !imageIO )
+    {
+        std::cout << "Could not read the image information of " << inputFileName << std::endl;
+        return EXIT_FAILURE;
+    }
+    try
+    {
+        imageIO->SetFileName(inputFileName);
+        imageIO->ReadImageInformation();
+    }
+    catch( itk::ExceptionObject & error )
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    const unsigned int dimension = imageIO->GetNumberOfDimensions();
+
+    itk::ImageHeaderEditor::Pointer editor = itk::ImageHeaderEditor::New();
+    editor->SetFileName(inputFileName);
+    itk::ImageHeaderEditor::ArrayType values;
+    for(int i=1; i < argc; i++)
+    {
+        bool valid = true;
+        if(strcmp(argv[i], "-i") == 0)
+        {
+            std::cout << "Set --i=" << argv[++i] << std::endl;
+        }
+        else if(strcmp(argv[i], "-v") == 0)
+        {
+            valid = ReadValues(argc, argv, i, 1, values);
+            if (valid)
+            {
+                editor->SetSpacing(itk::ImageHeaderEditor::ArrayType(dimension, values[0]));
+                std::cout << "Set --v=" << values[0] << std::endl;
+            }
+        }
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            valid = ReadValues(argc, argv, i, dimension, values);
+            if (valid)
+                editor->SetSpacing(values);
+            std::cout << "Set --s" << std::endl;
+        }
+        else if(strcmp(argv[i], "-or") == 0)
+        {
+            valid = ReadValues(argc, argv, i, dimension, values);
+            if (valid)
+                editor->SetOrigin(values);
+            std::cout << "Set --or" << std::endl;
+        }
+        else if(strcmp(argv[i], "-t") == 0)
+        {
+            valid = ReadValues(argc, argv, i, dimension, values);
+            if (valid)
+            {
+                for (unsigned int d = 0; d < dimension; ++d)
+                    values[d] += imageIO->GetOrigin(d);
+                editor->SetOrigin(values);
+            }
+            std::cout << "Set --t" << std::endl;
+        }
+        else if(strcmp(argv[i], "-d") == 0)
+        {
+            valid = ReadValues(argc, argv, i, dimension * dimension, values);
+            if (valid)
+                editor->SetDirection(values);
+            std::cout << "Set --d" << std::endl;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            std::cout << "Error in arguments" << std::endl;
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!itk::ImageHeaderEditor::CanEditFile(inputFileName))
+    {
+        std::cerr << "Error: the header of " << inputFileName << " cannot be edited on its own. "
+                  << "Convert it to .mhd or .nii first" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        editor->Update();
+    }
+    catch( itk::ExceptionObject & error )
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
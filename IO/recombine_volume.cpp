@@ -0,0 +1,209 @@
+/**
+  * recombine_volume.cpp
+  * Recombines the processed blocks of a volume split by split_volume into
+  * whole volumes, one per channel (e.g. masks, segmentations, centrelines),
+  * writing the output one slab at a time.
+  * It replaces imagesplit --descriptor.
+  */
+#include "itkImage.h"
+#include "itkImageIOBase.h"
+#include "itkImageIOFactory.h"
+
+#include "itkImageBlockRecombiner.h"
+
+#include <map>
+
+
+void Usage(char *exec)
+{
+    std::cout << " " << std::endl;
+    std::cout << "Recombines processed blocks into whole volumes" << std::endl;
+    std::cout << " " << exec << " [-d descriptor -i input prefix -o output image [-i input prefix -o output image ...] ]" << std::endl;
+    std::cout << "**********************************************************" <<std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "-i <prefix> \t Block n is read from <prefix> followed by the file name of block n in the descriptor" << std::endl;
+    std::cout << "-o <file> \t Output of the previous -i, in a format that can be written in pieces (e.g. .mhd)" << std::endl;
+    std::cout << "--policy <crop|max|feather> \t Value in overlaps: from the block owning the voxel, the maximum or a feathered mean (default crop)" << std::endl;
+    std::cout << "Each channel is written with the pixel type of its blocks" << std::endl;
+    std::cout << std::endl;
+}
+
+template< class TPixel >
+int recombineImage( itk::ImageBlockGrid * grid,
+                    const std::vector< std::string > & inputPrefixes,
+                    const std::vector< std::string > & outputFileNames,
+                    int policy )
+{
+    const unsigned int Dimension = 3;
+    typedef itk::Image< TPixel, Dimension > ImageType;
+    typedef itk::ImageBlockRecombiner< ImageType > RecombinerType;
+
+    typename RecombinerType::Pointer recombiner = RecombinerType::New();
+    recombiner->SetGrid( grid );
+    recombiner->SetPolicy( static_cast< typename RecombinerType::PolicyType >( policy ) );
+    for (unsigned int c = 0; c < inputPrefixes.size(); ++c)
+      recombiner->AddChannel( inputPrefixes[c], outputFileNames[c] );
+
+    try
+    {
+      recombiner->Compute();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << "Error: " << e << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+int main( int argc, char * argv[] )
+{
+    std::string descriptorFileName;
+    std::vector< std::string > inputPrefixes;
+    std::vector< std::string > outputFileNames;
+    int policy = 0;
+
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0
+                || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0
+                || strcmp(argv[i], "--h")==0)
+        {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[i], "-d") == 0)
+        {
+            descriptorFileName=argv[++i];
+            std::cout << "Set --d=" << descriptorFileName << std::endl;
+        }
+        else if(strcmp(argv[i], "-i") == 0)
+        {
+            inputPrefixes.push_back(argv[++i]);
+            std::cout << "Set --i=" << inputPrefixes.back() << std::endl;
+        }
+        else if(strcmp(argv[i], "-o") == 0)
+        {
+            outputFileNames.push_back(argv[++i]);
+            std::cout << "Set --o=" << outputFileNames.back() << std::endl;
+        }
+        else if(strcmp(argv[i], "--policy") == 0)
+        {
+            ++i;
+            if (strcmp(argv[i], "crop") == 0)
+              policy = 0;
+            else if (strcmp(argv[i], "max") == 0)
+              policy = 1;
+            else if (strcmp(argv[i], "feather") == 0)
+              policy = 2;
+            else
+            {
+              std::cout << "Unknown policy " << argv[i] << std::endl;
+              Usage(argv[0]);
+              return EXIT_FAILURE;
+            }
+            std::cout << "Set --policy=" << argv[i] << std::endl;
+        }
+        else
+        {
+            std::cout << "Error in arguments" << std::endl;
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Validate command line args
+    if (descriptorFileName.length() == 0 || inputPrefixes.empty()
+        || inputPrefixes.size() != outputFileNames.size())
+    {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    itk::ImageBlockGrid::Pointer grid = itk::ImageBlockGrid::New();
+    try
+    {
+      grid->ReadDescriptor( descriptorFileName );
+      grid->ComputeCores();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << "Error: " << e << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    //Each channel keeps the pixel type of its first block. The channels of
+    //the same type are recombined together
+    typedef itk::ImageIOBase::IOComponentType IOComponentType;
+    typedef std::map< IOComponentType, std::vector< unsigned int > > ChannelGroupsType;
+    ChannelGroupsType channelGroups;
+    const std::string & blockFileName = grid->GetBlock(0).FileName;
+    const std::string::size_type slash = blockFileName.find_last_of("/\\");
+    for (unsigned int c = 0; c < inputPrefixes.size(); ++c)
+    {
+      const std::string firstFileName = inputPrefixes[c]
+          + blockFileName.substr(slash == std::string::npos ? 0 : slash + 1);
+      itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+            firstFileName.c_str(), itk::ImageIOFactory::ReadMode );
+      if (!imageIO)
+      {
+        std::cerr << "Cannot read " << firstFileName << std::endl;
+        return EXIT_FAILURE;
+      }
+      imageIO->SetFileName( firstFileName );
+      imageIO->ReadImageInformation();
+      channelGroups[imageIO->GetComponentType()].push_back(c);
+    }
+
+    for (ChannelGroupsType::const_iterator group = channelGroups.begin();
+         group != channelGroups.end(); ++group)
+    {
+      std::vector< std::string > groupPrefixes;
+      std::vector< std::string > groupFileNames;
+      for (unsigned int c = 0; c < group->second.size(); ++c)
+      {
+        groupPrefixes.push_back(inputPrefixes[group->second[c]]);
+        groupFileNames.push_back(outputFileNames[group->second[c]]);
+      }
+
+      int result = EXIT_FAILURE;
+      switch( group->first )
+      {
+          default:
+          case itk::ImageIOBase::UNKNOWNCOMPONENTTYPE:
+            std::cerr << "Unknown and unsupported component type!" << std::endl;
+            return EXIT_FAILURE;
+
+          case itk::ImageIOBase::UCHAR:
+            result = recombineImage< unsigned char >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::CHAR:
+            result = recombineImage< char >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::USHORT:
+            result = recombineImage< unsigned short >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::SHORT:
+            result = recombineImage< short >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::UINT:
+            result = recombineImage< unsigned int >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::INT:
+            result = recombineImage< int >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::FLOAT:
+            result = recombineImage< float >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+          case itk::ImageIOBase::DOUBLE:
+            result = recombineImage< double >( grid, groupPrefixes, groupFileNames, policy );
+            break;
+      }
+      if (result != EXIT_SUCCESS)
+        return result;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,286 @@
+/**
+  * split_volume.cpp
+  * Splits a volume into overlapping blocks that can be processed separately,
+  * optionally rescaling its intensities to 8 bits. It streams the volume, so
+  * it is never fully loaded when its format allows it (e.g. MetaImage), and
+  * writes a descriptor of the blocks for recombining them.
+  * The volume can also be a directory of slices described by a
+  * cardiovasc_pile configuration file, which are decoded as they are needed.
+  * It replaces imagesplit --overlap --max --rescale --type MET_UCHAR.
+  */
+#include "itkImage.h"
+#include "itkImageIOBase.h"
+#include "itkImageIOFactory.h"
+
+#include "itkImageBlockSplitter.h"
+#include "itkSliceStackImageSource.h"
+
+struct SliceSettings
+{
+    std::string ConfigFileName;
+    std::string Directory;
+    std::string Pattern;
+    double Spacing;
+    unsigned int CacheSize;
+};
+
+
+void Usage(char *exec)
+{
+    std::cout << " " << std::endl;
+    std::cout << "Splits a volume into overlapping blocks" << std::endl;
+    std::cout << " " << exec << " [-i input image | --slices config directory] -o output prefix" << std::endl;
+    std::cout << "**********************************************************" <<std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "--max <int> \t Maximum size of the blocks in every dimension (default 300)" << std::endl;
+    std::cout << "--overlap <int> \t Voxels shared by neighbouring blocks (default 50)" << std::endl;
+    std::cout << "--rescale <min> <max> \t Maps [min, max] to the range of the output type" << std::endl;
+    std::cout << "--uchar \t Writes unsigned char blocks (default: input type)" << std::endl;
+    std::cout << "--ext <ext> \t Extension of the blocks (default .mhd)" << std::endl;
+    std::cout << "--slices <config> <dir> \t Reads the jpg slices of <dir> named as in the cardiovasc_pile configuration file <config>" << std::endl;
+    std::cout << "--pattern <str> \t File pattern on the slices (default _)" << std::endl;
+    std::cout << "--spacing <float> \t Isotropic voxel spacing of the slices (default: spacing of the slices and 1 between them)" << std::endl;
+    std::cout << "--cache <int> \t Decoded slices kept in memory (default: --max)" << std::endl;
+    std::cout << "Blocks are written to <prefix>_<n><ext> and the descriptor to <prefix>_info.txt" << std::endl;
+    std::cout << std::endl;
+}
+
+template< class TInputImage, class TOutputImage >
+int splitImage( std::string inputFilename, const SliceSettings & slices,
+                std::string outputPrefix,
+                std::string extension, unsigned int maxSize,
+                unsigned int overlap, bool rescale,
+                double minimum, double maximum )
+{
+    typedef itk::ImageBlockSplitter< TInputImage, TOutputImage > SplitterType;
+    typedef itk::SliceStackImageSource< TInputImage > SourceType;
+
+    typename SplitterType::Pointer splitter = SplitterType::New();
+    if (slices.ConfigFileName.length() > 0)
+    {
+      typename SourceType::Pointer source = SourceType::New();
+      try
+      {
+        source->ReadConfiguration( slices.ConfigFileName, slices.Pattern );
+      }
+      catch( itk::ExceptionObject & e )
+      {
+        std::cerr << "Error: " << e << std::endl;
+        return EXIT_FAILURE;
+      }
+      source->SetDirectory( slices.Directory );
+      source->SetVoxelSpacing( slices.Spacing );
+      source->SetCacheSize( slices.CacheSize > 0 ? slices.CacheSize : maxSize );
+      splitter->SetSource( source );
+    }
+    else
+      splitter->SetFileName( inputFilename );
+    splitter->SetOutputPrefix( outputPrefix );
+    splitter->SetExtension( extension );
+    splitter->SetMaximumBlockSize( maxSize );
+    splitter->SetOverlap( overlap );
+    splitter->SetRescale( rescale );
+    splitter->SetWindowMinimum( minimum );
+    splitter->SetWindowMaximum( maximum );
+
+    try
+    {
+      splitter->Compute();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << "Error: " << e << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout << "Wrote " << splitter->GetGrid()->GetNumberOfBlocks() << " blocks and "
+              << splitter->GetDescriptorFileName() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+template< class TPixel >
+int splitImage( std::string inputFilename, const SliceSettings & slices,
+                std::string outputPrefix,
+                std::string extension, unsigned int maxSize,
+                unsigned int overlap, bool rescale,
+                double minimum, double maximum, bool uchar )
+{
+    const unsigned int Dimension = 3;
+    typedef itk::Image< TPixel, Dimension > InputImageType;
+    typedef itk::Image< unsigned char, Dimension > CharImageType;
+
+    if (uchar)
+      return splitImage< InputImageType, CharImageType >( inputFilename, slices, outputPrefix,
+          extension, maxSize, overlap, rescale, minimum, maximum );
+    return splitImage< InputImageType, InputImageType >( inputFilename, slices, outputPrefix,
+        extension, maxSize, overlap, rescale, minimum, maximum );
+}
+
+
+int main( int argc, char * argv[] )
+{
+    std::string inputFileName;
+    std::string outputPrefix;
+    std::string extension = ".mhd";
+    unsigned int maxSize = 300;
+    unsigned int overlap = 50;
+    bool rescale = false;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    bool uchar = false;
+    SliceSettings slices;
+    slices.Pattern = "_";
+    slices.Spacing = 0.0;
+    slices.CacheSize = 0;
+
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0
+                || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0
+                || strcmp(argv[i], "--h")==0)
+        {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[i], "-i") == 0)
+        {
+            inputFileName=argv[++i];
+            std::cout << "Set --i=" << inputFileName << std::endl;
+        }
+        else if(strcmp(argv[i], "-o") == 0)
+        {
+            outputPrefix=argv[++i];
+            std::cout << "Set --o=" << outputPrefix << std::endl;
+        }
+        else if(strcmp(argv[i], "--max") == 0)
+        {
+            maxSize=atoi(argv[++i]);
+            std::cout << "Set --max=" << maxSize << std::endl;
+        }
+        else if(strcmp(argv[i], "--overlap") == 0)
+        {
+            overlap=atoi(argv[++i]);
+            std::cout << "Set --overlap=" << overlap << std::endl;
+        }
+        else if(strcmp(argv[i], "--rescale") == 0)
+        {
+            rescale=true;
+            minimum=atof(argv[++i]);
+            maximum=atof(argv[++i]);
+            std::cout << "Set --rescale=" << minimum << " " << maximum << std::endl;
+        }
+        else if(strcmp(argv[i], "--uchar") == 0)
+        {
+            uchar=true;
+            std::cout << "Set --uchar" << std::endl;
+        }
+        else if(strcmp(argv[i], "--ext") == 0)
+        {
+            extension=argv[++i];
+            std::cout << "Set --ext=" << extension << std::endl;
+        }
+        else if(strcmp(argv[i], "--slices") == 0)
+        {
+            slices.ConfigFileName=argv[++i];
+            slices.Directory=argv[++i];
+            std::cout << "Set --slices=" << slices.ConfigFileName << " " << slices.Directory << std::endl;
+        }
+        else if(strcmp(argv[i], "--pattern") == 0)
+        {
+            slices.Pattern=argv[++i];
+            std::cout << "Set --pattern=" << slices.Pattern << std::endl;
+        }
+        else if(strcmp(argv[i], "--spacing") == 0)
+        {
+            slices.Spacing=atof(argv[++i]);
+            std::cout << "Set --spacing=" << slices.Spacing << std::endl;
+        }
+        else if(strcmp(argv[i], "--cache") == 0)
+        {
+            slices.CacheSize=atoi(argv[++i]);
+            std::cout << "Set --cache=" << slices.CacheSize << std::endl;
+        }
+        else
+        {
+            std::cout << "Error in arguments" << std::endl;
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Validate command line args
+    if ((inputFileName.length() == 0) == (slices.ConfigFileName.length() == 0)
+        || outputPrefix.length() == 0)
+    {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    //The pixel type of a slice stack is that of its first slice
+    std::string headerFileName = inputFileName;
+    if (slices.ConfigFileName.length() > 0)
+    {
+      typedef itk::SliceStackImageSource< itk::Image< unsigned char, 3 > > ProbeType;
+      ProbeType::Pointer probe = ProbeType::New();
+      try
+      {
+        probe->ReadConfiguration( slices.ConfigFileName, slices.Pattern );
+      }
+      catch( itk::ExceptionObject & e )
+      {
+        std::cerr << "Error: " << e << std::endl;
+        return EXIT_FAILURE;
+      }
+      probe->SetDirectory( slices.Directory );
+      headerFileName = probe->GetSliceFileName(0);
+    }
+
+    itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+          headerFileName.c_str(), itk::ImageIOFactory::ReadMode );
+    if (!imageIO)
+    {
+      std::cerr << "Cannot read " << headerFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    imageIO->SetFileName( headerFileName );
+    imageIO->ReadImageInformation();
+
+    typedef itk::ImageIOBase::IOComponentType IOComponentType;
+    const IOComponentType componentType = imageIO->GetComponentType();
+
+    switch( componentType )
+    {
+        default:
+        case itk::ImageIOBase::UNKNOWNCOMPONENTTYPE:
+          std::cerr << "Unknown and unsupported component type!" << std::endl;
+          return EXIT_FAILURE;
+
+        case itk::ImageIOBase::UCHAR:
+          return splitImage< unsigned char >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::CHAR:
+          return splitImage< char >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::USHORT:
+          return splitImage< unsigned short >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::SHORT:
+          return splitImage< short >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::UINT:
+          return splitImage< unsigned int >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::INT:
+          return splitImage< int >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::FLOAT:
+          return splitImage< float >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+        case itk::ImageIOBase::DOUBLE:
+          return splitImage< double >( inputFileName, slices, outputPrefix, extension,
+              maxSize, overlap, rescale, minimum, maximum, uchar );
+    }
+
+    return EXIT_FAILURE; //but it should never get here
+}
@@ -1,19 +1,25 @@
 /**
   * compute_statistics.cpp
-  * Computes some basic statistics over an image.
-  * The -f flag should be activated so that different regions can be evaluated (by providing different
-  * values). At the moment, anything that is not background is considered a label.
-  * Optionally writes these to a file
+  * Computes some basic statistics over an image, for every region of a label map.
+  * Every label that is not background is a region; -f restricts the output to one of them.
+  * All the regions are computed in a single multithreaded pass.
+  * Optionally writes the summary to a file as "min; <value>" lines, or every
+  * region to a CSV or JSON file if the file name ends in .csv or .json
   * @author M.A. Zuluaga
   */
 #include <itkImage.h>
 #include <itkImageFileReader.h>
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionConstIterator.h>
-
+#include "itkLabelStatisticsCalculator.h"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+
+typedef itk::Image<unsigned short,3> LabelImageType;
+typedef itk::Image<float,3> ImageType;
+typedef itk::LabelStatisticsCalculator<ImageType, LabelImageType> CalculatorType;
+typedef CalculatorType::Statistics StatisticsType;
 
 void Usage(char *exec)
 {
@@ -22,9 +28,92 @@ void Usage(char *exec)
     std::cout << " " << exec << " [-i image -l label map ]" << std::endl;
     std::cout << "**********************************************************" <<std::endl;
     std::cout << "Options:" <<std::endl;
-    std::cout << "-o <file> \t Output file with results (printed on screen default)" << std::endl;
+    std::cout << "-o <file> \t Output file with results (printed on screen default), as \"min; <value>\" lines," << std::endl;
+    std::cout << "\t\t or per label in CSV or JSON if <file> ends in .csv or .json" << std::endl;
     std::cout << "-b <int> \t Background label" << std::endl;
-    std::cout << "-f <int> \t Foreground label from where to do statistics (default is 1 but not used at the moment)" << std::endl;
+    std::cout << "-f <int> \t Foreground label from where to do statistics (default is every label but the background)" << std::endl;
+    std::cout << "-hist <bins> <min> <max> \t Histogram of every label over [min, max]" << std::endl;
+    std::cout << "-p <p1,p2,...> \t Percentiles to report (0-100), estimated from the histogram (needs -hist)" << std::endl;
+}
+
+bool EndsWith(const std::string & str, const std::string & suffix)
+{
+    return str.length() >= suffix.length()
+            && str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+/**
+ * Summary of the selected labels together, one "<name><separator><value>"
+ * line per statistic.
+ */
+void WriteSummary(std::ostream & out, const CalculatorType * calculator, const StatisticsType & total,
+                  const std::vector<double> & percentiles, const char * separator)
+{
+    out << "min" << separator << total.Min << std::endl;
+    out << "max" << separator << total.Max << std::endl;
+    out << "mean" << separator << total.Mean << std::endl;
+    out << "sigma" << separator << sqrt(total.GetVariance()) << std::endl;
+    out << "variance" << separator << total.GetVariance() << std::endl;
+    out << "volume" << separator << total.Count << std::endl;
+    for (unsigned int k = 0; k < percentiles.size(); ++k)
+        out << "p" << percentiles[k] << separator << calculator->GetPercentile(total, percentiles[k]) << std::endl;
+}
+
+void WriteCSV(std::ostream & out, const CalculatorType * calculator,
+              const std::vector<unsigned int> & labels,
+              const std::vector<double> & percentiles)
+{
+    out << "label,count,min,max,mean,sigma,variance,sum";
+    for (unsigned int k = 0; k < percentiles.size(); ++k)
+        out << ",p" << percentiles[k];
+    out << std::endl;
+
+    for (unsigned int i = 0; i < labels.size(); ++i)
+    {
+        const StatisticsType & s = calculator->GetStatistics().find(labels[i])->second;
+        out << labels[i] << "," << s.Count << "," << s.Min << "," << s.Max << "," << s.Mean
+            << "," << sqrt(s.GetVariance()) << "," << s.GetVariance() << "," << s.GetSum();
+        for (unsigned int k = 0; k < percentiles.size(); ++k)
+            out << "," << calculator->GetPercentile(s, percentiles[k]);
+        out << std::endl;
+    }
+}
+
+void WriteJSON(std::ostream & out, const CalculatorType * calculator,
+               const std::vector<unsigned int> & labels,
+               const std::vector<double> & percentiles)
+{
+    out << "{" << std::endl << "  \"labels\": [";
+    for (unsigned int i = 0; i < labels.size(); ++i)
+    {
+        const StatisticsType & s = calculator->GetStatistics().find(labels[i])->second;
+        out << (i == 0 ? "" : ",") << std::endl;
+        out << "    {\"label\": " << labels[i] << ", \"count\": " << s.Count
+            << ", \"min\": " << s.Min << ", \"max\": " << s.Max << ", \"mean\": " << s.Mean
+            << ", \"sigma\": " << sqrt(s.GetVariance()) << ", \"variance\": " << s.GetVariance()
+            << ", \"sum\": " << s.GetSum();
+        if (!s.Histogram.empty())
+        {
+            out << ", \"histogram\": [";
+            for (unsigned int b = 0; b < s.Histogram.size(); ++b)
+                out << (b == 0 ? "" : ", ") << s.Histogram[b];
+            out << "]";
+        }
+        if (!percentiles.empty())
+        {
+            out << ", \"percentiles\": {";
+            for (unsigned int k = 0; k < percentiles.size(); ++k)
+                out << (k == 0 ? "" : ", ") << "\"" << percentiles[k] << "\": "
+                    << calculator->GetPercentile(s, percentiles[k]);
+            out << "}";
+        }
+        out << "}";
+    }
+    out << std::endl << "  ]";
+    if (calculator->GetNumberOfBins() > 0)
+        out << "," << std::endl << "  \"histogram_range\": [" << calculator->GetHistogramMinimum()
+            << ", " << calculator->GetHistogramMaximum() << "]";
+    out << std::endl << "}" << std::endl;
 }
 
 int main( int argc, char * argv[] )
@@ -33,7 +122,10 @@ int main( int argc, char * argv[] )
     std::string map;
     std::string outputFileName;
     unsigned int bck = 0;
-    unsigned int fore = 1;
+    int fore = -1;
+    unsigned int bins = 0;
+    double hmin = 0, hmax = 0;
+    std::vector<double> percentiles;
 
     for(int i=1; i < argc; i++)
     {
@@ -69,6 +161,21 @@ int main( int argc, char * argv[] )
             fore=atoi(argv[++i]);
             std::cout << "Set --f=" << fore << std::endl;
         }
+        else if(strcmp(argv[i], "-hist") == 0)
+        {
+            bins=atoi(argv[++i]);
+            hmin=atof(argv[++i]);
+            hmax=atof(argv[++i]);
+            std::cout << "Set --hist=" << bins << " [" << hmin << ", " << hmax << "]" << std::endl;
+        }
+        else if(strcmp(argv[i], "-p") == 0)
+        {
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ','))
+                percentiles.push_back(atof(item.c_str()));
+            std::cout << "Set --p=" << argv[i] << std::endl;
+        }
         else
         {
             std::cout << "Error in arguments" << std::endl;
@@ -83,9 +190,12 @@ int main( int argc, char * argv[] )
       Usage(argv[0]);
       return EXIT_FAILURE;
     }
+    if (!percentiles.empty() && bins == 0)
+    {
+      std::cout << "Percentiles need a histogram (-hist)" << std::endl;
+      return EXIT_FAILURE;
+    }
 
-    typedef itk::Image<unsigned char,3> LabelImageType;
-    typedef itk::Image<float,3> ImageType;
     typedef itk::ImageFileReader<ImageType> ImageReaderType;
     typedef itk::ImageFileReader<LabelImageType> LabelReaderType;
 
@@ -93,76 +203,76 @@ int main( int argc, char * argv[] )
     labelreader->SetFileName( map );
     ImageReaderType::Pointer imagereader = ImageReaderType::New();
     imagereader->SetFileName ( image );
-    labelreader->Update();
-    imagereader->Update();
-
-    LabelImageType::Pointer mask_image = labelreader->GetOutput();
-    ImageType::Pointer in_img = imagereader->GetOutput();
-
-    itk::ImageRegionConstIterator<LabelImageType> maskIterator(mask_image,
-                                                            in_img->GetLargestPossibleRegion());
-    itk::ImageRegionIterator<ImageType> inimageIterator(in_img,
-                                                          in_img->GetLargestPossibleRegion());
-
-    ImageType::PixelType min_val = itk::NumericTraits< ImageType::PixelType >::max() ;
-    ImageType::PixelType max_val = itk::NumericTraits< ImageType::PixelType >::min() ;
-    float mean = 0;
-    float variance = 0;
-    unsigned long volume = 0;
-    while(!inimageIterator.IsAtEnd())
+
+    CalculatorType::Pointer calculator = CalculatorType::New();
+    try
     {
-        if (maskIterator.Get() != bck)
-        {
-            if (inimageIterator.Get() < min_val)
-                min_val = inimageIterator.Get();
-            if (inimageIterator.Get() > max_val)
-                max_val = inimageIterator.Get();
-            mean += inimageIterator.Get();
-            volume++;
-        }
-        ++maskIterator;
-        ++inimageIterator;
-    }
-    mean /= volume;
+        labelreader->Update();
+        imagereader->Update();
 
-    inimageIterator.GoToBegin();
-    maskIterator.GoToBegin();
-    while(!inimageIterator.IsAtEnd())
+        calculator->SetImage( imagereader->GetOutput() );
+        calculator->SetLabelImage( labelreader->GetOutput() );
+        calculator->SetBackgroundValue( bck );
+        if (bins > 0)
+            calculator->SetHistogram( bins, hmin, hmax );
+        calculator->Compute();
+    }
+    catch (itk::ExceptionObject & err)
     {
-        if (maskIterator.Get() != bck)
-            variance += ((inimageIterator.Get() - mean) *  (inimageIterator.Get() - mean));
-        ++maskIterator;
-        ++inimageIterator;
+        std::cerr << "ExceptionObject caught !" << std::endl;
+        std::cerr << err << std::endl;
+        return EXIT_FAILURE;
     }
-    variance /= (volume -1);
-    float std = sqrt(variance);
+
+    std::vector<unsigned int> labels;
+    CalculatorType::StatisticsMapType::const_iterator it;
+    for (it = calculator->GetStatistics().begin(); it != calculator->GetStatistics().end(); ++it)
+        if (fore < 0 || it->first == static_cast<unsigned int>(fore))
+            labels.push_back(it->first);
+
+    //Same summary as always, over every reported label together
+    StatisticsType total;
+    if (fore < 0)
+        total = calculator->GetTotal();
+    else if (!labels.empty())
+        total = calculator->GetStatistics().find(labels[0])->second;
+    else
+        total.Count = 0;
 
     if (outputFileName == "")
     {
-      std::cout << "min: " << min_val << std::endl;
-      std::cout << "max: " << max_val << std::endl;
-      std::cout << "mean: " << mean << std::endl;
-      std::cout << "sigma: " << std << std::endl;
-      std::cout << "variance: " << variance<< std::endl;
-      std::cout << "volume: " << volume << std::endl; //Not sure it is working properly
+      if (total.Count == 0)
+      {
+          std::cout << "No voxels in the selected labels" << std::endl;
+          return EXIT_FAILURE;
+      }
 
+      WriteSummary(std::cout, calculator, total, percentiles, ": ");
+      if (labels.size() > 1)
+      {
+          std::cout << std::endl;
+          WriteCSV(std::cout, calculator, labels, percentiles);
+      }
       std::cout << std::endl;
     }
     else
     {
         std::ofstream a_file;
         a_file.open (outputFileName.c_str());
-        a_file << "min; " << min_val<< std::endl;
-        a_file << "max; " << max_val << std::endl;
-        a_file << "mean; " << mean << std::endl;
-        a_file << "sigma; " << std << std::endl;
-        a_file << "variance; " << variance << std::endl;
-        a_file << "volume; " << volume << std::endl; //Not sure it is working properly
-
+        if (EndsWith(outputFileName, ".json"))
+        {
+            a_file.precision(10);
+            WriteJSON(a_file, calculator, labels, percentiles);
+        }
+        else if (EndsWith(outputFileName, ".csv"))
+        {
+            a_file.precision(10);
+            WriteCSV(a_file, calculator, labels, percentiles);
+        }
+        else
+            WriteSummary(a_file, calculator, total, percentiles, "; ");
         a_file.close();
     }
 
-
-
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,108 @@
+/**
+  * local_thickness.cpp
+  * Given a vessel segmentation (e.g. the output of seg_withhisto), it
+  * computes the local thickness map of the vessels, in voxels. This replaces
+  * ImageJ/ThicknessScript.bsh (Fiji's Local Thickness followed by
+  * Clean_Up_Local_Thickness) without the JVM.
+  */
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+
+#include "itkLocalThicknessImageFilter.h"
+
+
+void Usage(char *exec)
+{
+  std::cout << " " << std::endl;
+  std::cout << "Computes the local thickness (diameter of the largest inscribed sphere) of a segmentation." << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << " " << exec << " [-i inputFileName -o outputFileName -t threshold -nocleanup]" << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << "*** [options]" << std::endl;
+  std::cout << "    -t <int>     Voxels >= threshold are the structure [254]" << std::endl;
+  std::cout << "    -nocleanup   Keep the raw values on the boundary of the structure" << std::endl;
+  std::cout << " " << std::endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  std::string inputImageName;
+  std::string outputImageName;
+  int threshold = 254;
+  bool cleanUp = true;
+
+  for(int i=1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0)
+    {
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-i") == 0)
+    {
+      inputImageName=argv[++i];
+      std::cout << "Set -i=" << inputImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "-o") == 0)
+    {
+      outputImageName=argv[++i];
+      std::cout << "Set -o=" << outputImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "-t") == 0)
+    {
+      threshold=atoi(argv[++i]);
+      std::cout << "Set -t=" << threshold << std::endl;
+    }
+    else if(strcmp(argv[i], "-nocleanup") == 0)
+    {
+      cleanUp=false;
+      std::cout << "Set -nocleanup" << std::endl;
+    }
+    else
+    {
+      std::cout << "Error in arguments" << std::endl;
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Validate command line args
+  if (inputImageName.length() == 0 || outputImageName.length() == 0)
+  {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const unsigned int Dimension = 3;
+  typedef short InputPixelType;
+  typedef float OutputPixelType;
+
+  typedef itk::Image< InputPixelType, Dimension > InputImageType;
+  typedef itk::Image< OutputPixelType, Dimension > OutputImageType;
+  typedef itk::ImageFileReader< InputImageType > ReaderType;
+  typedef itk::ImageFileWriter< OutputImageType > WriterType;
+  typedef itk::LocalThicknessImageFilter< InputImageType, OutputImageType > ThicknessFilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( inputImageName );
+
+  ThicknessFilterType::Pointer thickness = ThicknessFilterType::New();
+  thickness->SetInput( reader->GetOutput() );
+  thickness->SetThreshold( threshold );
+  thickness->SetCleanUp( cleanUp );
+
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( thickness->GetOutput() );
+  writer->SetFileName( outputImageName );
+
+  try
+  {
+    writer->Update();
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << "Failed: " << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
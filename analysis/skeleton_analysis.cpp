@@ -0,0 +1,193 @@
+/**
+  * skeleton_analysis.cpp
+  * Measures a centreline image (e.g. the output of vessel_skeleton) and writes
+  * the two tables of Fiji's AnalyzeSkeleton, as produced by ImageJ/SkeletonScript.bsh:
+  * one row per skeleton and one row per branch.
+  * For a block of a volume split by split_volume, the descriptor restricts the
+  * analysis to the core of the block, and the graph can be saved for
+  * skeleton_stitch.
+  */
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include "itkSkeletonAnalysisCalculator.h"
+#include "itkImageBlockGrid.h"
+
+#include <iostream>
+#include <fstream>
+
+void Usage(char *exec)
+{
+    std::cout << " " << std::endl;
+    std::cout << "Builds the graph of a skeleton and writes its statistics as CSV tables." << std::endl;
+    std::cout << " " << exec << " [-i skeleton -s skeleton table -b branch table]" << std::endl;
+    std::cout << "**********************************************************" <<std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "-g <file> \t Image from which the branch intensities are read (default is the skeleton)" << std::endl;
+    std::cout << "-d <file> \t Descriptor written by split_volume: only the core of the block whose file name ends the skeleton file name is analysed" << std::endl;
+    std::cout << "-graph <file> \t Saves the graph, e.g. for skeleton_stitch" << std::endl;
+}
+
+int main( int argc, char * argv[] )
+{
+    std::string skeleton;
+    std::string intensity;
+    std::string skeletonTableName;
+    std::string branchTableName;
+    std::string descriptorFileName;
+    std::string graphFileName;
+
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0
+                || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0
+                || strcmp(argv[i], "--h")==0)
+        {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[i], "-i") == 0)
+        {
+            skeleton=argv[++i];
+            std::cout << "Set --i=" << skeleton << std::endl;
+        }
+        else if(strcmp(argv[i], "-g") == 0)
+        {
+            intensity=argv[++i];
+            std::cout << "Set --g=" << intensity << std::endl;
+        }
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            skeletonTableName=argv[++i];
+            std::cout << "Set --s=" << skeletonTableName << std::endl;
+        }
+        else if(strcmp(argv[i], "-b") == 0)
+        {
+            branchTableName=argv[++i];
+            std::cout << "Set --b=" << branchTableName << std::endl;
+        }
+        else if(strcmp(argv[i], "-d") == 0)
+        {
+            descriptorFileName=argv[++i];
+            std::cout << "Set --d=" << descriptorFileName << std::endl;
+        }
+        else if(strcmp(argv[i], "-graph") == 0)
+        {
+            graphFileName=argv[++i];
+            std::cout << "Set --graph=" << graphFileName << std::endl;
+        }
+        else
+        {
+            std::cout << "Error in arguments" << std::endl;
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Validate command line args
+    if (skeleton.length() == 0 || skeletonTableName.length() == 0 || branchTableName.length() == 0)
+    {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    typedef itk::Image<unsigned char,3> SkeletonImageType;
+    typedef itk::Image<float,3> ImageType;
+    typedef itk::ImageFileReader<SkeletonImageType> SkeletonReaderType;
+    typedef itk::ImageFileReader<ImageType> ImageReaderType;
+    typedef itk::SkeletonAnalysisCalculator<SkeletonImageType, ImageType> CalculatorType;
+
+    SkeletonReaderType::Pointer skeletonreader = SkeletonReaderType::New();
+    skeletonreader->SetFileName( skeleton );
+    ImageReaderType::Pointer imagereader = ImageReaderType::New();
+
+    CalculatorType::Pointer calculator = CalculatorType::New();
+    try
+    {
+        skeletonreader->Update();
+        calculator->SetSkeletonImage( skeletonreader->GetOutput() );
+        if (intensity.length() > 0)
+        {
+            imagereader->SetFileName( intensity );
+            imagereader->Update();
+            calculator->SetIntensityImage( imagereader->GetOutput() );
+        }
+        if (descriptorFileName.length() > 0)
+        {
+            //The block is the one whose file name ends the skeleton file name
+            itk::ImageBlockGrid::Pointer grid = itk::ImageBlockGrid::New();
+            grid->ReadDescriptor( descriptorFileName );
+            grid->ComputeCores();
+            const std::string::size_type slash = skeleton.find_last_of("/\\");
+            const std::string skeletonName = skeleton.substr(slash == std::string::npos ? 0 : slash + 1);
+            unsigned int b = 0;
+            for (; b < grid->GetNumberOfBlocks(); ++b)
+            {
+                const std::string & blockFileName = grid->GetBlock(b).FileName;
+                const std::string::size_type blockSlash = blockFileName.find_last_of("/\\");
+                const std::string blockName = blockFileName.substr(blockSlash == std::string::npos ? 0 : blockSlash + 1);
+                if (skeletonName.length() >= blockName.length()
+                    && skeletonName.compare(skeletonName.length() - blockName.length(), blockName.length(), blockName) == 0)
+                    break;
+            }
+            if (b == grid->GetNumberOfBlocks())
+            {
+                std::cerr << "No block of " << descriptorFileName << " matches " << skeleton << std::endl;
+                return EXIT_FAILURE;
+            }
+            const itk::ImageBlockGrid::Block & block = grid->GetBlock(b);
+            SkeletonImageType::RegionType core;
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+                core.SetIndex(d, skeletonreader->GetOutput()->GetLargestPossibleRegion().GetIndex()[d]
+                              + block.CoreIndex[d] - block.Index[d]);
+                core.SetSize(d, block.CoreSize[d]);
+            }
+            calculator->SetCoreRegion( core );
+        }
+        calculator->Compute();
+        if (graphFileName.length() > 0)
+            calculator->GetGraph()->Write( graphFileName );
+    }
+    catch (itk::ExceptionObject & err)
+    {
+        std::cerr << "ExceptionObject caught !" << std::endl;
+        std::cerr << err << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const CalculatorType::SkeletonStatisticsContainerType & skeletons = calculator->GetSkeletonStatistics();
+    std::ofstream skeleton_file;
+    skeleton_file.open (skeletonTableName.c_str());
+    skeleton_file << "Skeleton,# Branches,# Junctions,# End-point voxels,# Junction voxels,# Slab voxels,"
+                  << "Average Branch Length,# Triple points,# Quadruple points,Maximum Branch Length,"
+                  << "Longest Shortest Path,spx,spy,spz" << std::endl;
+    for (unsigned int t = 0; t < skeletons.size(); ++t)
+    {
+        const CalculatorType::SkeletonStatistics & s = skeletons[t];
+        skeleton_file << t + 1 << "," << s.Branches << "," << s.Junctions << "," << s.EndPointVoxels
+                      << "," << s.JunctionVoxels << "," << s.SlabVoxels << "," << s.AverageBranchLength
+                      << "," << s.TriplePoints << "," << s.QuadruplePoints << "," << s.MaximumBranchLength
+                      << "," << s.LongestShortestPath << "," << s.ShortestPathStart[0]
+                      << "," << s.ShortestPathStart[1] << "," << s.ShortestPathStart[2] << std::endl;
+    }
+    skeleton_file.close();
+
+    const CalculatorType::BranchStatisticsContainerType & branches = calculator->GetBranchStatistics();
+    std::ofstream branch_file;
+    branch_file.open (branchTableName.c_str());
+    branch_file << "Branch,Skeleton ID,Branch length,V1 x,V1 y,V1 z,V2 x,V2 y,V2 z,Euclidean distance,"
+                << "running average length,average intensity (inner 3rd),average intensity" << std::endl;
+    for (unsigned int b = 0; b < branches.size(); ++b)
+    {
+        const CalculatorType::BranchStatistics & e = branches[b];
+        branch_file << b + 1 << "," << e.Skeleton << "," << e.Length
+                    << "," << e.V1[0] << "," << e.V1[1] << "," << e.V1[2]
+                    << "," << e.V2[0] << "," << e.V2[1] << "," << e.V2[2]
+                    << "," << e.EuclideanDistance << "," << e.RunningAverageLength
+                    << "," << e.AverageIntensityInnerThird << "," << e.AverageIntensity << std::endl;
+    }
+    branch_file.close();
+
+    std::cout << skeletons.size() << " skeletons, " << branches.size() << " branches" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/**
+  * skeleton_stitch.cpp
+  * Joins the skeleton graphs saved by skeleton_analysis -d ... -graph for
+  * every block of a volume split by split_volume into the graph of the whole
+  * volume, and writes the tables of skeleton_analysis for it. Positions are
+  * in mm from the first voxel of the whole volume.
+  */
+#include "itkSkeletonGraphStitcher.h"
+
+#include <iostream>
+#include <fstream>
+
+void Usage(char *exec)
+{
+    std::cout << " " << std::endl;
+    std::cout << "Joins the skeleton graphs of the blocks of a split volume and writes their statistics as CSV tables." << std::endl;
+    std::cout << " " << exec << " [-d descriptor -p graph prefix -s skeleton table -b branch table]" << std::endl;
+    std::cout << "**********************************************************" <<std::endl;
+    std::cout << "Options:" <<std::endl;
+    std::cout << "-p <prefix> \t The graph of block n is <prefix> followed by the file name of block n in the descriptor, without extension, and .skg" << std::endl;
+    std::cout << "-o <file> \t Saves the joined graph" << std::endl;
+    std::cout << "-t <float> \t Largest distance in voxels between matching crossings of neighbouring blocks (default 2)" << std::endl;
+    std::cout << "The branch table has no running average length nor inner third intensity" << std::endl;
+}
+
+int main( int argc, char * argv[] )
+{
+    std::string descriptorFileName;
+    std::string graphPrefix;
+    std::string outputGraphName;
+    std::string skeletonTableName;
+    std::string branchTableName;
+    double tolerance = 2.0;
+
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0
+                || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0
+                || strcmp(argv[i], "--h")==0)
+        {
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[i], "-d") == 0)
+        {
+            descriptorFileName=argv[++i];
+            std::cout << "Set --d=" << descriptorFileName << std::endl;
+        }
+        else if(strcmp(argv[i], "-p") == 0)
+        {
+            graphPrefix=argv[++i];
+            std::cout << "Set --p=" << graphPrefix << std::endl;
+        }
+        else if(strcmp(argv[i], "-o") == 0)
+        {
+            outputGraphName=argv[++i];
+            std::cout << "Set --o=" << outputGraphName << std::endl;
+        }
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            skeletonTableName=argv[++i];
+            std::cout << "Set --s=" << skeletonTableName << std::endl;
+        }
+        else if(strcmp(argv[i], "-b") == 0)
+        {
+            branchTableName=argv[++i];
+            std::cout << "Set --b=" << branchTableName << std::endl;
+        }
+        else if(strcmp(argv[i], "-t") == 0)
+        {
+            tolerance=atof(argv[++i]);
+            std::cout << "Set --t=" << tolerance << std::endl;
+        }
+        else
+        {
+            std::cout << "Error in arguments" << std::endl;
+            Usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Validate command line args
+    if (descriptorFileName.length() == 0 || skeletonTableName.length() == 0 || branchTableName.length() == 0)
+    {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    typedef itk::SkeletonGraphStitcher StitcherType;
+    StitcherType::Pointer stitcher = StitcherType::New();
+    try
+    {
+        itk::ImageBlockGrid::Pointer grid = itk::ImageBlockGrid::New();
+        grid->ReadDescriptor( descriptorFileName );
+        grid->ComputeCores();
+
+        std::vector< std::string > graphFileNames;
+        for (unsigned int b = 0; b < grid->GetNumberOfBlocks(); ++b)
+        {
+            const std::string & blockFileName = grid->GetBlock(b).FileName;
+            const std::string::size_type slash = blockFileName.find_last_of("/\\");
+            std::string name = blockFileName.substr(slash == std::string::npos ? 0 : slash + 1);
+            const std::string::size_type dot = name.find_last_of('.');
+            if (dot != std::string::npos)
+                name = name.substr(0, dot);
+            graphFileNames.push_back(graphPrefix + name + ".skg");
+        }
+
+        stitcher->SetGrid( grid );
+        stitcher->SetGraphFileNames( graphFileNames );
+        stitcher->SetTolerance( tolerance );
+        stitcher->Compute();
+        if (outputGraphName.length() > 0)
+            stitcher->GetGraph()->Write( outputGraphName );
+    }
+    catch (itk::ExceptionObject & err)
+    {
+        std::cerr << "ExceptionObject caught !" << std::endl;
+        std::cerr << err << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const StitcherType::SkeletonStatisticsContainerType & skeletons = stitcher->GetSkeletonStatistics();
+    std::ofstream skeleton_file;
+    skeleton_file.open (skeletonTableName.c_str());
+    skeleton_file << "Skeleton,# Branches,# Junctions,# End-point voxels,# Junction voxels,# Slab voxels,"
+                  << "Average Branch Length,# Triple points,# Quadruple points,Maximum Branch Length,"
+                  << "Longest Shortest Path,spx,spy,spz" << std::endl;
+    for (unsigned int t = 0; t < skeletons.size(); ++t)
+    {
+        const StitcherType::SkeletonStatistics & s = skeletons[t];
+        skeleton_file << t + 1 << "," << s.Branches << "," << s.Junctions << "," << s.EndPointVoxels
+                      << "," << s.JunctionVoxels << "," << s.SlabVoxels << "," << s.AverageBranchLength
+                      << "," << s.TriplePoints << "," << s.QuadruplePoints << "," << s.MaximumBranchLength
+                      << "," << s.LongestShortestPath << "," << s.ShortestPathStart[0]
+                      << "," << s.ShortestPathStart[1] << "," << s.ShortestPathStart[2] << std::endl;
+    }
+    skeleton_file.close();
+
+    const StitcherType::BranchStatisticsContainerType & branches = stitcher->GetBranchStatistics();
+    std::ofstream branch_file;
+    branch_file.open (branchTableName.c_str());
+    branch_file << "Branch,Skeleton ID,Branch length,V1 x,V1 y,V1 z,V2 x,V2 y,V2 z,Euclidean distance,"
+                << "average intensity" << std::endl;
+    for (unsigned int b = 0; b < branches.size(); ++b)
+    {
+        const StitcherType::BranchStatistics & e = branches[b];
+        branch_file << b + 1 << "," << e.Skeleton << "," << e.Length
+                    << "," << e.V1[0] << "," << e.V1[1] << "," << e.V1[2]
+                    << "," << e.V2[0] << "," << e.V2[1] << "," << e.V2[2]
+                    << "," << e.EuclideanDistance << "," << e.AverageIntensity << std::endl;
+    }
+    branch_file.close();
+
+    std::cout << skeletons.size() << " skeletons, " << branches.size() << " branches, "
+              << stitcher->GetNumberOfUnmatchedCrossings() << " unmatched crossings" << std::endl;
+    return EXIT_SUCCESS;
+}
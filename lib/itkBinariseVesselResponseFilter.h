@@ -17,14 +17,21 @@
 
 #include <itkImageToImageFilter.h>
 #include <itkMacro.h>
-#include <itkRelabelComponentImageFilter.h>
-#include <itkConnectedComponentImageFilter.h>
-#include <itkNormalizeImageFilter.h>
-#include <itkBinaryThresholdImageFilter.h>
+#include <itkStatisticsImageFilter.h>
+#include "itkParallelConnectedComponentImageFilter.h"
 
 namespace itk {
 /** \class BinariseVesselResponseFilter
  * \brief Binarises the vesselness response and keeps the largest objects.
+ *
+ * The thresholds are given on the normalised response (zero mean, unit
+ * variance). They are mapped back to input intensities so the labelling
+ * runs directly on the input, and objects smaller than Percentage times the
+ * largest one are dropped from the size table of that single pass.
+ *
+ * With UseSeedThreshold on, the binarisation is a hysteresis: LowThreshold
+ * is the continuation level and only the objects reaching SeedThreshold
+ * (also normalised) are kept.
  */
 template < class TInputImage, class TOutputImage >
 class ITK_EXPORT BinariseVesselResponseFilter :
@@ -61,6 +68,12 @@ public:
   itkSetMacro(UpThreshold, InputPixelType);
   itkSetMacro(Percentage, float);
 
+  itkGetConstMacro(SeedThreshold, InputPixelType);
+  itkSetMacro(SeedThreshold, InputPixelType);
+  itkGetConstMacro(UseSeedThreshold, bool);
+  itkSetMacro(UseSeedThreshold, bool);
+  itkBooleanMacro(UseSeedThreshold);
+
 protected:
   BinariseVesselResponseFilter();
   ~BinariseVesselResponseFilter() {};
@@ -69,16 +82,16 @@ protected:
   /** Generate the output data. */
   virtual void GenerateData();
 
-  typedef double                                             InternalPixelType;
-  typedef Image<InternalPixelType,ImageDimension>            InternalImageType;
-  typedef itk::NormalizeImageFilter< InputImageType,
-                                          InternalImageType >NormalizerType;
-  typedef itk::BinaryThresholdImageFilter< InternalImageType, OutputImageType > ThresholdFilter;
-  typedef itk::BinaryThresholdImageFilter <OutputImageType,
-                                        OutputImageType>  BinaryLabelThresholdImageFilterType;
-  typedef itk::ConnectedComponentImageFilter <OutputImageType, OutputImageType >
-                                                            ConnectedComponentImageFilterType;
-  typedef itk::RelabelComponentImageFilter<OutputImageType, OutputImageType >  RelabelFilterType;
+  /** Mean and deviation of the input, as used by the normalisation. */
+  void ComputeNormalisation(double & mean, double & sigma);
+
+  /** Maps a normalised threshold to the input intensity range. */
+  InputPixelType NormalisedToInput(double value, double mean, double sigma,
+                                   bool lower) const;
+
+  typedef itk::StatisticsImageFilter< InputImageType >     StatisticsFilterType;
+  typedef itk::ParallelConnectedComponentImageFilter< InputImageType,
+                                          OutputImageType > LabelFilterType;
 
 private:
   BinariseVesselResponseFilter(const Self&); //purposely not implemented
@@ -87,6 +100,8 @@ private:
   InputPixelType  m_LowThreshold;
   InputPixelType  m_UpThreshold;
   float           m_Percentage;
+  InputPixelType  m_SeedThreshold;
+  bool            m_UseSeedThreshold;
 };
 
 } //end namespace
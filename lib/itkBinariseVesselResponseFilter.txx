@@ -2,7 +2,10 @@
 #define ITKBINARISEVESSELRESPONSEFILTER_TXX
 
 #include "itkBinariseVesselResponseFilter.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
 #include <limits>
+#include <math.h>
 
 namespace itk {
 
@@ -10,57 +13,62 @@ template<class TInputImage, class TOutputImage>
 BinariseVesselResponseFilter<TInputImage, TOutputImage>::BinariseVesselResponseFilter()
 {
   m_LowThreshold = 5;
-  m_UpThreshold = static_cast<InternalPixelType>(std::numeric_limits<InputPixelType>::max());
+  m_UpThreshold = static_cast<InputPixelType>(std::numeric_limits<InputPixelType>::max());
   m_Percentage = 0.001;
+  m_SeedThreshold = m_UpThreshold;
+  m_UseSeedThreshold = false;
 }
 
 template<class TInputImage, class TOutputImage>
 void BinariseVesselResponseFilter<TInputImage, TOutputImage>::GenerateData()
 {
-  typename NormalizerType::Pointer normaliser = NormalizerType::New();
-  typename ThresholdFilter::Pointer threshfilter = ThresholdFilter::New();
-  typename ConnectedComponentImageFilterType::Pointer labelFilter
-                                = ConnectedComponentImageFilterType::New ();
-  typename RelabelFilterType::Pointer relabelfilter = RelabelFilterType::New();
+  double mean, sigma;
+  this->ComputeNormalisation(mean, sigma);
 
-  //Wire up
-  normaliser->SetInput( this->GetInput() );
-  threshfilter->SetInput( normaliser->GetOutput() );
-  labelFilter->SetInput( threshfilter->GetOutput() );
-  relabelfilter->SetInput(labelFilter->GetOutput());
+  //Threshold, label and prune in one pass
+  typename LabelFilterType::Pointer labelFilter = LabelFilterType::New();
+  labelFilter->SetInput( this->GetInput() );
+  labelFilter->SetLowerThreshold( this->NormalisedToInput(m_LowThreshold, mean, sigma, true) );
+  labelFilter->SetUpperThreshold( this->NormalisedToInput(m_UpThreshold, mean, sigma, false) );
+  if (m_UseSeedThreshold)
+  {
+    labelFilter->SetSeedThreshold( this->NormalisedToInput(m_SeedThreshold, mean, sigma, true) );
+    labelFilter->UseSeedThresholdOn();
+  }
+  labelFilter->SetMinimumRelativeObjectSize( m_Percentage );
+  labelFilter->SetNumberOfThreads( this->GetNumberOfThreads() );
+  labelFilter->Update();
 
-  //param setting
-  threshfilter->SetLowerThreshold( m_LowThreshold );
-  threshfilter->SetUpperThreshold( m_UpThreshold );
-  threshfilter->SetOutsideValue( 0 );
-  threshfilter->SetInsideValue( 255 );
-
-  //execute
-  relabelfilter->Update();
+  this->GraftOutput( labelFilter->GetOutput() );
+}
 
-  //and resettle things an re-execute
-  unsigned long largerElement = (relabelfilter->GetSizeOfObjectsInPixels())[0];
-  unsigned long thres_vol = static_cast<OutputPixelType>(floor(m_Percentage * largerElement) );
-  relabelfilter->SetMinimumObjectSize( thres_vol );
-  relabelfilter->Update();
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseFilter<TInputImage, TOutputImage>
+::ComputeNormalisation(double & mean, double & sigma)
+{
+  typename StatisticsFilterType::Pointer stats = StatisticsFilterType::New();
+  stats->SetInput( this->GetInput() );
+  stats->SetNumberOfThreads( this->GetNumberOfThreads() );
+  stats->Update();
 
-  //Unify output
-  unsigned int elems = relabelfilter->GetNumberOfObjects() ;
-//  if (elems > 1)
-//  {
-//    typename BinaryLabelThresholdImageFilterType::Pointer thresholdfilter =
-//                              BinaryLabelThresholdImageFilterType::New();
-//    thresholdfilter->SetInput( relabelfilter->GetOutput() );
-//    thresholdfilter->SetLowerThreshold( 1 );
-//    thresholdfilter->SetUpperThreshold( elems );
-//    thresholdfilter->SetInsideValue( 1 );
-//    thresholdfilter->SetOutsideValue( 0 );
-//    thresholdfilter->Update();
-//    this->GraftOutput( thresholdfilter->GetOutput() );
-//  }
-//  else
-    this->GraftOutput( relabelfilter->GetOutput() );
+  mean = stats->GetMean();
+  sigma = stats->GetSigma();
+  if (sigma == 0)
+    sigma = 1;
+}
 
+template<class TInputImage, class TOutputImage>
+typename BinariseVesselResponseFilter<TInputImage, TOutputImage>::InputPixelType
+BinariseVesselResponseFilter<TInputImage, TOutputImage>
+::NormalisedToInput(double value, double mean, double sigma, bool lower) const
+{
+  const double minValue = static_cast<double>(NumericTraits<InputPixelType>::NonpositiveMin());
+  const double maxValue = static_cast<double>(NumericTraits<InputPixelType>::max());
+  double v = mean + value * sigma;
+  if (NumericTraits<InputPixelType>::is_integer)
+    v = lower ? ceil(v) : floor(v);
+  v = std::max(minValue, std::min(maxValue, v));
+  return static_cast<InputPixelType>(v);
 }
 
 /* ---------------------------------------------------------------------
@@ -73,6 +81,11 @@ BinariseVesselResponseFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "LowThreshold: " << m_LowThreshold << std::endl;
+  os << indent << "UpThreshold: " << m_UpThreshold << std::endl;
+  os << indent << "Percentage: " << m_Percentage << std::endl;
+  os << indent << "SeedThreshold: " << m_SeedThreshold << std::endl;
+  os << indent << "UseSeedThreshold: " << m_UseSeedThreshold << std::endl;
 }
 
 } // end namespace
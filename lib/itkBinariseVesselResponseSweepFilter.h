@@ -0,0 +1,145 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+
+#ifndef ITKBINARISEVESSELRESPONSESWEEPFILTER_H
+#define ITKBINARISEVESSELRESPONSESWEEPFILTER_H
+
+#include "itkBinariseVesselResponseFilter.h"
+#include <itkMultiThreader.h>
+#include <string>
+#include <vector>
+
+namespace itk {
+/** \class BinariseVesselResponseSweepFilter
+ * \brief Binarises the vesselness response at several thresholds at once.
+ *
+ * Output i holds the result BinariseVesselResponseFilter would give with
+ * LowThreshold set to Thresholds[i]. Instead of labelling the image once
+ * per threshold, a component tree (max-tree) of the voxels above the
+ * lowest threshold is built once. Every threshold is then a cut of that
+ * tree: the object sizes are read from the node areas and the labels are
+ * propagated from the cut nodes down to the voxels. The cuts are computed
+ * in parallel, one threshold per thread.
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT BinariseVesselResponseSweepFilter :
+    public BinariseVesselResponseFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef BinariseVesselResponseSweepFilter                        Self;
+  typedef BinariseVesselResponseFilter<TInputImage,TOutputImage>   Superclass;
+  typedef SmartPointer<Self>                                       Pointer;
+  typedef SmartPointer<const Self>                                 ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BinariseVesselResponseSweepFilter, BinariseVesselResponseFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename Superclass::InputPixelType         InputPixelType;
+  typedef typename Superclass::OutputPixelType        OutputPixelType;
+
+  typedef std::vector< double >                       ThresholdContainerType;
+
+  /** Normalised thresholds, one output per threshold. */
+  void SetThresholds(const ThresholdContainerType & thresholds);
+  const ThresholdContainerType & GetThresholds() const
+  { return m_Thresholds; }
+
+protected:
+  BinariseVesselResponseSweepFilter();
+  ~BinariseVesselResponseSweepFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** The tree covers the whole image. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *);
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  /** Builds the max-tree of the voxels in [lower, upper]. */
+  void BuildComponentTree(InputPixelType lower, InputPixelType upper);
+
+  /** Cuts the tree at m_InputThresholds[i] and writes output i. */
+  void ThreadedExtractLevel(unsigned int i);
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Orders voxel offsets by decreasing intensity, then increasing offset. */
+  struct IntensityGreater
+  {
+    const InputPixelType *Buffer;
+    bool operator()(SizeValueType a, SizeValueType b) const
+    {
+      if (Buffer[a] != Buffer[b])
+        return Buffer[a] > Buffer[b];
+      return a < b;
+    }
+  };
+
+  /** Orders tree nodes by decreasing area, then by their first voxel in
+   * raster order, which numbers objects of equal size as
+   * ParallelConnectedComponentImageFilter does. */
+  struct AreaGreater
+  {
+    const std::vector< SizeValueType > *Area;
+    const std::vector< SizeValueType > *FirstVoxel;
+    bool operator()(SizeValueType a, SizeValueType b) const
+    {
+      if ((*Area)[a] != (*Area)[b])
+        return (*Area)[a] > (*Area)[b];
+      return (*FirstVoxel)[a] < (*FirstVoxel)[b];
+    }
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+private:
+  BinariseVesselResponseSweepFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  ThresholdContainerType         m_Thresholds;
+  std::vector< InputPixelType >  m_InputThresholds;
+
+  /** Tree voxels sorted by decreasing intensity; nodes are indices in it. */
+  std::vector< SizeValueType >   m_Order;
+  std::vector< SizeValueType >   m_Parent;
+  std::vector< SizeValueType >   m_Area;
+  /** Lowest voxel offset of the subtree of every node. */
+  std::vector< SizeValueType >   m_FirstVoxel;
+  /** Error of every level, set by the thread that extracts it. */
+  std::vector< std::string >     m_LevelErrors;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBinariseVesselResponseSweepFilter.txx"
+#endif
+
+#endif // ITKBINARISEVESSELRESPONSESWEEPFILTER_H
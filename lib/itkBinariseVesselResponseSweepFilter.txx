@@ -0,0 +1,270 @@
+#ifndef ITKBINARISEVESSELRESPONSESWEEPFILTER_TXX
+#define ITKBINARISEVESSELRESPONSESWEEPFILTER_TXX
+
+#include "itkBinariseVesselResponseSweepFilter.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <sstream>
+#include <math.h>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::BinariseVesselResponseSweepFilter()
+{
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::SetThresholds(const ThresholdContainerType & thresholds)
+{
+  m_Thresholds = thresholds;
+
+  const unsigned int n = std::max<unsigned int>(1, m_Thresholds.size());
+  this->SetNumberOfRequiredOutputs(n);
+  this->SetNumberOfIndexedOutputs(n);
+  for (unsigned int i = 1; i < n; ++i)
+  {
+    if (!this->ProcessObject::GetOutput(i))
+      this->SetNthOutput(i, this->MakeOutput(i));
+  }
+  this->Modified();
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( input )
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(DataObject *)
+{
+  for (unsigned int i = 0; i < this->GetNumberOfIndexedOutputs(); ++i)
+    if (this->GetOutput(i))
+      this->GetOutput(i)->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  if (m_Thresholds.empty())
+    itkExceptionMacro(<< "No thresholds set");
+
+  for (unsigned int i = 0; i < m_Thresholds.size(); ++i)
+  {
+    OutputImagePointer output = this->GetOutput(i);
+    output->SetBufferedRegion( output->GetRequestedRegion() );
+    output->Allocate();
+    output->FillBuffer( NumericTraits<OutputPixelType>::ZeroValue() );
+  }
+
+  double mean, sigma;
+  this->ComputeNormalisation(mean, sigma);
+
+  m_InputThresholds.resize(m_Thresholds.size());
+  for (unsigned int i = 0; i < m_Thresholds.size(); ++i)
+    m_InputThresholds[i] = this->NormalisedToInput(m_Thresholds[i], mean, sigma, true);
+  InputPixelType lower = *std::min_element(m_InputThresholds.begin(), m_InputThresholds.end());
+  InputPixelType upper = this->NormalisedToInput(this->GetUpThreshold(), mean, sigma, false);
+
+  //The tree is built once for the lowest threshold...
+  this->BuildComponentTree(lower, upper);
+
+  //...and every threshold is a cut of it
+  unsigned int numThreads = std::min<unsigned int>(this->GetNumberOfThreads(),
+                                                   m_Thresholds.size());
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(std::max<unsigned int>(1, numThreads));
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+  m_LevelErrors.assign(m_Thresholds.size(), std::string());
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  std::vector< SizeValueType >().swap(m_Order);
+  std::vector< SizeValueType >().swap(m_Parent);
+  std::vector< SizeValueType >().swap(m_Area);
+  std::vector< SizeValueType >().swap(m_FirstVoxel);
+  for (unsigned int i = 0; i < m_LevelErrors.size(); ++i)
+    if (!m_LevelErrors[i].empty())
+      itkExceptionMacro(<< m_LevelErrors[i]);
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::BuildComponentTree(InputPixelType lower, InputPixelType upper)
+{
+  InputImageConstPointer input = this->GetInput();
+  const InputPixelType * in = input->GetBufferPointer();
+  const typename InputImageType::SizeType size = input->GetBufferedRegion().GetSize();
+  const SizeValueType numPixels = input->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType none = NumericTraits<SizeValueType>::max();
+
+  m_Order.clear();
+  for (SizeValueType p = 0; p < numPixels; ++p)
+    if (in[p] >= lower && in[p] <= upper)
+      m_Order.push_back(p);
+
+  IntensityGreater greater;
+  greater.Buffer = in;
+  std::sort(m_Order.begin(), m_Order.end(), greater);
+
+  const SizeValueType numNodes = m_Order.size();
+  std::vector< SizeValueType > rank(numPixels, none);
+  for (SizeValueType i = 0; i < numNodes; ++i)
+    rank[ m_Order[i] ] = i;
+
+  OffsetValueType stride[ImageDimension];
+  stride[0] = 1;
+  for (unsigned int d = 1; d < ImageDimension; ++d)
+    stride[d] = stride[d-1] * size[d-1];
+
+  //Union-find in decreasing intensity: a node becomes the parent of the
+  //trees of its already processed neighbours, so parents always come later
+  m_Parent.resize(numNodes);
+  std::vector< SizeValueType > zpar(numNodes);
+  for (SizeValueType i = 0; i < numNodes; ++i)
+  {
+    m_Parent[i] = i;
+    zpar[i] = i;
+
+    const SizeValueType p = m_Order[i];
+    SizeValueType rest = p;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const SizeValueType c = rest % size[d];
+      rest /= size[d];
+      for (int side = 0; side < 2; ++side)
+      {
+        SizeValueType q;
+        if (side == 0)
+        {
+          if (c == 0)
+            continue;
+          q = p - stride[d];
+        }
+        else
+        {
+          if (c + 1 >= size[d])
+            continue;
+          q = p + stride[d];
+        }
+        SizeValueType r = rank[q];
+        if (r == none || r > i)
+          continue;
+        while (zpar[r] != r)
+        {
+          zpar[r] = zpar[ zpar[r] ];
+          r = zpar[r];
+        }
+        if (r != i)
+        {
+          m_Parent[r] = i;
+          zpar[r] = i;
+        }
+      }
+    }
+  }
+
+  //Children come before their parents, so areas accumulate in one sweep
+  m_Area.assign(numNodes, 1);
+  m_FirstVoxel.assign(m_Order.begin(), m_Order.end());
+  for (SizeValueType i = 0; i < numNodes; ++i)
+    if (m_Parent[i] != i)
+    {
+      m_Area[ m_Parent[i] ] += m_Area[i];
+      m_FirstVoxel[ m_Parent[i] ] = std::min(m_FirstVoxel[ m_Parent[i] ], m_FirstVoxel[i]);
+    }
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  for (unsigned int i = threadId; i < filter->m_Thresholds.size(); i += threadCount)
+    filter->ThreadedExtractLevel(i);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage>
+void BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::ThreadedExtractLevel(unsigned int i)
+{
+  const InputPixelType * in = this->GetInput()->GetBufferPointer();
+  OutputPixelType * out = this->GetOutput(i)->GetBufferPointer();
+  const InputPixelType threshold = m_InputThresholds[i];
+
+  //Nodes above the threshold are a prefix of m_Order
+  SizeValueType end = 0;
+  while (end < m_Order.size() && in[ m_Order[end] ] >= threshold)
+    ++end;
+
+  //The cut nodes are the roots of the objects at this level
+  std::vector< SizeValueType > roots;
+  for (SizeValueType n = 0; n < end; ++n)
+    if (m_Parent[n] == n || m_Parent[n] >= end)
+      roots.push_back(n);
+  if (roots.empty())
+    return;
+
+  AreaGreater greater;
+  greater.Area = &m_Area;
+  greater.FirstVoxel = &m_FirstVoxel;
+  std::sort(roots.begin(), roots.end(), greater);
+
+  const SizeValueType minSize = static_cast<SizeValueType>(
+        floor(this->GetPercentage() * m_Area[ roots[0] ]) );
+  SizeValueType numKept = 0;
+  while (numKept < roots.size() && m_Area[ roots[numKept] ] >= minSize)
+    ++numKept;
+  if (numKept > static_cast<SizeValueType>(NumericTraits<OutputPixelType>::max()))
+  {
+    std::ostringstream error;
+    error << "Number of objects (" << numKept << ") at threshold " << m_Thresholds[i]
+          << " exceeds the output pixel type range";
+    m_LevelErrors[i] = error.str();
+    return;
+  }
+  for (SizeValueType k = 0; k < numKept; ++k)
+    out[ m_Order[ roots[k] ] ] = static_cast<OutputPixelType>(k + 1);
+
+  //Parents come later in m_Order, so a backward sweep labels them first
+  for (SizeValueType n = end; n-- > 0; )
+    if (m_Parent[n] != n && m_Parent[n] < end)
+      out[ m_Order[n] ] = out[ m_Order[ m_Parent[n] ] ];
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template <class TInputImage, class TOutputImage>
+void
+BinariseVesselResponseSweepFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Thresholds:";
+  for (unsigned int i = 0; i < m_Thresholds.size(); ++i)
+    os << " " << m_Thresholds[i];
+  os << std::endl;
+}
+
+} // end namespace
+#endif //endif ITKBINARISEVESSELRESPONSESWEEPFILTER_TXX
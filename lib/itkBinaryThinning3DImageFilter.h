@@ -0,0 +1,137 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKBINARYTHINNING3DIMAGEFILTER_H
+#define ITKBINARYTHINNING3DIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk {
+
+/** \class BinaryThinning3DImageFilter
+ * \brief Topology preserving thinning of a 3D binary image into its
+ * centrelines (Lee, Kashyap and Chu, 1994).
+ *
+ * This is the algorithm of Fiji's "Skeletonize (2D/3D)": every iteration
+ * has six subiterations, one per face direction (N, S, E, W, U, B). A
+ * subiteration first collects the border voxels of that direction that are
+ * not end points, are Euler invariant and are simple, then deletes them one
+ * by one, re-checking simplicity so that connectivity is never broken. The
+ * thinning stops when no subiteration of a full iteration deletes anything.
+ *
+ * The collection only reads the image, so the list of foreground voxels is
+ * split among the threads. The partial lists are joined in raster order,
+ * which is the order of the sequential scan, so the result is the same as
+ * Fiji's whatever the number of threads. Any non-zero input is foreground;
+ * the centrelines are set to InsideValue.
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT BinaryThinning3DImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef BinaryThinning3DImageFilter                   Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BinaryThinning3DImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+
+  itkGetConstMacro(InsideValue, OutputPixelType);
+  itkSetMacro(InsideValue, OutputPixelType);
+
+  /** Number of iterations run by the last update. */
+  itkGetConstMacro(NumberOfIterations, unsigned int);
+
+protected:
+  BinaryThinning3DImageFilter();
+  ~BinaryThinning3DImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** The thinning is global. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *);
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  /** 3x3x3 neighbourhood of a voxel as a bit mask, bit (z*9 + y*3 + x). */
+  typedef unsigned int NeighbourhoodType;
+
+  NeighbourhoodType GetNeighbourhood(OffsetValueType p) const;
+  bool IsEulerInvariant(NeighbourhoodType n) const;
+  bool IsSimple(NeighbourhoodType n) const;
+
+  /** Collects the deletion candidates among m_Points[begin, end). */
+  void ThreadedCollectCandidates(SizeValueType begin, SizeValueType end,
+                                 std::vector< OffsetValueType > & candidates);
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+private:
+  BinaryThinning3DImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  OutputPixelType  m_InsideValue;
+  unsigned int     m_NumberOfIterations;
+
+  /** Working copy of the image with a one voxel background frame. */
+  std::vector< unsigned char >    m_Volume;
+  OffsetValueType                 m_Stride[3];
+  OffsetValueType                 m_NeighbourOffset[27];
+  /** Foreground voxels of m_Volume in raster order. */
+  std::vector< OffsetValueType >  m_Points;
+  /** Current subiteration direction, an index in m_NeighbourOffset. */
+  unsigned int                    m_Border;
+
+  /** Neighbours, within the 3x3x3 cube, 26-adjacent to every position. */
+  NeighbourhoodType               m_Adjacent[27];
+  /** Neighbours sharing each vertex, edge and face of the centre voxel. */
+  std::vector< NeighbourhoodType > m_Vertices;
+  std::vector< NeighbourhoodType > m_Edges;
+  std::vector< NeighbourhoodType > m_Faces;
+
+  std::vector< std::vector< OffsetValueType > > m_ThreadCandidates;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBinaryThinning3DImageFilter.txx"
+#endif
+
+#endif // ITKBINARYTHINNING3DIMAGEFILTER_H
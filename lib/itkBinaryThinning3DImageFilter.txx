@@ -0,0 +1,289 @@
+#ifndef ITKBINARYTHINNING3DIMAGEFILTER_TXX
+#define ITKBINARYTHINNING3DIMAGEFILTER_TXX
+
+#include "itkBinaryThinning3DImageFilter.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <stdlib.h>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+BinaryThinning3DImageFilter<TInputImage, TOutputImage>::BinaryThinning3DImageFilter()
+{
+  m_InsideValue = NumericTraits<OutputPixelType>::OneValue();
+  m_NumberOfIterations = 0;
+  m_Border = 0;
+
+  for (int a = 0; a < 27; ++a)
+  {
+    const int ax = a % 3, ay = (a / 3) % 3, az = a / 9;
+    m_Adjacent[a] = 0;
+    for (int b = 0; b < 27; ++b)
+    {
+      const int bx = b % 3, by = (b / 3) % 3, bz = b / 9;
+      if (a != b && b != 13 && abs(ax - bx) <= 1 && abs(ay - by) <= 1 && abs(az - bz) <= 1)
+        m_Adjacent[a] |= 1u << b;
+    }
+  }
+
+  //Every cell of the centre voxel is named by the direction c pointing to
+  //it; the neighbours sharing it are the o != 0 with o_i in {0, c_i}
+  for (int c = 0; c < 27; ++c)
+  {
+    if (c == 13)
+      continue;
+    const int cd[3] = { c % 3 - 1, (c / 3) % 3 - 1, c / 9 - 1 };
+    NeighbourhoodType mask = 0;
+    for (int o = 0; o < 27; ++o)
+    {
+      const int od[3] = { o % 3 - 1, (o / 3) % 3 - 1, o / 9 - 1 };
+      bool shares = (o != 13);
+      for (int i = 0; i < 3; ++i)
+        shares = shares && (od[i] == 0 || od[i] == cd[i]);
+      if (shares)
+        mask |= 1u << o;
+    }
+    const int nonzero = (cd[0] != 0) + (cd[1] != 0) + (cd[2] != 0);
+    if (nonzero == 3)
+      m_Vertices.push_back(mask);
+    else if (nonzero == 2)
+      m_Edges.push_back(mask);
+    else
+      m_Faces.push_back(mask);
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( input )
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(DataObject *)
+{
+  this->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+typename BinaryThinning3DImageFilter<TInputImage, TOutputImage>::NeighbourhoodType
+BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::GetNeighbourhood(OffsetValueType p) const
+{
+  NeighbourhoodType n = 0;
+  for (unsigned int i = 0; i < 27; ++i)
+    if (m_Volume[ p + m_NeighbourOffset[i] ])
+      n |= 1u << i;
+  return n;
+}
+
+template<class TInputImage, class TOutputImage>
+bool BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::IsEulerInvariant(NeighbourhoodType n) const
+{
+  //Removing p keeps the (26-connected) Euler characteristic iff the cells
+  //of its closed cube shared with the neighbours have V - E + F = 1
+  int euler = 0;
+  for (unsigned int i = 0; i < m_Vertices.size(); ++i)
+    euler += (n & m_Vertices[i]) != 0;
+  for (unsigned int i = 0; i < m_Edges.size(); ++i)
+    euler -= (n & m_Edges[i]) != 0;
+  for (unsigned int i = 0; i < m_Faces.size(); ++i)
+    euler += (n & m_Faces[i]) != 0;
+  return euler == 1;
+}
+
+template<class TInputImage, class TOutputImage>
+bool BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::IsSimple(NeighbourhoodType n) const
+{
+  //The foreground neighbours must form a single 26-connected object. An
+  //isolated voxel is not simple: deleting it would delete its object
+  const NeighbourhoodType remaining = n & ~(1u << 13);
+  if (!remaining)
+    return false;
+
+  NeighbourhoodType component = remaining & (~remaining + 1);
+  NeighbourhoodType front = component;
+  while (front)
+  {
+    const NeighbourhoodType bit = front & (~front + 1);
+    front &= ~bit;
+    unsigned int b = 0;
+    while (!(bit & (1u << b)))
+      ++b;
+    const NeighbourhoodType added = m_Adjacent[b] & remaining & ~component;
+    component |= added;
+    front |= added;
+  }
+  return component == remaining;
+}
+
+template<class TInputImage, class TOutputImage>
+void BinaryThinning3DImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  if (ImageDimension != 3)
+    itkExceptionMacro(<< "Only 3D images can be thinned");
+
+  InputImageConstPointer input = this->GetInput();
+  const typename InputImageType::SizeType size = input->GetBufferedRegion().GetSize();
+  const InputPixelType * in = input->GetBufferPointer();
+
+  m_Stride[0] = 1;
+  m_Stride[1] = size[0] + 2;
+  m_Stride[2] = m_Stride[1] * (size[1] + 2);
+  for (int i = 0; i < 27; ++i)
+    m_NeighbourOffset[i] = (i % 3 - 1) * m_Stride[0] + ((i / 3) % 3 - 1) * m_Stride[1]
+        + (i / 9 - 1) * m_Stride[2];
+
+  m_Volume.assign(m_Stride[2] * (size[2] + 2), 0);
+  m_Points.clear();
+  SizeValueType q = 0;
+  for (SizeValueType z = 0; z < size[2]; ++z)
+    for (SizeValueType y = 0; y < size[1]; ++y)
+    {
+      OffsetValueType p = (z + 1) * m_Stride[2] + (y + 1) * m_Stride[1] + 1;
+      for (SizeValueType x = 0; x < size[0]; ++x, ++p, ++q)
+        if (in[q] != NumericTraits<InputPixelType>::ZeroValue())
+        {
+          m_Volume[p] = 1;
+          m_Points.push_back(p);
+        }
+    }
+
+  //Face neighbours in Fiji's order: N, S, E, W, U, B
+  const unsigned int borders[6] = { 10, 16, 14, 12, 22, 4 };
+
+  const unsigned int numThreads = this->GetNumberOfThreads();
+  m_ThreadCandidates.resize(numThreads);
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+
+  m_NumberOfIterations = 0;
+  unsigned int unchangedBorders = 0;
+  while (unchangedBorders < 6)
+  {
+    unchangedBorders = 0;
+    for (unsigned int b = 0; b < 6; ++b)
+    {
+      m_Border = borders[b];
+      this->GetMultiThreader()->SingleMethodExecute();
+
+      //Sequential re-check, in raster order
+      bool changed = false;
+      for (unsigned int t = 0; t < numThreads; ++t)
+      {
+        const std::vector< OffsetValueType > & candidates = m_ThreadCandidates[t];
+        for (SizeValueType i = 0; i < candidates.size(); ++i)
+        {
+          m_Volume[ candidates[i] ] = 0;
+          if (this->IsSimple( this->GetNeighbourhood(candidates[i]) ))
+            changed = true;
+          else
+            m_Volume[ candidates[i] ] = 1;
+        }
+      }
+      if (!changed)
+        ++unchangedBorders;
+    }
+
+    //Drop the deleted voxels from the list
+    SizeValueType kept = 0;
+    for (SizeValueType i = 0; i < m_Points.size(); ++i)
+      if (m_Volume[ m_Points[i] ])
+        m_Points[kept++] = m_Points[i];
+    m_Points.resize(kept);
+    ++m_NumberOfIterations;
+  }
+
+  OutputImagePointer output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+  output->FillBuffer( NumericTraits<OutputPixelType>::ZeroValue() );
+  OutputPixelType * out = output->GetBufferPointer();
+  for (SizeValueType i = 0; i < m_Points.size(); ++i)
+  {
+    const OffsetValueType p = m_Points[i];
+    const OffsetValueType z = p / m_Stride[2] - 1;
+    const OffsetValueType y = (p % m_Stride[2]) / m_Stride[1] - 1;
+    const OffsetValueType x = p % m_Stride[1] - 1;
+    out[ (z * size[1] + y) * size[0] + x ] = m_InsideValue;
+  }
+
+  std::vector< unsigned char >().swap(m_Volume);
+  std::vector< OffsetValueType >().swap(m_Points);
+  m_ThreadCandidates.clear();
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  //Contiguous chunks keep the joined list in raster order
+  Self * filter = str->Filter;
+  const SizeValueType numPoints = filter->m_Points.size();
+  const SizeValueType begin = numPoints * threadId / threadCount;
+  const SizeValueType end = numPoints * (threadId + 1) / threadCount;
+  filter->ThreadedCollectCandidates(begin, end, filter->m_ThreadCandidates[threadId]);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage>
+void BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::ThreadedCollectCandidates(SizeValueType begin, SizeValueType end,
+                            std::vector< OffsetValueType > & candidates)
+{
+  candidates.clear();
+  const OffsetValueType border = m_NeighbourOffset[m_Border];
+  for (SizeValueType i = begin; i < end; ++i)
+  {
+    const OffsetValueType p = m_Points[i];
+    if (!m_Volume[p] || m_Volume[p + border])
+      continue;
+
+    const NeighbourhoodType n = this->GetNeighbourhood(p);
+    const NeighbourhoodType neighbours = n & ~(1u << 13);
+    //End points have a single neighbour
+    if (!(neighbours & (neighbours - 1)))
+      continue;
+    if (!this->IsEulerInvariant(n) || !this->IsSimple(n))
+      continue;
+    candidates.push_back(p);
+  }
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template <class TInputImage, class TOutputImage>
+void
+BinaryThinning3DImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "InsideValue: "
+     << static_cast<typename NumericTraits<OutputPixelType>::PrintType>(m_InsideValue)
+     << std::endl;
+  os << indent << "NumberOfIterations: " << m_NumberOfIterations << std::endl;
+}
+
+} // end namespace
+#endif //ITKBINARYTHINNING3DIMAGEFILTER_TXX
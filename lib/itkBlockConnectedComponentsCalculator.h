@@ -0,0 +1,207 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_H
+#define ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_H
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkMultiThreader.h>
+#include "itkImageBlockGrid.h"
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class BlockConnectedComponentsCalculator
+ * \brief Labels the connected components of a volume split into blocks
+ * without loading the whole volume.
+ *
+ * Every block is read and labelled on its own thread with
+ * ParallelConnectedComponentImageFilter, and its labels are kept run-length
+ * encoded. The cores of the blocks (see ImageBlockGrid) tile the volume:
+ * the labels of neighbouring voxels lying in different cores are paired up,
+ * which only involves the outer layer of every core, and a global union-find
+ * over the pairs joins the block labels. A block label with no voxel in the
+ * core, i.e. a piece lying only in the overlap with other blocks, is joined
+ * with the label its first voxel has in the block owning it. The component
+ * sizes are counted over the cores only, so overlaps are not counted twice.
+ *
+ * As with ParallelConnectedComponentImageFilter, the objects are numbered by
+ * decreasing size and can be filtered by MinimumObjectSize and
+ * NumberOfObjects. WriteBlocks then writes the global labels, or InsideValue
+ * with BinaryOutput on, of every block to its own file. Overlapping blocks
+ * are expected to hold the same values in their overlap.
+ */
+template< class TInputImage, class TOutputImage >
+class ITK_EXPORT BlockConnectedComponentsCalculator : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef BlockConnectedComponentsCalculator Self;
+  typedef Object                             Superclass;
+  typedef SmartPointer< Self >               Pointer;
+  typedef SmartPointer< const Self >         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BlockConnectedComponentsCalculator, Object);
+
+  typedef TInputImage                           InputImageType;
+  typedef TOutputImage                          OutputImageType;
+  typedef typename InputImageType::PixelType    InputPixelType;
+  typedef typename OutputImageType::PixelType   OutputPixelType;
+  typedef Image< unsigned int, 3 >              LabelImageType;
+  typedef std::vector< SizeValueType >          ObjectSizeContainerType;
+
+  itkSetConstObjectMacro(Grid, ImageBlockGrid);
+
+  itkGetConstMacro(LowerThreshold, InputPixelType);
+  itkGetConstMacro(UpperThreshold, InputPixelType);
+  itkSetMacro(LowerThreshold, InputPixelType);
+  itkSetMacro(UpperThreshold, InputPixelType);
+
+  itkGetConstMacro(FullyConnected, bool);
+  itkSetMacro(FullyConnected, bool);
+  itkBooleanMacro(FullyConnected);
+
+  itkGetConstMacro(MinimumObjectSize, SizeValueType);
+  itkSetMacro(MinimumObjectSize, SizeValueType);
+  itkGetConstMacro(NumberOfObjects, SizeValueType);
+  itkSetMacro(NumberOfObjects, SizeValueType);
+
+  itkGetConstMacro(BinaryOutput, bool);
+  itkSetMacro(BinaryOutput, bool);
+  itkBooleanMacro(BinaryOutput);
+  itkGetConstMacro(InsideValue, OutputPixelType);
+  itkSetMacro(InsideValue, OutputPixelType);
+
+  /** Blocks processed at once. */
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Labels the blocks and joins their labels. */
+  void Compute();
+
+  /** Writes the output of block b to fileNames[b], for all blocks. */
+  void WriteBlocks(const std::vector< std::string > & fileNames);
+
+  /** Number of objects in the volume before any size filtering. */
+  itkGetConstMacro(OriginalNumberOfObjects, SizeValueType);
+  /** Number of objects written. */
+  itkGetConstMacro(NumberOfKeptObjects, SizeValueType);
+
+  /** Sizes of all the objects found, largest first. */
+  const ObjectSizeContainerType & GetSizeOfObjectsInPixels() const
+  { return m_SizeOfObjectsInPixels; }
+
+protected:
+  BlockConnectedComponentsCalculator();
+  ~BlockConnectedComponentsCalculator() { }
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  typedef enum
+  {
+    LABEL = 0,
+    PAIRS = 1,
+    WRITE = 2
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** A span of voxels with the same label along x, in block coordinates. */
+  struct Run
+  {
+    IndexValueType Start;
+    IndexValueType End;   // one past the last voxel
+    SizeValueType  Label;
+  };
+
+  /** Run-length encoded labels of a block. */
+  struct BlockLabels
+  {
+    std::vector< SizeValueType >  LineOffsets;
+    std::vector< Run >            Runs;
+    SizeValueType                 FirstLabel;
+    /** Voxels in the core, per label (0 unused). */
+    std::vector< SizeValueType >  CoreSizes;
+    /** First voxel of every label, in volume coordinates. */
+    std::vector< IndexValueType > FirstVoxels;
+  };
+
+  /** Orders component ids by decreasing size, then by increasing id. */
+  struct SizeGreater
+  {
+    const ObjectSizeContainerType *Sizes;
+    bool operator()(SizeValueType a, SizeValueType b) const
+    {
+      if ((*Sizes)[a] != (*Sizes)[b])
+        return (*Sizes)[a] > (*Sizes)[b];
+      return a < b;
+    }
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Runs the current phase over all blocks, on m_NumberOfThreads threads. */
+  void Execute();
+
+  void ThreadedLabel(SizeValueType b);
+  /** Label pairs of block b with the blocks around its core. */
+  void ThreadedPairs(SizeValueType b, std::vector< std::pair< SizeValueType, SizeValueType > > & pairs);
+  void ThreadedWrite(SizeValueType b);
+
+  /** Label of the voxel (volume coordinates) in block b, or 0. */
+  SizeValueType GetLabel(SizeValueType b, const IndexValueType index[3]) const;
+
+  SizeValueType FindRoot(SizeValueType r);
+
+private:
+  BlockConnectedComponentsCalculator(const Self &); //purposely not implemented
+  void operator=(const Self &);         //purposely not implemented
+
+  ImageBlockGrid::ConstPointer m_Grid;
+  InputPixelType               m_LowerThreshold;
+  InputPixelType               m_UpperThreshold;
+  bool                         m_FullyConnected;
+  SizeValueType                m_MinimumObjectSize;
+  SizeValueType                m_NumberOfObjects;
+  bool                         m_BinaryOutput;
+  OutputPixelType              m_InsideValue;
+  ThreadIdType                 m_NumberOfThreads;
+
+  PhaseType                    m_Phase;
+  std::vector< BlockLabels >   m_BlockLabels;
+  std::vector< std::vector< std::pair< SizeValueType, SizeValueType > > > m_ThreadPairs;
+  std::vector< std::string >   m_ThreadErrors;
+  std::vector< SizeValueType > m_Parent;
+  /** Output value of every block label (index FirstLabel + label). */
+  std::vector< SizeValueType > m_OutputLabel;
+  std::vector< std::string >   m_OutputFileNames;
+
+  SizeValueType                m_OriginalNumberOfObjects;
+  SizeValueType                m_NumberOfKeptObjects;
+  ObjectSizeContainerType      m_SizeOfObjectsInPixels;
+};
+
+}
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBlockConnectedComponentsCalculator.txx"
+#endif
+
+#endif // ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_H
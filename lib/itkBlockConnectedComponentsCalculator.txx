@@ -0,0 +1,466 @@
+#ifndef ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_TXX
+#define ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_TXX
+
+#include "itkBlockConnectedComponentsCalculator.h"
+#include "itkParallelConnectedComponentImageFilter.h"
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace itk {
+
+template< class TInputImage, class TOutputImage >
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::BlockConnectedComponentsCalculator()
+{
+  m_LowerThreshold = NumericTraits<InputPixelType>::OneValue();
+  m_UpperThreshold = NumericTraits<InputPixelType>::max();
+  m_FullyConnected = false;
+  m_MinimumObjectSize = 0;
+  m_NumberOfObjects = 0;
+  m_BinaryOutput = false;
+  m_InsideValue = NumericTraits<OutputPixelType>::OneValue();
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_Phase = LABEL;
+  m_OriginalNumberOfObjects = 0;
+  m_NumberOfKeptObjects = 0;
+}
+
+template< class TInputImage, class TOutputImage >
+SizeValueType
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::FindRoot(SizeValueType r)
+{
+  while (m_Parent[r] != r)
+  {
+    m_Parent[r] = m_Parent[ m_Parent[r] ];
+    r = m_Parent[r];
+  }
+  return r;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::Compute()
+{
+  if (!m_Grid)
+    itkExceptionMacro(<< "Grid not set");
+
+  const SizeValueType numBlocks = m_Grid->GetNumberOfBlocks();
+  m_BlockLabels.assign(numBlocks, BlockLabels());
+  m_Phase = LABEL;
+  this->Execute();
+
+  SizeValueType numLabels = 0;
+  for (SizeValueType b = 0; b < numBlocks; ++b)
+  {
+    m_BlockLabels[b].FirstLabel = numLabels;
+    numLabels += m_BlockLabels[b].CoreSizes.size() - 1;
+  }
+
+  //The pairs are found in parallel and joined here; they only come from the
+  //faces of the cores, so there are few of them
+  m_ThreadPairs.assign(numBlocks, std::vector< std::pair< SizeValueType, SizeValueType > >());
+  m_Phase = PAIRS;
+  this->Execute();
+
+  m_Parent.resize(numLabels);
+  for (SizeValueType i = 0; i < numLabels; ++i)
+    m_Parent[i] = i;
+  for (SizeValueType b = 0; b < numBlocks; ++b)
+  {
+    for (SizeValueType i = 0; i < m_ThreadPairs[b].size(); ++i)
+    {
+      const SizeValueType ra = this->FindRoot(m_ThreadPairs[b][i].first);
+      const SizeValueType rb = this->FindRoot(m_ThreadPairs[b][i].second);
+      if (ra < rb)
+        m_Parent[rb] = ra;
+      else if (rb < ra)
+        m_Parent[ra] = rb;
+    }
+  }
+  m_ThreadPairs.clear();
+
+  //Objects are the roots, sized by their voxels in the cores
+  ObjectSizeContainerType sizes(numLabels, 0);
+  for (SizeValueType b = 0; b < numBlocks; ++b)
+  {
+    const BlockLabels & labels = m_BlockLabels[b];
+    for (SizeValueType l = 1; l < labels.CoreSizes.size(); ++l)
+      sizes[ this->FindRoot(labels.FirstLabel + l - 1) ] += labels.CoreSizes[l];
+  }
+  std::vector< SizeValueType > objects;
+  for (SizeValueType i = 0; i < numLabels; ++i)
+    if (m_Parent[i] == i && sizes[i] > 0)
+      objects.push_back(i);
+  SizeGreater greater;
+  greater.Sizes = &sizes;
+  std::sort(objects.begin(), objects.end(), greater);
+
+  m_OriginalNumberOfObjects = objects.size();
+  m_SizeOfObjectsInPixels.resize(objects.size());
+  std::vector< SizeValueType > rank(numLabels, 0);
+  m_NumberOfKeptObjects = 0;
+  for (SizeValueType k = 0; k < objects.size(); ++k)
+  {
+    m_SizeOfObjectsInPixels[k] = sizes[ objects[k] ];
+    if (sizes[ objects[k] ] < m_MinimumObjectSize)
+      continue;
+    if (m_NumberOfObjects > 0 && m_NumberOfKeptObjects >= m_NumberOfObjects)
+      continue;
+    rank[ objects[k] ] = ++m_NumberOfKeptObjects;
+  }
+  m_OutputLabel.resize(numLabels);
+  for (SizeValueType i = 0; i < numLabels; ++i)
+    m_OutputLabel[i] = rank[ this->FindRoot(i) ];
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::WriteBlocks(const std::vector< std::string > & fileNames)
+{
+  if (fileNames.size() != m_BlockLabels.size())
+    itkExceptionMacro(<< "Expected " << m_BlockLabels.size() << " output files, got " << fileNames.size());
+  if (!m_BinaryOutput && m_NumberOfKeptObjects > static_cast< SizeValueType >(NumericTraits<OutputPixelType>::max()))
+    itkExceptionMacro(<< "Too many objects for the output pixel type: " << m_NumberOfKeptObjects);
+
+  m_OutputFileNames = fileNames;
+  m_Phase = WRITE;
+  this->Execute();
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::Execute()
+{
+  ThreadStruct str;
+  str.Filter = this;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, m_Grid->GetNumberOfBlocks()));
+  m_ThreadErrors.assign(numThreads, std::string());
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numThreads);
+  threader->SetSingleMethod(this->ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (ThreadIdType t = 0; t < m_ThreadErrors.size(); ++t)
+    if (!m_ThreadErrors[t].empty())
+      itkExceptionMacro(<< m_ThreadErrors[t]);
+}
+
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_TYPE
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  //Blocks are dealt round-robin, every thread reads its own
+  Self * filter = str->Filter;
+  const SizeValueType numBlocks = filter->m_Grid->GetNumberOfBlocks();
+  try
+  {
+    for (SizeValueType b = threadId; b < numBlocks; b += threadCount)
+    {
+      switch (filter->m_Phase)
+      {
+        case LABEL:
+          filter->ThreadedLabel(b);
+          break;
+        case PAIRS:
+          filter->ThreadedPairs(b, filter->m_ThreadPairs[b]);
+          break;
+        case WRITE:
+          filter->ThreadedWrite(b);
+          break;
+      }
+    }
+  }
+  catch( ExceptionObject & err )
+  {
+    filter->m_ThreadErrors[threadId] = err.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::ThreadedLabel(SizeValueType b)
+{
+  typedef ImageFileReader< InputImageType > ReaderType;
+  typedef ParallelConnectedComponentImageFilter< InputImageType, LabelImageType > LabelFilterType;
+
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( block.FileName );
+  typename LabelFilterType::Pointer labelFilter = LabelFilterType::New();
+  labelFilter->SetInput( reader->GetOutput() );
+  labelFilter->SetLowerThreshold( m_LowerThreshold );
+  labelFilter->SetUpperThreshold( m_UpperThreshold );
+  labelFilter->SetFullyConnected( m_FullyConnected );
+  labelFilter->SetNumberOfThreads( 1 );
+  labelFilter->Update();
+
+  const typename LabelImageType::SizeType size =
+      labelFilter->GetOutput()->GetBufferedRegion().GetSize();
+  for (unsigned int d = 0; d < 3; ++d)
+    if (size[d] != block.Size[d])
+      itkExceptionMacro(<< block.FileName << " does not have the size of its block");
+  const LabelImageType::PixelType * in = labelFilter->GetOutput()->GetBufferPointer();
+
+  BlockLabels & labels = m_BlockLabels[b];
+  const SizeValueType numObjects = labelFilter->GetNumberOfKeptObjects();
+  labels.CoreSizes.assign(numObjects + 1, 0);
+  labels.FirstVoxels.assign(3 * (numObjects + 1), 0);
+  std::vector< bool > seen(numObjects + 1, false);
+  labels.LineOffsets.resize(size[1] * size[2] + 1);
+  labels.Runs.clear();
+
+  IndexValueType coreStart[3], coreEnd[3];
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    coreStart[d] = block.CoreIndex[d] - block.Index[d];
+    coreEnd[d] = coreStart[d] + block.CoreSize[d];
+  }
+
+  SizeValueType line = 0;
+  for (IndexValueType z = 0; z < (IndexValueType)size[2]; ++z)
+    for (IndexValueType y = 0; y < (IndexValueType)size[1]; ++y, ++line)
+    {
+      labels.LineOffsets[line] = labels.Runs.size();
+      const bool coreLine = y >= coreStart[1] && y < coreEnd[1] && z >= coreStart[2] && z < coreEnd[2];
+      IndexValueType x = 0;
+      while (x < (IndexValueType)size[0])
+      {
+        const SizeValueType label = in[x];
+        if (label == 0)
+        {
+          ++x;
+          continue;
+        }
+        Run run;
+        run.Start = x;
+        run.Label = label;
+        while (x < (IndexValueType)size[0] && in[x] == label)
+          ++x;
+        run.End = x;
+        labels.Runs.push_back(run);
+
+        if (!seen[label])
+        {
+          seen[label] = true;
+          labels.FirstVoxels[3 * label] = block.Index[0] + run.Start;
+          labels.FirstVoxels[3 * label + 1] = block.Index[1] + y;
+          labels.FirstVoxels[3 * label + 2] = block.Index[2] + z;
+        }
+        if (coreLine)
+        {
+          const IndexValueType start = std::max(run.Start, coreStart[0]);
+          const IndexValueType end = std::min(run.End, coreEnd[0]);
+          if (end > start)
+            labels.CoreSizes[label] += end - start;
+        }
+      }
+      in += size[0];
+    }
+  labels.LineOffsets[line] = labels.Runs.size();
+}
+
+template< class TInputImage, class TOutputImage >
+SizeValueType
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::GetLabel(SizeValueType b, const IndexValueType index[3]) const
+{
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  IndexValueType local[3];
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    local[d] = index[d] - block.Index[d];
+    if (local[d] < 0 || local[d] >= (IndexValueType)block.Size[d])
+      return 0;
+  }
+  const BlockLabels & labels = m_BlockLabels[b];
+  const SizeValueType line = local[2] * block.Size[1] + local[1];
+  SizeValueType first = labels.LineOffsets[line];
+  SizeValueType last = labels.LineOffsets[line + 1];
+  while (first < last)
+  {
+    const SizeValueType middle = first + (last - first) / 2;
+    if (labels.Runs[middle].End <= local[0])
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  if (first < labels.LineOffsets[line + 1] && labels.Runs[first].Start <= local[0])
+    return labels.Runs[first].Label;
+  return 0;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::ThreadedPairs(SizeValueType b, std::vector< std::pair< SizeValueType, SizeValueType > > & pairs)
+{
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  const BlockLabels & labels = m_BlockLabels[b];
+  const SizeValueType numBlocks = m_Grid->GetNumberOfBlocks();
+
+  //Forward neighbours only: every pair of cores is seen from one side
+  std::vector< IndexValueType > offsets;
+  for (int dz = -1; dz <= 1; ++dz)
+    for (int dy = -1; dy <= 1; ++dy)
+      for (int dx = -1; dx <= 1; ++dx)
+      {
+        const bool forward = dz > 0 || (dz == 0 && (dy > 0 || (dy == 0 && dx > 0)));
+        if (!forward || (!m_FullyConnected && abs(dx) + abs(dy) + abs(dz) > 1))
+          continue;
+        offsets.push_back(dx);
+        offsets.push_back(dy);
+        offsets.push_back(dz);
+      }
+
+  IndexValueType coreStart[3], coreEnd[3];
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    coreStart[d] = block.CoreIndex[d];
+    coreEnd[d] = coreStart[d] + block.CoreSize[d];
+  }
+
+  IndexValueType p[3], q[3];
+  for (p[2] = coreStart[2]; p[2] < coreEnd[2]; ++p[2])
+    for (p[1] = coreStart[1]; p[1] < coreEnd[1]; ++p[1])
+    {
+      //Inside the core only the first and last voxels of a line can have
+      //neighbours in other cores
+      const bool face = p[1] == coreStart[1] || p[1] == coreEnd[1] - 1
+          || p[2] == coreStart[2] || p[2] == coreEnd[2] - 1;
+      const SizeValueType line = (p[2] - block.Index[2]) * block.Size[1] + (p[1] - block.Index[1]);
+      for (SizeValueType r = labels.LineOffsets[line]; r < labels.LineOffsets[line + 1]; ++r)
+      {
+        const Run & run = labels.Runs[r];
+        const IndexValueType start = std::max(block.Index[0] + run.Start, coreStart[0]);
+        const IndexValueType end = std::min(block.Index[0] + run.End, coreEnd[0]);
+        for (p[0] = start; p[0] < end; ++p[0])
+        {
+          if (!face && p[0] != coreStart[0] && p[0] != coreEnd[0] - 1)
+          {
+            p[0] = std::max(p[0], coreEnd[0] - 2);
+            continue;
+          }
+          for (SizeValueType o = 0; o < offsets.size(); o += 3)
+          {
+            bool inCore = true;
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+              q[d] = p[d] + offsets[o + d];
+              inCore = inCore && q[d] >= coreStart[d] && q[d] < coreEnd[d];
+            }
+            if (inCore)
+              continue;
+            const SizeValueType other = m_Grid->FindCoreBlock(q);
+            if (other == numBlocks)
+              continue;
+            const SizeValueType label = this->GetLabel(other, q);
+            if (label > 0)
+              pairs.push_back(std::make_pair(labels.FirstLabel + run.Label - 1,
+                                             m_BlockLabels[other].FirstLabel + label - 1));
+          }
+        }
+      }
+    }
+
+  //Pieces lying only in the overlap take the label of their owner
+  for (SizeValueType l = 1; l < labels.CoreSizes.size(); ++l)
+  {
+    if (labels.CoreSizes[l] > 0)
+      continue;
+    const IndexValueType * voxel = &labels.FirstVoxels[3 * l];
+    const SizeValueType other = m_Grid->FindCoreBlock(voxel);
+    if (other == numBlocks || other == b)
+      continue;
+    const SizeValueType label = this->GetLabel(other, voxel);
+    if (label > 0)
+      pairs.push_back(std::make_pair(labels.FirstLabel + l - 1,
+                                     m_BlockLabels[other].FirstLabel + label - 1));
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::ThreadedWrite(SizeValueType b)
+{
+  typedef ImageFileReader< InputImageType > ReaderType;
+  typedef ImageFileWriter< OutputImageType > WriterType;
+
+  //Only the header of the block is read, to copy its geometry
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( block.FileName );
+  reader->UpdateOutputInformation();
+
+  typename OutputImageType::Pointer output = OutputImageType::New();
+  output->CopyInformation( reader->GetOutput() );
+  output->SetRegions( reader->GetOutput()->GetLargestPossibleRegion() );
+  output->Allocate();
+  output->FillBuffer( NumericTraits<OutputPixelType>::ZeroValue() );
+
+  const BlockLabels & labels = m_BlockLabels[b];
+  OutputPixelType * out = output->GetBufferPointer();
+  for (SizeValueType line = 0; line + 1 < labels.LineOffsets.size(); ++line)
+  {
+    for (SizeValueType r = labels.LineOffsets[line]; r < labels.LineOffsets[line + 1]; ++r)
+    {
+      const Run & run = labels.Runs[r];
+      const SizeValueType label = m_OutputLabel[labels.FirstLabel + run.Label - 1];
+      if (label == 0)
+        continue;
+      const OutputPixelType value = m_BinaryOutput ? m_InsideValue : static_cast< OutputPixelType >(label);
+      std::fill(out + run.Start, out + run.End, value);
+    }
+    out += block.Size[0];
+  }
+
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( output );
+  writer->SetFileName( m_OutputFileNames[b] );
+  writer->Update();
+}
+
+template< class TInputImage, class TOutputImage >
+void
+BlockConnectedComponentsCalculator< TInputImage, TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "LowerThreshold: "
+     << static_cast<typename NumericTraits<InputPixelType>::PrintType>(m_LowerThreshold) << std::endl;
+  os << indent << "UpperThreshold: "
+     << static_cast<typename NumericTraits<InputPixelType>::PrintType>(m_UpperThreshold) << std::endl;
+  os << indent << "FullyConnected: " << m_FullyConnected << std::endl;
+  os << indent << "MinimumObjectSize: " << m_MinimumObjectSize << std::endl;
+  os << indent << "NumberOfObjects: " << m_NumberOfObjects << std::endl;
+  os << indent << "BinaryOutput: " << m_BinaryOutput << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+  os << indent << "OriginalNumberOfObjects: " << m_OriginalNumberOfObjects << std::endl;
+  os << indent << "NumberOfKeptObjects: " << m_NumberOfKeptObjects << std::endl;
+}
+
+} // end namespace
+#endif //ITKBLOCKCONNECTEDCOMPONENTSCALCULATOR_TXX
@@ -16,18 +16,10 @@
 
 #include <itkImageToImageFilter.h>
 #include <itkMacro.h>
-#include <itkBinaryThresholdImageFilter.h>
-#include <itkConnectedComponentImageFilter.h>
-#include <itkConnectedThresholdImageFilter.h>
-#include <itkLabelShapeKeepNObjectsImageFilter.h>
-#include <itkOtsuThresholdImageFilter.h>
-#include <itkImageDuplicator.h>
-#include <itkMaskImageFilter.h>
-#include <itkBinaryBallStructuringElement.h>
-#include <itkBinaryCrossStructuringElement.h>
-#include <itkBinaryDilateImageFilter.h>
-#include <itkBinaryErodeImageFilter.h>
-#include <itkSubtractImageFilter.h>
+#include <itkMultiThreader.h>
+#include "itkParallelConnectedComponentImageFilter.h"
+#include "itkParallelOtsuThresholdImageFilter.h"
+#include "itkDistanceMorphologyImageFilter.h"
 
 namespace itk {
 
@@ -79,34 +71,28 @@ protected:
   ~BrainMaskFromCTFilter() {};
   void PrintSelf(std::ostream&os, Indent indent) const;
 
-  typedef itk::BinaryThresholdImageFilter<InputImageType,
-                                          OutputImageType> ThreshFilterType;
-  typedef itk::ConnectedComponentImageFilter<OutputImageType,
-                                             OutputImageType> ConnectFilterType;
-  typedef itk::ConnectedThresholdImageFilter<InputImageType,
-                                             OutputImageType> ConnectThreshFilterType;
-  typedef itk::LabelShapeKeepNObjectsImageFilter< OutputImageType >
-                                         LabelShapeKeepNObjectsImageFilterType;
-  typedef itk::OtsuThresholdImageFilter <InputImageType,
-                                         OutputImageType> OtsuFilterType;
-  typedef itk::ImageDuplicator< OutputImageType > DuplicatorType;
- typedef itk::MaskImageFilter< OutputImageType, OutputImageType > MaskFilterType;
-  typedef itk::BinaryBallStructuringElement<OutputPixelType,ImageDimension>
-                                                  StructuringElementType;
-  typedef itk::BinaryDilateImageFilter<OutputImageType,
-                                       OutputImageType,
-                                       StructuringElementType> DilateFilter;
-  typedef itk::BinaryCrossStructuringElement<OutputPixelType,
-                                             ImageDimension> CrossType;
-  typedef itk::BinaryDilateImageFilter<OutputImageType,
-                                       OutputImageType,
-                                       CrossType> DilateCrossFilterType;
-  typedef itk::BinaryErodeImageFilter<OutputImageType,
-                                       OutputImageType,
-                                      StructuringElementType> ErodeFilterType;
-  typedef itk::SubtractImageFilter< OutputImageType, OutputImageType, OutputImageType >
-                                      SubtractFilterType;
-
+  typedef itk::ParallelConnectedComponentImageFilter<InputImageType,
+                                          OutputImageType> ThreshConnectFilterType;
+  typedef itk::ParallelConnectedComponentImageFilter<OutputImageType,
+                                          OutputImageType> ConnectFilterType;
+  typedef itk::ParallelOtsuThresholdImageFilter<InputImageType,
+                                          OutputImageType> OtsuFilterType;
+  typedef itk::DistanceMorphologyImageFilter<OutputImageType,
+                                          OutputImageType> MorphologyFilterType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+    OutputPixelType *Mask;
+    const OutputPixelType *Otsu;
+  };
+
+  static ITK_THREAD_RETURN_TYPE SweepThreaderCallback( void *arg );
+
+  /** Fills the skull from the outside along x and y on a single slice and
+   * keeps the Otsu foreground left inside. Slices are independent. */
+  void SweepSlice(OutputPixelType *mask, const OutputPixelType *otsu,
+                  SizeValueType slice);
 
   /** Generate the output data. */
   virtual void GenerateData();
@@ -125,6 +111,11 @@ private:
 
   /** Scans an image to determine if it comes in Hounsfield units or nor **/
   void checkHounsfieldImage();
+
+  /** Ball dilation/erosion of a 0/1 mask, radius in voxels. The ball holds
+   * the voxels at a distance up to radius + 0.5, as BinaryBallStructuringElement **/
+  OutputImagePointer morphology(OutputImagePointer mask, double radius,
+                                typename MorphologyFilterType::OperationType op);
   std::vector<double> getMaskStatistics(OutputImagePointer i);
 
 };
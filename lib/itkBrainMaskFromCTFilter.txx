@@ -7,6 +7,7 @@
 #include <itkImageRegionIterator.h>
 
 #include <limits>
+#include <vector>
 namespace itk
 {
 
@@ -25,186 +26,157 @@ void BrainMaskFromCTFilter<TInputImage, TOutputImage>::GenerateData()
 
   InputImageConstPointer  inputPtr = this->GetInput();
 
-  //1- Threshold using HU's
-  typename ThreshFilterType::Pointer threshfilter = ThreshFilterType::New();
-  threshfilter->SetInput( inputPtr );
-  threshfilter->SetUpperThreshold(std::numeric_limits<InputPixelType>::max() );
-  threshfilter->SetOutsideValue( 0 );
-  threshfilter->SetInsideValue( 1 );
-
   InputPixelType bone = lowThresh_noHU;
   if (m_IsHU)
     bone = lowThresh_HU;
-  threshfilter->SetLowerThreshold(lowThresh_HU);
-
 
-  //1b- Separate foreground and background
+  //1- Separate foreground and background
   typename OtsuFilterType::Pointer otsu = OtsuFilterType::New();
   otsu->SetInput( inputPtr );
   otsu->SetInsideValue(0);
   otsu->SetOutsideValue(1);
+  otsu->SetNumberOfThreads( this->GetNumberOfThreads() );
+  otsu->InPlaceOff();
   otsu->Update();
- // threshfilter->Update();
 
-  //2- Largest connected component
-  typename ConnectFilterType::Pointer connectfilter = ConnectFilterType::New();
-  connectfilter->SetInput(threshfilter->GetOutput());
-  connectfilter->SetBackgroundValue(0);
+  //2- Threshold using HU's and keep the largest connected component
+  typename ThreshConnectFilterType::Pointer connectfilter = ThreshConnectFilterType::New();
+  connectfilter->SetInput( inputPtr );
+  connectfilter->SetLowerThreshold( lowThresh_HU );
+  connectfilter->SetUpperThreshold( std::numeric_limits<InputPixelType>::max() );
   connectfilter->FullyConnectedOn();
-  typename LabelShapeKeepNObjectsImageFilterType::Pointer labelfilter =
-                                LabelShapeKeepNObjectsImageFilterType::New();
-  labelfilter->SetInput(connectfilter->GetOutput());
-  labelfilter->SetBackgroundValue( 0 );
-  labelfilter->SetNumberOfObjects( 1 );
-  labelfilter->SetAttribute(LabelShapeKeepNObjectsImageFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-  labelfilter->Update();
-  OutputImagePointer maskimg =  labelfilter->GetOutput();
+  connectfilter->SetNumberOfObjects( 1 );
+  connectfilter->BinaryOutputOn();
+  connectfilter->SetInsideValue( 1 );
+  connectfilter->SetNumberOfThreads( this->GetNumberOfThreads() );
+  connectfilter->Update();
+  OutputImagePointer maskimg = connectfilter->GetOutput();
   maskimg->DisconnectPipeline();
 
-  typename itk::ImageRegionIterator<OutputImageType> maskIterator(maskimg,
-                                                                maskimg->GetLargestPossibleRegion());
-  while(!maskIterator.IsAtEnd()) {
-    if (maskIterator.Get() != 0)
-      maskIterator.Set(1);
-    ++maskIterator;
-  }
+  maskimg = this->morphology(maskimg, 5, MorphologyFilterType::DILATE);
 
-  typename DilateFilter::Pointer dilate = DilateFilter::New();
-  StructuringElementType structuringElement;
+  //3- Swipe the skull from the outside, slice by slice, and invert it while
+  //   removing the Otsu background. Written in place, one slice per thread
+  ThreadStruct str;
+  str.Filter = this;
+  str.Mask = maskimg->GetBufferPointer();
+  str.Otsu = otsu->GetOutput()->GetBufferPointer();
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( this->SweepThreaderCallback, &str );
+  this->GetMultiThreader()->SingleMethodExecute();
 
-  structuringElement.SetRadius(5);
-  structuringElement.CreateStructuringElement();
-  dilate->SetInput( maskimg );
-  dilate->SetKernel(structuringElement);
-  dilate->SetDilateValue(1);
-  dilate->Update();
+  //4- Detach the brain from what is left of the skull
+  maskimg = this->morphology(maskimg, 5, MorphologyFilterType::ERODE);
 
-  maskimg = dilate->GetOutput();
+  typename ConnectFilterType::Pointer connectfilter2 = ConnectFilterType::New();
+  connectfilter2->SetInput( maskimg );
+  connectfilter2->SetLowerThreshold( 1 );
+  connectfilter2->FullyConnectedOff();
+  connectfilter2->SetNumberOfObjects( 1 );
+  connectfilter2->BinaryOutputOn();
+  connectfilter2->SetInsideValue( 1 );
+  connectfilter2->SetNumberOfThreads( this->GetNumberOfThreads() );
+  connectfilter2->Update();
+  maskimg = connectfilter2->GetOutput();
   maskimg->DisconnectPipeline();
 
-  //swipe starts
-  typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
-  duplicator->SetInputImage(maskimg);
-  duplicator->Update();
-  typename OutputImageType::Pointer mask_image_bis = duplicator->GetOutput();
-
-  typename OutputImageType::IndexType ind;
-  typename OutputImageType::SizeType size = maskimg->GetLargestPossibleRegion().GetSize();
-  for (ind[2] = size[2] -1; ind[2] >=0; ind[2]--) {
-    for (ind[1] = 0; ind[1] < (unsigned int) size[1]; ind[1]++)  {     //X swipe
-      bool stop = false;
-      for (ind[0] = 0; ind[0] < (unsigned int) size[0] && !stop; ind[0]++) {
-        if (mask_image_bis->GetPixel(ind) != 0)
-          stop = true;
-        maskimg->SetPixel(ind,1);
-      }
-      if (stop) {
-        stop = false;
-        for (ind[0] = size[0] -1; ind[0] >= 0 && !stop; ind[0]--) {
-          if (mask_image_bis->GetPixel(ind) != 0)
-            stop = true;
-          maskimg->SetPixel(ind,1);
-        }
-      }
-    }
-    for (ind[0] = 0; ind[0] < (unsigned int) size[0]; ind[0]++) {     //Y swipe
-      bool stop = false;
-      for (ind[1] = 0; ind[1] < (unsigned int) size[1] && !stop; ind[1]++) {
-        if (mask_image_bis->GetPixel(ind) != 0)
-          stop = true;
-        maskimg->SetPixel(ind,1);
-      }
-      if (stop) {
-        stop = false;
-        for (ind[1] = size[1] -1; ind[1] >= 0 && !stop; ind[1]--) {
-          if (mask_image_bis->GetPixel(ind) != 0)
-            stop = true;
-          maskimg->SetPixel(ind,1);
-        }
-      }
-    }
-  } //End of swipe
-
-  //invert the image while removing Otsu
-  typename itk::ImageRegionIterator<OutputImageType> invIterator(maskimg,
-                                                                maskimg->GetLargestPossibleRegion());
-  typename itk::ImageRegionConstIterator<OutputImageType> otsuIterator(otsu->GetOutput(),
-                                                                           maskimg->GetLargestPossibleRegion());
-  while(!invIterator.IsAtEnd()) {
-    if (invIterator.Get() == 0)
-    {
-      if (otsuIterator.Get() != 0 ) //&& threshIterator.Get() == 0)
-        invIterator.Set(1);
-    }
-    else
-      invIterator.Set(0);
-    ++invIterator;
-    ++otsuIterator;
-  }
+  //5- Final Dilation, restricted to the foreground
+  maskimg = this->morphology(maskimg, 10, MorphologyFilterType::DILATE);
 
-  typename ErodeFilterType::Pointer erode = ErodeFilterType::New();
-
-  StructuringElementType cross_er;
-  cross_er.SetRadius( 5 );
-  cross_er.CreateStructuringElement();
-  erode->SetInput( maskimg );
-  erode->SetKernel( cross_er );
-  erode->SetErodeValue(1);
-  erode->SetBackgroundValue(0);
-  erode->Update();
-  maskimg = erode->GetOutput();
-  maskimg->DisconnectPipeline();
+  OutputPixelType * maskPtr = maskimg->GetBufferPointer();
+  const OutputPixelType * otsuPtr = otsu->GetOutput()->GetBufferPointer();
+  const SizeValueType numPixels = maskimg->GetBufferedRegion().GetNumberOfPixels();
+  for (SizeValueType i = 0; i < numPixels; ++i)
+    if (otsuPtr[i] == 0)
+      maskPtr[i] = 0;
 
-  typename ConnectFilterType::Pointer connectfilter2  = ConnectFilterType::New();
-  connectfilter2->SetInput(maskimg);
-  connectfilter2->SetBackgroundValue(0);
-  connectfilter2->FullyConnectedOff();
-  connectfilter2->Update();
-  maskimg =  connectfilter2->GetOutput();
-  typename LabelShapeKeepNObjectsImageFilterType::Pointer labelfilter2 =  LabelShapeKeepNObjectsImageFilterType::New();
-  labelfilter2->SetInput(connectfilter2->GetOutput());
-  labelfilter2->SetBackgroundValue( 0 );
-  labelfilter2->SetNumberOfObjects( 1 );
-  labelfilter2->SetAttribute(LabelShapeKeepNObjectsImageFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-  labelfilter2->Update();
-  maskimg =  labelfilter2->GetOutput();
-  maskimg->DisconnectPipeline();
+  this->GraftOutput( maskimg );
 
-  typename itk::ImageRegionIterator<OutputImageType> maskIterator2(maskimg,
-                                                                maskimg->GetLargestPossibleRegion());
-  maskIterator2.GoToBegin();
-  while(!maskIterator2.IsAtEnd()) {
-    if (maskIterator2.Get() != 0)
-      maskIterator2.Set(1);
-    ++maskIterator2;
-  }
+}
 
-  //Final Dilation
-  typename DilateFilter::Pointer dilate2 = DilateFilter::New();
-  StructuringElementType structuringElement2;
-
-  structuringElement2.SetRadius(10);
-  structuringElement2.CreateStructuringElement();
-  dilate2->SetInput( maskimg );
-  dilate2->SetKernel(structuringElement2);
-  dilate2->SetDilateValue(1);
-  dilate2->SetBackgroundValue(0);
-  dilate2->Update();
-  maskimg = dilate2->GetOutput();
-  maskimg->DisconnectPipeline();
+template<class TInputImage, class TOutputImage>
+typename BrainMaskFromCTFilter<TInputImage, TOutputImage>::OutputImagePointer
+BrainMaskFromCTFilter<TInputImage, TOutputImage>
+::morphology(OutputImagePointer mask, double radius,
+             typename MorphologyFilterType::OperationType op)
+{
+  typename MorphologyFilterType::Pointer morph = MorphologyFilterType::New();
+  morph->SetInput( mask );
+  morph->SetOperation( op );
+  morph->SetRadius( radius + 0.5 );
+  morph->SetForegroundValue( 1 );
+  morph->SetInsideValue( 1 );
+  morph->SetNumberOfThreads( this->GetNumberOfThreads() );
+  morph->Update();
+  OutputImagePointer result = morph->GetOutput();
+  result->DisconnectPipeline();
+  return result;
+}
 
-  typename itk::ImageRegionIterator<OutputImageType> maskIterator3(maskimg,
-                                                                maskimg->GetLargestPossibleRegion());
-  otsuIterator.GoToBegin();
-  while(!maskIterator3.IsAtEnd()) {
-      if (otsuIterator.Get() == 0 ) //&& threshIterator.Get() == 0)
-        maskIterator3.Set(0);
-    ++maskIterator3;
-    ++otsuIterator;
-  }
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+BrainMaskFromCTFilter<TInputImage, TOutputImage>
+::SweepThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
 
-  this->GraftOutput( maskimg );
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  const SizeValueType slices =
+      str->Filter->GetInput()->GetLargestPossibleRegion().GetSize()[2];
+  for (SizeValueType z = threadId; z < slices; z += threadCount)
+    str->Filter->SweepSlice(str->Mask, str->Otsu, z);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
 
+template<class TInputImage, class TOutputImage>
+void BrainMaskFromCTFilter<TInputImage, TOutputImage>
+::SweepSlice(OutputPixelType *mask, const OutputPixelType *otsu,
+             SizeValueType slice)
+{
+  const typename InputImageType::SizeType size =
+      this->GetInput()->GetLargestPossibleRegion().GetSize();
+  const OffsetValueType nx = size[0];
+  const OffsetValueType ny = size[1];
+  OutputPixelType * m = mask + slice * nx * ny;
+  const OutputPixelType * o = otsu + slice * nx * ny;
+
+  //First and last skull voxel of every row (X swipe) and column (Y swipe).
+  //Both swipes stop at the skull of the dilated mask, not at each other
+  std::vector<OffsetValueType> xFirst(ny, nx), xLast(ny, -1);
+  std::vector<OffsetValueType> yFirst(nx, ny), yLast(nx, -1);
+  for (OffsetValueType y = 0; y < ny; ++y)
+  {
+    const OutputPixelType * row = m + y * nx;
+    for (OffsetValueType x = 0; x < nx; ++x)
+    {
+      if (row[x] == 0)
+        continue;
+      if (xFirst[y] == nx)
+        xFirst[y] = x;
+      xLast[y] = x;
+      if (yFirst[x] == ny)
+        yFirst[x] = y;
+      yLast[x] = y;
+    }
+  }
+
+  //Whatever the swipes did not reach, is not skull and is foreground is brain
+  for (OffsetValueType y = 0; y < ny; ++y)
+  {
+    OutputPixelType * row = m + y * nx;
+    const OutputPixelType * orow = o + y * nx;
+    for (OffsetValueType x = 0; x < nx; ++x)
+    {
+      bool inside = row[x] == 0 && orow[x] != 0 &&
+          x > xFirst[y] && x < xLast[y] && y > yFirst[x] && y < yLast[x];
+      row[x] = inside ? 1 : 0;
+    }
+  }
 }
 
 template<class TInputImage, class TOutputImage>
@@ -0,0 +1,114 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKDISTANCEMORPHOLOGYIMAGEFILTER_H
+#define ITKDISTANCEMORPHOLOGYIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkMacro.h>
+#include <itkSignedMaurerDistanceMapImageFilter.h>
+#include <itkBinaryThresholdImageFilter.h>
+
+namespace itk {
+
+/** \class DistanceMorphologyImageFilter
+ * \brief Binary dilation or erosion with a ball of any radius, computed by
+ * thresholding a Euclidean distance map.
+ *
+ * Dilation keeps the voxels whose distance to the foreground is at most
+ * Radius; erosion keeps the foreground voxels whose distance to the
+ * background is larger than Radius. The distance map is multithreaded and
+ * its cost does not depend on the radius. With UseImageSpacing on, the
+ * radius is in physical units, otherwise it is in voxels.
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT DistanceMorphologyImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef DistanceMorphologyImageFilter                 Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(DistanceMorphologyImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+
+  typedef enum
+  {
+    DILATE = 0,
+    ERODE = 1
+  } OperationType;
+
+  itkGetConstMacro(Operation, OperationType);
+  itkSetMacro(Operation, OperationType);
+  itkGetConstMacro(Radius, double);
+  itkSetMacro(Radius, double);
+  itkGetConstMacro(UseImageSpacing, bool);
+  itkSetMacro(UseImageSpacing, bool);
+  itkBooleanMacro(UseImageSpacing);
+  /** Input value taken as foreground (any non-zero value when dilating). */
+  itkGetConstMacro(ForegroundValue, InputPixelType);
+  itkSetMacro(ForegroundValue, InputPixelType);
+  /** Value written to the kept voxels. */
+  itkGetConstMacro(InsideValue, OutputPixelType);
+  itkSetMacro(InsideValue, OutputPixelType);
+
+protected:
+  DistanceMorphologyImageFilter();
+  ~DistanceMorphologyImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  typedef float                                              DistancePixelType;
+  typedef Image<DistancePixelType,ImageDimension>            DistanceImageType;
+  typedef itk::SignedMaurerDistanceMapImageFilter< InputImageType,
+                                          DistanceImageType > DistanceFilterType;
+  typedef itk::BinaryThresholdImageFilter< DistanceImageType,
+                                          OutputImageType >  ThresholdFilterType;
+
+private:
+  DistanceMorphologyImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  OperationType   m_Operation;
+  double          m_Radius;
+  bool            m_UseImageSpacing;
+  InputPixelType  m_ForegroundValue;
+  OutputPixelType m_InsideValue;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkDistanceMorphologyImageFilter.txx"
+#endif
+
+#endif // ITKDISTANCEMORPHOLOGYIMAGEFILTER_H
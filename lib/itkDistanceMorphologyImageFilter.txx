@@ -0,0 +1,66 @@
+#ifndef ITKDISTANCEMORPHOLOGYIMAGEFILTER_TXX
+#define ITKDISTANCEMORPHOLOGYIMAGEFILTER_TXX
+
+#include "itkDistanceMorphologyImageFilter.h"
+#include <itkNumericTraits.h>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+DistanceMorphologyImageFilter<TInputImage, TOutputImage>::DistanceMorphologyImageFilter()
+{
+  m_Operation = DILATE;
+  m_Radius = 1;
+  m_UseImageSpacing = false;
+  m_ForegroundValue = NumericTraits<InputPixelType>::OneValue();
+  m_InsideValue = NumericTraits<OutputPixelType>::OneValue();
+}
+
+template<class TInputImage, class TOutputImage>
+void DistanceMorphologyImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  typename DistanceFilterType::Pointer distance = DistanceFilterType::New();
+  typename ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
+
+  //The distance is measured from the foreground when dilating and from the
+  //background when eroding. Either way the kept voxels are the ones whose
+  //squared distance is inside or outside [-inf, r^2]
+  distance->SetInput( this->GetInput() );
+  distance->SetUseImageSpacing( m_UseImageSpacing );
+  distance->SquaredDistanceOn();
+  distance->InsideIsPositiveOff();
+  if (m_Operation == DILATE)
+    distance->SetBackgroundValue( NumericTraits<InputPixelType>::ZeroValue() );
+  else
+    distance->SetBackgroundValue( m_ForegroundValue );
+  distance->SetNumberOfThreads( this->GetNumberOfThreads() );
+
+  const OutputPixelType zero = NumericTraits<OutputPixelType>::ZeroValue();
+  threshold->SetInput( distance->GetOutput() );
+  threshold->SetLowerThreshold( NumericTraits<DistancePixelType>::NonpositiveMin() );
+  threshold->SetUpperThreshold( static_cast<DistancePixelType>(m_Radius * m_Radius) );
+  threshold->SetInsideValue( m_Operation == DILATE ? m_InsideValue : zero );
+  threshold->SetOutsideValue( m_Operation == DILATE ? zero : m_InsideValue );
+  threshold->SetNumberOfThreads( this->GetNumberOfThreads() );
+  threshold->Update();
+
+  this->GraftOutput( threshold->GetOutput() );
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template <class TInputImage, class TOutputImage>
+void
+DistanceMorphologyImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Operation: " << m_Operation << std::endl;
+  os << indent << "Radius: " << m_Radius << std::endl;
+  os << indent << "UseImageSpacing: " << m_UseImageSpacing << std::endl;
+}
+
+} // end namespace
+#endif //ITKDISTANCEMORPHOLOGYIMAGEFILTER_TXX
@@ -0,0 +1,136 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKFUSEDPOINTWISEIMAGEFILTER_H
+#define ITKFUSEDPOINTWISEIMAGEFILTER_H
+
+#include <itkInPlaceImageFilter.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk {
+
+/** \class FusedPointwiseImageFilter
+ * \brief Applies a chain of pointwise operations in a single threaded pass.
+ *
+ * The operations are applied in the order they were added, with the same
+ * arithmetic in the pixel type as the ITK filter each one replaces
+ * (BinaryThresholdImageFilter, InvertIntensityImageFilter,
+ * MultiplyImageFilter and masking), so the chain gives the same output
+ * without an intermediate image per operation. Every line of the image is
+ * loaded once and all operations are applied to it before it is stored.
+ *
+ * When ComputeMinimumMaximum is on, the range of the output is gathered in
+ * the same pass. Without operations and in place, the pass only computes
+ * the range and leaves the image untouched.
+ */
+template< class TImage >
+class ITK_EXPORT FusedPointwiseImageFilter : public InPlaceImageFilter< TImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef FusedPointwiseImageFilter      Self;
+  typedef InPlaceImageFilter< TImage >   Superclass;
+  typedef SmartPointer< Self >           Pointer;
+  typedef SmartPointer< const Self >     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FusedPointwiseImageFilter, InPlaceImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
+
+  typedef TImage                             ImageType;
+  typedef typename ImageType::Pointer        ImagePointer;
+  typedef typename ImageType::PixelType      PixelType;
+  typedef typename ImageType::RegionType     RegionType;
+
+  typedef enum
+  {
+    THRESHOLD = 0,
+    INVERT = 1,
+    MULTIPLY = 2,
+    MULTIPLY_IMAGE = 3,
+    MASK = 4
+  } OperationType;
+
+  /** Inside where lower <= value <= upper, outside elsewhere. */
+  void AddThreshold(PixelType lower, PixelType upper, PixelType inside, PixelType outside);
+  /** maximum - value. */
+  void AddInvert(PixelType maximum);
+  void AddMultiply(PixelType factor);
+  /** Voxel by voxel product with image. */
+  void AddMultiply(const ImageType * image);
+  /** Outside where mask differs from maskValue. */
+  void AddMask(const ImageType * mask, PixelType maskValue, PixelType outside);
+
+  void ClearOperations();
+  SizeValueType GetNumberOfOperations() const
+  { return m_Operations.size(); }
+
+  itkGetConstMacro(ComputeMinimumMaximum, bool);
+  itkSetMacro(ComputeMinimumMaximum, bool);
+  itkBooleanMacro(ComputeMinimumMaximum);
+
+  /** Range of the output, when ComputeMinimumMaximum is on. */
+  itkGetConstMacro(Minimum, PixelType);
+  itkGetConstMacro(Maximum, PixelType);
+
+protected:
+  FusedPointwiseImageFilter();
+  ~FusedPointwiseImageFilter() {}
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  virtual void GenerateData();
+
+  struct Operation
+  {
+    OperationType Type;
+    PixelType     Lower;
+    PixelType     Upper;
+    PixelType     Inside;
+    PixelType     Outside;
+    /** Input holding the image of MULTIPLY_IMAGE and MASK. */
+    unsigned int  Input;
+  };
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  void ThreadedApply(const RegionType & region, ThreadIdType threadId);
+
+private:
+  FusedPointwiseImageFilter(const Self &); //purposely not implemented
+  void operator=(const Self &);            //purposely not implemented
+
+  std::vector< Operation >   m_Operations;
+  bool                       m_ComputeMinimumMaximum;
+  PixelType                  m_Minimum;
+  PixelType                  m_Maximum;
+  std::vector< PixelType >   m_ThreadMinimum;
+  std::vector< PixelType >   m_ThreadMaximum;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkFusedPointwiseImageFilter.txx"
+#endif
+
+#endif // ITKFUSEDPOINTWISEIMAGEFILTER_H
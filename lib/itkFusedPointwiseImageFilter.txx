@@ -0,0 +1,233 @@
+#ifndef ITKFUSEDPOINTWISEIMAGEFILTER_TXX
+#define ITKFUSEDPOINTWISEIMAGEFILTER_TXX
+
+#include "itkFusedPointwiseImageFilter.h"
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkNumericTraits.h>
+#include <algorithm>
+
+namespace itk {
+
+template< class TImage >
+FusedPointwiseImageFilter< TImage >
+::FusedPointwiseImageFilter()
+{
+  m_ComputeMinimumMaximum = false;
+  m_Minimum = NumericTraits< PixelType >::max();
+  m_Maximum = NumericTraits< PixelType >::NonpositiveMin();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::AddThreshold(PixelType lower, PixelType upper, PixelType inside, PixelType outside)
+{
+  Operation operation;
+  operation.Type = THRESHOLD;
+  operation.Lower = lower;
+  operation.Upper = upper;
+  operation.Inside = inside;
+  operation.Outside = outside;
+  operation.Input = 0;
+  m_Operations.push_back(operation);
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::AddInvert(PixelType maximum)
+{
+  Operation operation;
+  operation.Type = INVERT;
+  operation.Upper = maximum;
+  operation.Input = 0;
+  m_Operations.push_back(operation);
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::AddMultiply(PixelType factor)
+{
+  Operation operation;
+  operation.Type = MULTIPLY;
+  operation.Upper = factor;
+  operation.Input = 0;
+  m_Operations.push_back(operation);
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::AddMultiply(const ImageType * image)
+{
+  Operation operation;
+  operation.Type = MULTIPLY_IMAGE;
+  operation.Input = this->GetNumberOfIndexedInputs() > 0 ? this->GetNumberOfIndexedInputs() : 1;
+  this->SetNthInput(operation.Input, const_cast< ImageType * >(image));
+  m_Operations.push_back(operation);
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::AddMask(const ImageType * mask, PixelType maskValue, PixelType outside)
+{
+  Operation operation;
+  operation.Type = MASK;
+  operation.Inside = maskValue;
+  operation.Outside = outside;
+  operation.Input = this->GetNumberOfIndexedInputs() > 0 ? this->GetNumberOfIndexedInputs() : 1;
+  this->SetNthInput(operation.Input, const_cast< ImageType * >(mask));
+  m_Operations.push_back(operation);
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::ClearOperations()
+{
+  //Only the image being processed stays
+  this->SetNumberOfIndexedInputs(1);
+  m_Operations.clear();
+  this->Modified();
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::GenerateData()
+{
+  //In place, the output takes over the buffer of the input
+  this->AllocateOutputs();
+
+  const ThreadIdType numThreads = this->GetNumberOfThreads();
+  m_ThreadMinimum.assign(numThreads, NumericTraits< PixelType >::max());
+  m_ThreadMaximum.assign(numThreads, NumericTraits< PixelType >::NonpositiveMin());
+
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  m_Minimum = NumericTraits< PixelType >::max();
+  m_Maximum = NumericTraits< PixelType >::NonpositiveMin();
+  for (ThreadIdType t = 0; t < numThreads; ++t)
+  {
+    m_Minimum = std::min(m_Minimum, m_ThreadMinimum[t]);
+    m_Maximum = std::max(m_Maximum, m_ThreadMaximum[t]);
+  }
+}
+
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+FusedPointwiseImageFilter< TImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  RegionType splitRegion;
+  int total = str->Filter->SplitRequestedRegion(threadId, threadCount, splitRegion);
+  if (threadId < total)
+    str->Filter->ThreadedApply(splitRegion, threadId);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::ThreadedApply(const RegionType & region, ThreadIdType threadId)
+{
+  const ImageType * input = this->GetInput();
+  ImageType * output = this->GetOutput();
+  const bool store = !m_Operations.empty() || input->GetBufferPointer() != output->GetBufferPointer();
+
+  std::vector< const ImageType * > images(m_Operations.size(), static_cast< const ImageType * >(0));
+  for (unsigned int i = 0; i < m_Operations.size(); ++i)
+    if (m_Operations[i].Input > 0)
+      images[i] = static_cast< const ImageType * >(this->ProcessObject::GetInput(m_Operations[i].Input));
+
+  //One iteration per line of the region
+  const SizeValueType length = region.GetSize(0);
+  RegionType lines = region;
+  lines.SetSize(0, 1);
+  std::vector< PixelType > line(length);
+  PixelType minimum = m_ThreadMinimum[threadId];
+  PixelType maximum = m_ThreadMaximum[threadId];
+
+  for (ImageRegionConstIteratorWithIndex< ImageType > it(input, lines); !it.IsAtEnd(); ++it)
+  {
+    const typename ImageType::IndexType & index = it.GetIndex();
+    const PixelType * in = input->GetBufferPointer() + input->ComputeOffset(index);
+    PixelType * v = &line[0];
+    std::copy(in, in + length, v);
+
+    for (unsigned int i = 0; i < m_Operations.size(); ++i)
+    {
+      const Operation & operation = m_Operations[i];
+      const PixelType * other = images[i] ? images[i]->GetBufferPointer() + images[i]->ComputeOffset(index) : 0;
+      switch (operation.Type)
+      {
+        case THRESHOLD:
+          for (SizeValueType x = 0; x < length; ++x)
+            v[x] = operation.Lower <= v[x] && v[x] <= operation.Upper ? operation.Inside : operation.Outside;
+          break;
+        case INVERT:
+          for (SizeValueType x = 0; x < length; ++x)
+            v[x] = static_cast< PixelType >(operation.Upper - v[x]);
+          break;
+        case MULTIPLY:
+          for (SizeValueType x = 0; x < length; ++x)
+            v[x] = static_cast< PixelType >(v[x] * operation.Upper);
+          break;
+        case MULTIPLY_IMAGE:
+          for (SizeValueType x = 0; x < length; ++x)
+            v[x] = static_cast< PixelType >(v[x] * other[x]);
+          break;
+        case MASK:
+          for (SizeValueType x = 0; x < length; ++x)
+            v[x] = other[x] == operation.Inside ? v[x] : operation.Outside;
+          break;
+      }
+    }
+
+    if (m_ComputeMinimumMaximum)
+      for (SizeValueType x = 0; x < length; ++x)
+      {
+        minimum = v[x] < minimum ? v[x] : minimum;
+        maximum = v[x] > maximum ? v[x] : maximum;
+      }
+    if (store)
+      std::copy(v, v + length, output->GetBufferPointer() + output->ComputeOffset(index));
+  }
+
+  m_ThreadMinimum[threadId] = minimum;
+  m_ThreadMaximum[threadId] = maximum;
+}
+
+template< class TImage >
+void
+FusedPointwiseImageFilter< TImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfOperations: " << m_Operations.size() << std::endl;
+  os << indent << "ComputeMinimumMaximum: " << m_ComputeMinimumMaximum << std::endl;
+  os << indent << "Minimum: " << static_cast< typename NumericTraits< PixelType >::PrintType >(m_Minimum) << std::endl;
+  os << indent << "Maximum: " << static_cast< typename NumericTraits< PixelType >::PrintType >(m_Maximum) << std::endl;
+}
+
+} // end namespace
+#endif //ITKFUSEDPOINTWISEIMAGEFILTER_TXX
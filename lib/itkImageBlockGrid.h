@@ -0,0 +1,260 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKIMAGEBLOCKGRID_H
+#define ITKIMAGEBLOCKGRID_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class ImageBlockGrid
+ * \brief Layout of the (possibly overlapping) blocks a 3D volume was split
+ * into, as imagesplit does.
+ *
+ * Blocks are given by their file name, first voxel and size in the voxel
+ * grid of the whole volume. ComputeCores checks that they form a regular
+ * grid and cuts every overlap in half, so that the cores of the blocks tile
+ * the volume: every voxel is owned by exactly one block.
+ *
+ * The blocks can be saved to a descriptor file, one block per line as
+ * "index_x index_y index_z size_x size_y size_z fileName" after # comments.
+ * File names in the folder of the descriptor are written relative to it.
+ */
+class ImageBlockGrid : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageBlockGrid                Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageBlockGrid, Object);
+
+  struct Block
+  {
+    std::string    FileName;
+    IndexValueType Index[3];
+    SizeValueType  Size[3];
+    /** Part of the block owned by it, set by ComputeCores. */
+    IndexValueType CoreIndex[3];
+    SizeValueType  CoreSize[3];
+  };
+
+  void AddBlock(const std::string & fileName, const IndexValueType index[3],
+                const SizeValueType size[3])
+  {
+    Block block;
+    block.FileName = fileName;
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      block.Index[d] = block.CoreIndex[d] = index[d];
+      block.Size[d] = block.CoreSize[d] = size[d];
+    }
+    m_Blocks.push_back(block);
+    this->Modified();
+  }
+
+  void Clear()
+  {
+    m_Blocks.clear();
+    this->Modified();
+  }
+
+  SizeValueType GetNumberOfBlocks() const
+  { return m_Blocks.size(); }
+
+  const Block & GetBlock(SizeValueType b) const
+  { return m_Blocks[b]; }
+
+  void WriteDescriptor(const std::string & fileName) const
+  {
+    std::ofstream file(fileName.c_str());
+    if (!file)
+      itkExceptionMacro(<< "Cannot write " << fileName);
+    const std::string folder = GetFolder(fileName);
+    file << "# index_x index_y index_z size_x size_y size_z file" << std::endl;
+    for (SizeValueType b = 0; b < m_Blocks.size(); ++b)
+    {
+      const Block & block = m_Blocks[b];
+      std::string name = block.FileName;
+      if (!folder.empty() && name.compare(0, folder.length(), folder) == 0)
+        name = name.substr(folder.length());
+      file << block.Index[0] << " " << block.Index[1] << " " << block.Index[2] << " "
+           << block.Size[0] << " " << block.Size[1] << " " << block.Size[2] << " "
+           << name << std::endl;
+    }
+    if (!file)
+      itkExceptionMacro(<< "Cannot write " << fileName);
+  }
+
+  /** Replaces the blocks with those of the descriptor file. */
+  void ReadDescriptor(const std::string & fileName)
+  {
+    std::ifstream file(fileName.c_str());
+    if (!file)
+      itkExceptionMacro(<< "Cannot read " << fileName);
+    const std::string folder = GetFolder(fileName);
+    m_Blocks.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream fields(line);
+      IndexValueType index[3];
+      SizeValueType size[3];
+      std::string name;
+      fields >> index[0] >> index[1] >> index[2] >> size[0] >> size[1] >> size[2] >> std::ws;
+      std::getline(fields, name);
+      if (fields.fail() || name.empty())
+        itkExceptionMacro(<< "Wrong line in " << fileName << ": " << line);
+      if (name[0] != '/')
+        name = folder + name;
+      this->AddBlock(name, index, size);
+    }
+    if (m_Blocks.empty())
+      itkExceptionMacro(<< "No blocks in " << fileName);
+  }
+
+  /** First voxel and size of the whole volume, set by ComputeCores. */
+  const IndexValueType * GetIndex() const
+  { return m_Index; }
+  const SizeValueType * GetSize() const
+  { return m_Size; }
+
+  /** Checks the blocks form a grid and sets their cores. */
+  void ComputeCores()
+  {
+    if (m_Blocks.empty())
+      itkExceptionMacro(<< "No blocks");
+
+    std::vector< unsigned int > cell[3];
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      //Distinct extents along d, which must be ordered the same by start and end
+      std::vector< std::pair< IndexValueType, IndexValueType > > extents;
+      for (SizeValueType b = 0; b < m_Blocks.size(); ++b)
+        extents.push_back(std::make_pair(m_Blocks[b].Index[d],
+                                         m_Blocks[b].Index[d] + (IndexValueType)m_Blocks[b].Size[d]));
+      std::sort(extents.begin(), extents.end());
+      extents.erase(std::unique(extents.begin(), extents.end()), extents.end());
+
+      m_Cuts[d].assign(1, extents[0].first);
+      for (SizeValueType k = 1; k < extents.size(); ++k)
+      {
+        if (extents[k].first == extents[k - 1].first || extents[k].second <= extents[k - 1].second)
+          itkExceptionMacro(<< "The blocks do not form a grid along dimension " << d);
+        if (extents[k].first > extents[k - 1].second)
+          itkExceptionMacro(<< "Gap between blocks along dimension " << d);
+        const IndexValueType cut = (extents[k].first + extents[k - 1].second) / 2;
+        if (cut <= m_Cuts[d].back())
+          itkExceptionMacro(<< "The blocks do not form a grid along dimension " << d);
+        m_Cuts[d].push_back(cut);
+      }
+      m_Cuts[d].push_back(extents.back().second);
+      m_Index[d] = m_Cuts[d].front();
+      m_Size[d] = m_Cuts[d].back() - m_Cuts[d].front();
+
+      cell[d].resize(m_Blocks.size());
+      for (SizeValueType b = 0; b < m_Blocks.size(); ++b)
+      {
+        const IndexValueType start = m_Blocks[b].Index[d];
+        const unsigned int k = std::lower_bound(extents.begin(), extents.end(),
+            std::make_pair(start, start + (IndexValueType)m_Blocks[b].Size[d])) - extents.begin();
+        cell[d][b] = k;
+        m_Blocks[b].CoreIndex[d] = m_Cuts[d][k];
+        m_Blocks[b].CoreSize[d] = m_Cuts[d][k + 1] - m_Cuts[d][k];
+      }
+    }
+
+    m_Cells.assign((m_Cuts[0].size() - 1) * (m_Cuts[1].size() - 1) * (m_Cuts[2].size() - 1),
+                   m_Blocks.size());
+    for (SizeValueType b = 0; b < m_Blocks.size(); ++b)
+    {
+      const SizeValueType c = (cell[2][b] * (m_Cuts[1].size() - 1) + cell[1][b])
+          * (m_Cuts[0].size() - 1) + cell[0][b];
+      if (m_Cells[c] != m_Blocks.size())
+        itkExceptionMacro(<< m_Blocks[b].FileName << " and " << m_Blocks[m_Cells[c]].FileName
+                          << " are at the same position");
+      m_Cells[c] = b;
+    }
+  }
+
+  /** Block whose core holds the voxel, or GetNumberOfBlocks() if none. */
+  SizeValueType FindCoreBlock(const IndexValueType index[3]) const
+  {
+    SizeValueType c = 0;
+    for (int d = 2; d >= 0; --d)
+    {
+      if (index[d] < m_Cuts[d].front() || index[d] >= m_Cuts[d].back())
+        return m_Blocks.size();
+      const SizeValueType k = std::upper_bound(m_Cuts[d].begin(), m_Cuts[d].end(), index[d])
+          - m_Cuts[d].begin() - 1;
+      c = c * (m_Cuts[d].size() - 1) + k;
+    }
+    return m_Cells[c];
+  }
+
+protected:
+  ImageBlockGrid()
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      m_Index[d] = 0;
+      m_Size[d] = 0;
+    }
+  }
+  ~ImageBlockGrid() {}
+
+  /** Folder of a file name, with its trailing slash. */
+  static std::string GetFolder(const std::string & fileName)
+  {
+    const std::string::size_type slash = fileName.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : fileName.substr(0, slash + 1);
+  }
+
+  void PrintSelf(std::ostream & os, Indent indent) const
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "NumberOfBlocks: " << m_Blocks.size() << std::endl;
+    os << indent << "Size: " << m_Size[0] << " " << m_Size[1] << " " << m_Size[2] << std::endl;
+  }
+
+private:
+  ImageBlockGrid(const Self &); //purposely not implemented
+  void operator=(const Self &); //purposely not implemented
+
+  std::vector< Block >          m_Blocks;
+  IndexValueType                m_Index[3];
+  SizeValueType                 m_Size[3];
+  /** Core boundaries along every dimension. */
+  std::vector< IndexValueType > m_Cuts[3];
+  /** Block of every grid cell, x fastest. */
+  std::vector< SizeValueType >  m_Cells;
+};
+
+} //end namespace
+
+#endif // ITKIMAGEBLOCKGRID_H
@@ -0,0 +1,165 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKIMAGEBLOCKRECOMBINER_H
+#define ITKIMAGEBLOCKRECOMBINER_H
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkMultiThreader.h>
+#include "itkImageBlockGrid.h"
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class ImageBlockRecombiner
+ * \brief Recombines processed blocks (see ImageBlockSplitter) into whole
+ * volumes, streaming the output along z.
+ *
+ * Every channel is a set of blocks named by an input prefix followed by the
+ * file name of the block in the grid (e.g. "segmented/segmented_" for
+ * "split/Plac51_0.mhd" gives "segmented/segmented_Plac51_0.mhd"), and is
+ * written to its own output file. The output takes its geometry from the
+ * first block of the first channel.
+ *
+ * The output is produced one slab at a time, the slabs being the z extents
+ * of the block cores. For every slab, only the parts of the blocks that
+ * intersect it are read, all channels at once, and the slab is pasted into
+ * the output files, which must be in a format that can be written in pieces
+ * (e.g. MetaImage). Where blocks overlap, the output is given by the Policy:
+ * CROP takes the voxel from the block owning it (see ImageBlockGrid), MAXIMUM
+ * the largest value and FEATHER a weighted mean, the weight of a block
+ * falling linearly to the faces it shares with other blocks.
+ */
+template< class TImage >
+class ITK_EXPORT ImageBlockRecombiner : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageBlockRecombiner         Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageBlockRecombiner, Object);
+
+  typedef TImage                                ImageType;
+  typedef typename ImageType::PixelType         PixelType;
+  typedef typename ImageType::Pointer           ImagePointer;
+  typedef typename ImageType::RegionType        RegionType;
+
+  typedef enum
+  {
+    CROP = 0,
+    MAXIMUM = 1,
+    FEATHER = 2
+  } PolicyType;
+
+  itkSetConstObjectMacro(Grid, ImageBlockGrid);
+
+  itkGetConstMacro(Policy, PolicyType);
+  itkSetMacro(Policy, PolicyType);
+
+  /** Blocks read at once. */
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Adds a channel read from inputPrefix + block file name and written to
+   * outputFileName. */
+  void AddChannel(const std::string & inputPrefix, const std::string & outputFileName)
+  {
+    m_InputPrefixes.push_back(inputPrefix);
+    m_OutputFileNames.push_back(outputFileName);
+    this->Modified();
+  }
+
+  /** Writes all channels. */
+  void Compute();
+
+protected:
+  ImageBlockRecombiner();
+  ~ImageBlockRecombiner() { }
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  typedef enum
+  {
+    READ = 0,
+    COMBINE = 1,
+    WRITE = 2
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Part of a block read for the current slab, in volume coordinates. */
+  struct Piece
+  {
+    SizeValueType  Block;
+    RegionType     Region;
+    /** Index in Image minus index in the volume. */
+    IndexValueType Shift[3];
+    ImagePointer   Image;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Runs the current phase on m_NumberOfThreads threads. */
+  void Execute();
+
+  void ThreadedRead(SizeValueType p);
+  /** Combines the pieces over the lines [first, last) of the slab. */
+  void ThreadedCombine(SizeValueType first, SizeValueType last);
+  void ThreadedWrite(unsigned int c);
+
+  /** Name of the block b of channel c. */
+  std::string GetBlockFileName(SizeValueType b, unsigned int c) const;
+
+  /** Weight of a voxel (volume coordinates) of block b for FEATHER. */
+  double GetWeight(SizeValueType b, const IndexValueType index[3]) const;
+
+private:
+  ImageBlockRecombiner(const Self &); //purposely not implemented
+  void operator=(const Self &);       //purposely not implemented
+
+  ImageBlockGrid::ConstPointer m_Grid;
+  PolicyType                   m_Policy;
+  ThreadIdType                 m_NumberOfThreads;
+  std::vector< std::string >   m_InputPrefixes;
+  std::vector< std::string >   m_OutputFileNames;
+
+  PhaseType                    m_Phase;
+  /** Whole volume, with the geometry of the output. */
+  ImagePointer                 m_Volume;
+  RegionType                   m_Slab;
+  /** Pieces of the current slab, the channels of a block next to each other. */
+  std::vector< Piece >         m_Pieces;
+  /** Output slab and, for FEATHER, weighted sums of every channel. */
+  std::vector< ImagePointer >  m_Outputs;
+  std::vector< std::vector< double > > m_Sums;
+  std::vector< double >        m_Weights;
+  std::vector< std::string >   m_ThreadErrors;
+};
+
+}
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageBlockRecombiner.txx"
+#endif
+
+#endif // ITKIMAGEBLOCKRECOMBINER_H
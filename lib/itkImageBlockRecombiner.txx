@@ -0,0 +1,391 @@
+#ifndef ITKIMAGEBLOCKRECOMBINER_TXX
+#define ITKIMAGEBLOCKRECOMBINER_TXX
+
+#include "itkImageBlockRecombiner.h"
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageIORegion.h>
+#include <itkNumericTraits.h>
+#include <itkMath.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace itk {
+
+template< class TImage >
+ImageBlockRecombiner< TImage >
+::ImageBlockRecombiner()
+{
+  m_Policy = CROP;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_Phase = READ;
+}
+
+template< class TImage >
+std::string
+ImageBlockRecombiner< TImage >
+::GetBlockFileName(SizeValueType b, unsigned int c) const
+{
+  const std::string & fileName = m_Grid->GetBlock(b).FileName;
+  const std::string::size_type slash = fileName.find_last_of("/\\");
+  return m_InputPrefixes[c] + fileName.substr(slash == std::string::npos ? 0 : slash + 1);
+}
+
+template< class TImage >
+double
+ImageBlockRecombiner< TImage >
+::GetWeight(SizeValueType b, const IndexValueType index[3]) const
+{
+  //Distance to the nearest face shared with another block, along every dimension
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  double weight = 1.0;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    const IndexValueType start = block.Index[d];
+    const IndexValueType end = start + (IndexValueType)block.Size[d];
+    IndexValueType distance = NumericTraits< IndexValueType >::max();
+    if (start > m_Grid->GetIndex()[d])
+      distance = index[d] - start + 1;
+    if (end < m_Grid->GetIndex()[d] + (IndexValueType)m_Grid->GetSize()[d])
+      distance = std::min(distance, end - index[d]);
+    if (distance != NumericTraits< IndexValueType >::max())
+      weight *= distance;
+  }
+  return weight;
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::Compute()
+{
+  typedef ImageFileReader< ImageType > ReaderType;
+
+  if (!m_Grid)
+    itkExceptionMacro(<< "Grid not set");
+  if (m_InputPrefixes.empty())
+    itkExceptionMacro(<< "No channels");
+
+  const unsigned int numChannels = m_InputPrefixes.size();
+  const SizeValueType numBlocks = m_Grid->GetNumberOfBlocks();
+
+  //Geometry of the output, from the header of the first block
+  const ImageBlockGrid::Block & first = m_Grid->GetBlock(0);
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( this->GetBlockFileName(0, 0) );
+  reader->UpdateOutputInformation();
+  const ImageType * header = reader->GetOutput();
+  typename ImageType::IndexType originIndex = header->GetLargestPossibleRegion().GetIndex();
+  typename ImageType::SizeType size;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    originIndex[d] += m_Grid->GetIndex()[d] - first.Index[d];
+    size[d] = m_Grid->GetSize()[d];
+  }
+  typename ImageType::PointType origin;
+  header->TransformIndexToPhysicalPoint(originIndex, origin);
+  m_Volume = ImageType::New();
+  m_Volume->SetRegions( size );
+  m_Volume->SetSpacing( header->GetSpacing() );
+  m_Volume->SetDirection( header->GetDirection() );
+  m_Volume->SetOrigin( origin );
+
+  //Pasting into an existing file of another size fails
+  for (unsigned int c = 0; c < numChannels; ++c)
+    std::remove( m_OutputFileNames[c].c_str() );
+
+  //The slabs are the z extents of the cores
+  std::vector< std::pair< IndexValueType, SizeValueType > > slabs;
+  for (SizeValueType b = 0; b < numBlocks; ++b)
+    slabs.push_back(std::make_pair(m_Grid->GetBlock(b).CoreIndex[2], m_Grid->GetBlock(b).CoreSize[2]));
+  std::sort(slabs.begin(), slabs.end());
+  slabs.erase(std::unique(slabs.begin(), slabs.end()), slabs.end());
+
+  const IndexValueType * gridIndex = m_Grid->GetIndex();
+  m_Outputs.resize(numChannels);
+  for (SizeValueType s = 0; s < slabs.size(); ++s)
+  {
+    m_Slab = m_Volume->GetLargestPossibleRegion();
+    m_Slab.SetIndex(2, slabs[s].first - gridIndex[2]);
+    m_Slab.SetSize(2, slabs[s].second);
+
+    m_Pieces.clear();
+    for (SizeValueType b = 0; b < numBlocks; ++b)
+    {
+      const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+      RegionType region;
+      for (unsigned int d = 0; d < 3; ++d)
+      {
+        if (m_Policy == CROP)
+        {
+          region.SetIndex(d, block.CoreIndex[d] - gridIndex[d]);
+          region.SetSize(d, block.CoreSize[d]);
+        }
+        else
+        {
+          region.SetIndex(d, block.Index[d] - gridIndex[d]);
+          region.SetSize(d, block.Size[d]);
+        }
+      }
+      if (!region.Crop(m_Slab))
+        continue;
+      Piece piece;
+      piece.Block = b;
+      piece.Region = region;
+      for (unsigned int c = 0; c < numChannels; ++c)
+        m_Pieces.push_back(piece);
+    }
+
+    for (unsigned int c = 0; c < numChannels; ++c)
+    {
+      m_Outputs[c] = ImageType::New();
+      m_Outputs[c]->CopyInformation( m_Volume );
+      m_Outputs[c]->SetLargestPossibleRegion( m_Volume->GetLargestPossibleRegion() );
+      m_Outputs[c]->SetBufferedRegion( m_Slab );
+      m_Outputs[c]->SetRequestedRegion( m_Slab );
+      m_Outputs[c]->Allocate();
+      if (m_Policy == MAXIMUM)
+        m_Outputs[c]->FillBuffer( NumericTraits<PixelType>::NonpositiveMin() );
+      else
+        m_Outputs[c]->FillBuffer( NumericTraits<PixelType>::ZeroValue() );
+    }
+    if (m_Policy == FEATHER)
+    {
+      m_Sums.assign(numChannels, std::vector< double >(m_Slab.GetNumberOfPixels(), 0.0));
+      m_Weights.assign(m_Slab.GetNumberOfPixels(), 0.0);
+    }
+
+    m_Phase = READ;
+    this->Execute();
+    m_Phase = COMBINE;
+    this->Execute();
+    m_Pieces.clear();
+    m_Sums.clear();
+    m_Weights.clear();
+    m_Phase = WRITE;
+    this->Execute();
+  }
+  m_Outputs.clear();
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::Execute()
+{
+  ThreadStruct str;
+  str.Filter = this;
+  m_ThreadErrors.assign(m_NumberOfThreads, std::string());
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(m_NumberOfThreads);
+  threader->SetSingleMethod(this->ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (ThreadIdType t = 0; t < m_ThreadErrors.size(); ++t)
+    if (!m_ThreadErrors[t].empty())
+    {
+      m_Pieces.clear();
+      m_Outputs.clear();
+      itkExceptionMacro(<< m_ThreadErrors[t]);
+    }
+}
+
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+ImageBlockRecombiner< TImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  try
+  {
+    switch (filter->m_Phase)
+    {
+      case READ:
+        for (SizeValueType p = threadId; p < filter->m_Pieces.size(); p += threadCount)
+          filter->ThreadedRead(p);
+        break;
+      case COMBINE:
+      {
+        //Lines of the slab, along x
+        const SizeValueType n = filter->m_Slab.GetSize(1) * filter->m_Slab.GetSize(2);
+        filter->ThreadedCombine(n * threadId / threadCount, n * (threadId + 1) / threadCount);
+        break;
+      }
+      case WRITE:
+        for (unsigned int c = threadId; c < filter->m_Outputs.size(); c += threadCount)
+          filter->ThreadedWrite(c);
+        break;
+    }
+  }
+  catch( ExceptionObject & err )
+  {
+    filter->m_ThreadErrors[threadId] = err.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::ThreadedRead(SizeValueType p)
+{
+  typedef ImageFileReader< ImageType > ReaderType;
+
+  Piece & piece = m_Pieces[p];
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(piece.Block);
+  const unsigned int c = p % m_InputPrefixes.size();
+
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( this->GetBlockFileName(piece.Block, c) );
+  reader->UpdateOutputInformation();
+  const RegionType largest = reader->GetOutput()->GetLargestPossibleRegion();
+  RegionType region = piece.Region;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    if (largest.GetSize(d) != block.Size[d])
+      itkExceptionMacro(<< this->GetBlockFileName(piece.Block, c) << " does not have the size of its block");
+    piece.Shift[d] = largest.GetIndex(d) - (block.Index[d] - m_Grid->GetIndex()[d]);
+    region.SetIndex(d, region.GetIndex(d) + piece.Shift[d]);
+  }
+  reader->GetOutput()->SetRequestedRegion( region );
+  reader->Update();
+  piece.Image = reader->GetOutput();
+  piece.Image->DisconnectPipeline();
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::ThreadedCombine(SizeValueType first, SizeValueType last)
+{
+  const unsigned int numChannels = m_InputPrefixes.size();
+  const IndexValueType x0 = m_Slab.GetIndex(0);
+  const SizeValueType width = m_Slab.GetSize(0);
+  std::vector< double > weights(width);
+
+  for (SizeValueType line = first; line < last; ++line)
+  {
+    typename ImageType::IndexType index = m_Slab.GetIndex();
+    index[1] += line % m_Slab.GetSize(1);
+    index[2] += line / m_Slab.GetSize(1);
+    const SizeValueType lineOffset = line * width;
+
+    for (SizeValueType p = 0; p < m_Pieces.size(); p += numChannels)
+    {
+      const RegionType & region = m_Pieces[p].Region;
+      if (index[1] < region.GetIndex(1) || index[1] >= region.GetIndex(1) + (IndexValueType)region.GetSize(1)
+          || index[2] < region.GetIndex(2) || index[2] >= region.GetIndex(2) + (IndexValueType)region.GetSize(2))
+        continue;
+      const IndexValueType start = region.GetIndex(0);
+      const SizeValueType length = region.GetSize(0);
+
+      //The weights of the block are shared by all channels
+      if (m_Policy == FEATHER)
+      {
+        const IndexValueType * gridIndex = m_Grid->GetIndex();
+        IndexValueType voxel[3] = { 0, index[1] + gridIndex[1], index[2] + gridIndex[2] };
+        for (SizeValueType x = 0; x < length; ++x)
+        {
+          voxel[0] = start + x + gridIndex[0];
+          weights[x] = this->GetWeight(m_Pieces[p].Block, voxel);
+          m_Weights[lineOffset + start - x0 + x] += weights[x];
+        }
+      }
+
+      for (unsigned int c = 0; c < numChannels; ++c)
+      {
+        const Piece & piece = m_Pieces[p + c];
+        typename ImageType::IndexType pieceIndex = index;
+        pieceIndex[0] = start;
+        for (unsigned int d = 0; d < 3; ++d)
+          pieceIndex[d] += piece.Shift[d];
+        const PixelType * in = piece.Image->GetBufferPointer() + piece.Image->ComputeOffset(pieceIndex);
+        index[0] = start;
+        PixelType * out = m_Outputs[c]->GetBufferPointer() + m_Outputs[c]->ComputeOffset(index);
+
+        switch (m_Policy)
+        {
+          case CROP:
+            std::copy(in, in + length, out);
+            break;
+          case MAXIMUM:
+            for (SizeValueType x = 0; x < length; ++x)
+              out[x] = std::max(out[x], in[x]);
+            break;
+          case FEATHER:
+          {
+            double * sum = &m_Sums[c][lineOffset + start - x0];
+            for (SizeValueType x = 0; x < length; ++x)
+              sum[x] += weights[x] * in[x];
+            break;
+          }
+        }
+      }
+    }
+
+    if (m_Policy == FEATHER)
+    {
+      const double * weight = &m_Weights[lineOffset];
+      for (unsigned int c = 0; c < numChannels; ++c)
+      {
+        const double * sum = &m_Sums[c][lineOffset];
+        index[0] = x0;
+        PixelType * out = m_Outputs[c]->GetBufferPointer() + m_Outputs[c]->ComputeOffset(index);
+        for (SizeValueType x = 0; x < width; ++x)
+        {
+          if (weight[x] <= 0.0)
+            continue;
+          if (NumericTraits<PixelType>::is_integer)
+            out[x] = Math::Round< PixelType >(sum[x] / weight[x]);
+          else
+            out[x] = static_cast< PixelType >(sum[x] / weight[x]);
+        }
+      }
+    }
+  }
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::ThreadedWrite(unsigned int c)
+{
+  typedef ImageFileWriter< ImageType > WriterType;
+
+  ImageIORegion ioRegion(3);
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    ioRegion.SetIndex(d, m_Slab.GetIndex(d));
+    ioRegion.SetSize(d, m_Slab.GetSize(d));
+  }
+
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( m_Outputs[c] );
+  writer->SetFileName( m_OutputFileNames[c] );
+  writer->SetIORegion( ioRegion );
+  writer->Update();
+}
+
+template< class TImage >
+void
+ImageBlockRecombiner< TImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Policy: " << m_Policy << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+  for (unsigned int c = 0; c < m_InputPrefixes.size(); ++c)
+    os << indent << "Channel " << c << ": " << m_InputPrefixes[c] << " -> " << m_OutputFileNames[c] << std::endl;
+}
+
+} // end namespace
+#endif //ITKIMAGEBLOCKRECOMBINER_TXX
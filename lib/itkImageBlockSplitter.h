@@ -0,0 +1,165 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKIMAGEBLOCKSPLITTER_H
+#define ITKIMAGEBLOCKSPLITTER_H
+
+#include <itkImage.h>
+#include <itkImageSource.h>
+#include <itkObject.h>
+#include <itkMultiThreader.h>
+#include <itkSimpleFastMutexLock.h>
+#include "itkImageBlockGrid.h"
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class ImageBlockSplitter
+ * \brief Splits a 3D image file into overlapping blocks, as imagesplit does,
+ * without loading the whole image.
+ *
+ * The image is cut into as few blocks per dimension as keep every block
+ * within MaximumBlockSize voxels, neighbouring blocks sharing Overlap voxels.
+ * The image is read one row of blocks (all of x, the y and z extents of a
+ * block) at a time, which only reads that part of the file when its format
+ * can be streamed (e.g. MetaImage). Every block is converted to the output
+ * pixel type, linearly mapping [WindowMinimum, WindowMaximum] to the range
+ * of the output type when Rescale is on and clamping to it otherwise, and
+ * written to OutputPrefix_<n><Extension>, x fastest.
+ *
+ * The image can also be produced by a Source that supports requested
+ * regions (e.g. SliceStackImageSource) instead of read from FileName.
+ *
+ * The blocks of a row are written by all threads while the first one reads
+ * the next row, so memory holds two rows. The blocks are finally saved to the
+ * descriptor file OutputPrefix_info.txt (see ImageBlockGrid).
+ */
+template< class TInputImage, class TOutputImage >
+class ITK_EXPORT ImageBlockSplitter : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageBlockSplitter           Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageBlockSplitter, Object);
+
+  typedef TInputImage                           InputImageType;
+  typedef TOutputImage                          OutputImageType;
+  typedef typename InputImageType::PixelType    InputPixelType;
+  typedef typename OutputImageType::PixelType   OutputPixelType;
+  typedef typename InputImageType::Pointer      InputImagePointer;
+  typedef typename InputImageType::RegionType   RegionType;
+  typedef ImageSource< InputImageType >         SourceType;
+
+  itkGetStringMacro(FileName);
+  itkSetStringMacro(FileName);
+  /** Source of the image, used instead of FileName when set. */
+  itkGetObjectMacro(Source, SourceType);
+  itkSetObjectMacro(Source, SourceType);
+  itkGetStringMacro(OutputPrefix);
+  itkSetStringMacro(OutputPrefix);
+  /** Extension of the blocks, which sets their format [.mhd]. */
+  itkGetStringMacro(Extension);
+  itkSetStringMacro(Extension);
+
+  itkGetConstMacro(MaximumBlockSize, SizeValueType);
+  itkSetMacro(MaximumBlockSize, SizeValueType);
+  itkGetConstMacro(Overlap, SizeValueType);
+  itkSetMacro(Overlap, SizeValueType);
+
+  itkGetConstMacro(Rescale, bool);
+  itkSetMacro(Rescale, bool);
+  itkBooleanMacro(Rescale);
+  itkGetConstMacro(WindowMinimum, double);
+  itkSetMacro(WindowMinimum, double);
+  itkGetConstMacro(WindowMaximum, double);
+  itkSetMacro(WindowMaximum, double);
+
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Writes the blocks and the descriptor. */
+  void Compute();
+
+  /** Blocks written by Compute. */
+  const ImageBlockGrid * GetGrid() const
+  { return m_Grid.GetPointer(); }
+
+  /** Name of the descriptor file written by Compute. */
+  std::string GetDescriptorFileName() const
+  { return m_OutputPrefix + "_info.txt"; }
+
+protected:
+  ImageBlockSplitter();
+  ~ImageBlockSplitter() { }
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Starts and sizes of the blocks along a dimension of the given size. */
+  void SplitDimension(SizeValueType size, std::vector< IndexValueType > & starts,
+                      std::vector< SizeValueType > & sizes) const;
+
+  /** Reads row r of blocks into m_Rows[r % 2]. */
+  void ReadRow(SizeValueType r);
+  void WriteBlock(SizeValueType b, const InputImageType * row);
+
+private:
+  ImageBlockSplitter(const Self &); //purposely not implemented
+  void operator=(const Self &);     //purposely not implemented
+
+  std::string                  m_FileName;
+  typename SourceType::Pointer m_Source;
+  std::string                  m_OutputPrefix;
+  std::string                  m_Extension;
+  SizeValueType                m_MaximumBlockSize;
+  SizeValueType                m_Overlap;
+  bool                         m_Rescale;
+  double                       m_WindowMinimum;
+  double                       m_WindowMaximum;
+  ThreadIdType                 m_NumberOfThreads;
+
+  ImageBlockGrid::Pointer      m_Grid;
+  /** Header of the whole image. */
+  InputImagePointer            m_Image;
+  /** Number of blocks along x, and index of the current row. */
+  SizeValueType                m_BlocksPerRow;
+  SizeValueType                m_Row;
+  SizeValueType                m_NumberOfRows;
+  InputImagePointer            m_Rows[2];
+  /** Whole image, when its format cannot be streamed. */
+  InputImagePointer            m_WholeImage;
+  SizeValueType                m_NextBlock;
+  SimpleFastMutexLock          m_Mutex;
+  std::vector< std::string >   m_ThreadErrors;
+};
+
+}
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageBlockSplitter.txx"
+#endif
+
+#endif // ITKIMAGEBLOCKSPLITTER_H
@@ -0,0 +1,318 @@
+#ifndef ITKIMAGEBLOCKSPLITTER_TXX
+#define ITKIMAGEBLOCKSPLITTER_TXX
+
+#include "itkImageBlockSplitter.h"
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkNumericTraits.h>
+#include <itkMath.h>
+#include <sstream>
+
+namespace itk {
+
+template< class TInputImage, class TOutputImage >
+ImageBlockSplitter< TInputImage, TOutputImage >
+::ImageBlockSplitter()
+{
+  m_Extension = ".mhd";
+  m_MaximumBlockSize = 300;
+  m_Overlap = 50;
+  m_Rescale = false;
+  m_WindowMinimum = 0.0;
+  m_WindowMaximum = 0.0;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_Grid = ImageBlockGrid::New();
+  m_BlocksPerRow = 0;
+  m_Row = 0;
+  m_NumberOfRows = 0;
+  m_NextBlock = 0;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ImageBlockSplitter< TInputImage, TOutputImage >
+::SplitDimension(SizeValueType size, std::vector< IndexValueType > & starts,
+                 std::vector< SizeValueType > & sizes) const
+{
+  //The cores are cut evenly and every block extends half the overlap past them
+  const SizeValueType step = m_MaximumBlockSize - m_Overlap;
+  const SizeValueType n = size > m_MaximumBlockSize ? (size + step - 1) / step : 1;
+  starts.resize(n);
+  sizes.resize(n);
+  for (SizeValueType k = 0; k < n; ++k)
+  {
+    const IndexValueType start = size * k / n;
+    const IndexValueType end = size * (k + 1) / n;
+    starts[k] = k == 0 ? 0 : std::max< IndexValueType >(0, start - m_Overlap / 2);
+    sizes[k] = (k == n - 1 ? (IndexValueType)size
+        : std::min< IndexValueType >(size, end + m_Overlap - m_Overlap / 2)) - starts[k];
+  }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ImageBlockSplitter< TInputImage, TOutputImage >
+::Compute()
+{
+  typedef ImageFileReader< InputImageType > ReaderType;
+
+  if ((m_FileName.empty() && !m_Source) || m_OutputPrefix.empty())
+    itkExceptionMacro(<< "FileName or Source, and OutputPrefix must be set");
+  if (2 * m_Overlap > m_MaximumBlockSize)
+    itkExceptionMacro(<< "Overlap must be at most half of MaximumBlockSize");
+  if (m_Rescale && m_WindowMaximum <= m_WindowMinimum)
+    itkExceptionMacro(<< "WindowMaximum must be greater than WindowMinimum");
+
+  if (m_Source)
+  {
+    m_Source->UpdateOutputInformation();
+    m_Image = m_Source->GetOutput();
+  }
+  else
+  {
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( m_FileName );
+    reader->UpdateOutputInformation();
+    m_Image = reader->GetOutput();
+  }
+  m_Image->DisconnectPipeline();
+  const typename InputImageType::SizeType size = m_Image->GetLargestPossibleRegion().GetSize();
+
+  std::vector< IndexValueType > starts[3];
+  std::vector< SizeValueType > sizes[3];
+  for (unsigned int d = 0; d < 3; ++d)
+    this->SplitDimension(size[d], starts[d], sizes[d]);
+
+  m_Grid->Clear();
+  for (SizeValueType z = 0; z < starts[2].size(); ++z)
+    for (SizeValueType y = 0; y < starts[1].size(); ++y)
+      for (SizeValueType x = 0; x < starts[0].size(); ++x)
+      {
+        const IndexValueType index[3] = { starts[0][x], starts[1][y], starts[2][z] };
+        const SizeValueType blockSize[3] = { sizes[0][x], sizes[1][y], sizes[2][z] };
+        std::ostringstream fileName;
+        fileName << m_OutputPrefix << "_" << m_Grid->GetNumberOfBlocks() << m_Extension;
+        m_Grid->AddBlock(fileName.str(), index, blockSize);
+      }
+  m_Grid->ComputeCores();
+  m_BlocksPerRow = starts[0].size();
+  m_NumberOfRows = starts[1].size() * starts[2].size();
+
+  ThreadStruct str;
+  str.Filter = this;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, m_BlocksPerRow + 1));
+  m_ThreadErrors.assign(numThreads, std::string());
+
+  this->ReadRow(0);
+  for (m_Row = 0; m_Row < m_NumberOfRows; ++m_Row)
+  {
+    m_NextBlock = m_Row * m_BlocksPerRow;
+
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads(numThreads);
+    threader->SetSingleMethod(this->ThreaderCallback, &str);
+    threader->SingleMethodExecute();
+
+    for (ThreadIdType t = 0; t < m_ThreadErrors.size(); ++t)
+      if (!m_ThreadErrors[t].empty())
+      {
+        m_Rows[0] = m_Rows[1] = m_WholeImage = 0;
+        itkExceptionMacro(<< m_ThreadErrors[t]);
+      }
+  }
+  m_Rows[0] = m_Rows[1] = m_WholeImage = 0;
+
+  m_Grid->WriteDescriptor( this->GetDescriptorFileName() );
+}
+
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_TYPE
+ImageBlockSplitter< TInputImage, TOutputImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  //The first thread reads the next row before joining the others
+  Self * filter = str->Filter;
+  try
+  {
+    if (threadId == 0 && filter->m_Row + 1 < filter->m_NumberOfRows)
+      filter->ReadRow(filter->m_Row + 1);
+
+    const InputImageType * row = filter->m_Rows[filter->m_Row % 2];
+    const SizeValueType end = (filter->m_Row + 1) * filter->m_BlocksPerRow;
+    while (true)
+    {
+      filter->m_Mutex.Lock();
+      const SizeValueType b = filter->m_NextBlock++;
+      filter->m_Mutex.Unlock();
+      if (b >= end)
+        break;
+      filter->WriteBlock(b, row);
+    }
+  }
+  catch( ExceptionObject & err )
+  {
+    filter->m_ThreadErrors[threadId] = err.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ImageBlockSplitter< TInputImage, TOutputImage >
+::ReadRow(SizeValueType r)
+{
+  typedef ImageFileReader< InputImageType > ReaderType;
+
+  //Release the row written two steps ago before reading
+  m_Rows[r % 2] = 0;
+  if (m_WholeImage)
+  {
+    m_Rows[r % 2] = m_WholeImage;
+    return;
+  }
+
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(r * m_BlocksPerRow);
+  RegionType region = m_Image->GetLargestPossibleRegion();
+  for (unsigned int d = 1; d < 3; ++d)
+  {
+    region.SetIndex(d, region.GetIndex(d) + block.Index[d]);
+    region.SetSize(d, block.Size[d]);
+  }
+
+  InputImagePointer image;
+  if (m_Source)
+  {
+    m_Source->UpdateOutputInformation();
+    m_Source->GetOutput()->SetRequestedRegion( region );
+    m_Source->Update();
+    image = m_Source->GetOutput();
+  }
+  else
+  {
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( m_FileName );
+    reader->UpdateOutputInformation();
+    reader->GetOutput()->SetRequestedRegion( region );
+    reader->Update();
+    image = reader->GetOutput();
+  }
+  image->DisconnectPipeline();
+
+  //Formats that cannot be streamed are read whole, so only once
+  if (image->GetBufferedRegion() == image->GetLargestPossibleRegion())
+    m_WholeImage = image;
+  m_Rows[r % 2] = image;
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ImageBlockSplitter< TInputImage, TOutputImage >
+::WriteBlock(SizeValueType b, const InputImageType * row)
+{
+  typedef ImageFileWriter< OutputImageType > WriterType;
+
+  const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+  typename InputImageType::IndexType index = m_Image->GetLargestPossibleRegion().GetIndex();
+  typename OutputImageType::SizeType size;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    index[d] += block.Index[d];
+    size[d] = block.Size[d];
+  }
+  typename OutputImageType::PointType origin;
+  m_Image->TransformIndexToPhysicalPoint(index, origin);
+
+  typename OutputImageType::Pointer output = OutputImageType::New();
+  output->SetRegions( size );
+  output->SetSpacing( m_Image->GetSpacing() );
+  output->SetDirection( m_Image->GetDirection() );
+  output->SetOrigin( origin );
+  output->Allocate();
+
+  //out = in * scale + shift, clamped to the output range. An empty window
+  //leaves the values unscaled
+  const double outMinimum = NumericTraits<OutputPixelType>::NonpositiveMin();
+  const double outMaximum = NumericTraits<OutputPixelType>::max();
+  double scale = 1.0;
+  double shift = 0.0;
+  if (m_Rescale && m_WindowMaximum > m_WindowMinimum)
+  {
+    scale = (outMaximum - outMinimum) / (m_WindowMaximum - m_WindowMinimum);
+    shift = outMinimum - m_WindowMinimum * scale;
+  }
+  const bool integer = NumericTraits<OutputPixelType>::is_integer;
+  const bool positive = outMinimum >= 0.0;
+
+  OutputPixelType * out = output->GetBufferPointer();
+  typename InputImageType::IndexType lineIndex = index;
+  for (SizeValueType z = 0; z < block.Size[2]; ++z)
+    for (SizeValueType y = 0; y < block.Size[1]; ++y)
+    {
+      lineIndex[1] = index[1] + y;
+      lineIndex[2] = index[2] + z;
+      const InputPixelType * in = row->GetBufferPointer() + row->ComputeOffset(lineIndex);
+      if (integer && positive)
+      {
+        //The values are not negative, so truncation rounds and the loop vectorises
+        for (SizeValueType x = 0; x < block.Size[0]; ++x)
+        {
+          double value = static_cast< double >(in[x]) * scale + shift;
+          value = value < outMinimum ? outMinimum : (value > outMaximum ? outMaximum : value);
+          out[x] = static_cast< OutputPixelType >(value + 0.5);
+        }
+      }
+      else if (integer)
+      {
+        for (SizeValueType x = 0; x < block.Size[0]; ++x)
+        {
+          double value = static_cast< double >(in[x]) * scale + shift;
+          value = value < outMinimum ? outMinimum : (value > outMaximum ? outMaximum : value);
+          out[x] = Math::Round< OutputPixelType >(value);
+        }
+      }
+      else
+      {
+        for (SizeValueType x = 0; x < block.Size[0]; ++x)
+        {
+          const double value = static_cast< double >(in[x]) * scale + shift;
+          out[x] = static_cast< OutputPixelType >(
+              value < outMinimum ? outMinimum : (value > outMaximum ? outMaximum : value));
+        }
+      }
+      out += block.Size[0];
+    }
+
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( output );
+  writer->SetFileName( block.FileName );
+  writer->Update();
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ImageBlockSplitter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "Source: " << m_Source.GetPointer() << std::endl;
+  os << indent << "OutputPrefix: " << m_OutputPrefix << std::endl;
+  os << indent << "Extension: " << m_Extension << std::endl;
+  os << indent << "MaximumBlockSize: " << m_MaximumBlockSize << std::endl;
+  os << indent << "Overlap: " << m_Overlap << std::endl;
+  os << indent << "Rescale: " << m_Rescale << std::endl;
+  os << indent << "WindowMinimum: " << m_WindowMinimum << std::endl;
+  os << indent << "WindowMaximum: " << m_WindowMaximum << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+}
+
+} // end namespace
+#endif //ITKIMAGEBLOCKSPLITTER_TXX
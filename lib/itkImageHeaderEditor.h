@@ -0,0 +1,503 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKIMAGEHEADEREDITOR_H
+#define ITKIMAGEHEADEREDITOR_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class ImageHeaderEditor
+ * \brief Changes the spacing, origin and direction of an image file by
+ * rewriting its header only, in constant time whatever the size of the
+ * volume.
+ *
+ * The geometry is given as ChangeInformationImageFilter takes it, in the
+ * physical space of ITK: one spacing and origin value per dimension and
+ * the direction matrix row by row. Only the fields that are set are
+ * changed.
+ *
+ * Two kinds of headers can be edited:
+ * - MetaImage .mhd headers whose data is in another file: the fields
+ *   ElementSpacing, Offset and TransformMatrix (or their synonyms) are
+ *   replaced and the header is written again.
+ * - Uncompressed NIfTI files (.nii, or the .hdr of a .hdr/.img pair): the
+ *   348 bytes of the header are patched in place. The qform and sform are
+ *   both written from the new geometry, converted to RAS as NiftiImageIO
+ *   does. Analyze .hdr files only have a spacing.
+ * Any other file (.mha, .nii.gz, ...) must be rewritten through ITK, and
+ * CanEditFile tells them apart.
+ */
+class ImageHeaderEditor : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageHeaderEditor             Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageHeaderEditor, Object);
+
+  typedef std::vector< double > ArrayType;
+
+  itkGetStringMacro(FileName);
+  itkSetStringMacro(FileName);
+
+  void SetSpacing(const ArrayType & spacing)
+  {
+    m_Spacing = spacing;
+    m_ChangeSpacing = true;
+    this->Modified();
+  }
+  const ArrayType & GetSpacing() const
+  { return m_Spacing; }
+
+  void SetOrigin(const ArrayType & origin)
+  {
+    m_Origin = origin;
+    m_ChangeOrigin = true;
+    this->Modified();
+  }
+  const ArrayType & GetOrigin() const
+  { return m_Origin; }
+
+  /** Direction matrix row by row, dimension x dimension values. */
+  void SetDirection(const ArrayType & direction)
+  {
+    m_Direction = direction;
+    m_ChangeDirection = true;
+    this->Modified();
+  }
+  const ArrayType & GetDirection() const
+  { return m_Direction; }
+
+  itkGetConstMacro(ChangeSpacing, bool);
+  itkSetMacro(ChangeSpacing, bool);
+  itkBooleanMacro(ChangeSpacing);
+  itkGetConstMacro(ChangeOrigin, bool);
+  itkSetMacro(ChangeOrigin, bool);
+  itkBooleanMacro(ChangeOrigin);
+  itkGetConstMacro(ChangeDirection, bool);
+  itkSetMacro(ChangeDirection, bool);
+  itkBooleanMacro(ChangeDirection);
+
+  /** Whether the header of fileName can be edited without the data. */
+  static bool CanEditFile(const std::string & fileName)
+  {
+    const std::string extension = GetExtension(fileName);
+    if (extension == ".nii" || extension == ".hdr")
+      return true;
+    if (extension != ".mhd")
+      return false;
+    std::vector< std::string > lines;
+    if (!ReadLines(fileName, lines))
+      return false;
+    const SizeValueType dataFile = FindField(lines, "ElementDataFile");
+    return dataFile < lines.size() && GetValue(lines[dataFile]) != "LOCAL";
+  }
+
+  /** Writes the changed fields to the header of FileName. */
+  void Update()
+  {
+    if (m_FileName.empty())
+      itkExceptionMacro(<< "No file name");
+    if (!CanEditFile(m_FileName))
+      itkExceptionMacro(<< "Cannot edit the header of " << m_FileName << " without its data");
+    if (GetExtension(m_FileName) == ".mhd")
+      this->UpdateMetaImage();
+    else
+      this->UpdateNifti();
+  }
+
+protected:
+  ImageHeaderEditor() :
+    m_ChangeSpacing(false),
+    m_ChangeOrigin(false),
+    m_ChangeDirection(false)
+  {}
+  ~ImageHeaderEditor() {}
+
+  void PrintSelf(std::ostream & os, Indent indent) const
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "FileName: " << m_FileName << std::endl;
+    os << indent << "ChangeSpacing: " << m_ChangeSpacing << std::endl;
+    os << indent << "ChangeOrigin: " << m_ChangeOrigin << std::endl;
+    os << indent << "ChangeDirection: " << m_ChangeDirection << std::endl;
+  }
+
+  static std::string GetExtension(const std::string & fileName)
+  {
+    const std::string::size_type dot = fileName.find_last_of('.');
+    if (dot == std::string::npos || fileName.find('/', dot) != std::string::npos)
+      return std::string();
+    return fileName.substr(dot);
+  }
+
+  static std::string Trim(const std::string & s)
+  {
+    const std::string::size_type first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+      return std::string();
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+  }
+
+  static bool ReadLines(const std::string & fileName, std::vector< std::string > & lines)
+  {
+    std::ifstream file(fileName.c_str());
+    if (!file)
+      return false;
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    return true;
+  }
+
+  static std::string GetKey(const std::string & line)
+  { return Trim(line.substr(0, line.find('='))); }
+
+  static std::string GetValue(const std::string & line)
+  {
+    const std::string::size_type equal = line.find('=');
+    return equal == std::string::npos ? std::string() : Trim(line.substr(equal + 1));
+  }
+
+  /** Line of the first of the keys separated by "|", or lines.size(). */
+  static SizeValueType FindField(const std::vector< std::string > & lines, const std::string & keys)
+  {
+    const std::string bounded = "|" + keys + "|";
+    for (SizeValueType l = 0; l < lines.size(); ++l)
+      if (bounded.find("|" + GetKey(lines[l]) + "|") != std::string::npos)
+        return l;
+    return lines.size();
+  }
+
+  /** Replaces the field of keys, written as the first of them, or inserts
+   * it before ElementDataFile, which must stay last. */
+  static void SetField(std::vector< std::string > & lines, const std::string & keys,
+                       const ArrayType & values)
+  {
+    std::ostringstream line;
+    line.precision(15);
+    line << keys.substr(0, keys.find('|')) << " =";
+    for (SizeValueType i = 0; i < values.size(); ++i)
+      line << " " << values[i];
+
+    SizeValueType l = FindField(lines, keys);
+    if (l == lines.size())
+      l = lines.insert(lines.begin() + FindField(lines, "ElementDataFile"), std::string()) - lines.begin();
+    lines[l] = line.str();
+    //Synonyms further down would be read instead
+    for (SizeValueType k = lines.size(); k-- > l + 1; )
+      if (FindField(std::vector< std::string >(1, lines[k]), keys) == 0)
+        lines.erase(lines.begin() + k);
+  }
+
+  void CheckSize(const ArrayType & values, SizeValueType size, const char * name) const
+  {
+    if (values.size() != size)
+      itkExceptionMacro(<< name << " of " << m_FileName << " needs " << size << " values");
+  }
+
+  void UpdateMetaImage()
+  {
+    std::vector< std::string > lines;
+    if (!ReadLines(m_FileName, lines))
+      itkExceptionMacro(<< "Cannot read " << m_FileName);
+    const SizeValueType nDims = FindField(lines, "NDims");
+    if (nDims == lines.size())
+      itkExceptionMacro(<< "No NDims in " << m_FileName);
+    const unsigned int dimension = atoi(GetValue(lines[nDims]).c_str());
+
+    if (m_ChangeSpacing)
+    {
+      this->CheckSize(m_Spacing, dimension, "The spacing");
+      SetField(lines, "ElementSpacing", m_Spacing);
+    }
+    if (m_ChangeOrigin)
+    {
+      this->CheckSize(m_Origin, dimension, "The origin");
+      SetField(lines, "Offset|Origin|Position", m_Origin);
+    }
+    if (m_ChangeDirection)
+    {
+      //MetaImageIO writes the direction column by column
+      this->CheckSize(m_Direction, dimension * dimension, "The direction");
+      ArrayType matrix(m_Direction.size());
+      for (unsigned int i = 0; i < dimension; ++i)
+        for (unsigned int j = 0; j < dimension; ++j)
+          matrix[i * dimension + j] = m_Direction[j * dimension + i];
+      SetField(lines, "TransformMatrix|Rotation|Orientation", matrix);
+      const SizeValueType orientation = FindField(lines, "AnatomicalOrientation");
+      if (orientation < lines.size())
+        lines.erase(lines.begin() + orientation);
+    }
+
+    //The new header replaces the old one once it is complete
+    const std::string temporary = m_FileName + ".tmp";
+    std::ofstream file(temporary.c_str());
+    for (SizeValueType l = 0; l < lines.size(); ++l)
+      file << lines[l] << "\n";
+    file.close();
+    if (!file || std::rename(temporary.c_str(), m_FileName.c_str()) != 0)
+    {
+      std::remove(temporary.c_str());
+      itkExceptionMacro(<< "Cannot write " << m_FileName);
+    }
+  }
+
+  /** Access to the fields of a NIfTI-1 header, in either byte order. */
+  template< typename T >
+  static T GetHeaderValue(const char * header, unsigned int offset, bool swap)
+  {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, header + offset, sizeof(T));
+    if (swap)
+      std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+  }
+
+  template< typename T >
+  static void SetHeaderValue(char * header, unsigned int offset, bool swap, T value)
+  {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (swap)
+      std::reverse(bytes, bytes + sizeof(T));
+    std::memcpy(header + offset, bytes, sizeof(T));
+  }
+
+  void UpdateNifti()
+  {
+    //Offsets of the fields of nifti_1_header
+    const unsigned int sizeofHdr = 0, dim = 40, pixdim = 76, qformCode = 252, sformCode = 254,
+        quatern = 256, qoffset = 268, srow = 280, magic = 344, headerSize = 348;
+
+    std::fstream file(m_FileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    char header[headerSize];
+    if (!file.read(header, headerSize))
+      itkExceptionMacro(<< "Cannot read " << m_FileName);
+    bool swap = false;
+    if (GetHeaderValue< int >(header, sizeofHdr, false) != static_cast< int >(headerSize))
+    {
+      swap = true;
+      if (GetHeaderValue< int >(header, sizeofHdr, true) != static_cast< int >(headerSize))
+        itkExceptionMacro(<< m_FileName << " is not a NIfTI or Analyze file");
+    }
+    const bool nifti = std::strcmp(header + magic, "n+1") == 0 || std::strcmp(header + magic, "ni1") == 0;
+    const short numberOfDimensions = GetHeaderValue< short >(header, dim, swap);
+    if (numberOfDimensions < 1 || numberOfDimensions > 7)
+      itkExceptionMacro(<< "Wrong dimension in " << m_FileName);
+    const unsigned int dimension = std::min< unsigned int >(numberOfDimensions, 3);
+
+    if (m_ChangeSpacing)
+    {
+      this->CheckSize(m_Spacing, dimension, "The spacing");
+      for (unsigned int d = 0; d < dimension; ++d)
+        SetHeaderValue< float >(header, pixdim + 4 * (d + 1), swap, static_cast< float >(m_Spacing[d]));
+    }
+
+    if (m_ChangeOrigin || m_ChangeDirection)
+    {
+      if (!nifti)
+        itkExceptionMacro(<< "Analyze header " << m_FileName << " has no origin or direction");
+
+      //Current geometry in RAS, from the qform if there is one as
+      //NiftiImageIO reads it, else from the sform, else the identity
+      double rotation[3][3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
+      double origin[3] = { 0, 0, 0 };
+      if (GetHeaderValue< short >(header, qformCode, swap) > 0)
+      {
+        double b = GetHeaderValue< float >(header, quatern, swap);
+        double c = GetHeaderValue< float >(header, quatern + 4, swap);
+        double d = GetHeaderValue< float >(header, quatern + 8, swap);
+        double a = 1.0 - (b * b + c * c + d * d);
+        if (a < 1.e-7)
+        {
+          a = 1.0 / std::sqrt(b * b + c * c + d * d);
+          b *= a;
+          c *= a;
+          d *= a;
+          a = 0.0;
+        }
+        else
+          a = std::sqrt(a);
+        const double qfac = GetHeaderValue< float >(header, pixdim, swap) < 0.0f ? -1.0 : 1.0;
+        const double q[3][3] = {
+          { a * a + b * b - c * c - d * d, 2 * (b * c - a * d), 2 * (b * d + a * c) * qfac },
+          { 2 * (b * c + a * d), a * a + c * c - b * b - d * d, 2 * (c * d - a * b) * qfac },
+          { 2 * (b * d - a * c), 2 * (c * d + a * b), (a * a + d * d - c * c - b * b) * qfac } };
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+          for (unsigned int j = 0; j < 3; ++j)
+            rotation[i][j] = q[i][j];
+          origin[i] = GetHeaderValue< float >(header, qoffset + 4 * i, swap);
+        }
+      }
+      else if (GetHeaderValue< short >(header, sformCode, swap) > 0)
+      {
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+          double norm = 0.0;
+          for (unsigned int i = 0; i < 3; ++i)
+            norm += std::pow(GetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap), 2);
+          norm = norm > 0.0 ? std::sqrt(norm) : 1.0;
+          for (unsigned int i = 0; i < 3; ++i)
+            rotation[i][j] = GetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap) / norm;
+        }
+        for (unsigned int i = 0; i < 3; ++i)
+          origin[i] = GetHeaderValue< float >(header, srow + 16 * i + 12, swap);
+      }
+
+      //ITK is LPS and NIfTI RAS: the first two rows change sign
+      if (m_ChangeOrigin)
+      {
+        this->CheckSize(m_Origin, dimension, "The origin");
+        for (unsigned int i = 0; i < dimension; ++i)
+          origin[i] = i < 2 ? -m_Origin[i] : m_Origin[i];
+      }
+      if (m_ChangeDirection)
+      {
+        this->CheckSize(m_Direction, dimension * dimension, "The direction");
+        for (unsigned int i = 0; i < dimension; ++i)
+          for (unsigned int j = 0; j < dimension; ++j)
+            rotation[i][j] = i < 2 ? -m_Direction[i * dimension + j] : m_Direction[i * dimension + j];
+      }
+
+      //sform: the rotation scaled by the spacing, and the origin
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        for (unsigned int j = 0; j < 3; ++j)
+          SetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap, static_cast< float >(
+              rotation[i][j] * GetHeaderValue< float >(header, pixdim + 4 * (j + 1), swap)));
+        SetHeaderValue< float >(header, srow + 16 * i + 12, swap, static_cast< float >(origin[i]));
+        SetHeaderValue< float >(header, qoffset + 4 * i, swap, static_cast< float >(origin[i]));
+      }
+
+      //qform: the quaternion of the rotation, as nifti_mat44_to_quatern,
+      //with the sign of the determinant in pixdim[0]
+      const double determinant =
+          rotation[0][0] * (rotation[1][1] * rotation[2][2] - rotation[1][2] * rotation[2][1])
+        - rotation[0][1] * (rotation[1][0] * rotation[2][2] - rotation[1][2] * rotation[2][0])
+        + rotation[0][2] * (rotation[1][0] * rotation[2][1] - rotation[1][1] * rotation[2][0]);
+      const double qfac = determinant < 0.0 ? -1.0 : 1.0;
+      double r[3][3];
+      for (unsigned int i = 0; i < 3; ++i)
+        for (unsigned int j = 0; j < 3; ++j)
+          r[i][j] = j == 2 ? rotation[i][j] * qfac : rotation[i][j];
+      double a = r[0][0] + r[1][1] + r[2][2] + 1.0, b, c, d;
+      if (a > 0.5)
+      {
+        a = 0.5 * std::sqrt(a);
+        b = 0.25 * (r[2][1] - r[1][2]) / a;
+        c = 0.25 * (r[0][2] - r[2][0]) / a;
+        d = 0.25 * (r[1][0] - r[0][1]) / a;
+      }
+      else
+      {
+        const double xd = 1.0 + r[0][0] - (r[1][1] + r[2][2]);
+        const double yd = 1.0 + r[1][1] - (r[0][0] + r[2][2]);
+        const double zd = 1.0 + r[2][2] - (r[0][0] + r[1][1]);
+        if (xd > 1.0)
+        {
+          b = 0.5 * std::sqrt(xd);
+          c = 0.25 * (r[0][1] + r[1][0]) / b;
+          d = 0.25 * (r[0][2] + r[2][0]) / b;
+          a = 0.25 * (r[2][1] - r[1][2]) / b;
+        }
+        else if (yd > 1.0)
+        {
+          c = 0.5 * std::sqrt(yd);
+          b = 0.25 * (r[0][1] + r[1][0]) / c;
+          d = 0.25 * (r[1][2] + r[2][1]) / c;
+          a = 0.25 * (r[0][2] - r[2][0]) / c;
+        }
+        else
+        {
+          d = 0.5 * std::sqrt(zd);
+          b = 0.25 * (r[0][2] + r[2][0]) / d;
+          c = 0.25 * (r[1][2] + r[2][1]) / d;
+          a = 0.25 * (r[1][0] - r[0][1]) / d;
+        }
+        if (a < 0.0)
+        {
+          b = -b;
+          c = -c;
+          d = -d;
+        }
+      }
+      SetHeaderValue< float >(header, quatern, swap, static_cast< float >(b));
+      SetHeaderValue< float >(header, quatern + 4, swap, static_cast< float >(c));
+      SetHeaderValue< float >(header, quatern + 8, swap, static_cast< float >(d));
+      SetHeaderValue< float >(header, pixdim, swap, static_cast< float >(qfac));
+      //NIFTI_XFORM_SCANNER_ANAT, as NiftiImageIO writes them
+      if (GetHeaderValue< short >(header, qformCode, swap) <= 0)
+        SetHeaderValue< short >(header, qformCode, swap, 1);
+      if (GetHeaderValue< short >(header, sformCode, swap) <= 0)
+        SetHeaderValue< short >(header, sformCode, swap, 1);
+    }
+    else if (nifti && GetHeaderValue< short >(header, sformCode, swap) > 0)
+    {
+      //The columns of the sform carry the spacing
+      for (unsigned int j = 0; j < dimension; ++j)
+      {
+        double norm = 0.0;
+        for (unsigned int i = 0; i < 3; ++i)
+          norm += std::pow(GetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap), 2);
+        if (norm <= 0.0)
+          continue;
+        const double scale = GetHeaderValue< float >(header, pixdim + 4 * (j + 1), swap) / std::sqrt(norm);
+        for (unsigned int i = 0; i < 3; ++i)
+          SetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap, static_cast< float >(
+              GetHeaderValue< float >(header, srow + 16 * i + 4 * j, swap) * scale));
+      }
+    }
+
+    file.seekp(0);
+    if (!file.write(header, headerSize))
+      itkExceptionMacro(<< "Cannot write " << m_FileName);
+  }
+
+private:
+  ImageHeaderEditor(const Self &); //purposely not implemented
+  void operator=(const Self &);    //purposely not implemented
+
+  std::string  m_FileName;
+  ArrayType    m_Spacing;
+  ArrayType    m_Origin;
+  ArrayType    m_Direction;
+  bool         m_ChangeSpacing;
+  bool         m_ChangeOrigin;
+  bool         m_ChangeDirection;
+};
+
+} //end namespace
+
+#endif // ITKIMAGEHEADEREDITOR_H
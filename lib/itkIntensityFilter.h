@@ -16,15 +16,20 @@
 
 #include <itkImageToImageFilter.h>
 #include <itkMacro.h>
-#include <itkRescaleIntensityImageFilter.h>
-#include <itkNormalizeImageFilter.h>
-#include <itkCastImageFilter.h>
+#include <itkMultiThreader.h>
+#include <vector>
 
 namespace itk {
 
 /** \class IntensityCTFilter
  * \brief Uses intensity information from CT to enhance the vesselness filter
  * response.
+ *
+ * Both images are rescaled to [0,1] (MULTIPLY) or normalised (LINEAR,
+ * EXPONENTIAL), combined and the result rescaled to the output range. The
+ * rescaling is never materialised: the global statistics of both inputs
+ * are gathered in one threaded pass, and the combined values are computed
+ * on the fly in the threaded passes that follow.
  */
 template < class TIntensityImage, class TVesselImage >
 class ITK_EXPORT IntensityFilter :
@@ -70,22 +75,45 @@ protected:
   ~IntensityFilter(){}
 
   typedef double                                             InternalPixelType;
-  typedef Image<InternalPixelType,ImageDimension>            InternalImageType;
-  typedef itk::RescaleIntensityImageFilter< VesselImageType,
-                                        InternalImageType > VesselRescalerType;
-  typedef itk::RescaleIntensityImageFilter< IntensityImageType,
-                                          InternalImageType >InputRescalerType;
-  typedef itk::RescaleIntensityImageFilter< InternalImageType,
-                                          InternalImageType >InternalRescalerType;
-//  typedef itk::NormalizeImageFilter< InternalImageType,
-//                                          InternalImageType >NormalizerType;
-  typedef itk::CastImageFilter< InternalImageType, VesselImageType >
-                                                          CastOutFilterType;
-  typedef itk::NormalizeImageFilter< IntensityImageType,
-                                          InternalImageType >NormalizerIntensityType;
-  typedef itk::NormalizeImageFilter< VesselImageType,
-                                            InternalImageType >NormalizerVesselType;
+  typedef typename VesselImageType::RegionType               RegionType;
+  typedef typename VesselImageType::PixelType                VesselPixelType;
 
+  typedef enum
+  {
+    STATISTICS = 0,
+    RANGE = 1,
+    WRITE = 2
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Per-thread partial results of the reductions. */
+  struct ThreadAccumulator
+  {
+    InternalPixelType Min[2];
+    InternalPixelType Max[2];
+    InternalPixelType Sum[2];
+    InternalPixelType SumOfSquares[2];
+    SizeValueType     Count;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  void ThreadedStatistics(const RegionType & region, ThreadIdType threadId);
+  void ThreadedRange(const RegionType & region, ThreadIdType threadId);
+  void ThreadedWrite(const RegionType & region, ThreadIdType threadId);
+
+  /** Combined value of an intensity/vesselness pair, before the final rescale. */
+  InternalPixelType Combine(InternalPixelType intensity,
+                            InternalPixelType vessel) const;
+
+  /** Linear map of [inMin,inMax] onto [outMin,outMax], as RescaleIntensityImageFilter. */
+  static void RescaleParameters(InternalPixelType inMin, InternalPixelType inMax,
+                                InternalPixelType outMin, InternalPixelType outMax,
+                                InternalPixelType & scale, InternalPixelType & shift);
 
   typename IntensityImageType::ConstPointer GetIntensityImage();
   typename VesselImageType::ConstPointer    GetVesselnessImage();
@@ -101,6 +129,14 @@ private:
   FilterModeType m_FilterMode;
   double          m_Degree;
   double          m_Threshold;
+
+  PhaseType                       m_Phase;
+  std::vector< ThreadAccumulator > m_Accumulators;
+  /** Scale and shift of the intensity (0) and vesselness (1) images */
+  InternalPixelType               m_Scale[2];
+  InternalPixelType               m_Shift[2];
+  InternalPixelType               m_OutputScale;
+  InternalPixelType               m_OutputShift;
 };
 } // namespace itk
 
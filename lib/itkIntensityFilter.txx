@@ -6,7 +6,10 @@
 #include <itkObjectFactory.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
 
+#include <algorithm>
+#include <limits>
 #include <math.h>
 
 
@@ -20,6 +23,7 @@ IntensityFilter<TIntensityImage, TVesselImage>::IntensityFilter()
   this->m_Degree = 0.5;
   this->m_FilterMode = MULTIPLY;
   this->m_Threshold = 5.0;
+  this->m_Phase = STATISTICS;
 }
 
 template< class TIntensityImage, class TVesselImage >
@@ -51,12 +55,8 @@ typename TVesselImage::ConstPointer IntensityFilter<TIntensityImage, TVesselImag
 template< class TIntensityImage, class TVesselImage >
 void IntensityFilter<TIntensityImage, TVesselImage>::GenerateData()
 {
-  typename InternalImageType::Pointer tmp_image = InternalImageType::New();
-  tmp_image->SetRegions(this->GetVesselnessImage()->GetLargestPossibleRegion());
-  tmp_image->Allocate();
-  tmp_image->SetSpacing(this->GetVesselnessImage()->GetSpacing());
-  tmp_image->SetOrigin( this->GetVesselnessImage()->GetOrigin() );
-  tmp_image->SetDirection( this->GetVesselnessImage()->GetDirection() );
+  if (m_FilterMode != MULTIPLY && m_FilterMode != LINEAR && m_FilterMode != EXPONENTIAL)
+    return; // Error - Uknown option and will return
 
   typename VesselImageType::Pointer output = this->GetOutput();
   output->SetRegions(this->GetVesselnessImage()->GetLargestPossibleRegion());
@@ -65,125 +65,222 @@ void IntensityFilter<TIntensityImage, TVesselImage>::GenerateData()
   output->SetOrigin( this->GetVesselnessImage()->GetOrigin() );
   output->SetDirection( this->GetVesselnessImage()->GetDirection() );
 
-  typename InternalImageType::Pointer vessel_image;
-  typename InternalImageType::Pointer inres_image;
-
-  if (m_FilterMode == MULTIPLY) {
-    typename VesselRescalerType::Pointer vesselrescaler = VesselRescalerType::New();
-    typename InputRescalerType::Pointer inputrescaler = InputRescalerType::New();
-    vesselrescaler->SetInput( this->GetVesselnessImage() );
-    vesselrescaler->SetOutputMaximum(1);
-    vesselrescaler->SetOutputMinimum(0);
-    vesselrescaler->Update();
-    inputrescaler->SetInput( this->GetIntensityImage() );
-    inputrescaler->SetOutputMaximum(1);
-    inputrescaler->SetOutputMinimum(0);
-    inputrescaler->Update();
-    vessel_image = vesselrescaler->GetOutput();
-    inres_image = inputrescaler->GetOutput();
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+
+  ThreadAccumulator init;
+  for (unsigned int k = 0; k < 2; ++k)
+  {
+    init.Min[k] = NumericTraits<InternalPixelType>::max();
+    init.Max[k] = NumericTraits<InternalPixelType>::NonpositiveMin();
+    init.Sum[k] = 0;
+    init.SumOfSquares[k] = 0;
   }
-  else {
-    typename NormalizerIntensityType::Pointer normalise_intensity = NormalizerIntensityType::New();
-    normalise_intensity->SetInput( this->GetIntensityImage() );
-    normalise_intensity->Update();
-    inres_image = normalise_intensity->GetOutput();
+  init.Count = 0;
 
-    typename NormalizerVesselType::Pointer normalise_vessel = NormalizerVesselType::New();
-    normalise_vessel->SetInput( this->GetVesselnessImage() );
-    normalise_vessel->Update();
-    vessel_image = normalise_vessel->GetOutput();
+  //1- Global statistics of both images in one pass
+  m_Accumulators.assign(this->GetNumberOfThreads(), init);
+  m_Phase = STATISTICS;
+  this->GetMultiThreader()->SingleMethodExecute();
 
+  ThreadAccumulator total = init;
+  for (unsigned int t = 0; t < m_Accumulators.size(); ++t)
+  {
+    for (unsigned int k = 0; k < 2; ++k)
+    {
+      total.Min[k] = std::min(total.Min[k], m_Accumulators[t].Min[k]);
+      total.Max[k] = std::max(total.Max[k], m_Accumulators[t].Max[k]);
+      total.Sum[k] += m_Accumulators[t].Sum[k];
+      total.SumOfSquares[k] += m_Accumulators[t].SumOfSquares[k];
+    }
+    total.Count += m_Accumulators[t].Count;
   }
 
-  typename itk::ImageRegionConstIterator<InternalImageType> imageIterator(inres_image,inres_image->GetLargestPossibleRegion());
-  typename itk::ImageRegionConstIterator<InternalImageType> vesselimageIterator(vessel_image,inres_image->GetLargestPossibleRegion());
-  typename itk::ImageRegionIterator<InternalImageType> outimageIterator(tmp_image,inres_image->GetLargestPossibleRegion());
-  switch (m_FilterMode) {
-    case MULTIPLY: {
-      while(!imageIterator.IsAtEnd()) {
-        if (vesselimageIterator.Get() != 0)
-          outimageIterator.Set( imageIterator.Get() * vesselimageIterator.Get() );
-        else
-          outimageIterator.Set( 0 );
-        ++imageIterator;
-        ++vesselimageIterator;
-        ++outimageIterator;
-      }
-      break;
-    }
-  case EXPONENTIAL:
+  for (unsigned int k = 0; k < 2; ++k)
   {
-    typename itk::ImageRegionConstIterator<VesselImageType> vesselIterator(
-                this->GetVesselnessImage(),inres_image->GetLargestPossibleRegion());
-    while(!imageIterator.IsAtEnd())
+    if (m_FilterMode == MULTIPLY)
+      RescaleParameters(total.Min[k], total.Max[k], 0, 1, m_Scale[k], m_Shift[k]);
+    else
     {
-      if (vesselIterator.Get() != 0) {
-        InternalPixelType val_in = vesselimageIterator.Get();
-        InternalPixelType val_out = imageIterator.Get();
-          val_out *= exp((val_in - m_Threshold) / m_Degree);
-        if (val_out > 0)
-          outimageIterator.Set( val_out );
-        else
-          outimageIterator.Set( 0 );
-      }
-      else {
-        outimageIterator.Set( 0 );
-      }
-      ++imageIterator;
-      ++vesselimageIterator;
-      ++outimageIterator;
-      ++vesselIterator;
+      //Same normalisation as NormalizeImageFilter
+      InternalPixelType count = static_cast<InternalPixelType>(total.Count);
+      InternalPixelType mean = total.Sum[k] / count;
+      InternalPixelType variance = 0;
+      if (total.Count > 1)
+        variance = (total.SumOfSquares[k] - total.Sum[k] * total.Sum[k] / count) / (count - 1);
+      InternalPixelType sigma = variance > 0 ? sqrt(variance) : 1;
+      m_Scale[k] = 1.0 / sigma;
+      m_Shift[k] = -mean / sigma;
     }
-      break;
   }
-  case LINEAR:
+
+  //2- Range of the combined values, computed on the fly
+  m_Accumulators.assign(this->GetNumberOfThreads(), init);
+  m_Phase = RANGE;
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  InternalPixelType combinedMin = NumericTraits<InternalPixelType>::max();
+  InternalPixelType combinedMax = NumericTraits<InternalPixelType>::NonpositiveMin();
+  for (unsigned int t = 0; t < m_Accumulators.size(); ++t)
+  {
+    combinedMin = std::min(combinedMin, m_Accumulators[t].Min[0]);
+    combinedMax = std::max(combinedMax, m_Accumulators[t].Max[0]);
+  }
+  RescaleParameters(combinedMin, combinedMax, 0,
+                    static_cast<float>(std::numeric_limits<OutputPixelType>::max()),
+                    m_OutputScale, m_OutputShift);
+
+  //3- Combine, rescale and write the output
+  m_Phase = WRITE;
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  std::vector< ThreadAccumulator >().swap(m_Accumulators);
+}
+
+template< class TIntensityImage, class TVesselImage >
+ITK_THREAD_RETURN_TYPE
+IntensityFilter<TIntensityImage, TVesselImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  RegionType splitRegion;
+  int total = str->Filter->SplitRequestedRegion(threadId, threadCount, splitRegion);
+  if (threadId < total)
   {
-    typename itk::ImageRegionConstIterator<VesselImageType> vesselIterator(
-                this->GetVesselnessImage(),inres_image->GetLargestPossibleRegion());
-    while(!imageIterator.IsAtEnd())
+    switch (str->Filter->m_Phase)
     {
-      if (vesselIterator.Get() != 0)
-      {
-        InternalPixelType val_in = vesselimageIterator.Get();
-        InternalPixelType val_out = imageIterator.Get();
-        if (val_in > m_Threshold)
-          val_out += m_Degree * (val_in - m_Threshold);
-        if (val_out > 0)
-          outimageIterator.Set( val_out );
-        else
-          outimageIterator.Set( 0 );
-      }
-      else
-      {
-        outimageIterator.Set( 0 );
-      }
-      ++imageIterator;
-      ++vesselimageIterator;
-      ++outimageIterator;
-      ++vesselIterator;
+      case STATISTICS:
+        str->Filter->ThreadedStatistics(splitRegion, threadId);
+        break;
+      case RANGE:
+        str->Filter->ThreadedRange(splitRegion, threadId);
+        break;
+      case WRITE:
+        str->Filter->ThreadedWrite(splitRegion, threadId);
+        break;
     }
-    break;
   }
-  default: // Error - Uknown option and will return
-    return;
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TIntensityImage, class TVesselImage >
+void IntensityFilter<TIntensityImage, TVesselImage>
+::ThreadedStatistics(const RegionType & region, ThreadIdType threadId)
+{
+  typename itk::ImageRegionConstIterator<IntensityImageType> imageIterator(this->GetIntensityImage(), region);
+  typename itk::ImageRegionConstIterator<VesselImageType> vesselIterator(this->GetVesselnessImage(), region);
+  ThreadAccumulator & acc = m_Accumulators[threadId];
+  while(!imageIterator.IsAtEnd())
+  {
+    InternalPixelType val[2];
+    val[0] = static_cast<InternalPixelType>(imageIterator.Get());
+    val[1] = static_cast<InternalPixelType>(vesselIterator.Get());
+    for (unsigned int k = 0; k < 2; ++k)
+    {
+      if (val[k] < acc.Min[k])
+        acc.Min[k] = val[k];
+      if (val[k] > acc.Max[k])
+        acc.Max[k] = val[k];
+      acc.Sum[k] += val[k];
+      acc.SumOfSquares[k] += val[k] * val[k];
+    }
+    acc.Count++;
+    ++imageIterator;
+    ++vesselIterator;
   }
+}
 
-  typename InternalRescalerType::Pointer outrescaler = InternalRescalerType::New();
-  outrescaler->SetInput( tmp_image );
-  outrescaler->SetOutputMaximum(static_cast<float>(std::numeric_limits<OutputPixelType>::max()));
-  outrescaler->SetOutputMinimum(0);
-  outrescaler->Update();
+template< class TIntensityImage, class TVesselImage >
+void IntensityFilter<TIntensityImage, TVesselImage>
+::ThreadedRange(const RegionType & region, ThreadIdType threadId)
+{
+  typename itk::ImageRegionConstIterator<IntensityImageType> imageIterator(this->GetIntensityImage(), region);
+  typename itk::ImageRegionConstIterator<VesselImageType> vesselIterator(this->GetVesselnessImage(), region);
+  ThreadAccumulator & acc = m_Accumulators[threadId];
+  while(!imageIterator.IsAtEnd())
+  {
+    InternalPixelType val = this->Combine(imageIterator.Get(), vesselIterator.Get());
+    if (val < acc.Min[0])
+      acc.Min[0] = val;
+    if (val > acc.Max[0])
+      acc.Max[0] = val;
+    ++imageIterator;
+    ++vesselIterator;
+  }
+}
 
-  typename CastOutFilterType::Pointer caster = CastOutFilterType::New();
-  caster->SetInput( outrescaler->GetOutput() ) ;
-  caster->Update();
+template< class TIntensityImage, class TVesselImage >
+void IntensityFilter<TIntensityImage, TVesselImage>
+::ThreadedWrite(const RegionType & region, ThreadIdType)
+{
+  typename itk::ImageRegionConstIterator<IntensityImageType> imageIterator(this->GetIntensityImage(), region);
+  typename itk::ImageRegionConstIterator<VesselImageType> vesselIterator(this->GetVesselnessImage(), region);
+  typename itk::ImageRegionIterator<VesselImageType> outimageIterator(this->GetOutput(), region);
+  const InternalPixelType outMax = static_cast<float>(std::numeric_limits<OutputPixelType>::max());
+  while(!imageIterator.IsAtEnd())
+  {
+    InternalPixelType val = this->Combine(imageIterator.Get(), vesselIterator.Get());
+    val = val * m_OutputScale + m_OutputShift;
+    if (val > outMax)
+      val = outMax;
+    if (val < 0)
+      val = 0;
+    outimageIterator.Set( static_cast<VesselPixelType>(val) );
+    ++imageIterator;
+    ++vesselIterator;
+    ++outimageIterator;
+  }
+}
 
-  /*typename NormalizerType::Pointer normaliser = NormalizerType::New();
-  normaliser->SetInput( outrescaler );
-  normaliser->Update();*/
-  output = caster->GetOutput();
-  this->GraftOutput( output );
+template< class TIntensityImage, class TVesselImage >
+typename IntensityFilter<TIntensityImage, TVesselImage>::InternalPixelType
+IntensityFilter<TIntensityImage, TVesselImage>
+::Combine(InternalPixelType intensity, InternalPixelType vessel) const
+{
+  InternalPixelType val_out = intensity * m_Scale[0] + m_Shift[0];
+  InternalPixelType val_in = vessel * m_Scale[1] + m_Shift[1];
+  switch (m_FilterMode) {
+    case MULTIPLY:
+      if (val_in != 0)
+        return val_out * val_in;
+      return 0;
+    case EXPONENTIAL:
+      if (vessel == 0)
+        return 0;
+      val_out *= exp((val_in - m_Threshold) / m_Degree);
+      break;
+    case LINEAR:
+      if (vessel == 0)
+        return 0;
+      if (val_in > m_Threshold)
+        val_out += m_Degree * (val_in - m_Threshold);
+      break;
+  }
+  return val_out > 0 ? val_out : 0;
+}
 
+template< class TIntensityImage, class TVesselImage >
+void IntensityFilter<TIntensityImage, TVesselImage>
+::RescaleParameters(InternalPixelType inMin, InternalPixelType inMax,
+                    InternalPixelType outMin, InternalPixelType outMax,
+                    InternalPixelType & scale, InternalPixelType & shift)
+{
+  if (inMax != inMin)
+    scale = (outMax - outMin) / (inMax - inMin);
+  else if (inMax != 0)
+    scale = (outMax - outMin) / inMax;
+  else
+    scale = 0;
+  shift = outMin - inMin * scale;
 }
 
 template< class TIntensityImage, class TVesselImage >
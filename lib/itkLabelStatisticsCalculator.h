@@ -0,0 +1,161 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKLABELSTATISTICSCALCULATOR_H
+#define ITKLABELSTATISTICSCALCULATOR_H
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkMultiThreader.h>
+#include <map>
+#include <vector>
+
+namespace itk {
+
+/** \class LabelStatisticsCalculator
+ * \brief Count, min, max, sum, mean and variance of an image for every label
+ * of a label map, in a single multithreaded pass.
+ *
+ * Every slice along the last dimension is reduced on its own (Welford's
+ * update for the mean and variance, compensated summation for the sum) and
+ * the slice partials are merged in slice order (Chan et al.), so the results
+ * do not depend on the number of threads. An optional fixed-range histogram
+ * per label gives approximate percentiles.
+ */
+template< class TImage, class TLabelImage >
+class ITK_EXPORT LabelStatisticsCalculator : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef LabelStatisticsCalculator        Self;
+  typedef Object                           Superclass;
+  typedef SmartPointer< Self >             Pointer;
+  typedef SmartPointer< const Self >       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LabelStatisticsCalculator, Object);
+
+  typedef TImage                                ImageType;
+  typedef TLabelImage                           LabelImageType;
+  typedef typename ImageType::ConstPointer      ImageConstPointer;
+  typedef typename LabelImageType::ConstPointer LabelImageConstPointer;
+  typedef typename ImageType::PixelType         PixelType;
+  typedef typename LabelImageType::PixelType    LabelType;
+
+  /** Statistics of a single label. */
+  struct Statistics
+  {
+    SizeValueType                Count;
+    double                       Min;
+    double                       Max;
+    double                       Mean;
+    double                       M2;
+    double                       Sum;
+    double                       Compensation;
+    std::vector< SizeValueType > Histogram;
+
+    double GetSum() const { return Sum + Compensation; }
+    double GetVariance() const { return Count > 1 ? M2 / (Count - 1) : 0; }
+  };
+
+  typedef std::map< LabelType, Statistics > StatisticsMapType;
+
+  itkSetConstObjectMacro(Image, ImageType);
+  itkSetConstObjectMacro(LabelImage, LabelImageType);
+
+  /** Label excluded from the statistics. */
+  itkGetConstMacro(BackgroundValue, LabelType);
+  itkSetMacro(BackgroundValue, LabelType);
+  itkGetConstMacro(UseBackgroundValue, bool);
+  itkSetMacro(UseBackgroundValue, bool);
+  itkBooleanMacro(UseBackgroundValue);
+
+  /** Histogram of NumberOfBins bins over [HistogramMinimum, HistogramMaximum],
+   * values outside go to the first/last bin. 0 bins disables it. */
+  void SetHistogram(unsigned int bins, double minimum, double maximum);
+  itkGetConstMacro(NumberOfBins, unsigned int);
+  itkGetConstMacro(HistogramMinimum, double);
+  itkGetConstMacro(HistogramMaximum, double);
+
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Runs the single pass over the images. */
+  void Compute();
+
+  /** Statistics of every label found, sorted by label. */
+  const StatisticsMapType & GetStatistics() const
+  { return m_Statistics; }
+
+  /** Statistics of all the labels together. */
+  const Statistics & GetTotal() const
+  { return m_Total; }
+
+  /** Percentile (0-100) read from the histogram of s, with linear
+   * interpolation inside the bin. */
+  double GetPercentile(const Statistics & s, double percentile) const;
+
+  /** Adds b into a; a must not be empty. */
+  static void Merge(Statistics & a, const Statistics & b);
+
+protected:
+  LabelStatisticsCalculator();
+  ~LabelStatisticsCalculator() { }
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  typedef std::map< LabelType, std::vector< SizeValueType > > HistogramMapType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Accumulates one slice into m_SlicePartials[slice] and the histograms
+   * of the calling thread. */
+  void ComputeSlice(SizeValueType slice, HistogramMapType & histograms);
+
+  /** Neumaier's compensated s.Sum += value. */
+  static void AddToSum(Statistics & s, double value);
+
+private:
+  LabelStatisticsCalculator(const Self &); //purposely not implemented
+  void operator=(const Self &);         //purposely not implemented
+
+  ImageConstPointer        m_Image;
+  LabelImageConstPointer   m_LabelImage;
+  LabelType                m_BackgroundValue;
+  bool                     m_UseBackgroundValue;
+  unsigned int             m_NumberOfBins;
+  double                   m_HistogramMinimum;
+  double                   m_HistogramMaximum;
+  ThreadIdType             m_NumberOfThreads;
+
+  std::vector< StatisticsMapType > m_SlicePartials;
+  /** Histograms are integer counts, so they are kept per thread */
+  std::vector< HistogramMapType >  m_ThreadHistograms;
+
+  StatisticsMapType        m_Statistics;
+  Statistics               m_Total;
+};
+
+}
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLabelStatisticsCalculator.txx"
+#endif
+
+#endif // ITKLABELSTATISTICSCALCULATOR_H
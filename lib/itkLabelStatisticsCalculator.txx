@@ -0,0 +1,279 @@
+#ifndef ITKLABELSTATISTICSCALCULATOR_TXX
+#define ITKLABELSTATISTICSCALCULATOR_TXX
+
+#include "itkLabelStatisticsCalculator.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <math.h>
+
+namespace itk {
+
+template< class TImage, class TLabelImage >
+LabelStatisticsCalculator< TImage, TLabelImage >::LabelStatisticsCalculator()
+{
+  m_Image = NULL;
+  m_LabelImage = NULL;
+  m_BackgroundValue = NumericTraits< LabelType >::ZeroValue();
+  m_UseBackgroundValue = true;
+  m_NumberOfBins = 0;
+  m_HistogramMinimum = 0;
+  m_HistogramMaximum = 0;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_Total.Count = 0;
+}
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >
+::SetHistogram(unsigned int bins, double minimum, double maximum)
+{
+  m_NumberOfBins = bins;
+  m_HistogramMinimum = minimum;
+  m_HistogramMaximum = maximum;
+  this->Modified();
+}
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >::Compute()
+{
+  if ( !m_Image || !m_LabelImage )
+    itkExceptionMacro(<< "Image and label image must be set");
+  if ( m_Image->GetBufferedRegion() != m_LabelImage->GetBufferedRegion() )
+    itkExceptionMacro(<< "Image and label image do not cover the same region");
+  if ( m_NumberOfBins > 0 && !(m_HistogramMaximum > m_HistogramMinimum) )
+    itkExceptionMacro(<< "Empty histogram range");
+
+  const SizeValueType numSlices =
+      m_Image->GetBufferedRegion().GetSize()[ImageType::ImageDimension - 1];
+  m_SlicePartials.assign(numSlices, StatisticsMapType());
+  const ThreadIdType numThreads = std::max< ThreadIdType >(1,
+        std::min< SizeValueType >(m_NumberOfThreads, numSlices));
+  m_ThreadHistograms.assign(numThreads, HistogramMapType());
+
+  ThreadStruct str;
+  str.Filter = this;
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(numThreads);
+  threader->SetSingleMethod(this->ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  //Merging in slice order gives the same result whatever the thread count
+  m_Statistics.clear();
+  for (SizeValueType z = 0; z < numSlices; ++z)
+  {
+    typename StatisticsMapType::const_iterator it;
+    for (it = m_SlicePartials[z].begin(); it != m_SlicePartials[z].end(); ++it)
+    {
+      typename StatisticsMapType::iterator found = m_Statistics.find(it->first);
+      if (found == m_Statistics.end())
+        m_Statistics.insert(*it);
+      else
+        Merge(found->second, it->second);
+    }
+  }
+  std::vector< StatisticsMapType >().swap(m_SlicePartials);
+
+  //Bin counts are integers, any order will do
+  for (ThreadIdType t = 0; t < numThreads; ++t)
+  {
+    typename HistogramMapType::const_iterator it;
+    for (it = m_ThreadHistograms[t].begin(); it != m_ThreadHistograms[t].end(); ++it)
+    {
+      std::vector< SizeValueType > & hist = m_Statistics[it->first].Histogram;
+      hist.resize(m_NumberOfBins, 0);
+      for (unsigned int b = 0; b < m_NumberOfBins; ++b)
+        hist[b] += it->second[b];
+    }
+  }
+  std::vector< HistogramMapType >().swap(m_ThreadHistograms);
+
+  m_Total.Count = 0;
+  m_Total.Histogram.clear();
+  typename StatisticsMapType::const_iterator it;
+  for (it = m_Statistics.begin(); it != m_Statistics.end(); ++it)
+  {
+    if (m_Total.Count == 0)
+      m_Total = it->second;
+    else
+    {
+      Merge(m_Total, it->second);
+      for (unsigned int b = 0; b < m_Total.Histogram.size(); ++b)
+        m_Total.Histogram[b] += it->second.Histogram[b];
+    }
+  }
+}
+
+template< class TImage, class TLabelImage >
+ITK_THREAD_RETURN_TYPE
+LabelStatisticsCalculator< TImage, TLabelImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * calculator = str->Filter;
+  const SizeValueType numSlices = calculator->m_SlicePartials.size();
+  for (SizeValueType z = threadId; z < numSlices; z += threadCount)
+    calculator->ComputeSlice(z, calculator->m_ThreadHistograms[threadId]);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >
+::ComputeSlice(SizeValueType slice, HistogramMapType & histograms)
+{
+  const SizeValueType sliceSize = m_Image->GetBufferedRegion().GetNumberOfPixels()
+      / m_Image->GetBufferedRegion().GetSize()[ImageType::ImageDimension - 1];
+  const PixelType * in = m_Image->GetBufferPointer() + slice * sliceSize;
+  const LabelType * labels = m_LabelImage->GetBufferPointer() + slice * sliceSize;
+  const double binWidth = m_NumberOfBins > 0 ?
+        (m_HistogramMaximum - m_HistogramMinimum) / m_NumberOfBins : 0;
+
+  StatisticsMapType & partial = m_SlicePartials[slice];
+  //Label maps come in runs, so the last entry is kept at hand
+  Statistics * current = NULL;
+  SizeValueType * bins = NULL;
+  LabelType currentLabel = NumericTraits< LabelType >::ZeroValue();
+
+  for (SizeValueType p = 0; p < sliceSize; ++p)
+  {
+    const LabelType label = labels[p];
+    if (m_UseBackgroundValue && label == m_BackgroundValue)
+      continue;
+
+    if (!current || label != currentLabel)
+    {
+      typename StatisticsMapType::iterator found = partial.find(label);
+      if (found == partial.end())
+      {
+        Statistics empty;
+        empty.Count = 0;
+        empty.Min = NumericTraits< double >::max();
+        empty.Max = NumericTraits< double >::NonpositiveMin();
+        empty.Mean = 0;
+        empty.M2 = 0;
+        empty.Sum = 0;
+        empty.Compensation = 0;
+        found = partial.insert(std::make_pair(label, empty)).first;
+      }
+      current = &found->second;
+      currentLabel = label;
+      if (m_NumberOfBins > 0)
+      {
+        std::vector< SizeValueType > & hist = histograms[label];
+        hist.resize(m_NumberOfBins, 0);
+        bins = &hist[0];
+      }
+    }
+
+    const double value = static_cast< double >(in[p]);
+    current->Count++;
+    current->Min = std::min(current->Min, value);
+    current->Max = std::max(current->Max, value);
+    const double delta = value - current->Mean;
+    current->Mean += delta / current->Count;
+    current->M2 += delta * (value - current->Mean);
+    AddToSum(*current, value);
+
+    if (bins)
+    {
+      const double b = floor((value - m_HistogramMinimum) / binWidth);
+      if (b < 0)
+        bins[0]++;
+      else if (b >= m_NumberOfBins)
+        bins[m_NumberOfBins - 1]++;
+      else
+        bins[static_cast< unsigned int >(b)]++;
+    }
+  }
+}
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >
+::AddToSum(Statistics & s, double value)
+{
+  const double t = s.Sum + value;
+  if (fabs(s.Sum) >= fabs(value))
+    s.Compensation += (s.Sum - t) + value;
+  else
+    s.Compensation += (value - t) + s.Sum;
+  s.Sum = t;
+}
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >
+::Merge(Statistics & a, const Statistics & b)
+{
+  if (b.Count == 0)
+    return;
+  const double na = a.Count;
+  const double nb = b.Count;
+  const double n = na + nb;
+  const double delta = b.Mean - a.Mean;
+  a.Mean += delta * nb / n;
+  a.M2 += b.M2 + delta * delta * na * nb / n;
+  a.Count += b.Count;
+  a.Min = std::min(a.Min, b.Min);
+  a.Max = std::max(a.Max, b.Max);
+  AddToSum(a, b.Sum);
+  a.Compensation += b.Compensation;
+}
+
+template< class TImage, class TLabelImage >
+double
+LabelStatisticsCalculator< TImage, TLabelImage >
+::GetPercentile(const Statistics & s, double percentile) const
+{
+  if (s.Histogram.empty() || s.Count == 0)
+    itkExceptionMacro(<< "No histogram computed");
+
+  const double binWidth = (m_HistogramMaximum - m_HistogramMinimum) / m_NumberOfBins;
+  const double target = percentile / 100.0 * s.Count;
+  double cumulative = 0;
+  for (unsigned int b = 0; b < s.Histogram.size(); ++b)
+  {
+    const double next = cumulative + s.Histogram[b];
+    if (next >= target && s.Histogram[b] > 0)
+    {
+      const double fraction = (target - cumulative) / s.Histogram[b];
+      const double value = m_HistogramMinimum + (b + std::max(0.0, fraction)) * binWidth;
+      //The outer bins also hold the out of range values
+      return std::min(s.Max, std::max(s.Min, value));
+    }
+    cumulative = next;
+  }
+  return s.Max;
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template< class TImage, class TLabelImage >
+void
+LabelStatisticsCalculator< TImage, TLabelImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "BackgroundValue: "
+     << static_cast< typename NumericTraits< LabelType >::PrintType >(m_BackgroundValue)
+     << std::endl;
+  os << indent << "UseBackgroundValue: " << m_UseBackgroundValue << std::endl;
+  os << indent << "NumberOfBins: " << m_NumberOfBins << std::endl;
+  os << indent << "HistogramMinimum: " << m_HistogramMinimum << std::endl;
+  os << indent << "HistogramMaximum: " << m_HistogramMaximum << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+  os << indent << "NumberOfLabels: " << m_Statistics.size() << std::endl;
+}
+
+} // end namespace
+#endif //ITKLABELSTATISTICSCALCULATOR_TXX
@@ -0,0 +1,176 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKLOCALTHICKNESSIMAGEFILTER_H
+#define ITKLOCALTHICKNESSIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk {
+
+/** \class LocalThicknessImageFilter
+ * \brief Local thickness of a 3D structure: the diameter of the largest
+ * ball inside the structure that contains the voxel (Hildebrand and
+ * Ruegsegger), as computed by Fiji's Local Thickness plugin.
+ *
+ * Voxels >= Threshold are the structure. The squared Euclidean distance
+ * map is computed exactly with three separable passes of lower parabola
+ * envelopes (Meijster et al.), each pass parallel over the lines of the
+ * image. The distance ridge keeps the balls not contained in the ball of a
+ * neighbour. Rather than painting every ridge ball, the balls are sorted by
+ * decreasing radius and bucketed into a coarse grid; every voxel then scans
+ * the balls of its cell and stops at the first, hence largest, one that
+ * contains it. As in Fiji, the thickness is in voxels, and outside of the
+ * image is not background.
+ *
+ * With CleanUp on, the boundary voxels, whose values are biased by the
+ * voxel discretisation, are replaced by the mean of their interior
+ * neighbours (Fiji's Clean_Up_Local_Thickness).
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT LocalThicknessImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef LocalThicknessImageFilter                     Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LocalThicknessImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+
+  itkGetConstMacro(Threshold, InputPixelType);
+  itkSetMacro(Threshold, InputPixelType);
+  itkGetConstMacro(CleanUp, bool);
+  itkSetMacro(CleanUp, bool);
+  itkBooleanMacro(CleanUp);
+  /** Edge, in voxels, of the cells the ridge balls are bucketed into. */
+  itkGetConstMacro(BucketSize, unsigned int);
+  itkSetMacro(BucketSize, unsigned int);
+
+protected:
+  LocalThicknessImageFilter();
+  ~LocalThicknessImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** The distance map is global. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *);
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  typedef enum
+  {
+    DISTANCE = 0,
+    RIDGE = 1,
+    THICKNESS = 2,
+    CLEANUP = 3
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Ball of the distance ridge. */
+  struct Ball
+  {
+    OffsetValueType Centre[3];
+    double          SquaredRadius;
+  };
+
+  /** Orders balls by decreasing radius, then raster order. */
+  struct BallGreater
+  {
+    bool operator()(const Ball & a, const Ball & b) const
+    {
+      if (a.SquaredRadius != b.SquaredRadius)
+        return a.SquaredRadius > b.SquaredRadius;
+      for (int d = 2; d >= 0; --d)
+        if (a.Centre[d] != b.Centre[d])
+          return a.Centre[d] < b.Centre[d];
+      return false;
+    }
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Squared distance along dimension m_Dimension for lines [begin, end). */
+  void ThreadedDistance(SizeValueType begin, SizeValueType end);
+  /** Ridge balls of slices [begin, end). */
+  void ThreadedRidge(SizeValueType begin, SizeValueType end, std::vector< Ball > & balls);
+  void ThreadedThickness(SizeValueType begin, SizeValueType end);
+  /** Boundary voxels of slices [begin, end); the ones without interior
+   * neighbours are left in 'pending'. */
+  void ThreadedCleanUp(SizeValueType begin, SizeValueType end,
+                       std::vector< SizeValueType > & pending);
+
+  /** Number of lines or slices the current phase is split on. */
+  SizeValueType GetNumberOfWorkUnits() const;
+
+  bool IsInside(SizeValueType offset) const
+  { return m_Input[offset] >= m_Threshold; }
+
+private:
+  LocalThicknessImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  InputPixelType  m_Threshold;
+  bool            m_CleanUp;
+  unsigned int    m_BucketSize;
+
+  PhaseType                  m_Phase;
+  unsigned int               m_Dimension;
+  const InputPixelType *     m_Input;
+  OutputPixelType *          m_Output;
+  SizeValueType              m_Size[3];
+  OffsetValueType            m_Stride[3];
+  /** Squared distance map. */
+  std::vector< float >       m_Distance;
+
+  std::vector< std::vector< Ball > >          m_ThreadBalls;
+  std::vector< Ball >                         m_Balls;
+  SizeValueType                               m_Buckets[3];
+  /** Balls overlapping every bucket, sorted like m_Balls (CSR layout). */
+  std::vector< SizeValueType >                m_BucketStart;
+  std::vector< SizeValueType >                m_BucketBalls;
+  std::vector< std::vector< SizeValueType > > m_ThreadPending;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLocalThicknessImageFilter.txx"
+#endif
+
+#endif // ITKLOCALTHICKNESSIMAGEFILTER_H
@@ -0,0 +1,423 @@
+#ifndef ITKLOCALTHICKNESSIMAGEFILTER_TXX
+#define ITKLOCALTHICKNESSIMAGEFILTER_TXX
+
+#include "itkLocalThicknessImageFilter.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+LocalThicknessImageFilter<TInputImage, TOutputImage>::LocalThicknessImageFilter()
+{
+  m_Threshold = NumericTraits<InputPixelType>::OneValue();
+  m_CleanUp = true;
+  m_BucketSize = 8;
+  m_Phase = DISTANCE;
+  m_Dimension = 0;
+  m_Input = NULL;
+  m_Output = NULL;
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( input )
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(DataObject *)
+{
+  this->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  if (ImageDimension != 3)
+    itkExceptionMacro(<< "Only 3D images are supported");
+  if (m_BucketSize == 0)
+    itkExceptionMacro(<< "BucketSize must be positive");
+
+  InputImageConstPointer input = this->GetInput();
+  OutputImagePointer output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+  output->FillBuffer( NumericTraits<OutputPixelType>::ZeroValue() );
+
+  m_Input = input->GetBufferPointer();
+  m_Output = output->GetBufferPointer();
+  for (unsigned int d = 0; d < 3; ++d)
+    m_Size[d] = input->GetBufferedRegion().GetSize()[d];
+  m_Stride[0] = 1;
+  m_Stride[1] = m_Size[0];
+  m_Stride[2] = m_Size[0] * m_Size[1];
+  const SizeValueType numPixels = m_Stride[2] * m_Size[2];
+
+  const float infinity = std::numeric_limits<float>::max();
+  m_Distance.resize(numPixels);
+  bool background = false;
+  for (SizeValueType i = 0; i < numPixels; ++i)
+  {
+    m_Distance[i] = this->IsInside(i) ? infinity : 0;
+    background = background || !this->IsInside(i);
+  }
+  if (!background)
+    itkExceptionMacro(<< "The image has no background, the thickness is unbounded");
+
+  const unsigned int numThreads = this->GetNumberOfThreads();
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+
+  m_Phase = DISTANCE;
+  for (m_Dimension = 0; m_Dimension < 3; ++m_Dimension)
+    this->GetMultiThreader()->SingleMethodExecute();
+
+  m_ThreadBalls.assign(numThreads, std::vector< Ball >());
+  m_Phase = RIDGE;
+  this->GetMultiThreader()->SingleMethodExecute();
+  std::vector< float >().swap(m_Distance);
+
+  //Every bucket lists the balls whose bounding box overlaps it, largest first
+  m_Balls.clear();
+  for (unsigned int t = 0; t < numThreads; ++t)
+    m_Balls.insert(m_Balls.end(), m_ThreadBalls[t].begin(), m_ThreadBalls[t].end());
+  m_ThreadBalls.clear();
+  std::sort(m_Balls.begin(), m_Balls.end(), BallGreater());
+
+  for (unsigned int d = 0; d < 3; ++d)
+    m_Buckets[d] = (m_Size[d] + m_BucketSize - 1) / m_BucketSize;
+  const SizeValueType numBuckets = m_Buckets[0] * m_Buckets[1] * m_Buckets[2];
+  m_BucketStart.assign(numBuckets + 1, 0);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    std::vector< SizeValueType > fill;
+    if (pass == 1)
+    {
+      for (SizeValueType b = 0; b < numBuckets; ++b)
+        m_BucketStart[b + 1] += m_BucketStart[b];
+      m_BucketBalls.resize(m_BucketStart[numBuckets]);
+      fill.assign(m_BucketStart.begin(), m_BucketStart.end() - 1);
+    }
+    for (SizeValueType k = 0; k < m_Balls.size(); ++k)
+    {
+      const OffsetValueType reach = static_cast<OffsetValueType>(sqrt(m_Balls[k].SquaredRadius));
+      SizeValueType first[3], last[3];
+      for (unsigned int d = 0; d < 3; ++d)
+      {
+        first[d] = std::max<OffsetValueType>(0, m_Balls[k].Centre[d] - reach) / m_BucketSize;
+        last[d] = std::min<OffsetValueType>(m_Size[d] - 1, m_Balls[k].Centre[d] + reach) / m_BucketSize;
+      }
+      for (SizeValueType bz = first[2]; bz <= last[2]; ++bz)
+        for (SizeValueType by = first[1]; by <= last[1]; ++by)
+          for (SizeValueType bx = first[0]; bx <= last[0]; ++bx)
+          {
+            const SizeValueType b = (bz * m_Buckets[1] + by) * m_Buckets[0] + bx;
+            if (pass == 0)
+              m_BucketStart[b + 1]++;
+            else
+              m_BucketBalls[ fill[b]++ ] = k;
+          }
+    }
+  }
+
+  m_Phase = THICKNESS;
+  this->GetMultiThreader()->SingleMethodExecute();
+  std::vector< Ball >().swap(m_Balls);
+  std::vector< SizeValueType >().swap(m_BucketStart);
+  std::vector< SizeValueType >().swap(m_BucketBalls);
+
+  if (m_CleanUp)
+  {
+    m_ThreadPending.assign(numThreads, std::vector< SizeValueType >());
+    m_Phase = CLEANUP;
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    //Boundary voxels with only boundary neighbours take the mean of the
+    //already corrected ones
+    for (unsigned int t = 0; t < numThreads; ++t)
+      for (SizeValueType i = 0; i < m_ThreadPending[t].size(); ++i)
+      {
+        const SizeValueType p = m_ThreadPending[t][i];
+        const OffsetValueType x = p % m_Size[0];
+        const OffsetValueType y = (p / m_Size[0]) % m_Size[1];
+        const OffsetValueType z = p / m_Stride[2];
+        double sum = 0;
+        unsigned int count = 0;
+        for (OffsetValueType dz = -1; dz <= 1; ++dz)
+          for (OffsetValueType dy = -1; dy <= 1; ++dy)
+            for (OffsetValueType dx = -1; dx <= 1; ++dx)
+            {
+              if (x + dx < 0 || y + dy < 0 || z + dz < 0 || x + dx >= (OffsetValueType)m_Size[0]
+                  || y + dy >= (OffsetValueType)m_Size[1] || z + dz >= (OffsetValueType)m_Size[2])
+                continue;
+              const SizeValueType q = p + dx + dy * m_Stride[1] + dz * m_Stride[2];
+              if (q != p && this->IsInside(q))
+              {
+                sum += m_Output[q];
+                ++count;
+              }
+            }
+        if (count > 0)
+          m_Output[p] = static_cast<OutputPixelType>(sum / count);
+      }
+    m_ThreadPending.clear();
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+SizeValueType LocalThicknessImageFilter<TInputImage, TOutputImage>
+::GetNumberOfWorkUnits() const
+{
+  if (m_Phase == DISTANCE)
+    return m_Size[0] * m_Size[1] * m_Size[2] / m_Size[m_Dimension];
+  return m_Size[2];
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+LocalThicknessImageFilter<TInputImage, TOutputImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  const SizeValueType numUnits = filter->GetNumberOfWorkUnits();
+  const SizeValueType begin = numUnits * threadId / threadCount;
+  const SizeValueType end = numUnits * (threadId + 1) / threadCount;
+  switch (filter->m_Phase)
+  {
+    case DISTANCE:
+      filter->ThreadedDistance(begin, end);
+      break;
+    case RIDGE:
+      filter->ThreadedRidge(begin, end, filter->m_ThreadBalls[threadId]);
+      break;
+    case THICKNESS:
+      filter->ThreadedThickness(begin, end);
+      break;
+    case CLEANUP:
+      filter->ThreadedCleanUp(begin, end, filter->m_ThreadPending[threadId]);
+      break;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::ThreadedDistance(SizeValueType begin, SizeValueType end)
+{
+  const unsigned int d = m_Dimension;
+  const unsigned int d1 = (d + 1) % 3;
+  const unsigned int d2 = (d + 2) % 3;
+  const SizeValueType n = m_Size[d];
+  const float infinity = std::numeric_limits<float>::max();
+
+  std::vector< double > f(n);
+  std::vector< SizeValueType > v(n);
+  std::vector< double > z(n + 1);
+  for (SizeValueType line = begin; line < end; ++line)
+  {
+    const SizeValueType start = (line % m_Size[d1]) * m_Stride[d1]
+        + (line / m_Size[d1]) * m_Stride[d2];
+    for (SizeValueType q = 0; q < n; ++q)
+      f[q] = m_Distance[start + q * m_Stride[d]];
+
+    //Lower envelope of the parabolas rooted at the finite samples
+    OffsetValueType k = -1;
+    for (SizeValueType q = 0; q < n; ++q)
+    {
+      if (f[q] >= infinity)
+        continue;
+      double s = 0;
+      while (k >= 0)
+      {
+        const double vk = static_cast<double>(v[k]);
+        s = ((f[q] + double(q) * q) - (f[v[k]] + vk * vk)) / (2.0 * (double(q) - vk));
+        if (s > z[k])
+          break;
+        --k;
+      }
+      ++k;
+      v[k] = q;
+      z[k] = (k == 0) ? -infinity : s;
+      z[k + 1] = infinity;
+    }
+    if (k < 0)
+      continue;
+
+    OffsetValueType j = 0;
+    for (SizeValueType q = 0; q < n; ++q)
+    {
+      while (z[j + 1] < q)
+        ++j;
+      const double dq = double(q) - double(v[j]);
+      m_Distance[start + q * m_Stride[d]] = static_cast<float>(dq * dq + f[v[j]]);
+    }
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::ThreadedRidge(SizeValueType begin, SizeValueType end, std::vector< Ball > & balls)
+{
+  //A ball is redundant when a neighbouring ball contains it
+  for (SizeValueType z = begin; z < end; ++z)
+    for (SizeValueType y = 0; y < m_Size[1]; ++y)
+      for (SizeValueType x = 0; x < m_Size[0]; ++x)
+      {
+        const SizeValueType p = x + y * m_Stride[1] + z * m_Stride[2];
+        if (m_Distance[p] <= 0)
+          continue;
+        const double radius = sqrt(static_cast<double>(m_Distance[p]));
+        bool ridge = true;
+        for (OffsetValueType dz = -1; dz <= 1 && ridge; ++dz)
+          for (OffsetValueType dy = -1; dy <= 1 && ridge; ++dy)
+            for (OffsetValueType dx = -1; dx <= 1 && ridge; ++dx)
+            {
+              const OffsetValueType nx = x + dx, ny = y + dy, nz = z + dz;
+              if ((dx == 0 && dy == 0 && dz == 0) || nx < 0 || ny < 0 || nz < 0
+                  || nx >= (OffsetValueType)m_Size[0] || ny >= (OffsetValueType)m_Size[1]
+                  || nz >= (OffsetValueType)m_Size[2])
+                continue;
+              const float neighbour = m_Distance[nx + ny * m_Stride[1] + nz * m_Stride[2]];
+              const double step = sqrt(static_cast<double>(dx * dx + dy * dy + dz * dz));
+              if (sqrt(static_cast<double>(neighbour)) >= radius + step - 1e-6)
+                ridge = false;
+            }
+        if (!ridge)
+          continue;
+        Ball ball;
+        ball.Centre[0] = x;
+        ball.Centre[1] = y;
+        ball.Centre[2] = z;
+        ball.SquaredRadius = m_Distance[p];
+        balls.push_back(ball);
+      }
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::ThreadedThickness(SizeValueType begin, SizeValueType end)
+{
+  for (SizeValueType z = begin; z < end; ++z)
+    for (SizeValueType y = 0; y < m_Size[1]; ++y)
+    {
+      const SizeValueType rowBucket = ((z / m_BucketSize) * m_Buckets[1] + y / m_BucketSize)
+          * m_Buckets[0];
+      for (SizeValueType x = 0; x < m_Size[0]; ++x)
+      {
+        const SizeValueType p = x + y * m_Stride[1] + z * m_Stride[2];
+        if (!this->IsInside(p))
+          continue;
+        const SizeValueType b = rowBucket + x / m_BucketSize;
+        for (SizeValueType i = m_BucketStart[b]; i < m_BucketStart[b + 1]; ++i)
+        {
+          const Ball & ball = m_Balls[ m_BucketBalls[i] ];
+          const double dx = double(x) - ball.Centre[0];
+          const double dy = double(y) - ball.Centre[1];
+          const double dz = double(z) - ball.Centre[2];
+          if (dx * dx + dy * dy + dz * dz <= ball.SquaredRadius)
+          {
+            m_Output[p] = static_cast<OutputPixelType>(2.0 * sqrt(ball.SquaredRadius));
+            break;
+          }
+        }
+      }
+    }
+}
+
+template<class TInputImage, class TOutputImage>
+void LocalThicknessImageFilter<TInputImage, TOutputImage>
+::ThreadedCleanUp(SizeValueType begin, SizeValueType end, std::vector< SizeValueType > & pending)
+{
+  const OffsetValueType size[3] = { (OffsetValueType)m_Size[0], (OffsetValueType)m_Size[1],
+                                    (OffsetValueType)m_Size[2] };
+  for (OffsetValueType z = begin; z < (OffsetValueType)end; ++z)
+    for (OffsetValueType y = 0; y < size[1]; ++y)
+      for (OffsetValueType x = 0; x < size[0]; ++x)
+      {
+        const SizeValueType p = x + y * m_Stride[1] + z * m_Stride[2];
+        if (!this->IsInside(p))
+          continue;
+
+        //Only the boundary voxels are written, and only the interior ones
+        //are read, so the slabs do not interfere
+        double sum = 0;
+        unsigned int count = 0;
+        bool boundary = false;
+        for (OffsetValueType dz = -1; dz <= 1; ++dz)
+          for (OffsetValueType dy = -1; dy <= 1; ++dy)
+            for (OffsetValueType dx = -1; dx <= 1; ++dx)
+            {
+              const OffsetValueType nx = x + dx, ny = y + dy, nz = z + dz;
+              if (nx < 0 || ny < 0 || nz < 0 || nx >= size[0] || ny >= size[1] || nz >= size[2])
+                continue;
+              const SizeValueType q = nx + ny * m_Stride[1] + nz * m_Stride[2];
+              if (!this->IsInside(q))
+              {
+                boundary = true;
+                continue;
+              }
+              if (q == p)
+                continue;
+
+              bool interior = true;
+              for (OffsetValueType ez = -1; ez <= 1 && interior; ++ez)
+                for (OffsetValueType ey = -1; ey <= 1 && interior; ++ey)
+                  for (OffsetValueType ex = -1; ex <= 1 && interior; ++ex)
+                  {
+                    const OffsetValueType mx = nx + ex, my = ny + ey, mz = nz + ez;
+                    if (mx < 0 || my < 0 || mz < 0 || mx >= size[0] || my >= size[1] || mz >= size[2])
+                      continue;
+                    interior = this->IsInside(mx + my * m_Stride[1] + mz * m_Stride[2]);
+                  }
+              if (interior)
+              {
+                sum += m_Output[q];
+                ++count;
+              }
+            }
+        if (!boundary)
+          continue;
+        if (count > 0)
+          m_Output[p] = static_cast<OutputPixelType>(sum / count);
+        else
+          pending.push_back(p);
+      }
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template <class TInputImage, class TOutputImage>
+void
+LocalThicknessImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Threshold: "
+     << static_cast<typename NumericTraits<InputPixelType>::PrintType>(m_Threshold)
+     << std::endl;
+  os << indent << "CleanUp: " << m_CleanUp << std::endl;
+  os << indent << "BucketSize: " << m_BucketSize << std::endl;
+}
+
+} // end namespace
+#endif //ITKLOCALTHICKNESSIMAGEFILTER_TXX
@@ -49,6 +49,10 @@ namespace itk
  * the Gerardus modification) distributed scale levels are computed
  * within the bound set by the minimum and maximum sigma values
  *
+ * With GenerateScaleOutput on, output 1 holds the index (from 1, 0 where no
+ * scale responds) of the best scale. With GenerateRadiusOutput on, output 2
+ * holds the matching vessel radius, sqrt(2) * sigma: the scale normalised
+ * response at the centre of a cylinder of radius r peaks at r / sqrt(2).
  *
  * \par References
  *  Manniesing, R, Viergever, MA, & Niessen, WJ (2006). Vessel Enhancing
@@ -88,6 +92,9 @@ public:
   /** Update image buffer that holds the best vesselness response */
   typedef Image< double, 3>                              UpdateBufferType;
 
+  /** Index of the best scale */
+  typedef Image< unsigned char, 3>                       ScaleImageType;
+
   /** Image dimension = 3. */
   itkStaticConstMacro(ImageDimension, unsigned int,
                    InputImageType::ImageDimension);
@@ -115,6 +122,22 @@ public:
   itkSetMacro( BrightVessels, bool );
   itkGetMacro( BrightVessels, bool );
 
+  /** Set/Get macros for the optional best scale and radius outputs */
+  itkSetMacro( GenerateScaleOutput, bool );
+  itkGetMacro( GenerateScaleOutput, bool );
+  itkBooleanMacro( GenerateScaleOutput );
+  itkSetMacro( GenerateRadiusOutput, bool );
+  itkGetMacro( GenerateRadiusOutput, bool );
+  itkBooleanMacro( GenerateRadiusOutput );
+
+  ScaleImageType * GetScaleOutput();
+  OutputImageType * GetRadiusOutput();
+
+  /** Output 1 is the scale index image */
+  typedef ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+  using Superclass::MakeOutput;
+  virtual DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx);
+
 protected:
   MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter();
   ~MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter() {};
@@ -130,7 +153,7 @@ protected:
   void GenerateData( void );
 
 private:
-  void UpdateMaximumResponse();
+  void UpdateMaximumResponse( int scaleLevel );
 
   double ComputeSigmaValue( int scaleLevel );
 
@@ -147,6 +170,8 @@ private:
 
   bool                                              m_IsSigmaStepLog;
   bool                                              m_BrightVessels;
+  bool                                              m_GenerateScaleOutput;
+  bool                                              m_GenerateRadiusOutput;
 
   typename VesselnessFilterType::Pointer            m_VesselnessFilter;
   typename HessianFilterType::Pointer               m_HessianFilter;
@@ -26,7 +26,9 @@
 #include "itkMultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
+#include "itkNumericTraits.h"
 #include "vnl/vnl_math.h"
+#include <vector>
 
 #define EPSILON  1e-03
 
@@ -55,6 +57,45 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 
   //Instantiate Update buffer
   m_UpdateBuffer                 = UpdateBufferType::New();
+
+  m_GenerateScaleOutput = false;
+  m_GenerateRadiusOutput = false;
+  this->ProcessObject::SetNumberOfRequiredOutputs(3);
+  this->ProcessObject::SetNthOutput(1, this->MakeOutput(1));
+  this->ProcessObject::SetNthOutput(2, this->MakeOutput(2));
+}
+
+template <typename TInputImage, typename TOutputImage >
+DataObject::Pointer
+MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
+<TInputImage,TOutputImage>
+::MakeOutput(DataObjectPointerArraySizeType idx)
+{
+  if (idx == 1)
+    {
+    return ScaleImageType::New().GetPointer();
+    }
+  return Superclass::MakeOutput(idx);
+}
+
+template <typename TInputImage, typename TOutputImage >
+typename MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
+<TInputImage,TOutputImage>::ScaleImageType *
+MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
+<TInputImage,TOutputImage>
+::GetScaleOutput()
+{
+  return dynamic_cast< ScaleImageType * >( this->ProcessObject::GetOutput(1) );
+}
+
+template <typename TInputImage, typename TOutputImage >
+typename MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
+<TInputImage,TOutputImage>::OutputImageType *
+MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
+<TInputImage,TOutputImage>
+::GetRadiusOutput()
+{
+  return dynamic_cast< OutputImageType * >( this->ProcessObject::GetOutput(2) );
 }
 
 template <typename TInputImage, typename TOutputImage >
@@ -74,6 +115,16 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
   m_UpdateBuffer->SetRequestedRegion(output->GetRequestedRegion());
   m_UpdateBuffer->SetBufferedRegion(output->GetBufferedRegion());
   m_UpdateBuffer->Allocate();
+  m_UpdateBuffer->FillBuffer( 0.0 );
+
+  //The best scale is tracked whenever the radius is requested too
+  if ( m_GenerateScaleOutput || m_GenerateRadiusOutput )
+    {
+    ScaleImageType * scaleImage = this->GetScaleOutput();
+    scaleImage->SetBufferedRegion(output->GetBufferedRegion());
+    scaleImage->Allocate();
+    scaleImage->FillBuffer( 0 );
+    }
 }
 
 
@@ -102,8 +153,17 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 
   int scaleLevel = 1;
 
+  std::vector< double > sigmas;
+
   while ( sigma <= m_SigmaMax )
     {
+    if ( ( m_GenerateScaleOutput || m_GenerateRadiusOutput )
+         && scaleLevel > NumericTraits< ScaleImageType::PixelType >::max() )
+      {
+      itkExceptionMacro(<< "Too many scales to store their index");
+      }
+    sigmas.push_back( sigma );
+
 //    std::cout << "Computing vesselness for scale with sigma= "
 //              << sigma << std::endl;
 
@@ -113,7 +173,7 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 
     m_VesselnessFilter->Update();
 
-    this->UpdateMaximumResponse();
+    this->UpdateMaximumResponse( scaleLevel );
 
     sigma  = this->ComputeSigmaValue( scaleLevel );
 
@@ -135,13 +195,40 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
     ++oit;
     ++it;
     }
+
+  if ( m_GenerateRadiusOutput )
+    {
+    std::vector< OutputPixelType > radius( sigmas.size() + 1,
+                                           NumericTraits< OutputPixelType >::ZeroValue() );
+    for ( unsigned int s = 0; s < sigmas.size(); ++s )
+      {
+      radius[s + 1] = static_cast< OutputPixelType >( vcl_sqrt( 2.0 ) * sigmas[s] );
+      }
+
+    TOutputImage * radiusImage = this->GetRadiusOutput();
+    radiusImage->SetBufferedRegion( this->GetOutput()->GetBufferedRegion() );
+    radiusImage->Allocate();
+
+    ImageRegionConstIterator<ScaleImageType> sit(this->GetScaleOutput(),
+                          this->GetOutput()->GetLargestPossibleRegion());
+    ImageRegionIterator<TOutputImage> rit(radiusImage,
+                          this->GetOutput()->GetLargestPossibleRegion());
+    for ( ; !rit.IsAtEnd(); ++rit, ++sit )
+      {
+      rit.Set( radius[ sit.Get() ] );
+      }
+    }
+  if ( !m_GenerateScaleOutput )
+    {
+    this->GetScaleOutput()->ReleaseData();
+    }
 }
 
 template <typename TInputImage, typename TOutputImage >
 void
 MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 <TInputImage,TOutputImage>
-::UpdateMaximumResponse()
+::UpdateMaximumResponse( int scaleLevel )
 {
 
   ImageRegionIterator<UpdateBufferType>
@@ -158,6 +245,26 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 
   it.GoToBegin();
 
+  if ( m_GenerateScaleOutput || m_GenerateRadiusOutput )
+    {
+    ImageRegionIterator<ScaleImageType>
+              sit(this->GetScaleOutput(),m_UpdateBuffer->GetLargestPossibleRegion());
+    const ScaleImageType::PixelType scale =
+      static_cast< ScaleImageType::PixelType >( scaleLevel );
+    while(!oit.IsAtEnd())
+      {
+      if( oit.Value() < it.Value() )
+        {
+        oit.Value() = it.Value();
+        sit.Value() = scale;
+        }
+      ++oit;
+      ++it;
+      ++sit;
+      }
+    return;
+    }
+
   while(!oit.IsAtEnd())
     {
     if( oit.Value() < it.Value() )
@@ -206,6 +313,8 @@ MultiScaleHessianSmoothed3DToVesselnessMeasureImageFilter
 
   os << indent << "SigmaMin:  " << m_SigmaMin << std::endl;
   os << indent << "SigmaMax:  " << m_SigmaMax  << std::endl;
+  os << indent << "GenerateScaleOutput:  " << m_GenerateScaleOutput << std::endl;
+  os << indent << "GenerateRadiusOutput:  " << m_GenerateRadiusOutput << std::endl;
 }
 
 
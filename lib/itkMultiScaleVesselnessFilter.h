@@ -20,12 +20,18 @@
 #include <itkHessianRecursiveGaussianImageFilter.h>
 #include <itkCustomHessian3DToVesselnessMeasureImageFilter.h>
 #include <math.h>
+#include <vector>
 
 namespace itk {
 
 /** \class MultiScaleVesselnessFilter
  * \brief Gives tha maximum filter response using Sato's filter
  * (Sato et al, MedIA 1998) per voxel, given a range of scales
+ *
+ * Optionally, output 1 holds the index (from 1, 0 where no scale responds)
+ * of the scale giving the maximum response and output 2 the vessel radius
+ * it corresponds to, in mm. With the scale normalised Hessian, the response
+ * at the centre of a cylinder of radius r peaks at sigma = r / sqrt(2).
  */
 template < class TInputImage, class TOutputImage >
 class ITK_EXPORT MultiScaleVesselnessFilter :
@@ -55,6 +61,9 @@ public:
   typedef typename InputImageType::SpacingType        SpacingType;
   typedef typename OutputImageType::PixelType         OutputPixelType;
 
+  /** Best scale index image. */
+  typedef Image< unsigned char, itkGetStaticConstMacro(ImageDimension) > ScaleImageType;
+
   typedef enum
   {
     LINEAR = 0,
@@ -72,6 +81,24 @@ public:
   itkSetMacro(MinScale, float);
   itkSetMacro(MaxScale, float);
   itkSetMacro(ScaleMode, ScaleModeType);
+  itkGetConstMacro(GenerateScaleOutput, bool);
+  itkSetMacro(GenerateScaleOutput, bool);
+  itkBooleanMacro(GenerateScaleOutput);
+  itkGetConstMacro(GenerateRadiusOutput, bool);
+  itkSetMacro(GenerateRadiusOutput, bool);
+  itkBooleanMacro(GenerateRadiusOutput);
+
+  ScaleImageType * GetScaleOutput();
+  OutputImageType * GetRadiusOutput();
+
+  /** Scales used by the last update. */
+  const std::vector< float > & GetScales() const
+  { return m_Scales; }
+
+  /** Output 1 is the scale index image. */
+  typedef ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+  using Superclass::MakeOutput;
+  virtual DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx);
 
 protected:
   MultiScaleVesselnessFilter();
@@ -97,6 +124,9 @@ private:
   float   m_MinScale;
   float   m_MaxScale;
   ScaleModeType m_ScaleMode;
+  bool    m_GenerateScaleOutput;
+  bool    m_GenerateRadiusOutput;
+  std::vector< float > m_Scales;
 };
 
 }
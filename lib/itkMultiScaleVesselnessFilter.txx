@@ -5,6 +5,7 @@
 #include <itkImageRegionIterator.h>
 #include <itkMath.h>
 #include <itkImageRegionConstIterator.h>
+#include <itkNumericTraits.h>
 
 
 namespace itk {
@@ -17,6 +18,35 @@ MultiScaleVesselnessFilter<TInputImage, TOutputImage>::MultiScaleVesselnessFilte
   m_MinScale = 0.77;
   m_MaxScale = 3.09375;
   m_ScaleMode = LINEAR;
+  m_GenerateScaleOutput = false;
+  m_GenerateRadiusOutput = false;
+
+  this->ProcessObject::SetNumberOfRequiredOutputs(3);
+  this->ProcessObject::SetNthOutput(1, this->MakeOutput(1));
+  this->ProcessObject::SetNthOutput(2, this->MakeOutput(2));
+}
+
+template<class TInputImage, class TOutputImage>
+DataObject::Pointer MultiScaleVesselnessFilter<TInputImage, TOutputImage>
+::MakeOutput(DataObjectPointerArraySizeType idx)
+{
+  if (idx == 1)
+    return ScaleImageType::New().GetPointer();
+  return Superclass::MakeOutput(idx);
+}
+
+template<class TInputImage, class TOutputImage>
+typename MultiScaleVesselnessFilter<TInputImage, TOutputImage>::ScaleImageType *
+MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GetScaleOutput()
+{
+  return dynamic_cast< ScaleImageType * >( this->ProcessObject::GetOutput(1) );
+}
+
+template<class TInputImage, class TOutputImage>
+typename MultiScaleVesselnessFilter<TInputImage, TOutputImage>::OutputImageType *
+MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GetRadiusOutput()
+{
+  return dynamic_cast< OutputImageType * >( this->ProcessObject::GetOutput(2) );
 }
 
 template<class TInputImage, class TOutputImage>
@@ -71,10 +101,30 @@ void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateData()
   typename OutputImageType::Pointer maxImage = vesselnessFilter->GetOutput();
   maxImage->DisconnectPipeline();
 
+  //The best scale is tracked whenever the radius is requested too
+  const bool trackScale = m_GenerateScaleOutput || m_GenerateRadiusOutput;
+  if (trackScale && scales > NumericTraits<typename ScaleImageType::PixelType>::max())
+    itkExceptionMacro(<< "Too many scales to store their index: " << scales);
+  m_Scales = all_scales;
+  typename ScaleImageType::Pointer scaleImage = this->GetScaleOutput();
+  if (trackScale)
+  {
+    scaleImage->SetBufferedRegion( maxImage->GetBufferedRegion() );
+    scaleImage->Allocate();
+  }
+
   typename itk::ImageRegionIterator<OutputImageType> outimageIterator(maxImage,
                                                         maxImage->GetLargestPossibleRegion());
-    std::cout << "a test" << std::endl;
-  for (size_t s = 0; s < all_scales.size(); ++s) {
+  if (trackScale)
+  {
+    typename itk::ImageRegionIterator<ScaleImageType> scaleIterator(scaleImage,
+                                                          maxImage->GetLargestPossibleRegion());
+    for (outimageIterator.GoToBegin(); !outimageIterator.IsAtEnd(); ++outimageIterator, ++scaleIterator)
+      scaleIterator.Set( outimageIterator.Get() > NumericTraits<OutputPixelType>::ZeroValue() ? 1 : 0 );
+  }
+
+  //The first scale is already in maxImage
+  for (size_t s = 1; s < all_scales.size(); ++s) {
     hessianFilter->SetSigma( static_cast< double >( all_scales[s] ) );
     vesselnessFilter->Update();
     vesselnessImage = vesselnessFilter->GetOutput();
@@ -83,14 +133,51 @@ void MultiScaleVesselnessFilter<TInputImage, TOutputImage>::GenerateData()
 
     vesselimageIterator.GoToBegin();
     outimageIterator.GoToBegin();
-    while(!vesselimageIterator.IsAtEnd()) {
-      if (vesselimageIterator.Get() > outimageIterator.Get())
-        outimageIterator.Set( vesselimageIterator.Get() );
-      ++outimageIterator;
-      ++vesselimageIterator;
+    if (trackScale)
+    {
+      typename itk::ImageRegionIterator<ScaleImageType> scaleIterator(scaleImage,
+                                                            maxImage->GetLargestPossibleRegion());
+      while(!vesselimageIterator.IsAtEnd()) {
+        if (vesselimageIterator.Get() > outimageIterator.Get())
+        {
+          outimageIterator.Set( vesselimageIterator.Get() );
+          scaleIterator.Set( static_cast<typename ScaleImageType::PixelType>(s + 1) );
+        }
+        ++outimageIterator;
+        ++vesselimageIterator;
+        ++scaleIterator;
+      }
+    }
+    else
+    {
+      while(!vesselimageIterator.IsAtEnd()) {
+        if (vesselimageIterator.Get() > outimageIterator.Get())
+          outimageIterator.Set( vesselimageIterator.Get() );
+        ++outimageIterator;
+        ++vesselimageIterator;
+      }
     }
   }
 
+  if (m_GenerateRadiusOutput)
+  {
+    std::vector< OutputPixelType > radius(all_scales.size() + 1, NumericTraits<OutputPixelType>::ZeroValue());
+    for (unsigned int s = 0; s < all_scales.size(); ++s)
+      radius[s + 1] = static_cast< OutputPixelType >( sqrt(2.0) * all_scales[s] );
+
+    OutputImageType * radiusImage = this->GetRadiusOutput();
+    radiusImage->SetBufferedRegion( maxImage->GetBufferedRegion() );
+    radiusImage->Allocate();
+    typename itk::ImageRegionConstIterator<ScaleImageType> scaleIterator(scaleImage,
+                                                               maxImage->GetLargestPossibleRegion());
+    typename itk::ImageRegionIterator<OutputImageType> radiusIterator(radiusImage,
+                                                           maxImage->GetLargestPossibleRegion());
+    for (; !radiusIterator.IsAtEnd(); ++radiusIterator, ++scaleIterator)
+      radiusIterator.Set( radius[ scaleIterator.Get() ] );
+  }
+  if (!m_GenerateScaleOutput)
+    scaleImage->ReleaseData();
+
   this->GraftOutput( maxImage );
 }
 
@@ -104,6 +191,8 @@ MultiScaleVesselnessFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "GenerateScaleOutput: " << m_GenerateScaleOutput << std::endl;
+  os << indent << "GenerateRadiusOutput: " << m_GenerateRadiusOutput << std::endl;
 }
 
 }// end namespace
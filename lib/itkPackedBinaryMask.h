@@ -0,0 +1,260 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKPACKEDBINARYMASK_H
+#define ITKPACKEDBINARYMASK_H
+
+#include <itkImage.h>
+#include <itkIntTypes.h>
+#include <itkMultiThreader.h>
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <vector>
+
+namespace itk {
+
+/** \class PackedBinaryMask
+ * \brief 2D or 3D binary image stored as one bit per voxel.
+ *
+ * Every row along x is packed into 64-bit words, so a mask takes 1/32 of
+ * the memory of the same mask as a float image, and the morphology works
+ * on 64 voxels per instruction. The mask keeps the geometry of the image it
+ * was packed from, so that ToImage gives back an image on the same grid.
+ *
+ * Dilate and Erode use the ball of BinaryBallStructuringElement of the same
+ * radius in voxels, and treat the outside of the image as
+ * BinaryDilateImageFilter and BinaryErodeImageFilter do (background for
+ * dilation, foreground for erosion), so that the results are identical.
+ * The ball is applied as a union of rows: each row of the ball is a
+ * dilation along x, computed once per input slice and radius, shifted in y
+ * and z. The cost grows with the square of the radius in 3D.
+ *
+ * FillHoles sets the background that cannot be reached from the border of
+ * the image, as BinaryFillholeImageFilter does. The background is flooded
+ * from the border a row at a time: a row is filled along x with word
+ * operations, then passed on to the neighbouring rows. Every thread floods
+ * its own slab of rows and hands what crosses into other slabs over at the
+ * end of each round, until a round reaches nothing new.
+ */
+template< unsigned int VDimension >
+class ITK_EXPORT PackedBinaryMask : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef PackedBinaryMask              Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PackedBinaryMask, Object);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, VDimension);
+
+  typedef uint64_t                                  WordType;
+  typedef ImageRegion< VDimension >                 RegionType;
+  typedef Index< VDimension >                       IndexType;
+  typedef typename Image< unsigned char, VDimension >::SpacingType    SpacingType;
+  typedef typename Image< unsigned char, VDimension >::PointType      PointType;
+  typedef typename Image< unsigned char, VDimension >::DirectionType  DirectionType;
+
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Grid of the mask, that of the buffer of the image it was packed from. */
+  const RegionType & GetRegion() const
+  { return m_Region; }
+  const SpacingType & GetSpacing() const
+  { return m_Spacing; }
+  const PointType & GetOrigin() const
+  { return m_Origin; }
+  const DirectionType & GetDirection() const
+  { return m_Direction; }
+
+  /** Packs the voxels of image equal to foreground. */
+  template< class TImage >
+  void FromImage(const TImage * image, typename TImage::PixelType foreground);
+
+  /** New image on the grid of the mask, inside where the mask is set and
+   * outside elsewhere. */
+  template< class TImage >
+  typename TImage::Pointer ToImage(typename TImage::PixelType inside,
+                                   typename TImage::PixelType outside) const;
+
+  /** Sets the voxels of image, on the grid of the mask, to value where the
+   * mask is set and leaves the others unchanged. */
+  template< class TImage >
+  void PaintImage(TImage * image, typename TImage::PixelType value) const;
+
+  void Dilate(unsigned int radius);
+  void Erode(unsigned int radius);
+  void Invert();
+
+  /** Fills the background the border does not reach. With fullyConnected
+   * the background connects through edges and corners too. With sliceWise,
+   * every slice of a 3D mask is filled on its own and only the border of
+   * the slice seeds it. */
+  void FillHoles(bool fullyConnected, bool sliceWise = false);
+
+  /** Words of the row of the mask through index, along x. Bit x % 64 of
+   * word x / 64 is voxel x of the row, and the bits past the end of the
+   * row are always 0. */
+  SizeValueType GetWordsPerRow() const
+  { return m_WordsPerRow; }
+  WordType * GetRow(const IndexType & index)
+  { return &m_Words[this->ComputeRow(index) * m_WordsPerRow]; }
+  const WordType * GetRow(const IndexType & index) const
+  { return &m_Words[this->ComputeRow(index) * m_WordsPerRow]; }
+
+  bool GetPixel(const IndexType & index) const
+  {
+    const SizeValueType x = index[0] - m_Region.GetIndex(0);
+    return (this->GetRow(index)[x >> 6] >> (x & 63)) & 1;
+  }
+  void SetPixel(const IndexType & index, bool value)
+  {
+    const SizeValueType x = index[0] - m_Region.GetIndex(0);
+    const WordType bit = static_cast< WordType >(1) << (x & 63);
+    WordType & word = this->GetRow(index)[x >> 6];
+    word = value ? (word | bit) : (word & ~bit);
+  }
+
+protected:
+  PackedBinaryMask();
+  ~PackedBinaryMask() {}
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  typedef enum
+  {
+    INVERT = 0,
+    WIDEN = 1,
+    DILATE = 2,
+    SEED = 3,
+    FLOOD = 4,
+    RECEIVE = 5
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Mask;
+  };
+
+  template< class TImage >
+  struct ConvertStruct
+  {
+    Self                         *Mask;
+    const TImage                 *Input;
+    TImage                       *Output;
+    typename TImage::PixelType   Inside;
+    typename TImage::PixelType   Outside;
+    /** Leave the voxels outside the mask unchanged when unpacking. */
+    bool                         KeepOutside;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+  template< class TImage >
+  static ITK_THREAD_RETURN_TYPE PackCallback( void *arg );
+  template< class TImage >
+  static ITK_THREAD_RETURN_TYPE UnpackCallback( void *arg );
+
+  /** Row of index within the words, y + size_y * z. */
+  SizeValueType ComputeRow(const IndexType & index) const
+  {
+    SizeValueType row = 0;
+    for (unsigned int d = VDimension - 1; d > 0; --d)
+      row = row * m_Region.GetSize(d) + (index[d] - m_Region.GetIndex(d));
+    return row;
+  }
+
+  /** Rows [first, last) of the rows threadId handles out of rows. */
+  void SplitRows(ThreadIdType threadId, ThreadIdType threadCount, SizeValueType rows,
+                 SizeValueType & first, SizeValueType & last) const;
+
+  void ExecutePhase(PhaseType phase);
+  void ThreadedInvert(ThreadIdType threadId, ThreadIdType threadCount);
+  /** Dilations along x of slice m_Slice for every radius up to m_Radius. */
+  void ThreadedWiden(ThreadIdType threadId, ThreadIdType threadCount);
+  /** Slice m_Slice of the output, from the widened slices around it. */
+  void ThreadedDilate(ThreadIdType threadId, ThreadIdType threadCount);
+  /** Background of the border of the rows of threadId. */
+  void ThreadedSeed(ThreadIdType threadId);
+  /** Floods from the queued rows of threadId until its queue is empty. */
+  void ThreadedFlood(ThreadIdType threadId);
+  /** Takes the rows of threadId out of the outboxes of every thread. */
+  void ThreadedReceive(ThreadIdType threadId);
+  /** Extends the reached bits of a row through its background along x. */
+  void FillRow(WordType * reached, const WordType * foreground) const;
+  /** Adds the background of row of bits to its reached bits, and queues
+   * the row for threadId when they grow. */
+  void ReachRow(ThreadIdType threadId, SizeValueType row, const WordType * bits);
+
+  /** Offset and half length along x of one row of the ball. */
+  struct BallRow
+  {
+    OffsetValueType Y;
+    OffsetValueType Z;
+    unsigned int    HalfLength;
+  };
+
+private:
+  PackedBinaryMask(const Self &); //purposely not implemented
+  void operator=(const Self &);   //purposely not implemented
+
+  RegionType                 m_Region;
+  SpacingType                m_Spacing;
+  PointType                  m_Origin;
+  DirectionType              m_Direction;
+  SizeValueType              m_WordsPerRow;
+  SizeValueType              m_RowsPerSlice;
+  SizeValueType              m_NumberOfSlices;
+  WordType                   m_LastWordMask;
+  std::vector< WordType >    m_Words;
+  ThreadIdType               m_NumberOfThreads;
+  MultiThreader::Pointer     m_Threader;
+
+  /** State of Dilate: the rows of the ball, the widened slices of the
+   * window around the output slice (slot slice % (2 radius + 1)) and the
+   * output. */
+  PhaseType                                m_Phase;
+  unsigned int                             m_Radius;
+  SizeValueType                            m_Slice;
+  std::vector< BallRow >                   m_Ball;
+  std::vector< std::vector< WordType > >   m_Window;
+  SizeValueType                            m_WindowSize;
+  std::vector< WordType >                  m_Output;
+
+  /** State of FillHoles: the background reached from the border, the
+   * first row of every thread (and the end), the rows waiting to be
+   * flooded, and the rows each thread found in other slabs, stored as the
+   * row followed by its words. */
+  bool                                          m_FullyConnected;
+  bool                                          m_SliceWise;
+  std::vector< OffsetValueType >                m_NeighbourY;
+  std::vector< OffsetValueType >                m_NeighbourZ;
+  std::vector< WordType >                       m_Reached;
+  std::vector< SizeValueType >                  m_FirstRows;
+  std::vector< std::vector< SizeValueType > >   m_Queues;
+  std::vector< char >                           m_Queued;
+  std::vector< std::vector< WordType > >        m_Outboxes;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkPackedBinaryMask.txx"
+#endif
+
+#endif // ITKPACKEDBINARYMASK_H
@@ -0,0 +1,669 @@
+#ifndef ITKPACKEDBINARYMASK_TXX
+#define ITKPACKEDBINARYMASK_TXX
+
+#include "itkPackedBinaryMask.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk {
+
+template< unsigned int VDimension >
+PackedBinaryMask< VDimension >
+::PackedBinaryMask()
+{
+  m_Spacing.Fill(1.0);
+  m_Origin.Fill(0.0);
+  m_Direction.SetIdentity();
+  m_WordsPerRow = 0;
+  m_RowsPerSlice = 0;
+  m_NumberOfSlices = 0;
+  m_LastWordMask = 0;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_Threader = MultiThreader::New();
+  m_Phase = INVERT;
+  m_Radius = 0;
+  m_Slice = 0;
+  m_WindowSize = 0;
+  m_FullyConnected = false;
+  m_SliceWise = false;
+}
+
+template< unsigned int VDimension >
+template< class TImage >
+void
+PackedBinaryMask< VDimension >
+::FromImage(const TImage * image, typename TImage::PixelType foreground)
+{
+  m_Region = image->GetBufferedRegion();
+  m_Spacing = image->GetSpacing();
+  m_Origin = image->GetOrigin();
+  m_Direction = image->GetDirection();
+
+  const SizeValueType length = m_Region.GetSize(0);
+  m_WordsPerRow = (length + 63) / 64;
+  m_RowsPerSlice = VDimension > 1 ? m_Region.GetSize(1) : 1;
+  m_NumberOfSlices = 1;
+  for (unsigned int d = 2; d < VDimension; ++d)
+    m_NumberOfSlices *= m_Region.GetSize(d);
+  m_LastWordMask = length % 64 == 0 ? ~static_cast< WordType >(0)
+                                    : (static_cast< WordType >(1) << (length % 64)) - 1;
+  m_Words.assign(m_WordsPerRow * m_RowsPerSlice * m_NumberOfSlices, 0);
+
+  ConvertStruct< TImage > str;
+  str.Mask = this;
+  str.Input = image;
+  str.Output = 0;
+  str.Inside = foreground;
+  str.Outside = foreground;
+  str.KeepOutside = false;
+  m_Threader->SetNumberOfThreads(std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, m_RowsPerSlice * m_NumberOfSlices)));
+  m_Threader->SetSingleMethod(PackCallback< TImage >, &str);
+  m_Threader->SingleMethodExecute();
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+template< class TImage >
+typename TImage::Pointer
+PackedBinaryMask< VDimension >
+::ToImage(typename TImage::PixelType inside, typename TImage::PixelType outside) const
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(m_Region);
+  image->SetSpacing(m_Spacing);
+  image->SetOrigin(m_Origin);
+  image->SetDirection(m_Direction);
+  image->Allocate();
+
+  ConvertStruct< TImage > str;
+  str.Mask = const_cast< Self * >(this);
+  str.Input = 0;
+  str.Output = image;
+  str.Inside = inside;
+  str.Outside = outside;
+  str.KeepOutside = false;
+  m_Threader->SetNumberOfThreads(std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, m_RowsPerSlice * m_NumberOfSlices)));
+  m_Threader->SetSingleMethod(UnpackCallback< TImage >, &str);
+  m_Threader->SingleMethodExecute();
+  return image;
+}
+
+template< unsigned int VDimension >
+template< class TImage >
+void
+PackedBinaryMask< VDimension >
+::PaintImage(TImage * image, typename TImage::PixelType value) const
+{
+  if (image->GetBufferedRegion() != m_Region)
+    itkExceptionMacro(<< "The image is not on the grid of the mask");
+
+  ConvertStruct< TImage > str;
+  str.Mask = const_cast< Self * >(this);
+  str.Input = 0;
+  str.Output = image;
+  str.Inside = value;
+  str.Outside = value;
+  str.KeepOutside = true;
+  m_Threader->SetNumberOfThreads(std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, m_RowsPerSlice * m_NumberOfSlices)));
+  m_Threader->SetSingleMethod(UnpackCallback< TImage >, &str);
+  m_Threader->SingleMethodExecute();
+  image->Modified();
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::Dilate(unsigned int radius)
+{
+  if (radius == 0 || m_Words.empty())
+    return;
+
+  //Rows of the ball of BinaryBallStructuringElement, whose voxels are
+  //within radius + 0.5 of the centre
+  const double limit = (radius + 0.5) * (radius + 0.5);
+  const OffsetValueType radiusY = VDimension > 1 ? radius : 0;
+  const OffsetValueType radiusZ = VDimension > 2 ? radius : 0;
+  m_Ball.clear();
+  for (OffsetValueType z = -radiusZ; z <= radiusZ; ++z)
+    for (OffsetValueType y = -radiusY; y <= radiusY; ++y)
+    {
+      const double distance = static_cast< double >(y * y + z * z);
+      if (distance > limit)
+        continue;
+      BallRow row;
+      row.Y = y;
+      row.Z = z;
+      row.HalfLength = static_cast< unsigned int >(std::floor(std::sqrt(limit - distance)));
+      m_Ball.push_back(row);
+    }
+
+  m_Radius = radius;
+  m_WindowSize = 2 * radiusZ + 1;
+  m_Window.assign(m_WindowSize, std::vector< WordType >((radius + 1) * m_RowsPerSlice * m_WordsPerRow));
+  m_Output.assign(m_Words.size(), 0);
+
+  //Slices are widened once, when they enter the window of the output slice
+  SizeValueType widened = 0;
+  for (SizeValueType slice = 0; slice < m_NumberOfSlices; ++slice)
+  {
+    const SizeValueType end = std::min< SizeValueType >(slice + radiusZ + 1, m_NumberOfSlices);
+    for (; widened < end; ++widened)
+    {
+      m_Slice = widened;
+      this->ExecutePhase(WIDEN);
+    }
+    m_Slice = slice;
+    this->ExecutePhase(DILATE);
+  }
+
+  m_Words.swap(m_Output);
+  std::vector< WordType >().swap(m_Output);
+  std::vector< std::vector< WordType > >().swap(m_Window);
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::Erode(unsigned int radius)
+{
+  //The background dilated, with the outside of the image as background,
+  //is the foreground eroded with the outside as foreground
+  if (radius == 0 || m_Words.empty())
+    return;
+  this->Invert();
+  this->Dilate(radius);
+  this->Invert();
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::Invert()
+{
+  this->ExecutePhase(INVERT);
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::FillHoles(bool fullyConnected, bool sliceWise)
+{
+  if (m_Words.empty())
+    return;
+
+  m_FullyConnected = fullyConnected;
+  m_SliceWise = sliceWise || VDimension < 3;
+  m_NeighbourY.clear();
+  m_NeighbourZ.clear();
+  const OffsetValueType radiusY = VDimension > 1 ? 1 : 0;
+  const OffsetValueType radiusZ = m_SliceWise ? 0 : 1;
+  for (OffsetValueType z = -radiusZ; z <= radiusZ; ++z)
+    for (OffsetValueType y = -radiusY; y <= radiusY; ++y)
+      if ((y != 0 || z != 0) && (fullyConnected || y == 0 || z == 0))
+      {
+        m_NeighbourY.push_back(y);
+        m_NeighbourZ.push_back(z);
+      }
+
+  //Threads own whole slices when there are enough of them
+  const SizeValueType rows = m_RowsPerSlice * m_NumberOfSlices;
+  const SizeValueType unitRows = m_NumberOfSlices >= m_NumberOfThreads ? m_RowsPerSlice : 1;
+  const SizeValueType units = rows / unitRows;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(m_NumberOfThreads, units));
+  m_FirstRows.resize(numThreads + 1);
+  for (ThreadIdType t = 0; t <= numThreads; ++t)
+    m_FirstRows[t] = units * t / numThreads * unitRows;
+
+  m_Reached.assign(m_Words.size(), 0);
+  m_Queued.assign(rows, 0);
+  m_Queues.assign(numThreads, std::vector< SizeValueType >());
+  m_Outboxes.assign(numThreads, std::vector< WordType >());
+
+  this->ExecutePhase(SEED);
+  while (true)
+  {
+    this->ExecutePhase(FLOOD);
+    bool crossed = false;
+    for (ThreadIdType t = 0; t < numThreads; ++t)
+      crossed = crossed || !m_Outboxes[t].empty();
+    if (!crossed)
+      break;
+    this->ExecutePhase(RECEIVE);
+  }
+
+  //Everything the border did not reach is foreground
+  m_Words.swap(m_Reached);
+  std::vector< WordType >().swap(m_Reached);
+  std::vector< char >().swap(m_Queued);
+  std::vector< std::vector< SizeValueType > >().swap(m_Queues);
+  std::vector< std::vector< WordType > >().swap(m_Outboxes);
+  this->Invert();
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::SplitRows(ThreadIdType threadId, ThreadIdType threadCount, SizeValueType rows,
+            SizeValueType & first, SizeValueType & last) const
+{
+  first = rows * threadId / threadCount;
+  last = rows * (threadId + 1) / threadCount;
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ExecutePhase(PhaseType phase)
+{
+  m_Phase = phase;
+  const SizeValueType rows = phase == INVERT ? m_RowsPerSlice * m_NumberOfSlices : m_RowsPerSlice;
+
+  ThreadStruct str;
+  str.Mask = this;
+  if (phase == SEED || phase == FLOOD || phase == RECEIVE)
+    m_Threader->SetNumberOfThreads(m_FirstRows.size() - 1);
+  else
+    m_Threader->SetNumberOfThreads(std::max< SizeValueType >(1,
+        std::min< SizeValueType >(m_NumberOfThreads, rows)));
+  m_Threader->SetSingleMethod(this->ThreaderCallback, &str);
+  m_Threader->SingleMethodExecute();
+}
+
+template< unsigned int VDimension >
+ITK_THREAD_RETURN_TYPE
+PackedBinaryMask< VDimension >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  switch (str->Mask->m_Phase)
+  {
+    case INVERT:
+      str->Mask->ThreadedInvert(threadId, threadCount);
+      break;
+    case WIDEN:
+      str->Mask->ThreadedWiden(threadId, threadCount);
+      break;
+    case DILATE:
+      str->Mask->ThreadedDilate(threadId, threadCount);
+      break;
+    case SEED:
+      str->Mask->ThreadedSeed(threadId);
+      break;
+    case FLOOD:
+      str->Mask->ThreadedFlood(threadId);
+      break;
+    case RECEIVE:
+      str->Mask->ThreadedReceive(threadId);
+      break;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< unsigned int VDimension >
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+PackedBinaryMask< VDimension >
+::PackCallback( void * arg )
+{
+  ConvertStruct< TImage > * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ConvertStruct< TImage > *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * mask = str->Mask;
+  const SizeValueType length = mask->m_Region.GetSize(0);
+  SizeValueType first, last;
+  mask->SplitRows(threadId, threadCount, mask->m_RowsPerSlice * mask->m_NumberOfSlices, first, last);
+
+  const typename TImage::PixelType * in = str->Input->GetBufferPointer() + first * length;
+  for (SizeValueType row = first; row < last; ++row, in += length)
+  {
+    WordType * words = &mask->m_Words[row * mask->m_WordsPerRow];
+    for (SizeValueType x = 0; x < length; x += 64)
+    {
+      const SizeValueType bits = std::min< SizeValueType >(64, length - x);
+      WordType word = 0;
+      for (SizeValueType b = 0; b < bits; ++b)
+        word |= static_cast< WordType >(in[x + b] == str->Inside) << b;
+      words[x >> 6] = word;
+    }
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< unsigned int VDimension >
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+PackedBinaryMask< VDimension >
+::UnpackCallback( void * arg )
+{
+  ConvertStruct< TImage > * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ConvertStruct< TImage > *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  const Self * mask = str->Mask;
+  const SizeValueType length = mask->m_Region.GetSize(0);
+  SizeValueType first, last;
+  mask->SplitRows(threadId, threadCount, mask->m_RowsPerSlice * mask->m_NumberOfSlices, first, last);
+
+  typename TImage::PixelType * out = str->Output->GetBufferPointer() + first * length;
+  for (SizeValueType row = first; row < last; ++row, out += length)
+  {
+    const WordType * words = &mask->m_Words[row * mask->m_WordsPerRow];
+    if (str->KeepOutside)
+    {
+      for (SizeValueType x = 0; x < length; ++x)
+        if ((words[x >> 6] >> (x & 63)) & 1)
+          out[x] = str->Inside;
+    }
+    else
+      for (SizeValueType x = 0; x < length; ++x)
+        out[x] = (words[x >> 6] >> (x & 63)) & 1 ? str->Inside : str->Outside;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedInvert(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitRows(threadId, threadCount, m_RowsPerSlice * m_NumberOfSlices, first, last);
+  for (SizeValueType row = first; row < last; ++row)
+  {
+    WordType * words = &m_Words[row * m_WordsPerRow];
+    for (SizeValueType i = 0; i < m_WordsPerRow; ++i)
+      words[i] = ~words[i];
+    words[m_WordsPerRow - 1] &= m_LastWordMask;
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedWiden(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitRows(threadId, threadCount, m_RowsPerSlice, first, last);
+  std::vector< WordType > & slot = m_Window[m_Slice % m_WindowSize];
+  const SizeValueType words = m_WordsPerRow;
+
+  for (SizeValueType y = first; y < last; ++y)
+  {
+    const WordType * row = &m_Words[(m_Slice * m_RowsPerSlice + y) * words];
+    std::copy(row, row + words, &slot[y * words]);
+
+    //Each radius is the previous one grown by a voxel on both sides
+    for (unsigned int r = 1; r <= m_Radius; ++r)
+    {
+      const WordType * previous = &slot[((r - 1) * m_RowsPerSlice + y) * words];
+      WordType * current = &slot[(r * m_RowsPerSlice + y) * words];
+      for (SizeValueType i = 0; i < words; ++i)
+      {
+        const WordType word = previous[i];
+        WordType grown = word | (word << 1) | (word >> 1);
+        if (i > 0)
+          grown |= previous[i - 1] >> 63;
+        if (i + 1 < words)
+          grown |= previous[i + 1] << 63;
+        current[i] = grown;
+      }
+      current[words - 1] &= m_LastWordMask;
+    }
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedDilate(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitRows(threadId, threadCount, m_RowsPerSlice, first, last);
+  const SizeValueType words = m_WordsPerRow;
+  const OffsetValueType slices = static_cast< OffsetValueType >(m_NumberOfSlices);
+  const OffsetValueType rows = static_cast< OffsetValueType >(m_RowsPerSlice);
+
+  for (unsigned int b = 0; b < m_Ball.size(); ++b)
+  {
+    const BallRow & ballRow = m_Ball[b];
+    const OffsetValueType z = static_cast< OffsetValueType >(m_Slice) + ballRow.Z;
+    if (z < 0 || z >= slices)
+      continue;
+    const std::vector< WordType > & slot = m_Window[z % m_WindowSize];
+    for (SizeValueType y = first; y < last; ++y)
+    {
+      const OffsetValueType source = static_cast< OffsetValueType >(y) + ballRow.Y;
+      if (source < 0 || source >= rows)
+        continue;
+      const WordType * in = &slot[(ballRow.HalfLength * m_RowsPerSlice + source) * words];
+      WordType * out = &m_Output[(m_Slice * m_RowsPerSlice + y) * words];
+      for (SizeValueType i = 0; i < words; ++i)
+        out[i] |= in[i];
+    }
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedSeed(ThreadIdType threadId)
+{
+  const SizeValueType words = m_WordsPerRow;
+  const SizeValueType length = m_Region.GetSize(0);
+  std::vector< WordType > border(words);
+
+  for (SizeValueType row = m_FirstRows[threadId]; row < m_FirstRows[threadId + 1]; ++row)
+  {
+    const SizeValueType y = row % m_RowsPerSlice;
+    const SizeValueType z = row / m_RowsPerSlice;
+    const bool whole = (VDimension > 1 && (y == 0 || y + 1 == m_RowsPerSlice))
+        || (!m_SliceWise && (z == 0 || z + 1 == m_NumberOfSlices));
+    if (whole)
+      std::fill(border.begin(), border.end(), ~static_cast< WordType >(0));
+    else
+    {
+      std::fill(border.begin(), border.end(), 0);
+      border[0] |= 1;
+      border[(length - 1) >> 6] |= static_cast< WordType >(1) << ((length - 1) & 63);
+    }
+    border[words - 1] &= m_LastWordMask;
+    this->ReachRow(threadId, row, &border[0]);
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedFlood(ThreadIdType threadId)
+{
+  const SizeValueType words = m_WordsPerRow;
+  const SizeValueType first = m_FirstRows[threadId];
+  const SizeValueType last = m_FirstRows[threadId + 1];
+  const OffsetValueType rows = static_cast< OffsetValueType >(m_RowsPerSlice);
+  const OffsetValueType slices = static_cast< OffsetValueType >(m_NumberOfSlices);
+  std::vector< SizeValueType > & queue = m_Queues[threadId];
+  std::vector< WordType > & outbox = m_Outboxes[threadId];
+  std::vector< WordType > widened(words);
+  std::vector< WordType > crossing(words);
+  outbox.clear();
+
+  while (!queue.empty())
+  {
+    const SizeValueType row = queue.back();
+    queue.pop_back();
+    m_Queued[row] = 0;
+
+    WordType * reached = &m_Reached[row * words];
+    this->FillRow(reached, &m_Words[row * words]);
+
+    //With full connectivity a voxel also reaches the diagonal ones along x
+    const WordType * spread = reached;
+    if (m_FullyConnected)
+    {
+      for (SizeValueType i = 0; i < words; ++i)
+      {
+        WordType grown = reached[i] | (reached[i] << 1) | (reached[i] >> 1);
+        if (i > 0)
+          grown |= reached[i - 1] >> 63;
+        if (i + 1 < words)
+          grown |= reached[i + 1] << 63;
+        widened[i] = grown;
+      }
+      widened[words - 1] &= m_LastWordMask;
+      spread = &widened[0];
+    }
+
+    const OffsetValueType y = static_cast< OffsetValueType >(row % m_RowsPerSlice);
+    const OffsetValueType z = static_cast< OffsetValueType >(row / m_RowsPerSlice);
+    for (unsigned int k = 0; k < m_NeighbourY.size(); ++k)
+    {
+      const OffsetValueType ny = y + m_NeighbourY[k];
+      const OffsetValueType nz = z + m_NeighbourZ[k];
+      if (ny < 0 || ny >= rows || nz < 0 || nz >= slices)
+        continue;
+      const SizeValueType neighbour = static_cast< SizeValueType >(nz * rows + ny);
+      if (neighbour >= first && neighbour < last)
+      {
+        this->ReachRow(threadId, neighbour, spread);
+        continue;
+      }
+
+      //The owner of the row takes it in the next round
+      const WordType * foreground = &m_Words[neighbour * words];
+      bool any = false;
+      for (SizeValueType i = 0; i < words; ++i)
+      {
+        crossing[i] = spread[i] & ~foreground[i];
+        any = any || crossing[i] != 0;
+      }
+      if (any)
+      {
+        outbox.push_back(neighbour);
+        outbox.insert(outbox.end(), crossing.begin(), crossing.end());
+      }
+    }
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ThreadedReceive(ThreadIdType threadId)
+{
+  const SizeValueType words = m_WordsPerRow;
+  const SizeValueType first = m_FirstRows[threadId];
+  const SizeValueType last = m_FirstRows[threadId + 1];
+
+  for (unsigned int t = 0; t < m_Outboxes.size(); ++t)
+  {
+    const std::vector< WordType > & outbox = m_Outboxes[t];
+    for (SizeValueType i = 0; i < outbox.size(); i += words + 1)
+    {
+      const SizeValueType row = static_cast< SizeValueType >(outbox[i]);
+      if (row >= first && row < last)
+        this->ReachRow(threadId, row, &outbox[i + 1]);
+    }
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::ReachRow(ThreadIdType threadId, SizeValueType row, const WordType * bits)
+{
+  const SizeValueType words = m_WordsPerRow;
+  const WordType * foreground = &m_Words[row * words];
+  WordType * reached = &m_Reached[row * words];
+  bool grown = false;
+  for (SizeValueType i = 0; i < words; ++i)
+  {
+    const WordType added = bits[i] & ~foreground[i] & ~reached[i];
+    if (added)
+    {
+      reached[i] |= added;
+      grown = true;
+    }
+  }
+  if (grown && !m_Queued[row])
+  {
+    m_Queued[row] = 1;
+    m_Queues[threadId].push_back(row);
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::FillRow(WordType * reached, const WordType * foreground) const
+{
+  const SizeValueType words = m_WordsPerRow;
+
+  //Each word is filled through its background in doubling steps, and the
+  //fill carries into the next word, first upwards and then downwards
+  WordType carry = 0;
+  for (SizeValueType i = 0; i < words; ++i)
+  {
+    WordType open = ~foreground[i];
+    if (i + 1 == words)
+      open &= m_LastWordMask;
+    WordType fill = reached[i] | (carry & open);
+    for (unsigned int shift = 1; shift < 64; shift <<= 1)
+    {
+      fill |= open & (fill << shift);
+      open &= open << shift;
+    }
+    reached[i] = fill;
+    carry = fill >> 63;
+  }
+  carry = 0;
+  for (SizeValueType i = words; i-- > 0; )
+  {
+    WordType open = ~foreground[i];
+    if (i + 1 == words)
+      open &= m_LastWordMask;
+    WordType fill = reached[i] | (carry & open);
+    for (unsigned int shift = 1; shift < 64; shift <<= 1)
+    {
+      fill |= open & (fill >> shift);
+      open &= open >> shift;
+    }
+    reached[i] = fill;
+    carry = (fill & 1) << 63;
+  }
+}
+
+template< unsigned int VDimension >
+void
+PackedBinaryMask< VDimension >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Region: " << m_Region << std::endl;
+  os << indent << "WordsPerRow: " << m_WordsPerRow << std::endl;
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+}
+
+} // end namespace
+#endif //ITKPACKEDBINARYMASK_TXX
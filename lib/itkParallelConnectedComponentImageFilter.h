@@ -0,0 +1,222 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_H
+#define ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk {
+
+/** \class ParallelConnectedComponentImageFilter
+ * \brief Labels the connected components of a thresholded image and filters
+ * them by size in a single labelling pass.
+ *
+ * A voxel is foreground when LowerThreshold <= value <= UpperThreshold, so
+ * the input does not need to be binarised beforehand. The image is cut into
+ * slabs along the last dimension and every slab is run-length encoded and
+ * labelled with a union-find on its own thread. The slab faces are then
+ * merged and the component sizes are read from the run table, which is
+ * enough to sort and prune the objects without touching the image again.
+ * Only the final write-out is a full pass over the output.
+ *
+ * The output follows RelabelComponentImageFilter: objects are numbered by
+ * decreasing size (1 is the largest). Objects smaller than
+ * MinimumObjectSize, or than MinimumRelativeObjectSize times the largest
+ * object, are discarded, and at most NumberOfObjects are kept (0 keeps all).
+ * With BinaryOutput on, kept voxels are set to InsideValue instead.
+ *
+ * With UseSeedThreshold on, the labelling becomes a hysteresis: only the
+ * objects that contain at least one voxel >= SeedThreshold are kept. The
+ * seed test is done while encoding the runs, so it costs no extra pass.
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT ParallelConnectedComponentImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef ParallelConnectedComponentImageFilter         Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelConnectedComponentImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+  typedef typename OutputImageType::RegionType        RegionType;
+  typedef typename OutputImageType::IndexType         IndexType;
+  typedef typename OutputImageType::SizeType          SizeType;
+
+  typedef std::vector< SizeValueType >                ObjectSizeContainerType;
+
+  itkGetConstMacro(LowerThreshold, InputPixelType);
+  itkGetConstMacro(UpperThreshold, InputPixelType);
+  itkSetMacro(LowerThreshold, InputPixelType);
+  itkSetMacro(UpperThreshold, InputPixelType);
+
+  itkGetConstMacro(SeedThreshold, InputPixelType);
+  itkSetMacro(SeedThreshold, InputPixelType);
+  itkGetConstMacro(UseSeedThreshold, bool);
+  itkSetMacro(UseSeedThreshold, bool);
+  itkBooleanMacro(UseSeedThreshold);
+
+  itkGetConstMacro(FullyConnected, bool);
+  itkSetMacro(FullyConnected, bool);
+  itkBooleanMacro(FullyConnected);
+
+  itkGetConstMacro(MinimumObjectSize, SizeValueType);
+  itkSetMacro(MinimumObjectSize, SizeValueType);
+  itkGetConstMacro(MinimumRelativeObjectSize, double);
+  itkSetMacro(MinimumRelativeObjectSize, double);
+  itkGetConstMacro(NumberOfObjects, SizeValueType);
+  itkSetMacro(NumberOfObjects, SizeValueType);
+
+  itkGetConstMacro(BinaryOutput, bool);
+  itkSetMacro(BinaryOutput, bool);
+  itkBooleanMacro(BinaryOutput);
+  itkGetConstMacro(InsideValue, OutputPixelType);
+  itkSetMacro(InsideValue, OutputPixelType);
+
+  /** Number of (seeded) objects found before any size filtering. */
+  itkGetConstMacro(OriginalNumberOfObjects, SizeValueType);
+  /** Number of objects written to the output. */
+  itkGetConstMacro(NumberOfKeptObjects, SizeValueType);
+
+  /** Sizes of all the objects found, largest first. */
+  const ObjectSizeContainerType & GetSizeOfObjectsInPixels() const
+  { return m_SizeOfObjectsInPixels; }
+
+protected:
+  ParallelConnectedComponentImageFilter();
+  ~ParallelConnectedComponentImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** The whole image is labelled at once. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *);
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  /** A maximal span of foreground voxels along the first dimension. */
+  struct Run
+  {
+    OffsetValueType Start;
+    OffsetValueType End;   // one past the last voxel
+    bool            Seeded;
+  };
+
+  /** Runs of one slab, stored line by line. */
+  struct Slab
+  {
+    RegionType                   Region;
+    SizeValueType                FirstLine;
+    SizeValueType                NumberOfLines;
+    SizeValueType                FirstRun;
+    std::vector< Run >           Runs;
+    std::vector< SizeValueType > LineOffsets;
+  };
+
+  typedef enum
+  {
+    ENCODE = 0,
+    UNION = 1,
+    WRITE = 2
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Orders component ids by decreasing size, then by increasing id. */
+  struct SizeGreater
+  {
+    const ObjectSizeContainerType *Sizes;
+    bool operator()(SizeValueType a, SizeValueType b) const
+    {
+      if ((*Sizes)[a] != (*Sizes)[b])
+        return (*Sizes)[a] > (*Sizes)[b];
+      return a < b;
+    }
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  void ThreadedEncodeRuns(Slab & slab);
+  void ThreadedUnionRuns(Slab & slab);
+  void ThreadedWriteRuns(const Slab & slab);
+
+  /** Unions the first line plane of slab s with the last one of slab s-1. */
+  void MergeSlabFaces(unsigned int s);
+
+  /** Unions the overlapping runs of two lines. */
+  void UnionLines(const Run *a, const Run *aEnd, SizeValueType aFirst,
+                  const Run *b, const Run *bEnd, SizeValueType bFirst);
+
+  SizeValueType FindRoot(SizeValueType r);
+  void          UnionRoots(SizeValueType a, SizeValueType b);
+
+private:
+  ParallelConnectedComponentImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  InputPixelType  m_LowerThreshold;
+  InputPixelType  m_UpperThreshold;
+  InputPixelType  m_SeedThreshold;
+  bool            m_UseSeedThreshold;
+  bool            m_FullyConnected;
+  SizeValueType   m_MinimumObjectSize;
+  double          m_MinimumRelativeObjectSize;
+  SizeValueType   m_NumberOfObjects;
+  bool            m_BinaryOutput;
+  OutputPixelType m_InsideValue;
+
+  SizeValueType   m_OriginalNumberOfObjects;
+  SizeValueType   m_NumberOfKeptObjects;
+  ObjectSizeContainerType m_SizeOfObjectsInPixels;
+
+  /** Line neighbours (dimensions 1..N-1) already visited in raster order */
+  std::vector< Offset<itkGetStaticConstMacro(ImageDimension)> > m_LineNeighbours;
+  std::vector< OffsetValueType >        m_LineStrides;
+
+  PhaseType                       m_Phase;
+  std::vector< Slab >             m_Slabs;
+  std::vector< SizeValueType >    m_Parent;
+  std::vector< OutputPixelType >  m_ComponentValues;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelConnectedComponentImageFilter.txx"
+#endif
+
+#endif // ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_H
@@ -0,0 +1,500 @@
+#ifndef ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_TXX
+#define ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_TXX
+
+#include "itkParallelConnectedComponentImageFilter.h"
+
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <math.h>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::ParallelConnectedComponentImageFilter()
+{
+  m_LowerThreshold = NumericTraits<InputPixelType>::OneValue();
+  m_UpperThreshold = NumericTraits<InputPixelType>::max();
+  m_SeedThreshold = NumericTraits<InputPixelType>::max();
+  m_UseSeedThreshold = false;
+  m_FullyConnected = false;
+  m_MinimumObjectSize = 0;
+  m_MinimumRelativeObjectSize = 0;
+  m_NumberOfObjects = 0;
+  m_BinaryOutput = false;
+  m_InsideValue = NumericTraits<OutputPixelType>::OneValue();
+  m_OriginalNumberOfObjects = 0;
+  m_NumberOfKeptObjects = 0;
+  m_Phase = ENCODE;
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( input )
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(DataObject *)
+{
+  this->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::GenerateData()
+{
+  OutputImagePointer output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+
+  const RegionType region = output->GetRequestedRegion();
+  const SizeType   size = region.GetSize();
+  const unsigned int last = ImageDimension - 1;
+
+  //Lines run along x and are numbered in raster order over the other dimensions
+  m_LineStrides.assign( ImageDimension, 0 );
+  SizeValueType totalLines = 1;
+  for (unsigned int d = 1; d < ImageDimension; ++d)
+  {
+    m_LineStrides[d] = totalLines;
+    totalLines *= size[d];
+  }
+
+  //Neighbouring lines that precede the current one: the highest non-zero
+  //component is -1. Face connectivity only keeps the direct ones.
+  m_LineNeighbours.clear();
+  unsigned int combinations = 1;
+  for (unsigned int d = 1; d < ImageDimension; ++d)
+    combinations *= 3;
+  for (unsigned int c = 0; c < combinations; ++c)
+  {
+    Offset<itkGetStaticConstMacro(ImageDimension)> o;
+    o.Fill(0);
+    unsigned int code = c;
+    unsigned int nonzero = 0;
+    int highest = 0;
+    for (unsigned int d = 1; d < ImageDimension; ++d)
+    {
+      o[d] = static_cast<int>(code % 3) - 1;
+      code /= 3;
+      if (o[d] != 0)
+      {
+        nonzero++;
+        highest = o[d];
+      }
+    }
+    if (highest != -1)
+      continue;
+    if (!m_FullyConnected && nonzero != 1)
+      continue;
+    m_LineNeighbours.push_back(o);
+  }
+
+  //One slab per thread along the last dimension
+  unsigned int numSlabs = this->GetNumberOfThreads();
+  if (ImageDimension == 1 || numSlabs < 1)
+    numSlabs = 1;
+  if (numSlabs > size[last])
+    numSlabs = size[last];
+  m_Slabs.clear();
+  m_Slabs.resize(numSlabs);
+  for (unsigned int s = 0; s < numSlabs; ++s)
+  {
+    SizeValueType begin = (s * size[last]) / numSlabs;
+    SizeValueType end = ((s+1) * size[last]) / numSlabs;
+    Slab & slab = m_Slabs[s];
+    slab.Region = region;
+    slab.Region.SetIndex(last, region.GetIndex(last) + begin);
+    slab.Region.SetSize(last, end - begin);
+    if (ImageDimension > 1)
+    {
+      slab.FirstLine = begin * m_LineStrides[last];
+      slab.NumberOfLines = (end - begin) * m_LineStrides[last];
+    }
+    else
+    {
+      slab.FirstLine = 0;
+      slab.NumberOfLines = 1;
+    }
+    slab.FirstRun = 0;
+  }
+
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numSlabs);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+
+  //1- Run-length encode the thresholded input
+  m_Phase = ENCODE;
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  SizeValueType totalRuns = 0;
+  for (unsigned int s = 0; s < numSlabs; ++s)
+  {
+    m_Slabs[s].FirstRun = totalRuns;
+    totalRuns += m_Slabs[s].Runs.size();
+  }
+
+  //2- Union-find within every slab. Slabs own disjoint ranges of m_Parent
+  m_Parent.resize(totalRuns);
+  m_Phase = UNION;
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  //3- Stitch the slab faces
+  for (unsigned int s = 1; s < numSlabs; ++s)
+    this->MergeSlabFaces(s);
+
+  //4- Resolve the roots into consecutive component ids. Roots always point to
+  //   a lower index so a single forward sweep is enough
+  SizeValueType numComponents = 0;
+  for (SizeValueType r = 0; r < totalRuns; ++r)
+  {
+    if (m_Parent[r] == r)
+      m_Parent[r] = numComponents++;
+    else
+      m_Parent[r] = m_Parent[ m_Parent[r] ];
+  }
+
+  ObjectSizeContainerType sizes(numComponents, 0);
+  std::vector< bool > seeded(numComponents, !m_UseSeedThreshold);
+  for (unsigned int s = 0; s < numSlabs; ++s)
+  {
+    const Slab & slab = m_Slabs[s];
+    for (SizeValueType i = 0; i < slab.Runs.size(); ++i)
+    {
+      SizeValueType c = m_Parent[slab.FirstRun + i];
+      sizes[c] += slab.Runs[i].End - slab.Runs[i].Start;
+      if (slab.Runs[i].Seeded)
+        seeded[c] = true;
+    }
+  }
+
+  //5- Sort the components and decide which ones are kept from the size table
+  std::vector< SizeValueType > order;
+  order.reserve(numComponents);
+  for (SizeValueType c = 0; c < numComponents; ++c)
+    if (seeded[c])
+      order.push_back(c);
+  SizeGreater greater;
+  greater.Sizes = &sizes;
+  std::sort(order.begin(), order.end(), greater);
+
+  const SizeValueType numObjects = order.size();
+  m_OriginalNumberOfObjects = numObjects;
+  m_SizeOfObjectsInPixels.resize(numObjects);
+  for (SizeValueType c = 0; c < numObjects; ++c)
+    m_SizeOfObjectsInPixels[c] = sizes[ order[c] ];
+
+  SizeValueType minSize = m_MinimumObjectSize;
+  if (numObjects > 0)
+  {
+    SizeValueType relSize = static_cast<SizeValueType>(
+          floor(m_MinimumRelativeObjectSize * m_SizeOfObjectsInPixels[0]) );
+    if (relSize > minSize)
+      minSize = relSize;
+  }
+
+  m_NumberOfKeptObjects = 0;
+  while (m_NumberOfKeptObjects < numObjects &&
+         m_SizeOfObjectsInPixels[m_NumberOfKeptObjects] >= minSize &&
+         (m_NumberOfObjects == 0 || m_NumberOfKeptObjects < m_NumberOfObjects))
+    m_NumberOfKeptObjects++;
+
+  if (!m_BinaryOutput && m_NumberOfKeptObjects >
+      static_cast<SizeValueType>(NumericTraits<OutputPixelType>::max()))
+  {
+    m_Slabs.clear();
+    m_Parent.clear();
+    itkExceptionMacro(<< "Number of objects (" << m_NumberOfKeptObjects
+                      << ") exceeds the output pixel type range");
+  }
+
+  m_ComponentValues.assign(numComponents, NumericTraits<OutputPixelType>::ZeroValue());
+  for (SizeValueType k = 0; k < m_NumberOfKeptObjects; ++k)
+  {
+    if (m_BinaryOutput)
+      m_ComponentValues[ order[k] ] = m_InsideValue;
+    else
+      m_ComponentValues[ order[k] ] = static_cast<OutputPixelType>(k + 1);
+  }
+
+  //6- Write the labels run by run
+  m_Phase = WRITE;
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  //Release the run tables
+  std::vector< Slab >().swap(m_Slabs);
+  std::vector< SizeValueType >().swap(m_Parent);
+  std::vector< OutputPixelType >().swap(m_ComponentValues);
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  for (unsigned int s = threadId; s < filter->m_Slabs.size(); s += threadCount)
+  {
+    switch (filter->m_Phase)
+    {
+      case ENCODE:
+        filter->ThreadedEncodeRuns( filter->m_Slabs[s] );
+        break;
+      case UNION:
+        filter->ThreadedUnionRuns( filter->m_Slabs[s] );
+        break;
+      case WRITE:
+        filter->ThreadedWriteRuns( filter->m_Slabs[s] );
+        break;
+    }
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::ThreadedEncodeRuns(Slab & slab)
+{
+  InputImageConstPointer input = this->GetInput();
+  const RegionType region = this->GetOutput()->GetRequestedRegion();
+  const SizeType size = region.GetSize();
+  const OffsetValueType width = size[0];
+
+  slab.Runs.clear();
+  slab.LineOffsets.resize(slab.NumberOfLines + 1);
+  slab.LineOffsets[0] = 0;
+
+  IndexType index = region.GetIndex();
+  for (SizeValueType l = 0; l < slab.NumberOfLines; ++l)
+  {
+    SizeValueType line = slab.FirstLine + l;
+    for (unsigned int d = 1; d < ImageDimension; ++d)
+      index[d] = region.GetIndex(d) + (line / m_LineStrides[d]) % size[d];
+
+    const InputPixelType * in = input->GetBufferPointer() + input->ComputeOffset(index);
+    OffsetValueType x = 0;
+    while (x < width)
+    {
+      if (in[x] >= m_LowerThreshold && in[x] <= m_UpperThreshold)
+      {
+        Run run;
+        run.Start = x;
+        run.Seeded = false;
+        while (x < width && in[x] >= m_LowerThreshold && in[x] <= m_UpperThreshold)
+        {
+          if (in[x] >= m_SeedThreshold)
+            run.Seeded = true;
+          ++x;
+        }
+        run.End = x;
+        slab.Runs.push_back(run);
+      }
+      else
+        ++x;
+    }
+    slab.LineOffsets[l+1] = slab.Runs.size();
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::ThreadedUnionRuns(Slab & slab)
+{
+  const SizeType size = this->GetOutput()->GetRequestedRegion().GetSize();
+  const unsigned int last = ImageDimension - 1;
+
+  for (SizeValueType i = 0; i < slab.Runs.size(); ++i)
+    m_Parent[slab.FirstRun + i] = slab.FirstRun + i;
+
+  if (ImageDimension == 1)
+    return;
+
+  const SizeValueType slabBegin = slab.FirstLine / m_LineStrides[last];
+  for (SizeValueType l = 0; l < slab.NumberOfLines; ++l)
+  {
+    if (slab.LineOffsets[l] == slab.LineOffsets[l+1])
+      continue;
+    SizeValueType line = slab.FirstLine + l;
+    for (size_t n = 0; n < m_LineNeighbours.size(); ++n)
+    {
+      const Offset<itkGetStaticConstMacro(ImageDimension)> & o = m_LineNeighbours[n];
+      bool inside = true;
+      OffsetValueType shift = 0;
+      for (unsigned int d = 1; d < ImageDimension && inside; ++d)
+      {
+        OffsetValueType c = (line / m_LineStrides[d]) % size[d] + o[d];
+        if (d == last)
+          inside = (c >= static_cast<OffsetValueType>(slabBegin));
+        else
+          inside = (c >= 0 && c < static_cast<OffsetValueType>(size[d]));
+        shift += o[d] * m_LineStrides[d];
+      }
+      if (!inside)
+        continue;
+      SizeValueType nl = static_cast<OffsetValueType>(l) + shift;
+      this->UnionLines(&slab.Runs[0] + slab.LineOffsets[l],
+                       &slab.Runs[0] + slab.LineOffsets[l+1],
+                       slab.FirstRun + slab.LineOffsets[l],
+                       &slab.Runs[0] + slab.LineOffsets[nl],
+                       &slab.Runs[0] + slab.LineOffsets[nl+1],
+                       slab.FirstRun + slab.LineOffsets[nl]);
+    }
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::MergeSlabFaces(unsigned int s)
+{
+  const SizeType size = this->GetOutput()->GetRequestedRegion().GetSize();
+  const unsigned int last = ImageDimension - 1;
+  const Slab & slab = m_Slabs[s];
+  const Slab & prev = m_Slabs[s-1];
+
+  if (slab.Runs.empty() || prev.Runs.empty())
+    return;
+
+  //Only the first plane of the slab looks into the previous slab
+  for (SizeValueType l = 0; l < static_cast<SizeValueType>(m_LineStrides[last]); ++l)
+  {
+    if (slab.LineOffsets[l] == slab.LineOffsets[l+1])
+      continue;
+    SizeValueType line = slab.FirstLine + l;
+    for (size_t n = 0; n < m_LineNeighbours.size(); ++n)
+    {
+      const Offset<itkGetStaticConstMacro(ImageDimension)> & o = m_LineNeighbours[n];
+      if (o[last] != -1)
+        continue;
+      bool inside = true;
+      OffsetValueType shift = 0;
+      for (unsigned int d = 1; d < ImageDimension && inside; ++d)
+      {
+        if (d != last)
+        {
+          OffsetValueType c = (line / m_LineStrides[d]) % size[d] + o[d];
+          inside = (c >= 0 && c < static_cast<OffsetValueType>(size[d]));
+        }
+        shift += o[d] * m_LineStrides[d];
+      }
+      if (!inside)
+        continue;
+      SizeValueType nl = static_cast<OffsetValueType>(line - prev.FirstLine) + shift;
+      this->UnionLines(&slab.Runs[0] + slab.LineOffsets[l],
+                       &slab.Runs[0] + slab.LineOffsets[l+1],
+                       slab.FirstRun + slab.LineOffsets[l],
+                       &prev.Runs[0] + prev.LineOffsets[nl],
+                       &prev.Runs[0] + prev.LineOffsets[nl+1],
+                       prev.FirstRun + prev.LineOffsets[nl]);
+    }
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::UnionLines(const Run *a, const Run *aEnd, SizeValueType aFirst,
+             const Run *b, const Run *bEnd, SizeValueType bFirst)
+{
+  //Diagonal neighbours along x are allowed with full connectivity
+  const OffsetValueType tol = m_FullyConnected ? 1 : 0;
+  const Run * aBegin = a;
+  const Run * bBegin = b;
+  while (a != aEnd && b != bEnd)
+  {
+    if (a->Start < b->End + tol && b->Start < a->End + tol)
+      this->UnionRoots(aFirst + (a - aBegin), bFirst + (b - bBegin));
+    if (a->End < b->End)
+      ++a;
+    else
+      ++b;
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+SizeValueType ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::FindRoot(SizeValueType r)
+{
+  while (m_Parent[r] != r)
+  {
+    m_Parent[r] = m_Parent[ m_Parent[r] ];
+    r = m_Parent[r];
+  }
+  return r;
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::UnionRoots(SizeValueType a, SizeValueType b)
+{
+  a = this->FindRoot(a);
+  b = this->FindRoot(b);
+  //The lowest index becomes the root, so parents never point forward
+  if (a < b)
+    m_Parent[b] = a;
+  else if (b < a)
+    m_Parent[a] = b;
+}
+
+template<class TInputImage, class TOutputImage>
+void ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::ThreadedWriteRuns(const Slab & slab)
+{
+  OutputImagePointer output = this->GetOutput();
+  const RegionType region = output->GetRequestedRegion();
+  const SizeType size = region.GetSize();
+  const OutputPixelType zero = NumericTraits<OutputPixelType>::ZeroValue();
+
+  IndexType index = region.GetIndex();
+  for (SizeValueType l = 0; l < slab.NumberOfLines; ++l)
+  {
+    SizeValueType line = slab.FirstLine + l;
+    for (unsigned int d = 1; d < ImageDimension; ++d)
+      index[d] = region.GetIndex(d) + (line / m_LineStrides[d]) % size[d];
+
+    OutputPixelType * out = output->GetBufferPointer() + output->ComputeOffset(index);
+    std::fill(out, out + size[0], zero);
+    for (SizeValueType i = slab.LineOffsets[l]; i < slab.LineOffsets[l+1]; ++i)
+    {
+      const Run & run = slab.Runs[i];
+      std::fill(out + run.Start, out + run.End,
+                m_ComponentValues[ m_Parent[slab.FirstRun + i] ]);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template <class TInputImage, class TOutputImage>
+void
+ParallelConnectedComponentImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "LowerThreshold: " << m_LowerThreshold << std::endl;
+  os << indent << "UpperThreshold: " << m_UpperThreshold << std::endl;
+  os << indent << "SeedThreshold: " << m_SeedThreshold << std::endl;
+  os << indent << "UseSeedThreshold: " << m_UseSeedThreshold << std::endl;
+  os << indent << "FullyConnected: " << m_FullyConnected << std::endl;
+  os << indent << "MinimumObjectSize: " << m_MinimumObjectSize << std::endl;
+  os << indent << "MinimumRelativeObjectSize: " << m_MinimumRelativeObjectSize << std::endl;
+  os << indent << "NumberOfObjects: " << m_NumberOfObjects << std::endl;
+}
+
+} // end namespace
+#endif //ITKPARALLELCONNECTEDCOMPONENTIMAGEFILTER_TXX
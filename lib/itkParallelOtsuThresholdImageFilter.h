@@ -0,0 +1,214 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_H
+#define ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_H
+
+#include <itkInPlaceImageFilter.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <itkNumericTraits.h>
+#include <vector>
+
+namespace itk {
+
+/** \class ParallelOtsuThresholdImageFilter
+ * \brief Otsu thresholding, optionally within a mask and with several
+ * thresholds, from a histogram built in one threaded pass.
+ *
+ * Every thread builds a partial histogram of its part of the buffer and the
+ * partial histograms are summed. The bins are those ImageToHistogramFilter
+ * chooses: NumberOfHistogramBins bins from the minimum to the maximum plus
+ * a hundredth of a bin. Images of 8 and 16-bit integers are counted per
+ * value, which gives the range and the bins in the same pass; other pixel
+ * types need their range first, either from SetRange or from a pass that
+ * only reads the image. With a mask image, only the voxels of the mask
+ * equal to MaskValue are counted.
+ *
+ * The thresholds maximise the between-class variance over the bins and are
+ * the upper bounds of their bins, as OtsuMultipleThresholdsCalculator gives
+ * them, so one threshold gives the output of OtsuThresholdImageFilter: the
+ * values up to the threshold are set to InsideValue and the others to
+ * OutsideValue. With NumberOfThresholds above 1 the output is the number of
+ * thresholds below each value, from 0 to NumberOfThresholds. The search is
+ * exact and the cost grows with the square of the number of bins only.
+ *
+ * Invert swaps InsideValue and OutsideValue (reverses the labels with
+ * several thresholds). With MaskOutput on, the voxels outside the mask are
+ * set to OutsideValue (label 0). The output is written in a second threaded
+ * pass, in place when the pixel types allow it.
+ *
+ * ComputeThresholds runs the histogram pass alone, on an input that is
+ * already up to date, for callers that apply the thresholds themselves.
+ */
+template < class TInputImage, class TOutputImage, class TMaskImage = TOutputImage >
+class ITK_EXPORT ParallelOtsuThresholdImageFilter :
+    public InPlaceImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef ParallelOtsuThresholdImageFilter              Self;
+  typedef InPlaceImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelOtsuThresholdImageFilter, InPlaceImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+  typedef TMaskImage                                  MaskImageType;
+  typedef typename MaskImageType::PixelType           MaskPixelType;
+
+  typedef std::vector< InputPixelType >               ThresholdContainerType;
+  typedef std::vector< SizeValueType >                HistogramType;
+
+  /** Voxels of the input counted where the mask equals MaskValue. */
+  void SetMaskImage(const MaskImageType * mask);
+  const MaskImageType * GetMaskImage() const;
+
+  itkGetConstMacro(MaskValue, MaskPixelType);
+  itkSetMacro(MaskValue, MaskPixelType);
+  itkGetConstMacro(MaskOutput, bool);
+  itkSetMacro(MaskOutput, bool);
+  itkBooleanMacro(MaskOutput);
+
+  itkGetConstMacro(NumberOfHistogramBins, unsigned int);
+  itkSetMacro(NumberOfHistogramBins, unsigned int);
+  itkGetConstMacro(NumberOfThresholds, unsigned int);
+  itkSetMacro(NumberOfThresholds, unsigned int);
+
+  itkGetConstMacro(InsideValue, OutputPixelType);
+  itkSetMacro(InsideValue, OutputPixelType);
+  itkGetConstMacro(OutsideValue, OutputPixelType);
+  itkSetMacro(OutsideValue, OutputPixelType);
+  itkGetConstMacro(Invert, bool);
+  itkSetMacro(Invert, bool);
+  itkBooleanMacro(Invert);
+
+  /** Range of the (masked) input when the caller already knows it, which
+   * saves the range pass for pixel types not counted per value. */
+  void SetRange(InputPixelType minimum, InputPixelType maximum);
+  itkGetConstMacro(UseRange, bool);
+  itkSetMacro(UseRange, bool);
+  itkBooleanMacro(UseRange);
+
+  /** Builds the histogram of the input and computes the thresholds without
+   * writing the output. The input must be up to date. */
+  void ComputeThresholds();
+
+  /** Thresholds of the last run, in increasing order. Without any voxel to
+   * count they are all the maximum of the pixel type. */
+  const ThresholdContainerType & GetThresholds() const
+  { return m_Thresholds; }
+  InputPixelType GetThreshold() const
+  { return m_Thresholds.empty() ? NumericTraits< InputPixelType >::max() : m_Thresholds[0]; }
+
+  /** Range of the voxels counted by the last run. */
+  itkGetConstMacro(Minimum, InputPixelType);
+  itkGetConstMacro(Maximum, InputPixelType);
+
+protected:
+  ParallelOtsuThresholdImageFilter();
+  ~ParallelOtsuThresholdImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** The histogram needs the whole image. */
+  virtual void GenerateInputRequestedRegion();
+  virtual void EnlargeOutputRequestedRegion(DataObject *);
+
+  /** Generate the output data. */
+  virtual void GenerateData();
+
+  typedef enum
+  {
+    RANGE = 0,
+    HISTOGRAM = 1,
+    APPLY = 2
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  void ExecutePhase(PhaseType phase);
+  /** Voxels [first, last) of the buffer threadId handles. */
+  void SplitBuffer(ThreadIdType threadId, ThreadIdType threadCount,
+                   SizeValueType & first, SizeValueType & last) const;
+  void ThreadedRange(ThreadIdType threadId, ThreadIdType threadCount);
+  void ThreadedHistogram(ThreadIdType threadId, ThreadIdType threadCount);
+  void ThreadedApply(ThreadIdType threadId, ThreadIdType threadCount);
+
+  /** Bin of value, with the bounds of Histogram::Initialize. */
+  SizeValueType ComputeBin(double value) const;
+  /** Sets the bin bounds for the range [m_Minimum, m_Maximum]. */
+  void InitializeBins();
+  /** Thresholds of m_Histogram, by dynamic programming over the bins. */
+  void ComputeThresholdsFromHistogram();
+
+  /** Images of 8 and 16-bit integers are counted per value. */
+  static bool CountPerValue()
+  {
+    return NumericTraits< InputPixelType >::is_integer && sizeof(InputPixelType) <= 2;
+  }
+
+private:
+  ParallelOtsuThresholdImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  MaskPixelType                       m_MaskValue;
+  bool                                m_MaskOutput;
+  unsigned int                        m_NumberOfHistogramBins;
+  unsigned int                        m_NumberOfThresholds;
+  OutputPixelType                     m_InsideValue;
+  OutputPixelType                     m_OutsideValue;
+  bool                                m_Invert;
+  bool                                m_UseRange;
+  InputPixelType                      m_Minimum;
+  InputPixelType                      m_Maximum;
+  ThresholdContainerType              m_Thresholds;
+
+  /** State of a run: the partial ranges and histograms of every thread,
+   * the bins (lower bounds, bins per unit of value and the upper bound of
+   * the last one) and the summed histogram. */
+  PhaseType                           m_Phase;
+  std::vector< InputPixelType >       m_ThreadMinimum;
+  std::vector< InputPixelType >       m_ThreadMaximum;
+  std::vector< HistogramType >        m_ThreadHistograms;
+  std::vector< double >               m_BinMinimum;
+  double                              m_BinScale;
+  double                              m_BinUpper;
+  HistogramType                       m_Histogram;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelOtsuThresholdImageFilter.txx"
+#endif
+
+#endif // ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_H
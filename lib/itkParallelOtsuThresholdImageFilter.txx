@@ -0,0 +1,440 @@
+#ifndef ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_TXX
+#define ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_TXX
+
+#include "itkParallelOtsuThresholdImageFilter.h"
+
+#include <algorithm>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ParallelOtsuThresholdImageFilter()
+{
+  this->SetNumberOfRequiredInputs(1);
+  m_MaskValue = NumericTraits<MaskPixelType>::max();
+  m_MaskOutput = true;
+  m_NumberOfHistogramBins = 256;
+  m_NumberOfThresholds = 1;
+  m_InsideValue = NumericTraits<OutputPixelType>::max();
+  m_OutsideValue = NumericTraits<OutputPixelType>::ZeroValue();
+  m_Invert = false;
+  m_UseRange = false;
+  m_Minimum = NumericTraits<InputPixelType>::max();
+  m_Maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+  m_Phase = HISTOGRAM;
+  m_BinScale = 0.0;
+  m_BinUpper = 0.0;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::SetMaskImage(const MaskImageType * mask)
+{
+  this->SetNthInput(1, const_cast< MaskImageType * >(mask));
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+const typename ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>::MaskImageType *
+ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::GetMaskImage() const
+{
+  return static_cast< const MaskImageType * >(this->ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::SetRange(InputPixelType minimum, InputPixelType maximum)
+{
+  m_Minimum = minimum;
+  m_Maximum = maximum;
+  m_UseRange = true;
+  this->Modified();
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( input )
+    input->SetRequestedRegionToLargestPossibleRegion();
+  MaskImageType * mask = const_cast< MaskImageType * >( this->GetMaskImage() );
+  if ( mask )
+    mask->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::EnlargeOutputRequestedRegion(DataObject *)
+{
+  this->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::GenerateData()
+{
+  //1- Histogram and thresholds, before the output takes over the input
+  this->ComputeThresholds();
+
+  //2- Labels, in place when the types allow it
+  this->AllocateOutputs();
+  this->ExecutePhase(APPLY);
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ComputeThresholds()
+{
+  const InputImageType * input = this->GetInput();
+  const MaskImageType * mask = this->GetMaskImage();
+  if (!input)
+    itkExceptionMacro(<< "Input image not set");
+  if (mask && mask->GetBufferedRegion() != input->GetBufferedRegion())
+    itkExceptionMacro(<< "The mask does not cover the same voxels as the input");
+  if (m_NumberOfThresholds == 0 || m_NumberOfHistogramBins <= m_NumberOfThresholds)
+    itkExceptionMacro(<< "NumberOfHistogramBins must be above NumberOfThresholds, which must be positive");
+
+  m_Thresholds.assign(m_NumberOfThresholds, NumericTraits<InputPixelType>::max());
+  m_Histogram.clear();
+
+  //Counted per value, the range comes out of the histogram pass
+  if (!CountPerValue())
+  {
+    if (!m_UseRange)
+    {
+      this->ExecutePhase(RANGE);
+      m_Minimum = NumericTraits<InputPixelType>::max();
+      m_Maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+      for (ThreadIdType t = 0; t < m_ThreadMinimum.size(); ++t)
+      {
+        m_Minimum = std::min(m_Minimum, m_ThreadMinimum[t]);
+        m_Maximum = std::max(m_Maximum, m_ThreadMaximum[t]);
+      }
+    }
+    if (m_Minimum > m_Maximum)
+      return;
+    this->InitializeBins();
+  }
+
+  this->ExecutePhase(HISTOGRAM);
+
+  HistogramType counts = m_ThreadHistograms[0];
+  for (ThreadIdType t = 1; t < m_ThreadHistograms.size(); ++t)
+    for (SizeValueType b = 0; b < counts.size(); ++b)
+      counts[b] += m_ThreadHistograms[t][b];
+  m_ThreadHistograms.clear();
+
+  if (CountPerValue())
+  {
+    //The range is the first and last value counted, which are then put in
+    //the bins the range gives
+    SizeValueType first = 0;
+    while (first < counts.size() && counts[first] == 0)
+      ++first;
+    if (first == counts.size())
+    {
+      m_Minimum = NumericTraits<InputPixelType>::max();
+      m_Maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+      return;
+    }
+    SizeValueType last = counts.size() - 1;
+    while (counts[last] == 0)
+      --last;
+    const OffsetValueType offset = static_cast<OffsetValueType>(NumericTraits<InputPixelType>::NonpositiveMin());
+    m_Minimum = static_cast<InputPixelType>(offset + static_cast<OffsetValueType>(first));
+    m_Maximum = static_cast<InputPixelType>(offset + static_cast<OffsetValueType>(last));
+    this->InitializeBins();
+
+    m_Histogram.assign(m_NumberOfHistogramBins, 0);
+    for (SizeValueType v = first; v <= last; ++v)
+      if (counts[v] > 0)
+        m_Histogram[ this->ComputeBin(static_cast<double>(offset + static_cast<OffsetValueType>(v))) ] += counts[v];
+  }
+  else
+    m_Histogram.swap(counts);
+
+  this->ComputeThresholdsFromHistogram();
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::InitializeBins()
+{
+  //As ImageToHistogramFilter with AutoMinimumMaximum: the maximum is raised
+  //by a hundredth of a bin, so that it falls inside the last bin
+  const double bins = static_cast<double>(m_NumberOfHistogramBins);
+  const double lower = static_cast<double>(m_Minimum);
+  double upper = static_cast<double>(m_Maximum);
+  const double margin = ((upper - lower) / bins) / 100.0;
+  if (NumericTraits<double>::max() - upper > margin)
+    upper = upper + margin;
+
+  const double interval = (upper - lower) / bins;
+  m_BinMinimum.resize(m_NumberOfHistogramBins);
+  for (unsigned int b = 0; b < m_NumberOfHistogramBins; ++b)
+    m_BinMinimum[b] = lower + static_cast<double>(b) * interval;
+  m_BinScale = interval > 0.0 ? 1.0 / interval : 0.0;
+  m_BinUpper = upper;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+SizeValueType ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ComputeBin(double value) const
+{
+  //The guess from the interval is corrected against the bounds, which are
+  //rounded differently
+  const SizeValueType last = m_BinMinimum.size() - 1;
+  if (!(value > m_BinMinimum[0]))
+    return 0;
+  const double guess = (value - m_BinMinimum[0]) * m_BinScale;
+  SizeValueType bin = guess >= static_cast<double>(last) ? last : static_cast<SizeValueType>(guess);
+  while (bin > 0 && value < m_BinMinimum[bin])
+    --bin;
+  while (bin < last && value >= m_BinMinimum[bin + 1])
+    ++bin;
+  return bin;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ComputeThresholdsFromHistogram()
+{
+  const SizeValueType bins = m_Histogram.size();
+  const unsigned int classes = m_NumberOfThresholds + 1;
+
+  //Between-class variance is the sum over the classes of S^2 / W, with W
+  //the voxels of a class and S the sum of their distances to the mean. The
+  //bins stand for their centres
+  std::vector< double > centres(bins);
+  double total = 0.0;
+  double sum = 0.0;
+  for (SizeValueType b = 0; b < bins; ++b)
+  {
+    centres[b] = (m_BinMinimum[b] + (b + 1 < bins ? m_BinMinimum[b + 1] : m_BinUpper)) / 2.0;
+    total += static_cast<double>(m_Histogram[b]);
+    sum += static_cast<double>(m_Histogram[b]) * centres[b];
+  }
+  if (total == 0.0)
+    return;
+  const double mean = sum / total;
+
+  std::vector< double > w(bins + 1, 0.0);
+  std::vector< double > s(bins + 1, 0.0);
+  for (SizeValueType b = 0; b < bins; ++b)
+  {
+    w[b + 1] = w[b] + static_cast<double>(m_Histogram[b]);
+    s[b + 1] = s[b] + static_cast<double>(m_Histogram[b]) * (centres[b] - mean);
+  }
+
+  //best[c][k]: largest sum for bins 0..k split into c + 1 classes, the last
+  //one starting at bin start[c][k]. Ties keep the earliest start, which
+  //with one threshold is the first maximum OtsuThresholdCalculator finds
+  std::vector< std::vector< double > > best(classes, std::vector< double >(bins, 0.0));
+  std::vector< std::vector< SizeValueType > > start(classes, std::vector< SizeValueType >(bins, 0));
+  for (SizeValueType k = 0; k < bins; ++k)
+  {
+    const double wk = w[k + 1];
+    best[0][k] = wk > 0.0 ? s[k + 1] * s[k + 1] / wk : 0.0;
+  }
+  for (unsigned int c = 1; c < classes; ++c)
+    for (SizeValueType k = c; k < bins; ++k)
+    {
+      double bestSum = -1.0;
+      SizeValueType bestStart = c;
+      for (SizeValueType j = c; j <= k; ++j)
+      {
+        const double wc = w[k + 1] - w[j];
+        const double sc = s[k + 1] - s[j];
+        const double value = best[c - 1][j - 1] + (wc > 0.0 ? sc * sc / wc : 0.0);
+        if (value > bestSum)
+        {
+          bestSum = value;
+          bestStart = j;
+        }
+      }
+      best[c][k] = bestSum;
+      start[c][k] = bestStart;
+    }
+
+  //Each threshold is the upper bound of the last bin of its class
+  SizeValueType k = bins - 1;
+  for (unsigned int c = classes - 1; c > 0; --c)
+  {
+    const SizeValueType j = start[c][k];
+    m_Thresholds[c - 1] = static_cast<InputPixelType>(m_BinMinimum[j]);
+    k = j - 1;
+  }
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ExecutePhase(PhaseType phase)
+{
+  m_Phase = phase;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(this->GetNumberOfThreads(),
+                                this->GetInput()->GetBufferedRegion().GetNumberOfPixels()));
+  if (phase == RANGE)
+  {
+    m_ThreadMinimum.assign(numThreads, NumericTraits<InputPixelType>::max());
+    m_ThreadMaximum.assign(numThreads, NumericTraits<InputPixelType>::NonpositiveMin());
+  }
+  else if (phase == HISTOGRAM)
+    m_ThreadHistograms.assign(numThreads, HistogramType());
+
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+ITK_THREAD_RETURN_TYPE
+ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  switch (str->Filter->m_Phase)
+  {
+    case RANGE:
+      str->Filter->ThreadedRange(threadId, threadCount);
+      break;
+    case HISTOGRAM:
+      str->Filter->ThreadedHistogram(threadId, threadCount);
+      break;
+    case APPLY:
+      str->Filter->ThreadedApply(threadId, threadCount);
+      break;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::SplitBuffer(ThreadIdType threadId, ThreadIdType threadCount,
+              SizeValueType & first, SizeValueType & last) const
+{
+  const SizeValueType numPixels = this->GetInput()->GetBufferedRegion().GetNumberOfPixels();
+  first = numPixels * threadId / threadCount;
+  last = numPixels * (threadId + 1) / threadCount;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ThreadedRange(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitBuffer(threadId, threadCount, first, last);
+  const InputPixelType * in = this->GetInput()->GetBufferPointer();
+  const MaskImageType * mask = this->GetMaskImage();
+  const MaskPixelType * m = mask ? mask->GetBufferPointer() : 0;
+
+  InputPixelType minimum = m_ThreadMinimum[threadId];
+  InputPixelType maximum = m_ThreadMaximum[threadId];
+  for (SizeValueType i = first; i < last; ++i)
+    if (!m || m[i] == m_MaskValue)
+    {
+      minimum = in[i] < minimum ? in[i] : minimum;
+      maximum = in[i] > maximum ? in[i] : maximum;
+    }
+  m_ThreadMinimum[threadId] = minimum;
+  m_ThreadMaximum[threadId] = maximum;
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ThreadedHistogram(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitBuffer(threadId, threadCount, first, last);
+  const InputPixelType * in = this->GetInput()->GetBufferPointer();
+  const MaskImageType * mask = this->GetMaskImage();
+  const MaskPixelType * m = mask ? mask->GetBufferPointer() : 0;
+  HistogramType & counts = m_ThreadHistograms[threadId];
+
+  if (CountPerValue())
+  {
+    const OffsetValueType offset = static_cast<OffsetValueType>(NumericTraits<InputPixelType>::NonpositiveMin());
+    counts.assign(static_cast<SizeValueType>(1) << (8 * sizeof(InputPixelType)), 0);
+    for (SizeValueType i = first; i < last; ++i)
+      if (!m || m[i] == m_MaskValue)
+        ++counts[ static_cast<OffsetValueType>(in[i]) - offset ];
+    return;
+  }
+
+  counts.assign(m_NumberOfHistogramBins, 0);
+  for (SizeValueType i = first; i < last; ++i)
+    if (!m || m[i] == m_MaskValue)
+      ++counts[ this->ComputeBin(static_cast<double>(in[i])) ];
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::ThreadedApply(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  SizeValueType first, last;
+  this->SplitBuffer(threadId, threadCount, first, last);
+  const InputPixelType * in = this->GetInput()->GetBufferPointer();
+  OutputPixelType * out = this->GetOutput()->GetBufferPointer();
+  const MaskImageType * mask = m_MaskOutput ? this->GetMaskImage() : 0;
+  const MaskPixelType * m = mask ? mask->GetBufferPointer() : 0;
+
+  //In place, in and out share the buffer and every voxel is read first
+  if (m_NumberOfThresholds == 1)
+  {
+    const InputPixelType threshold = m_Thresholds[0];
+    const OutputPixelType inside = m_Invert ? m_OutsideValue : m_InsideValue;
+    const OutputPixelType outside = m_Invert ? m_InsideValue : m_OutsideValue;
+    //The voxels outside the mask are not inverted
+    for (SizeValueType i = first; i < last; ++i)
+      out[i] = !m || m[i] == m_MaskValue ? (in[i] <= threshold ? inside : outside) : m_OutsideValue;
+    return;
+  }
+
+  for (SizeValueType i = first; i < last; ++i)
+  {
+    if (m && m[i] != m_MaskValue)
+    {
+      out[i] = NumericTraits<OutputPixelType>::ZeroValue();
+      continue;
+    }
+    unsigned int label = 0;
+    while (label < m_NumberOfThresholds && in[i] > m_Thresholds[label])
+      ++label;
+    out[i] = static_cast<OutputPixelType>(m_Invert ? m_NumberOfThresholds - label : label);
+  }
+}
+
+template<class TInputImage, class TOutputImage, class TMaskImage>
+void ParallelOtsuThresholdImageFilter<TInputImage, TOutputImage, TMaskImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "MaskValue: " << static_cast< typename NumericTraits< MaskPixelType >::PrintType >(m_MaskValue) << std::endl;
+  os << indent << "MaskOutput: " << m_MaskOutput << std::endl;
+  os << indent << "NumberOfHistogramBins: " << m_NumberOfHistogramBins << std::endl;
+  os << indent << "NumberOfThresholds: " << m_NumberOfThresholds << std::endl;
+  os << indent << "InsideValue: " << static_cast< typename NumericTraits< OutputPixelType >::PrintType >(m_InsideValue) << std::endl;
+  os << indent << "OutsideValue: " << static_cast< typename NumericTraits< OutputPixelType >::PrintType >(m_OutsideValue) << std::endl;
+  os << indent << "Invert: " << m_Invert << std::endl;
+  os << indent << "UseRange: " << m_UseRange << std::endl;
+  os << indent << "Minimum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_Minimum) << std::endl;
+  os << indent << "Maximum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_Maximum) << std::endl;
+  for (unsigned int t = 0; t < m_Thresholds.size(); ++t)
+    os << indent << "Threshold " << t << ": "
+       << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_Thresholds[t]) << std::endl;
+}
+
+} // end namespace
+#endif //ITKPARALLELOTSUTHRESHOLDIMAGEFILTER_TXX
@@ -14,17 +14,25 @@
 #ifndef ITKRESAMPLEIMAGE_H
 #define ITKRESAMPLEIMAGE_H
 
-#include <itkIdentityTransform.h>
-#include <itkBSplineInterpolateImageFunction.h>
-#include <itkResampleImageFilter.h>
-#include <itkNearestNeighborInterpolateImageFunction.h>
 #include <itkImageToImageFilter.h>
 #include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <vector>
 
 namespace itk {
 
 /** \class ResampleImage
  * \brief Up/Down samples an image in the axial direction to reduce anistoropy
+ *
+ * Cubic B-spline interpolation along z only: x and y are left untouched, so
+ * the spline coefficients are computed and evaluated along z, one image row
+ * at a time, and rows are shared among threads. The result matches a
+ * ResampleImageFilter with identity transform and cubic
+ * BSplineInterpolateImageFunction.
+ *
+ * The filter supports streaming: an output slab only requests the input
+ * slices under it plus a margin where the recursive spline prefilter has
+ * decayed, so memory stays bounded when the writer streams the output.
  */
 template < class TInputImage >
 class ResampleImage :
@@ -64,12 +72,33 @@ protected:
   /** Does the real work. */
   virtual void GenerateData();
 
-  typedef itk::IdentityTransform<double, 3> TransformType;
-  //typedef itk::NearestNeighborInterpolateImageFunction< InputImageType, double > // Possibly used in the coming back
-  typedef itk::BSplineInterpolateImageFunction<InputImageType, double, double>
-      InterpolatorType;
-  typedef itk::ResampleImageFilter< InputImageType, OutputImageType >
-      ResampleFilterType;
+  /** Output grid is the input one with the new axial spacing and size. */
+  virtual void GenerateOutputInformation();
+
+  /** Only the slices needed by the requested output slab. */
+  virtual void GenerateInputRequestedRegion();
+
+  typedef typename OutputImageType::RegionType  RegionType;
+  typedef typename OutputImageType::IndexType   IndexType;
+  typedef typename OutputImageType::SizeType    SizeType;
+  typedef typename OutputImageType::PixelType   PixelType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Resamples the output row y over the whole requested output region. */
+  void ResampleRow(IndexValueType y, std::vector<double> & coefficients);
+
+  /** In-place cubic B-spline prefilter of width columns of length samples
+   * stored slice by slice. */
+  static void PrefilterColumns(double *c, SizeValueType length, SizeValueType width);
+
+  bool IsAxialSamplingValid() const
+  { return m_AxialSize != 0 && m_AxialSpacing != 0; }
 
 private:
   ResampleImage(const Self &); //purposely not implemented
@@ -78,6 +107,10 @@ private:
   //bool    m_Downsample;
   double  m_AxialSpacing;
   unsigned int m_AxialSize;
+
+  /** Input slices read beyond an output slab so that the spline
+   * coefficients inside it are not affected by the cut */
+  static const IndexValueType m_SlabMargin = 36;
 };
 
 }
@@ -2,6 +2,9 @@
 #define ITKRESAMPLEIMAGE_TXX
 
 #include "itkResampleImage.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <math.h>
 
 namespace itk {
 
@@ -12,10 +15,67 @@ ResampleImage<TInputImage>::ResampleImage()
   m_AxialSpacing = 0;
 }
 
+template<class TInputImage >
+void ResampleImage<TInputImage>::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (!this->IsAxialSamplingValid())
+    return;
+
+  InputImageConstPointer input = this->GetInput();
+  OutputImagePointer output = this->GetOutput();
+  if (!input || !output)
+    return;
+
+  typename InputImageType::SpacingType spacing = input->GetSpacing();
+  spacing[2] = m_AxialSpacing; // how will this be sorted!
+  output->SetSpacing(spacing);
+
+  RegionType region = input->GetLargestPossibleRegion();
+  region.SetIndex(2, 0);
+  region.SetSize(2, m_AxialSize);
+  output->SetLargestPossibleRegion(region);
+}
+
+template<class TInputImage >
+void ResampleImage<TInputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if (!input)
+    return;
+  if (!this->IsAxialSamplingValid())
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    return;
+  }
+
+  //Slices under the requested output slab, plus the spline support and the
+  //prefilter margin, cropped to the image
+  const RegionType outRegion = this->GetOutput()->GetRequestedRegion();
+  const RegionType largest = input->GetLargestPossibleRegion();
+  const double ratio = m_AxialSpacing / input->GetSpacing()[2];
+  IndexValueType first = static_cast<IndexValueType>(
+        floor(outRegion.GetIndex(2) * ratio) ) - 1 - m_SlabMargin;
+  IndexValueType last = static_cast<IndexValueType>(
+        floor((outRegion.GetIndex(2) + static_cast<IndexValueType>(outRegion.GetSize(2)) - 1) * ratio) )
+      + 2 + m_SlabMargin;
+  first = std::max(first, largest.GetIndex(2));
+  last = std::min(last, largest.GetIndex(2) + static_cast<IndexValueType>(largest.GetSize(2)) - 1);
+  if (last < first)
+    last = first = std::min(first, largest.GetIndex(2) + static_cast<IndexValueType>(largest.GetSize(2)) - 1);
+
+  typename InputImageType::RegionType inRegion = outRegion;
+  inRegion.SetIndex(2, first);
+  inRegion.SetSize(2, last - first + 1);
+  input->SetRequestedRegion(inRegion);
+}
+
 template<class TInputImage >
 void ResampleImage<TInputImage>::GenerateData()
 {
-  if (m_AxialSize == 0 || m_AxialSpacing == 0)
+  if (!this->IsAxialSamplingValid())
   {
     std::cerr << "New size and spacing are not coherent" <<std::endl;
     OutputImagePointer output = this->GetOutput();
@@ -25,74 +85,195 @@ void ResampleImage<TInputImage>::GenerateData()
     return;
   }
 
+  OutputImagePointer output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( this->ThreaderCallback, &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+}
+
+template<class TInputImage >
+ITK_THREAD_RETURN_TYPE
+ResampleImage<TInputImage>
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  //Rows along y are independent: every thread takes a contiguous block
+  const RegionType region = str->Filter->GetOutput()->GetRequestedRegion();
+  const IndexValueType rows = region.GetSize(1);
+  const IndexValueType begin = region.GetIndex(1) + (threadId * rows) / threadCount;
+  const IndexValueType end = region.GetIndex(1) + ((threadId + 1) * rows) / threadCount;
+
+  std::vector<double> coefficients;
+  for (IndexValueType y = begin; y < end; ++y)
+    str->Filter->ResampleRow(y, coefficients);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage >
+void ResampleImage<TInputImage>
+::ResampleRow(IndexValueType y, std::vector<double> & coefficients)
+{
   InputImageConstPointer input = this->GetInput();
-  double outputspacing[3];
-  typename InputImageType::SpacingType spacing = input->GetSpacing();
-  typename InputImageType::SizeType size_in = input->GetLargestPossibleRegion().GetSize();
-  typename InputImageType::SizeType size_out;
- // if (m_Downsample)
-  //{
-  outputspacing[0] = spacing[0];
-  outputspacing[1] = spacing[1];
-  outputspacing[2] = m_AxialSpacing; // how will this be sorted!
-  size_out[0] = size_in[0];
-  size_out[1] = size_in[1];
-  size_out[2] = m_AxialSize;
-
-  typename TransformType::Pointer _pTransform = TransformType::New();
-  _pTransform->SetIdentity();
-
-  typename InterpolatorType::Pointer _pInterpolator = InterpolatorType::New();
-  _pInterpolator->SetSplineOrder(3);
-  typename ResampleFilterType::Pointer _pResizeFilter = ResampleFilterType::New();
-  _pResizeFilter->SetTransform(_pTransform);
-  _pResizeFilter->SetInterpolator(_pInterpolator);
-
-  _pResizeFilter->SetOutputOrigin(input->GetOrigin());
-  _pResizeFilter->SetOutputSpacing(outputspacing);
-  _pResizeFilter->SetOutputDirection(input->GetDirection());
-  _pResizeFilter->SetSize(size_out);
-
-  _pResizeFilter->SetInput(input);
-  _pResizeFilter->Update();
-
-  this->GraftOutput( _pResizeFilter->GetOutput() );
- /* }
+  OutputImagePointer output = this->GetOutput();
+  const typename InputImageType::RegionType inRegion = input->GetRequestedRegion();
+  const RegionType outRegion = output->GetRequestedRegion();
+
+  const SizeValueType width = outRegion.GetSize(0);
+  const SizeValueType slices = inRegion.GetSize(2);
+  const IndexValueType firstSlice = inRegion.GetIndex(2);
+  const IndexValueType imageStart = input->GetLargestPossibleRegion().GetIndex(2);
+  const IndexValueType imageSlices = input->GetLargestPossibleRegion().GetSize(2);
+
+  //Gather the row from every slice: c[z * width + x]
+  coefficients.resize(slices * width);
+  typename InputImageType::IndexType ind;
+  ind[0] = outRegion.GetIndex(0);
+  ind[1] = y;
+  for (SizeValueType z = 0; z < slices; ++z)
+  {
+    ind[2] = firstSlice + z;
+    const typename InputImageType::PixelType * in =
+        input->GetBufferPointer() + input->ComputeOffset(ind);
+    double * c = &coefficients[z * width];
+    for (SizeValueType x = 0; x < width; ++x)
+      c[x] = static_cast<double>(in[x]);
+  }
+  PrefilterColumns(&coefficients[0], slices, width);
+
+  const double ratio = m_AxialSpacing / input->GetSpacing()[2];
+  const double minValue = static_cast<double>(NumericTraits<PixelType>::NonpositiveMin());
+  const double maxValue = static_cast<double>(NumericTraits<PixelType>::max());
+  const IndexValueType period = 2 * imageSlices - 2;
+
+  IndexType outInd;
+  outInd[0] = outRegion.GetIndex(0);
+  outInd[1] = y;
+  for (SizeValueType oz = 0; oz < outRegion.GetSize(2); ++oz)
+  {
+    outInd[2] = outRegion.GetIndex(2) + oz;
+    PixelType * out = output->GetBufferPointer() + output->ComputeOffset(outInd);
+
+    //Continuous input index, outside the buffer the pixel is 0 as in
+    //ResampleImageFilter
+    const double zin = outInd[2] * ratio - imageStart;
+    if (zin < -0.5 || zin >= imageSlices - 0.5)
+    {
+      std::fill(out, out + width, NumericTraits<PixelType>::ZeroValue());
+      continue;
+    }
+
+    //Cubic weights and mirrored support, as BSplineInterpolateImageFunction
+    const IndexValueType base = static_cast<IndexValueType>(floor(zin));
+    const double w = zin - base;
+    double weights[4];
+    weights[3] = (1.0 / 6.0) * w * w * w;
+    weights[0] = (1.0 / 6.0) + 0.5 * w * (w - 1.0) - weights[3];
+    weights[2] = w + weights[0] - 2.0 * weights[3];
+    weights[1] = 1.0 - weights[0] - weights[2] - weights[3];
+
+    const double * rows[4];
+    for (unsigned int k = 0; k < 4; ++k)
+    {
+      IndexValueType idx = base - 1 + k;
+      if (imageSlices == 1)
+        idx = 0;
+      else if (idx < 0)
+        idx = -idx - period * ((-idx) / period);
+      else
+        idx -= period * (idx / period);
+      if (idx >= imageSlices)
+        idx = period - idx;
+      rows[k] = &coefficients[(imageStart + idx - firstSlice) * width];
+    }
+
+    for (SizeValueType x = 0; x < width; ++x)
+    {
+      double value = weights[0] * rows[0][x] + weights[1] * rows[1][x] +
+                     weights[2] * rows[2][x] + weights[3] * rows[3][x];
+      if (value < minValue)
+        value = minValue;
+      if (value > maxValue)
+        value = maxValue;
+      out[x] = static_cast<PixelType>(value);
+    }
+  }
+}
+
+template<class TInputImage >
+void ResampleImage<TInputImage>
+::PrefilterColumns(double *c, SizeValueType length, SizeValueType width)
+{
+  if (length < 2)
+    return;
+
+  //Cubic spline: a single pole, mirror boundaries (BSplineDecompositionImageFilter)
+  const double z = sqrt(3.0) - 2.0;
+  const double gain = (1.0 - z) * (1.0 - 1.0 / z);
+  const double tolerance = 1e-10;
+  SizeValueType horizon = static_cast<SizeValueType>(ceil(log(tolerance) / log(fabs(z))));
+
+  for (SizeValueType i = 0; i < length * width; ++i)
+    c[i] *= gain;
+
+  //Initial causal coefficient
+  std::vector<double> sum(c, c + width);
+  if (horizon < length)
+  {
+    double zn = z;
+    for (SizeValueType n = 1; n < horizon; ++n)
+    {
+      for (SizeValueType x = 0; x < width; ++x)
+        sum[x] += zn * c[n * width + x];
+      zn *= z;
+    }
+  }
   else
   {
-    outputspacing[2] = sp;
-    InputImageType::SizeType size_out;
-    size_out[0] = size_in[0];
-    size_out[1] = size_in[1];
-    size_out[2] =  (unsigned int) ((spacing[2]/outputspacing[2])*size_in[2]);
-
-    typedef itk::IdentityTransform<double, Dimension> T_Transform;
-    typedef itk::BSplineInterpolateImageFunction<InputImageType, double, double>
-        T_Interpolator;
-
-    typedef itk::ResampleImageFilter<InputImageType, InputImageType>
-        T_ResampleFilter;
-
-    T_Transform::Pointer _pTransform = T_Transform::New();
-    _pTransform->SetIdentity();
-
-    T_Interpolator::Pointer _pInterpolator = T_Interpolator::New(); ->This is when using NN
-    //_pInterpolator->SetSplineOrder(3);
-
-    T_ResampleFilter::Pointer _pResizeFilter = T_ResampleFilter::New();
-    _pResizeFilter->SetTransform(_pTransform);
-    _pResizeFilter->SetInterpolator(_pInterpolator);
-    _pResizeFilter->SetOutputDirection(in_image->GetDirection());
-
-    _pResizeFilter->SetOutputOrigin(in_image->GetOrigin());
-    _pResizeFilter->SetOutputSpacing(outputspacing);
-    _pResizeFilter->SetSize(size_out);
-
-    // Specify the input.
-    _pResizeFilter->SetInput(reader->GetOutput());
-    _pResizeFilter->Update();
-    in_image = _pResizeFilter->GetOutput();
-  }*/
+    double zn = z;
+    const double iz = 1.0 / z;
+    double z2n = pow(z, static_cast<double>(length - 1));
+    for (SizeValueType x = 0; x < width; ++x)
+      sum[x] += z2n * c[(length - 1) * width + x];
+    z2n *= z2n * iz;
+    for (SizeValueType n = 1; n + 1 < length; ++n)
+    {
+      for (SizeValueType x = 0; x < width; ++x)
+        sum[x] += (zn + z2n) * c[n * width + x];
+      zn *= z;
+      z2n *= iz;
+    }
+    for (SizeValueType x = 0; x < width; ++x)
+      sum[x] /= (1.0 - zn * zn);
+  }
+  std::copy(sum.begin(), sum.end(), c);
+
+  //Causal recursion
+  for (SizeValueType n = 1; n < length; ++n)
+    for (SizeValueType x = 0; x < width; ++x)
+      c[n * width + x] += z * c[(n - 1) * width + x];
+
+  //Initial anti-causal coefficient
+  double * lastRow = c + (length - 1) * width;
+  const double * prevRow = c + (length - 2) * width;
+  for (SizeValueType x = 0; x < width; ++x)
+    lastRow[x] = (z / (z * z - 1.0)) * (z * prevRow[x] + lastRow[x]);
+
+  //Anti-causal recursion
+  for (SizeValueType n = length - 1; n-- > 0; )
+    for (SizeValueType x = 0; x < width; ++x)
+      c[n * width + x] = z * (c[(n + 1) * width + x] - c[n * width + x]);
 }
 
 template<class TInputImage >
@@ -105,4 +286,4 @@ ResampleImage<TInputImage>
 
 } //end namespace
 
-#endif //ITKINTENSITYFILTER_TXX
+#endif //ITKRESAMPLEIMAGE_TXX
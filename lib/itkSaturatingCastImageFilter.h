@@ -0,0 +1,144 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSATURATINGCASTIMAGEFILTER_H
+#define ITKSATURATINGCASTIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <itkNumericTraits.h>
+#include <vector>
+
+namespace itk {
+
+/** \class SaturatingCastImageFilter
+ * \brief Casts an image to another pixel type, clamping the values to the
+ * range of the output, optionally after a linear rescale.
+ *
+ * With Rescale on, [InputMinimum, InputMaximum] is mapped to
+ * [OutputMinimum, OutputMaximum] with the arithmetic of
+ * RescaleIntensityImageFilter, and the result is truncated to the output
+ * type as CastImageFilter does. With Rescale off the values are only
+ * clamped to the range of the output type. NaN becomes OutputMinimum with
+ * Rescale on and zero otherwise. Both go through the same
+ * branchless loop over every line of the region, which the compiler can
+ * vectorise.
+ *
+ * The filter works on any requested region, so a writer with stream
+ * divisions pulls the input slab by slab. Since the range is given rather
+ * than computed from the whole input, ComputeInputRange gathers it
+ * beforehand in a pass that streams the input NumberOfSlicesPerSlab
+ * slices at a time and only reads it.
+ */
+template < class TInputImage, class TOutputImage >
+class ITK_EXPORT SaturatingCastImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef SaturatingCastImageFilter                     Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SaturatingCastImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+  typedef typename OutputImageType::RegionType        RegionType;
+
+  itkGetConstMacro(Rescale, bool);
+  itkSetMacro(Rescale, bool);
+  itkBooleanMacro(Rescale);
+
+  /** Range of the input mapped to [OutputMinimum, OutputMaximum]. */
+  itkGetConstMacro(InputMinimum, InputPixelType);
+  itkSetMacro(InputMinimum, InputPixelType);
+  itkGetConstMacro(InputMaximum, InputPixelType);
+  itkSetMacro(InputMaximum, InputPixelType);
+  itkGetConstMacro(OutputMinimum, OutputPixelType);
+  itkSetMacro(OutputMinimum, OutputPixelType);
+  itkGetConstMacro(OutputMaximum, OutputPixelType);
+  itkSetMacro(OutputMaximum, OutputPixelType);
+
+  itkGetConstMacro(NumberOfSlicesPerSlab, SizeValueType);
+  itkSetMacro(NumberOfSlicesPerSlab, SizeValueType);
+
+  /** Sets InputMinimum and InputMaximum to the range of the input, pulling
+   * it through its pipeline one slab at a time. */
+  void ComputeInputRange();
+
+protected:
+  SaturatingCastImageFilter();
+  ~SaturatingCastImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  virtual void BeforeThreadedGenerateData();
+  virtual void ThreadedGenerateData(const RegionType & outputRegionForThread,
+                                    ThreadIdType threadId);
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE RangeThreaderCallback( void *arg );
+
+  /** Range of the lines of m_Slab that threadId handles. */
+  void ThreadedRange(ThreadIdType threadId, ThreadIdType threadCount);
+
+private:
+  SaturatingCastImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  bool                            m_Rescale;
+  InputPixelType                  m_InputMinimum;
+  InputPixelType                  m_InputMaximum;
+  OutputPixelType                 m_OutputMinimum;
+  OutputPixelType                 m_OutputMaximum;
+  SizeValueType                   m_NumberOfSlicesPerSlab;
+
+  /** value * m_Scale + m_Shift, clamped to [m_Lower, m_Upper]; NaN becomes
+   * m_NaNValue. */
+  double                          m_Scale;
+  double                          m_Shift;
+  double                          m_Lower;
+  double                          m_Upper;
+  double                          m_NaNValue;
+
+  /** State of ComputeInputRange: the slab being read and the range of
+   * every thread. */
+  RegionType                      m_Slab;
+  std::vector< InputPixelType >   m_ThreadMinimum;
+  std::vector< InputPixelType >   m_ThreadMaximum;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSaturatingCastImageFilter.txx"
+#endif
+
+#endif // ITKSATURATINGCASTIMAGEFILTER_H
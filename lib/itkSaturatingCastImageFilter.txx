@@ -0,0 +1,208 @@
+#ifndef ITKSATURATINGCASTIMAGEFILTER_TXX
+#define ITKSATURATINGCASTIMAGEFILTER_TXX
+
+#include "itkSaturatingCastImageFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <algorithm>
+
+namespace itk {
+
+template<class TInputImage, class TOutputImage>
+SaturatingCastImageFilter<TInputImage, TOutputImage>
+::SaturatingCastImageFilter()
+{
+  m_Rescale = false;
+  m_InputMinimum = NumericTraits<InputPixelType>::NonpositiveMin();
+  m_InputMaximum = NumericTraits<InputPixelType>::max();
+  m_OutputMinimum = NumericTraits<OutputPixelType>::NonpositiveMin();
+  m_OutputMaximum = NumericTraits<OutputPixelType>::max();
+  m_NumberOfSlicesPerSlab = 32;
+  m_Scale = 1.0;
+  m_Shift = 0.0;
+  m_Lower = 0.0;
+  m_Upper = 0.0;
+  m_NaNValue = 0.0;
+}
+
+template<class TInputImage, class TOutputImage>
+void SaturatingCastImageFilter<TInputImage, TOutputImage>
+::ComputeInputRange()
+{
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  if ( !input )
+    itkExceptionMacro(<< "Input image not set");
+  input->UpdateOutputInformation();
+
+  const unsigned int axis = ImageDimension - 1;
+  const RegionType largest = input->GetLargestPossibleRegion();
+  const IndexValueType begin = largest.GetIndex(axis);
+  const IndexValueType end = begin + static_cast<IndexValueType>(largest.GetSize(axis));
+  const IndexValueType step = static_cast<IndexValueType>(std::max< SizeValueType >(1, m_NumberOfSlicesPerSlab));
+
+  InputPixelType minimum = NumericTraits<InputPixelType>::max();
+  InputPixelType maximum = NumericTraits<InputPixelType>::NonpositiveMin();
+  for (IndexValueType first = begin; first < end; first += step)
+  {
+    m_Slab = largest;
+    m_Slab.SetIndex(axis, first);
+    m_Slab.SetSize(axis, std::min(first + step, end) - first);
+    input->SetRequestedRegion(m_Slab);
+    input->PropagateRequestedRegion();
+    input->UpdateOutputData();
+
+    //Threads own whole slices of the slab
+    const ThreadIdType numThreads = std::max< SizeValueType >(1,
+        std::min< SizeValueType >(this->GetNumberOfThreads(), m_Slab.GetSize(axis)));
+    m_ThreadMinimum.assign(numThreads, minimum);
+    m_ThreadMaximum.assign(numThreads, maximum);
+
+    ThreadStruct str;
+    str.Filter = this;
+    this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+    this->GetMultiThreader()->SetSingleMethod(this->RangeThreaderCallback, &str);
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    for (ThreadIdType t = 0; t < numThreads; ++t)
+    {
+      minimum = std::min(minimum, m_ThreadMinimum[t]);
+      maximum = std::max(maximum, m_ThreadMaximum[t]);
+    }
+  }
+
+  m_InputMinimum = minimum;
+  m_InputMaximum = maximum;
+  m_ThreadMinimum.clear();
+  m_ThreadMaximum.clear();
+  this->Modified();
+}
+
+template<class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+SaturatingCastImageFilter<TInputImage, TOutputImage>
+::RangeThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  str->Filter->ThreadedRange(threadId, threadCount);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage>
+void SaturatingCastImageFilter<TInputImage, TOutputImage>
+::ThreadedRange(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  const unsigned int axis = ImageDimension - 1;
+  const SizeValueType slices = m_Slab.GetSize(axis);
+  const SizeValueType firstSlice = slices * threadId / threadCount;
+  const SizeValueType lastSlice = slices * (threadId + 1) / threadCount;
+  if (firstSlice == lastSlice)
+    return;
+
+  RegionType region = m_Slab;
+  region.SetIndex(axis, m_Slab.GetIndex(axis) + static_cast<IndexValueType>(firstSlice));
+  region.SetSize(axis, lastSlice - firstSlice);
+
+  const InputImageType * input = this->GetInput();
+  InputPixelType minimum = m_ThreadMinimum[threadId];
+  InputPixelType maximum = m_ThreadMaximum[threadId];
+  const SizeValueType length = region.GetSize(0);
+  RegionType lines = region;
+  lines.SetSize(0, 1);
+  for (ImageRegionConstIteratorWithIndex< InputImageType > it(input, lines); !it.IsAtEnd(); ++it)
+  {
+    const InputPixelType * in = input->GetBufferPointer() + input->ComputeOffset(it.GetIndex());
+    for (SizeValueType x = 0; x < length; ++x)
+    {
+      minimum = std::min(minimum, in[x]);
+      maximum = std::max(maximum, in[x]);
+    }
+  }
+  m_ThreadMinimum[threadId] = minimum;
+  m_ThreadMaximum[threadId] = maximum;
+}
+
+template<class TInputImage, class TOutputImage>
+void SaturatingCastImageFilter<TInputImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  if (!m_Rescale)
+  {
+    m_Scale = 1.0;
+    m_Shift = 0.0;
+    m_Lower = static_cast<double>(NumericTraits<OutputPixelType>::NonpositiveMin());
+    m_Upper = static_cast<double>(NumericTraits<OutputPixelType>::max());
+    m_NaNValue = 0.0;
+    return;
+  }
+
+  //As RescaleIntensityImageFilter
+  const double inputMinimum = static_cast<double>(m_InputMinimum);
+  const double inputMaximum = static_cast<double>(m_InputMaximum);
+  m_Lower = static_cast<double>(m_OutputMinimum);
+  m_Upper = static_cast<double>(m_OutputMaximum);
+  m_NaNValue = m_Lower;
+  if (m_InputMinimum != m_InputMaximum)
+    m_Scale = (m_Upper - m_Lower) / (inputMaximum - inputMinimum);
+  else if (m_InputMaximum != NumericTraits<InputPixelType>::ZeroValue())
+    m_Scale = (m_Upper - m_Lower) / inputMaximum;
+  else
+    m_Scale = 0.0;
+  m_Shift = m_Lower - inputMinimum * m_Scale;
+}
+
+template<class TInputImage, class TOutputImage>
+void SaturatingCastImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData(const RegionType & outputRegionForThread, ThreadIdType)
+{
+  const InputImageType * input = this->GetInput();
+  OutputImageType * output = this->GetOutput();
+
+  //Local copies, so that the loop does not reload the members after
+  //every store
+  const double scale = m_Scale;
+  const double shift = m_Shift;
+  const double lower = m_Lower;
+  const double upper = m_Upper;
+  const double nanValue = m_NaNValue;
+
+  const SizeValueType length = outputRegionForThread.GetSize(0);
+  RegionType lines = outputRegionForThread;
+  lines.SetSize(0, 1);
+  for (ImageRegionConstIteratorWithIndex< OutputImageType > it(output, lines); !it.IsAtEnd(); ++it)
+  {
+    const InputPixelType * in = input->GetBufferPointer() + input->ComputeOffset(it.GetIndex());
+    OutputPixelType * out = output->GetBufferPointer() + output->ComputeOffset(it.GetIndex());
+    for (SizeValueType x = 0; x < length; ++x)
+    {
+      double v = static_cast<double>(in[x]) * scale + shift;
+      //The clamps keep NaN, whose cast to an integer is undefined
+      v = v == v ? v : nanValue;
+      v = v < lower ? lower : v;
+      v = v > upper ? upper : v;
+      out[x] = static_cast<OutputPixelType>(v);
+    }
+  }
+}
+
+template<class TInputImage, class TOutputImage>
+void SaturatingCastImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Rescale: " << m_Rescale << std::endl;
+  os << indent << "InputMinimum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_InputMinimum) << std::endl;
+  os << indent << "InputMaximum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_InputMaximum) << std::endl;
+  os << indent << "OutputMinimum: " << static_cast< typename NumericTraits< OutputPixelType >::PrintType >(m_OutputMinimum) << std::endl;
+  os << indent << "OutputMaximum: " << static_cast< typename NumericTraits< OutputPixelType >::PrintType >(m_OutputMaximum) << std::endl;
+  os << indent << "NumberOfSlicesPerSlab: " << m_NumberOfSlicesPerSlab << std::endl;
+}
+
+} // end namespace
+#endif //ITKSATURATINGCASTIMAGEFILTER_TXX
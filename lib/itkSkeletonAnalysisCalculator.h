@@ -0,0 +1,258 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSKELETONANALYSISCALCULATOR_H
+#define ITKSKELETONANALYSISCALCULATOR_H
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkMultiThreader.h>
+#include "itkSkeletonGraph.h"
+#include <vector>
+
+namespace itk {
+
+/** \class SkeletonAnalysisCalculator
+ * \brief Builds the graph of a 3D skeleton and measures it the way Fiji's
+ * AnalyzeSkeleton does.
+ *
+ * Skeleton voxels are classified in parallel by their number of
+ * 26-neighbours: end points (< 2), slabs (2) and junctions (> 2).
+ * Connected junction voxels are collapsed into a single vertex and every
+ * end point is a vertex. Branches are traced along the slabs from vertex to
+ * vertex and stored in adjacency lists, together with their calibrated
+ * length. Each connected skeleton is then summarised; its longest shortest
+ * path is found with Dijkstra, two sweeps on acyclic skeletons and one
+ * sweep per vertex otherwise, the skeletons being shared among threads.
+ * Above MaximumExactPathVertices vertices, the path of a skeleton with
+ * cycles is the longest of repeated double sweeps, a lower bound, as in
+ * SkeletonGraphStitcher.
+ *
+ * A closed loop without vertices is reported as a single branch starting
+ * and ending at its first voxel. Branch intensities are read from the
+ * intensity image when set, otherwise from the skeleton image.
+ *
+ * The graph is also returned as a SkeletonGraph. When a core region is set,
+ * as for the blocks of a split volume, voxels are still classified with
+ * their neighbours outside the core but only the skeleton inside it is
+ * traced: slabs leaving the core become BOUNDARY vertices, and the skeleton
+ * voxels next to a vertex outside the core are recorded as crossings, so
+ * that the graphs of neighbouring blocks can be joined.
+ */
+template< class TSkeletonImage, class TIntensityImage >
+class ITK_EXPORT SkeletonAnalysisCalculator : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SkeletonAnalysisCalculator       Self;
+  typedef Object                           Superclass;
+  typedef SmartPointer< Self >             Pointer;
+  typedef SmartPointer< const Self >       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SkeletonAnalysisCalculator, Object);
+
+  typedef TSkeletonImage                             SkeletonImageType;
+  typedef TIntensityImage                            IntensityImageType;
+  typedef typename SkeletonImageType::ConstPointer   SkeletonImageConstPointer;
+  typedef typename IntensityImageType::ConstPointer  IntensityImageConstPointer;
+  typedef typename SkeletonImageType::PixelType      SkeletonPixelType;
+  typedef typename IntensityImageType::PixelType     IntensityPixelType;
+  typedef typename SkeletonImageType::RegionType     RegionType;
+
+  /** One row of AnalyzeSkeleton's per skeleton table. */
+  struct SkeletonStatistics
+  {
+    SizeValueType Branches;
+    SizeValueType Junctions;
+    SizeValueType EndPointVoxels;
+    SizeValueType JunctionVoxels;
+    SizeValueType SlabVoxels;
+    double        AverageBranchLength;
+    SizeValueType TriplePoints;
+    SizeValueType QuadruplePoints;
+    double        MaximumBranchLength;
+    double        LongestShortestPath;
+    double        ShortestPathStart[3];
+  };
+
+  /** One row of the per branch table; positions are in mm. */
+  struct BranchStatistics
+  {
+    SizeValueType Skeleton;
+    double        Length;
+    double        V1[3];
+    double        V2[3];
+    double        EuclideanDistance;
+    double        RunningAverageLength;
+    double        AverageIntensityInnerThird;
+    double        AverageIntensity;
+  };
+
+  typedef std::vector< SkeletonStatistics > SkeletonStatisticsContainerType;
+  typedef std::vector< BranchStatistics >   BranchStatisticsContainerType;
+
+  itkSetConstObjectMacro(SkeletonImage, SkeletonImageType);
+  itkSetConstObjectMacro(IntensityImage, IntensityImageType);
+
+  itkGetConstMacro(MaximumExactPathVertices, SizeValueType);
+  itkSetMacro(MaximumExactPathVertices, SizeValueType);
+
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Only the skeleton inside this region, within the buffered region of the
+   * skeleton image, is traced. */
+  void SetCoreRegion(const RegionType & region)
+  {
+    m_CoreRegion = region;
+    m_UseCoreRegion = true;
+    this->Modified();
+  }
+
+  /** Classifies the skeleton, builds the graph and measures it. */
+  void Compute();
+
+  /** Skeletons are numbered from 1 in raster order of their first voxel. */
+  const SkeletonStatisticsContainerType & GetSkeletonStatistics() const
+  { return m_SkeletonStatistics; }
+
+  const BranchStatisticsContainerType & GetBranchStatistics() const
+  { return m_BranchStatistics; }
+
+  /** Graph with the vertex ids of the branch table, closed loops adding a
+   * LOOP vertex each; positions are image indices. */
+  const SkeletonGraph * GetGraph() const
+  { return m_Graph; }
+
+protected:
+  SkeletonAnalysisCalculator();
+  ~SkeletonAnalysisCalculator() { }
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  typedef enum
+  {
+    BACKGROUND = 0,
+    END_POINT = 1,
+    SLAB = 2,
+    JUNCTION = 3,
+    BOUNDARY = 4
+  } VoxelClassType;
+
+  typedef enum
+  {
+    CLASSIFY = 0,
+    PATHS = 1
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Graph edge as seen from one of its vertices. */
+  struct Arc
+  {
+    SizeValueType Vertex;
+    double        Length;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Sets the class of the skeleton voxels m_Points[begin, end). */
+  void ThreadedClassify(SizeValueType begin, SizeValueType end);
+
+  /** Longest shortest path of skeleton t, written in m_SkeletonStatistics. */
+  void ThreadedLongestShortestPath(SizeValueType t);
+
+  /** Dijkstra from the vertex 'source' of skeleton t, both numbered within
+   * the skeleton; returns the farthest vertex. */
+  SizeValueType Dijkstra(SizeValueType t, SizeValueType source,
+                         std::vector< double > & distance) const;
+
+  /** Index in m_Points of a padded offset, or m_Points.size(). */
+  SizeValueType FindPoint(OffsetValueType p) const;
+
+  /** Physical position (without origin) of a point. */
+  void GetPosition(SizeValueType point, double position[3]) const;
+
+  /** Image index of a padded offset. */
+  void GetIndex(OffsetValueType p, IndexValueType index[3]) const;
+
+  /** Intensity of a point. */
+  double GetIntensity(SizeValueType point) const;
+
+  double Distance(SizeValueType a, SizeValueType b) const;
+
+  /** Neighbouring skeleton voxels of a point. */
+  void GetNeighbours(SizeValueType point, std::vector< SizeValueType > & neighbours) const;
+
+  /** Follows the slabs from the voxel 'from' through slab 'next' until a
+   * vertex voxel, or 'from' again for a closed loop, and records the branch. */
+  void TraceBranch(SizeValueType from, SizeValueType next);
+
+  /** Records the branch along path, a list of voxels. */
+  void AddBranch(const std::vector< SizeValueType > & path);
+
+private:
+  SkeletonAnalysisCalculator(const Self &); //purposely not implemented
+  void operator=(const Self &);         //purposely not implemented
+
+  SkeletonImageConstPointer  m_SkeletonImage;
+  IntensityImageConstPointer m_IntensityImage;
+  ThreadIdType               m_NumberOfThreads;
+  SizeValueType              m_MaximumExactPathVertices;
+  RegionType                 m_CoreRegion;
+  bool                       m_UseCoreRegion;
+  PhaseType                  m_Phase;
+
+  /** Skeleton (1 in the core, 2 outside) with a one voxel background frame. */
+  std::vector< unsigned char >  m_Volume;
+  SizeValueType                 m_Size[3];
+  OffsetValueType               m_Stride[3];
+  OffsetValueType               m_NeighbourOffset[26];
+  double                        m_Spacing[3];
+  IndexValueType                m_Index[3];
+
+  /** Skeleton voxels in the core (padded offsets) in raster order. */
+  std::vector< OffsetValueType > m_Points;
+  std::vector< unsigned char >   m_PointClass;
+  std::vector< SizeValueType >   m_PointTree;
+  /** Vertex of the end point, junction and boundary voxels. */
+  std::vector< SizeValueType >   m_PointVertex;
+  std::vector< bool >            m_Visited;
+
+  /** First voxel, skeleton and index within the skeleton of every vertex. */
+  std::vector< SizeValueType >           m_VertexPoint;
+  std::vector< SizeValueType >           m_VertexTree;
+  std::vector< SizeValueType >           m_VertexLocal;
+  std::vector< std::vector< Arc > >      m_Adjacency;
+  /** Vertices, first voxel and number of branches of every skeleton. */
+  std::vector< std::vector< SizeValueType > > m_TreeVertices;
+  std::vector< SizeValueType >           m_TreePoint;
+  std::vector< SizeValueType >           m_TreeBranches;
+
+  SkeletonStatisticsContainerType m_SkeletonStatistics;
+  BranchStatisticsContainerType   m_BranchStatistics;
+  SkeletonGraph::Pointer          m_Graph;
+};
+
+}
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSkeletonAnalysisCalculator.txx"
+#endif
+
+#endif // ITKSKELETONANALYSISCALCULATOR_H
@@ -0,0 +1,656 @@
+#ifndef ITKSKELETONANALYSISCALCULATOR_TXX
+#define ITKSKELETONANALYSISCALCULATOR_TXX
+
+#include "itkSkeletonAnalysisCalculator.h"
+#include <itkNumericTraits.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <math.h>
+
+namespace itk {
+
+template< class TSkeletonImage, class TIntensityImage >
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >::SkeletonAnalysisCalculator()
+{
+  m_SkeletonImage = NULL;
+  m_IntensityImage = NULL;
+  m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  m_MaximumExactPathVertices = 5000;
+  m_UseCoreRegion = false;
+  m_Phase = CLASSIFY;
+  m_Graph = SkeletonGraph::New();
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >::Compute()
+{
+  if ( !m_SkeletonImage )
+    itkExceptionMacro(<< "Skeleton image must be set");
+  if ( SkeletonImageType::ImageDimension != 3 )
+    itkExceptionMacro(<< "Only 3D skeletons can be analysed");
+  if ( m_IntensityImage
+       && m_IntensityImage->GetBufferedRegion() != m_SkeletonImage->GetBufferedRegion() )
+    itkExceptionMacro(<< "Skeleton and intensity image do not cover the same region");
+  if ( m_UseCoreRegion && !m_SkeletonImage->GetBufferedRegion().IsInside(m_CoreRegion) )
+    itkExceptionMacro(<< "Core region " << m_CoreRegion << " is outside the skeleton image");
+
+  const RegionType & region = m_SkeletonImage->GetBufferedRegion();
+  IndexValueType coreBegin[3], coreEnd[3];
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    m_Size[d] = region.GetSize()[d];
+    m_Spacing[d] = m_SkeletonImage->GetSpacing()[d];
+    m_Index[d] = region.GetIndex()[d];
+    coreBegin[d] = m_UseCoreRegion ? m_CoreRegion.GetIndex()[d] - m_Index[d] : 0;
+    coreEnd[d] = m_UseCoreRegion ? coreBegin[d] + m_CoreRegion.GetSize()[d] : m_Size[d];
+  }
+  m_Stride[0] = 1;
+  m_Stride[1] = m_Size[0] + 2;
+  m_Stride[2] = m_Stride[1] * (m_Size[1] + 2);
+  unsigned int n = 0;
+  for (int i = 0; i < 27; ++i)
+    if (i != 13)
+      m_NeighbourOffset[n++] = (i % 3 - 1) * m_Stride[0] + ((i / 3) % 3 - 1) * m_Stride[1]
+          + (i / 9 - 1) * m_Stride[2];
+
+  const SkeletonPixelType * in = m_SkeletonImage->GetBufferPointer();
+  m_Volume.assign(m_Stride[2] * (m_Size[2] + 2), 0);
+  m_Points.clear();
+  SizeValueType q = 0;
+  for (SizeValueType z = 0; z < m_Size[2]; ++z)
+    for (SizeValueType y = 0; y < m_Size[1]; ++y)
+    {
+      OffsetValueType p = (z + 1) * m_Stride[2] + (y + 1) * m_Stride[1] + 1;
+      const bool inside = (IndexValueType)z >= coreBegin[2] && (IndexValueType)z < coreEnd[2]
+          && (IndexValueType)y >= coreBegin[1] && (IndexValueType)y < coreEnd[1];
+      for (SizeValueType x = 0; x < m_Size[0]; ++x, ++p, ++q)
+        if (in[q] != NumericTraits< SkeletonPixelType >::ZeroValue())
+        {
+          if (inside && (IndexValueType)x >= coreBegin[0] && (IndexValueType)x < coreEnd[0])
+          {
+            m_Volume[p] = 1;
+            m_Points.push_back(p);
+          }
+          else
+            m_Volume[p] = 2;
+        }
+    }
+  const SizeValueType numPoints = m_Points.size();
+  const SizeValueType none = NumericTraits< SizeValueType >::max();
+
+  ThreadStruct str;
+  str.Filter = this;
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(m_NumberOfThreads);
+  threader->SetSingleMethod(this->ThreaderCallback, &str);
+
+  m_PointClass.assign(numPoints, BACKGROUND);
+  m_Phase = CLASSIFY;
+  threader->SingleMethodExecute();
+
+  //Skeletons, numbered in raster order of their first voxel
+  std::vector< SizeValueType > neighbours;
+  std::vector< SizeValueType > stack;
+  m_PointTree.assign(numPoints, none);
+  m_TreePoint.clear();
+  for (SizeValueType i = 0; i < numPoints; ++i)
+  {
+    if (m_PointTree[i] != none)
+      continue;
+    const SizeValueType tree = m_TreePoint.size();
+    m_TreePoint.push_back(i);
+    m_PointTree[i] = tree;
+    stack.push_back(i);
+    while (!stack.empty())
+    {
+      const SizeValueType j = stack.back();
+      stack.pop_back();
+      this->GetNeighbours(j, neighbours);
+      for (unsigned int k = 0; k < neighbours.size(); ++k)
+        if (m_PointTree[ neighbours[k] ] == none)
+        {
+          m_PointTree[ neighbours[k] ] = tree;
+          stack.push_back(neighbours[k]);
+        }
+    }
+  }
+  const SizeValueType numTrees = m_TreePoint.size();
+
+  //Vertices: every end point and boundary voxel, and every cluster of
+  //junction voxels
+  m_PointVertex.assign(numPoints, none);
+  m_VertexPoint.clear();
+  m_VertexTree.clear();
+  m_VertexLocal.clear();
+  m_TreeVertices.assign(numTrees, std::vector< SizeValueType >());
+  for (SizeValueType i = 0; i < numPoints; ++i)
+  {
+    if (m_PointClass[i] == SLAB || m_PointVertex[i] != none)
+      continue;
+    const SizeValueType vertex = m_VertexPoint.size();
+    const SizeValueType tree = m_PointTree[i];
+    m_VertexPoint.push_back(i);
+    m_VertexTree.push_back(tree);
+    m_VertexLocal.push_back(m_TreeVertices[tree].size());
+    m_TreeVertices[tree].push_back(vertex);
+    m_PointVertex[i] = vertex;
+    if (m_PointClass[i] != JUNCTION)
+      continue;
+    stack.push_back(i);
+    while (!stack.empty())
+    {
+      const SizeValueType j = stack.back();
+      stack.pop_back();
+      this->GetNeighbours(j, neighbours);
+      for (unsigned int k = 0; k < neighbours.size(); ++k)
+        if (m_PointClass[ neighbours[k] ] == JUNCTION && m_PointVertex[ neighbours[k] ] == none)
+        {
+          m_PointVertex[ neighbours[k] ] = vertex;
+          stack.push_back(neighbours[k]);
+        }
+    }
+  }
+
+  m_Graph->Clear();
+  m_Graph->SetSpacing(m_Spacing);
+  std::vector< SizeValueType > vertexVoxels(m_VertexPoint.size(), 0);
+  for (SizeValueType i = 0; i < numPoints; ++i)
+    if (m_PointVertex[i] != none)
+      vertexVoxels[ m_PointVertex[i] ]++;
+  for (SizeValueType v = 0; v < m_VertexPoint.size(); ++v)
+  {
+    SkeletonGraph::Vertex vertex;
+    this->GetIndex(m_Points[ m_VertexPoint[v] ], vertex.Index);
+    //The vertex classes have the values of SkeletonGraph::VertexType
+    vertex.Type = m_PointClass[ m_VertexPoint[v] ];
+    vertex.Voxels = vertexVoxels[v];
+    vertex.Intensity = this->GetIntensity(m_VertexPoint[v]);
+    m_Graph->AddVertex(vertex);
+  }
+  if (m_UseCoreRegion)
+    for (SizeValueType i = 0; i < numPoints; ++i)
+    {
+      if (m_PointVertex[i] == none)
+        continue;
+      for (unsigned int k = 0; k < 26; ++k)
+        if (m_Volume[ m_Points[i] + m_NeighbourOffset[k] ] == 2)
+        {
+          SkeletonGraph::Crossing crossing;
+          crossing.Vertex = m_PointVertex[i];
+          this->GetIndex(m_Points[i], crossing.Inside);
+          this->GetIndex(m_Points[i] + m_NeighbourOffset[k], crossing.Outside);
+          m_Graph->AddCrossing(crossing);
+        }
+    }
+
+  //Branches, traced from the vertex voxels...
+  m_Adjacency.assign(m_VertexPoint.size(), std::vector< Arc >());
+  m_TreeBranches.assign(numTrees, 0);
+  m_BranchStatistics.clear();
+  m_Visited.assign(numPoints, false);
+  for (SizeValueType i = 0; i < numPoints; ++i)
+  {
+    if (m_PointVertex[i] == none)
+      continue;
+    this->GetNeighbours(i, neighbours);
+    for (unsigned int k = 0; k < neighbours.size(); ++k)
+    {
+      const SizeValueType j = neighbours[k];
+      if (m_PointClass[j] == SLAB)
+      {
+        if (!m_Visited[j])
+          this->TraceBranch(i, j);
+      }
+      else if (m_PointVertex[j] != m_PointVertex[i] && i < j)
+      {
+        std::vector< SizeValueType > path;
+        path.push_back(i);
+        path.push_back(j);
+        this->AddBranch(path);
+      }
+    }
+  }
+  //...and the closed loops left over
+  for (SizeValueType i = 0; i < numPoints; ++i)
+  {
+    if (m_PointClass[i] != SLAB || m_Visited[i])
+      continue;
+    this->GetNeighbours(i, neighbours);
+    m_Visited[i] = true;
+    this->TraceBranch(i, neighbours[0]);
+  }
+
+  //Skeleton summaries
+  m_SkeletonStatistics.resize(numTrees);
+  std::vector< double > totalLength(numTrees, 0);
+  for (SizeValueType t = 0; t < numTrees; ++t)
+  {
+    SkeletonStatistics & s = m_SkeletonStatistics[t];
+    s.Branches = m_TreeBranches[t];
+    s.Junctions = 0;
+    s.EndPointVoxels = 0;
+    s.JunctionVoxels = 0;
+    s.SlabVoxels = 0;
+    s.AverageBranchLength = 0;
+    s.TriplePoints = 0;
+    s.QuadruplePoints = 0;
+    s.MaximumBranchLength = 0;
+    s.LongestShortestPath = 0;
+    this->GetPosition(m_TreePoint[t], s.ShortestPathStart);
+  }
+  for (SizeValueType i = 0; i < numPoints; ++i)
+  {
+    SkeletonStatistics & s = m_SkeletonStatistics[ m_PointTree[i] ];
+    if (m_PointClass[i] == END_POINT)
+      s.EndPointVoxels++;
+    else if (m_PointClass[i] == SLAB || m_PointClass[i] == BOUNDARY)
+      s.SlabVoxels++;
+    else
+      s.JunctionVoxels++;
+  }
+  for (SizeValueType v = 0; v < m_VertexPoint.size(); ++v)
+  {
+    if (m_PointClass[ m_VertexPoint[v] ] != JUNCTION)
+      continue;
+    SkeletonStatistics & s = m_SkeletonStatistics[ m_VertexTree[v] ];
+    s.Junctions++;
+    if (m_Adjacency[v].size() == 3)
+      s.TriplePoints++;
+    else if (m_Adjacency[v].size() == 4)
+      s.QuadruplePoints++;
+  }
+  for (SizeValueType b = 0; b < m_BranchStatistics.size(); ++b)
+  {
+    const BranchStatistics & branch = m_BranchStatistics[b];
+    SkeletonStatistics & s = m_SkeletonStatistics[ branch.Skeleton - 1 ];
+    totalLength[ branch.Skeleton - 1 ] += branch.Length;
+    s.MaximumBranchLength = std::max(s.MaximumBranchLength, branch.Length);
+  }
+  for (SizeValueType t = 0; t < numTrees; ++t)
+    if (m_TreeBranches[t] > 0)
+      m_SkeletonStatistics[t].AverageBranchLength = totalLength[t] / m_TreeBranches[t];
+
+  m_Phase = PATHS;
+  threader->SingleMethodExecute();
+
+  std::vector< unsigned char >().swap(m_Volume);
+  std::vector< OffsetValueType >().swap(m_Points);
+  std::vector< unsigned char >().swap(m_PointClass);
+  std::vector< SizeValueType >().swap(m_PointTree);
+  std::vector< SizeValueType >().swap(m_PointVertex);
+  std::vector< bool >().swap(m_Visited);
+  std::vector< std::vector< Arc > >().swap(m_Adjacency);
+  std::vector< std::vector< SizeValueType > >().swap(m_TreeVertices);
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+ITK_THREAD_RETURN_TYPE
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * calculator = str->Filter;
+  switch (calculator->m_Phase)
+  {
+    case CLASSIFY:
+    {
+      const SizeValueType numPoints = calculator->m_Points.size();
+      calculator->ThreadedClassify(numPoints * threadId / threadCount,
+                                   numPoints * (threadId + 1) / threadCount);
+      break;
+    }
+    case PATHS:
+      for (SizeValueType t = threadId; t < calculator->m_SkeletonStatistics.size(); t += threadCount)
+        calculator->ThreadedLongestShortestPath(t);
+      break;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::ThreadedClassify(SizeValueType begin, SizeValueType end)
+{
+  for (SizeValueType i = begin; i < end; ++i)
+  {
+    unsigned int count = 0;
+    bool outside = false;
+    for (unsigned int k = 0; k < 26; ++k)
+    {
+      const unsigned char value = m_Volume[ m_Points[i] + m_NeighbourOffset[k] ];
+      count += value != 0;
+      outside = outside || value == 2;
+    }
+    if (count < 2)
+      m_PointClass[i] = END_POINT;
+    else if (count == 2)
+      m_PointClass[i] = outside ? BOUNDARY : SLAB;
+    else
+      m_PointClass[i] = JUNCTION;
+  }
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+SizeValueType
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::FindPoint(OffsetValueType p) const
+{
+  typename std::vector< OffsetValueType >::const_iterator it =
+      std::lower_bound(m_Points.begin(), m_Points.end(), p);
+  if (it == m_Points.end() || *it != p)
+    return m_Points.size();
+  return it - m_Points.begin();
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::GetNeighbours(SizeValueType point, std::vector< SizeValueType > & neighbours) const
+{
+  neighbours.clear();
+  for (unsigned int k = 0; k < 26; ++k)
+  {
+    const OffsetValueType p = m_Points[point] + m_NeighbourOffset[k];
+    if (m_Volume[p] == 1)
+      neighbours.push_back(this->FindPoint(p));
+  }
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::GetPosition(SizeValueType point, double position[3]) const
+{
+  const OffsetValueType p = m_Points[point];
+  position[0] = (p % m_Stride[1] - 1) * m_Spacing[0];
+  position[1] = ((p % m_Stride[2]) / m_Stride[1] - 1) * m_Spacing[1];
+  position[2] = (p / m_Stride[2] - 1) * m_Spacing[2];
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::GetIndex(OffsetValueType p, IndexValueType index[3]) const
+{
+  index[0] = m_Index[0] + p % m_Stride[1] - 1;
+  index[1] = m_Index[1] + (p % m_Stride[2]) / m_Stride[1] - 1;
+  index[2] = m_Index[2] + p / m_Stride[2] - 1;
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+double
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::GetIntensity(SizeValueType point) const
+{
+  const OffsetValueType p = m_Points[point];
+  const SizeValueType offset = ((p / m_Stride[2] - 1) * m_Size[1]
+                                + (p % m_Stride[2]) / m_Stride[1] - 1) * m_Size[0]
+      + p % m_Stride[1] - 1;
+  return m_IntensityImage ?
+        static_cast< double >(m_IntensityImage->GetBufferPointer()[offset]) :
+        static_cast< double >(m_SkeletonImage->GetBufferPointer()[offset]);
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+double
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::Distance(SizeValueType a, SizeValueType b) const
+{
+  double pa[3], pb[3];
+  this->GetPosition(a, pa);
+  this->GetPosition(b, pb);
+  return sqrt( (pa[0] - pb[0]) * (pa[0] - pb[0]) + (pa[1] - pb[1]) * (pa[1] - pb[1])
+               + (pa[2] - pb[2]) * (pa[2] - pb[2]) );
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::TraceBranch(SizeValueType from, SizeValueType next)
+{
+  std::vector< SizeValueType > path;
+  std::vector< SizeValueType > neighbours;
+  path.push_back(from);
+  SizeValueType previous = from;
+  SizeValueType current = next;
+  while (true)
+  {
+    path.push_back(current);
+    if (current == from || m_PointClass[current] != SLAB)
+      break;
+    m_Visited[current] = true;
+
+    this->GetNeighbours(current, neighbours);
+    const SizeValueType following = neighbours[0] != previous ? neighbours[0] : neighbours[1];
+    //A slab touching a visited slab other than its predecessor is not on a
+    //branch; it can only come from a degenerate junction
+    if (m_PointClass[following] == SLAB && m_Visited[following] && following != from)
+      return;
+    previous = current;
+    current = following;
+  }
+  this->AddBranch(path);
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::AddBranch(const std::vector< SizeValueType > & path)
+{
+  const SizeValueType none = NumericTraits< SizeValueType >::max();
+  const SizeValueType first = path.front();
+  const SizeValueType last = path.back();
+  const SizeValueType v1 = m_PointVertex[first];
+  const SizeValueType v2 = m_PointVertex[last];
+
+  BranchStatistics branch;
+  branch.Skeleton = m_PointTree[first] + 1;
+  this->GetPosition(v1 != none ? m_VertexPoint[v1] : first, branch.V1);
+  this->GetPosition(v2 != none ? m_VertexPoint[v2] : last, branch.V2);
+  branch.EuclideanDistance = sqrt( (branch.V1[0] - branch.V2[0]) * (branch.V1[0] - branch.V2[0])
+                                   + (branch.V1[1] - branch.V2[1]) * (branch.V1[1] - branch.V2[1])
+                                   + (branch.V1[2] - branch.V2[2]) * (branch.V1[2] - branch.V2[2]) );
+
+  branch.Length = 0;
+  for (SizeValueType i = 1; i < path.size(); ++i)
+    branch.Length += this->Distance(path[i-1], path[i]);
+
+  //Length along the path smoothed by a running average of three voxels
+  std::vector< double > positions(3 * path.size());
+  for (SizeValueType i = 0; i < path.size(); ++i)
+    this->GetPosition(path[i], &positions[3 * i]);
+  std::vector< double > smoothed(positions);
+  for (SizeValueType i = 1; i + 1 < path.size(); ++i)
+    for (unsigned int d = 0; d < 3; ++d)
+      smoothed[3 * i + d] = (positions[3 * (i-1) + d] + positions[3 * i + d]
+                             + positions[3 * (i+1) + d]) / 3.0;
+  branch.RunningAverageLength = 0;
+  for (SizeValueType i = 1; i < path.size(); ++i)
+  {
+    double squared = 0;
+    for (unsigned int d = 0; d < 3; ++d)
+      squared += (smoothed[3 * i + d] - smoothed[3 * (i-1) + d])
+          * (smoothed[3 * i + d] - smoothed[3 * (i-1) + d]);
+    branch.RunningAverageLength += sqrt(squared);
+  }
+
+  //Intensities along the slabs, the closing voxel of a loop counted once
+  std::vector< double > values;
+  const SizeValueType end = (first == last && path.size() > 1) ? path.size() - 1 : path.size();
+  for (SizeValueType i = 0; i < end; ++i)
+    if (m_PointClass[ path[i] ] == SLAB || m_PointClass[ path[i] ] == BOUNDARY)
+      values.push_back(this->GetIntensity(path[i]));
+  branch.AverageIntensity = 0;
+  branch.AverageIntensityInnerThird = 0;
+  if (!values.empty())
+  {
+    double sum = 0;
+    for (SizeValueType i = 0; i < values.size(); ++i)
+      sum += values[i];
+    branch.AverageIntensity = sum / values.size();
+
+    SizeValueType innerBegin = values.size() / 3;
+    SizeValueType innerEnd = values.size() - values.size() / 3;
+    sum = 0;
+    for (SizeValueType i = innerBegin; i < innerEnd; ++i)
+      sum += values[i];
+    branch.AverageIntensityInnerThird = sum / (innerEnd - innerBegin);
+  }
+  m_BranchStatistics.push_back(branch);
+  m_TreeBranches[ m_PointTree[first] ]++;
+
+  SkeletonGraph::Edge edge;
+  if (v1 != none)
+  {
+    edge.V1 = v1;
+    edge.V2 = v2;
+  }
+  else
+  {
+    SkeletonGraph::Vertex loop;
+    this->GetIndex(m_Points[first], loop.Index);
+    loop.Type = SkeletonGraph::LOOP;
+    loop.Voxels = 1;
+    loop.Intensity = this->GetIntensity(first);
+    edge.V1 = edge.V2 = m_Graph->AddVertex(loop);
+  }
+  edge.Length = branch.Length;
+  edge.SlabVoxels = path.size() - 2;
+  edge.IntensitySum = 0;
+  for (SizeValueType i = 1; i + 1 < path.size(); ++i)
+    edge.IntensitySum += this->GetIntensity(path[i]);
+  m_Graph->AddEdge(edge);
+
+  if (v1 != none && v2 != none)
+  {
+    Arc arc;
+    arc.Length = branch.Length;
+    arc.Vertex = v2;
+    m_Adjacency[v1].push_back(arc);
+    arc.Vertex = v1;
+    m_Adjacency[v2].push_back(arc);
+  }
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+SizeValueType
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::Dijkstra(SizeValueType t, SizeValueType source, std::vector< double > & distance) const
+{
+  typedef std::pair< double, SizeValueType > QueueEntry;
+  const std::vector< SizeValueType > & vertices = m_TreeVertices[t];
+  distance.assign(vertices.size(), -1);
+
+  std::priority_queue< QueueEntry, std::vector< QueueEntry >, std::greater< QueueEntry > > queue;
+  std::vector< bool > done(vertices.size(), false);
+  distance[source] = 0;
+  queue.push(QueueEntry(0, source));
+  while (!queue.empty())
+  {
+    const SizeValueType u = queue.top().second;
+    queue.pop();
+    if (done[u])
+      continue;
+    done[u] = true;
+    const std::vector< Arc > & arcs = m_Adjacency[ vertices[u] ];
+    for (SizeValueType a = 0; a < arcs.size(); ++a)
+    {
+      const SizeValueType w = m_VertexLocal[ arcs[a].Vertex ];
+      const double d = distance[u] + arcs[a].Length;
+      if (distance[w] < 0 || d < distance[w])
+      {
+        distance[w] = d;
+        queue.push(QueueEntry(d, w));
+      }
+    }
+  }
+
+  SizeValueType farthest = source;
+  for (SizeValueType v = 0; v < vertices.size(); ++v)
+    if (distance[v] > distance[farthest])
+      farthest = v;
+  return farthest;
+}
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::ThreadedLongestShortestPath(SizeValueType t)
+{
+  const std::vector< SizeValueType > & vertices = m_TreeVertices[t];
+  if (vertices.empty())
+    return;
+
+  std::vector< double > distance;
+  SizeValueType bestSource = 0;
+  double best = 0;
+  if (m_TreeBranches[t] + 1 == vertices.size())
+  {
+    //On a tree the farthest vertex from anywhere ends a longest path
+    const SizeValueType a = this->Dijkstra(t, 0, distance);
+    const SizeValueType b = this->Dijkstra(t, a, distance);
+    bestSource = a;
+    best = distance[b];
+  }
+  else if (vertices.size() <= m_MaximumExactPathVertices)
+  {
+    for (SizeValueType s = 0; s < vertices.size(); ++s)
+    {
+      const SizeValueType b = this->Dijkstra(t, s, distance);
+      if (distance[b] > best)
+      {
+        best = distance[b];
+        bestSource = s;
+      }
+    }
+  }
+  else
+  {
+    //Sweeps from the farthest vertex of the previous one, while they get longer
+    SizeValueType a = this->Dijkstra(t, 0, distance);
+    for (unsigned int sweep = 0; sweep < 8; ++sweep)
+    {
+      const SizeValueType b = this->Dijkstra(t, a, distance);
+      if (distance[b] <= best)
+        break;
+      best = distance[b];
+      bestSource = a;
+      a = b;
+    }
+  }
+
+  SkeletonStatistics & s = m_SkeletonStatistics[t];
+  s.LongestShortestPath = best;
+  this->GetPosition(m_VertexPoint[ vertices[bestSource] ], s.ShortestPathStart);
+}
+
+/* ---------------------------------------------------------------------
+   PrintSelf method
+   --------------------------------------------------------------------- */
+
+template< class TSkeletonImage, class TIntensityImage >
+void
+SkeletonAnalysisCalculator< TSkeletonImage, TIntensityImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+  os << indent << "MaximumExactPathVertices: " << m_MaximumExactPathVertices << std::endl;
+  if (m_UseCoreRegion)
+    os << indent << "CoreRegion: " << m_CoreRegion << std::endl;
+  os << indent << "NumberOfSkeletons: " << m_SkeletonStatistics.size() << std::endl;
+  os << indent << "NumberOfBranches: " << m_BranchStatistics.size() << std::endl;
+}
+
+} // end namespace
+#endif //ITKSKELETONANALYSISCALCULATOR_TXX
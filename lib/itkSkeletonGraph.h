@@ -0,0 +1,296 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSKELETONGRAPH_H
+#define ITKSKELETONGRAPH_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <itkIntTypes.h>
+#include <itkNumericTraits.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class SkeletonGraph
+ * \brief Graph of a skeleton, as built by SkeletonAnalysisCalculator, that
+ * can be stitched across blocks (see SkeletonGraphStitcher).
+ *
+ * Vertices are end points, clusters of junction voxels, BOUNDARY voxels
+ * (slab voxels where the skeleton leaves the core of a block) and LOOP
+ * voxels (the first voxel of a closed loop without other vertices). Edges
+ * are branches with their calibrated length and the number and intensity sum
+ * of their slab voxels, not counting their end vertices. Crossings record,
+ * for a boundary vertex, a skeleton voxel next to it outside the core.
+ * Positions are voxel indices in the whole volume.
+ *
+ * Graphs are saved in a compact binary format: an 8 character signature,
+ * the spacing and the number of vertices, edges and crossings, then the
+ * records with fixed width fields in the byte order of the machine.
+ */
+class SkeletonGraph : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SkeletonGraph                 Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SkeletonGraph, Object);
+
+  typedef enum
+  {
+    END_POINT = 1,
+    JUNCTION = 3,
+    BOUNDARY = 4,
+    LOOP = 5
+  } VertexType;
+
+  struct Vertex
+  {
+    IndexValueType Index[3];
+    unsigned char  Type;
+    /** Voxels of the vertex, more than one for junction clusters. */
+    SizeValueType  Voxels;
+    /** Intensity of the first voxel of the vertex. */
+    double         Intensity;
+  };
+
+  struct Edge
+  {
+    SizeValueType V1;
+    SizeValueType V2;
+    double        Length;
+    SizeValueType SlabVoxels;
+    double        IntensitySum;
+  };
+
+  struct Crossing
+  {
+    SizeValueType  Vertex;
+    IndexValueType Inside[3];
+    IndexValueType Outside[3];
+  };
+
+  void Clear()
+  {
+    m_Vertices.clear();
+    m_Edges.clear();
+    m_Crossings.clear();
+    this->Modified();
+  }
+
+  void SetSpacing(const double spacing[3])
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+      m_Spacing[d] = spacing[d];
+    this->Modified();
+  }
+  const double * GetSpacing() const
+  { return m_Spacing; }
+
+  /** Adds a vertex and returns its id. */
+  SizeValueType AddVertex(const Vertex & vertex)
+  {
+    m_Vertices.push_back(vertex);
+    return m_Vertices.size() - 1;
+  }
+  void AddEdge(const Edge & edge)
+  { m_Edges.push_back(edge); }
+  void AddCrossing(const Crossing & crossing)
+  { m_Crossings.push_back(crossing); }
+
+  SizeValueType GetNumberOfVertices() const
+  { return m_Vertices.size(); }
+  SizeValueType GetNumberOfEdges() const
+  { return m_Edges.size(); }
+  SizeValueType GetNumberOfCrossings() const
+  { return m_Crossings.size(); }
+
+  const Vertex & GetVertex(SizeValueType v) const
+  { return m_Vertices[v]; }
+  const Edge & GetEdge(SizeValueType e) const
+  { return m_Edges[e]; }
+  const Crossing & GetCrossing(SizeValueType c) const
+  { return m_Crossings[c]; }
+
+  void Write(const std::string & fileName) const
+  {
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+      itkExceptionMacro(<< "Cannot write " << fileName);
+    if (m_Vertices.size() > NumericTraits< uint32_t >::max())
+      itkExceptionMacro(<< "Too many vertices to write " << fileName);
+
+    file.write(Signature(), 8);
+    file.write(reinterpret_cast< const char * >(m_Spacing), 3 * sizeof(double));
+    WriteValue< uint64_t >(file, m_Vertices.size());
+    WriteValue< uint64_t >(file, m_Edges.size());
+    WriteValue< uint64_t >(file, m_Crossings.size());
+    for (SizeValueType v = 0; v < m_Vertices.size(); ++v)
+    {
+      const Vertex & vertex = m_Vertices[v];
+      for (unsigned int d = 0; d < 3; ++d)
+        WriteValue< int32_t >(file, vertex.Index[d]);
+      WriteValue< uint8_t >(file, vertex.Type);
+      WriteValue< uint32_t >(file, vertex.Voxels);
+      WriteValue< float >(file, vertex.Intensity);
+    }
+    for (SizeValueType e = 0; e < m_Edges.size(); ++e)
+    {
+      const Edge & edge = m_Edges[e];
+      WriteValue< uint32_t >(file, edge.V1);
+      WriteValue< uint32_t >(file, edge.V2);
+      WriteValue< float >(file, edge.Length);
+      WriteValue< uint32_t >(file, edge.SlabVoxels);
+      WriteValue< double >(file, edge.IntensitySum);
+    }
+    for (SizeValueType c = 0; c < m_Crossings.size(); ++c)
+    {
+      const Crossing & crossing = m_Crossings[c];
+      WriteValue< uint32_t >(file, crossing.Vertex);
+      for (unsigned int d = 0; d < 3; ++d)
+        WriteValue< int32_t >(file, crossing.Inside[d]);
+      for (unsigned int d = 0; d < 3; ++d)
+        WriteValue< int32_t >(file, crossing.Outside[d]);
+    }
+    if (!file)
+      itkExceptionMacro(<< "Cannot write " << fileName);
+  }
+
+  void Read(const std::string & fileName)
+  {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file)
+      itkExceptionMacro(<< "Cannot read " << fileName);
+    char signature[8];
+    file.read(signature, 8);
+    if (!file || std::string(signature, 8) != std::string(Signature(), 8))
+      itkExceptionMacro(<< fileName << " is not a skeleton graph");
+
+    file.read(reinterpret_cast< char * >(m_Spacing), 3 * sizeof(double));
+    const uint64_t numVertices = ReadValue< uint64_t >(file);
+    const uint64_t numEdges = ReadValue< uint64_t >(file);
+    const uint64_t numCrossings = ReadValue< uint64_t >(file);
+    if (!file)
+      itkExceptionMacro(<< "Cannot read " << fileName);
+
+    //The counts are checked against the bytes left before any allocation,
+    //so that a corrupt file is not taken for a huge graph
+    const std::streamoff position = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t left = static_cast< uint64_t >(file.tellg() - position);
+    file.seekg(position);
+    const uint64_t recordSizes[3] = { VertexRecordSize, EdgeRecordSize, CrossingRecordSize };
+    const uint64_t counts[3] = { numVertices, numEdges, numCrossings };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      if (counts[i] > left / recordSizes[i])
+        itkExceptionMacro(<< "Truncated skeleton graph " << fileName);
+      left -= counts[i] * recordSizes[i];
+    }
+
+    m_Vertices.resize(numVertices);
+    for (SizeValueType v = 0; v < numVertices; ++v)
+    {
+      Vertex & vertex = m_Vertices[v];
+      for (unsigned int d = 0; d < 3; ++d)
+        vertex.Index[d] = ReadValue< int32_t >(file);
+      vertex.Type = ReadValue< uint8_t >(file);
+      vertex.Voxels = ReadValue< uint32_t >(file);
+      vertex.Intensity = ReadValue< float >(file);
+    }
+    m_Edges.resize(numEdges);
+    for (SizeValueType e = 0; e < numEdges; ++e)
+    {
+      Edge & edge = m_Edges[e];
+      edge.V1 = ReadValue< uint32_t >(file);
+      edge.V2 = ReadValue< uint32_t >(file);
+      edge.Length = ReadValue< float >(file);
+      edge.SlabVoxels = ReadValue< uint32_t >(file);
+      edge.IntensitySum = ReadValue< double >(file);
+    }
+    m_Crossings.resize(numCrossings);
+    for (SizeValueType c = 0; c < numCrossings; ++c)
+    {
+      Crossing & crossing = m_Crossings[c];
+      crossing.Vertex = ReadValue< uint32_t >(file);
+      for (unsigned int d = 0; d < 3; ++d)
+        crossing.Inside[d] = ReadValue< int32_t >(file);
+      for (unsigned int d = 0; d < 3; ++d)
+        crossing.Outside[d] = ReadValue< int32_t >(file);
+    }
+    if (!file)
+      itkExceptionMacro(<< "Truncated skeleton graph " << fileName);
+    this->Modified();
+  }
+
+protected:
+  SkeletonGraph()
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+      m_Spacing[d] = 1.0;
+  }
+  ~SkeletonGraph() {}
+
+  void PrintSelf(std::ostream & os, Indent indent) const
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "NumberOfVertices: " << m_Vertices.size() << std::endl;
+    os << indent << "NumberOfEdges: " << m_Edges.size() << std::endl;
+    os << indent << "NumberOfCrossings: " << m_Crossings.size() << std::endl;
+  }
+
+  static const char * Signature()
+  { return "VTSKGRF1"; }
+
+  /** Bytes of a vertex, an edge and a crossing in the file. */
+  enum
+  {
+    VertexRecordSize = 3 * sizeof(int32_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(float),
+    EdgeRecordSize = 3 * sizeof(uint32_t) + sizeof(float) + sizeof(double),
+    CrossingRecordSize = sizeof(uint32_t) + 6 * sizeof(int32_t)
+  };
+
+  template< class T >
+  static void WriteValue(std::ostream & os, T value)
+  { os.write(reinterpret_cast< const char * >(&value), sizeof(T)); }
+
+  template< class T >
+  static T ReadValue(std::istream & is)
+  {
+    T value = T();
+    is.read(reinterpret_cast< char * >(&value), sizeof(T));
+    return value;
+  }
+
+private:
+  SkeletonGraph(const Self &);  //purposely not implemented
+  void operator=(const Self &); //purposely not implemented
+
+  double                  m_Spacing[3];
+  std::vector< Vertex >   m_Vertices;
+  std::vector< Edge >     m_Edges;
+  std::vector< Crossing > m_Crossings;
+};
+
+} //end namespace
+
+#endif // ITKSKELETONGRAPH_H
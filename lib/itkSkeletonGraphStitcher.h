@@ -0,0 +1,839 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSKELETONGRAPHSTITCHER_H
+#define ITKSKELETONGRAPHSTITCHER_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <itkMultiThreader.h>
+#include <itkNumericTraits.h>
+#include "itkImageBlockGrid.h"
+#include "itkSkeletonGraph.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include <math.h>
+
+namespace itk {
+
+/** \class SkeletonGraphStitcher
+ * \brief Joins the skeleton graphs of the blocks of a split volume into the
+ * graph of the whole volume and measures it.
+ *
+ * Every block graph covers the core of its block only (see
+ * SkeletonAnalysisCalculator::SetCoreRegion), so no branch is counted twice,
+ * and its voxel indices are those of the block image, which starts at index
+ * 0 as split_volume writes it. Crossings between neighbouring blocks are
+ * paired through a spatial hash of their midpoints: a crossing from block A
+ * to block B matches the crossing of B back to A whose inside and outside
+ * voxels are within Tolerance voxels of its outside and inside voxels, the
+ * closest one if there are several. Matches are exact wherever both blocks
+ * agree on the skeleton around the cut between their cores.
+ *
+ * Matched junction vertices are merged, other matched vertices are joined by
+ * a branch, and boundary vertices are then removed by joining their two
+ * branches; a boundary vertex left with a single branch, when one of its
+ * crossings has no match, becomes an end point.
+ *
+ * The statistics are those of SkeletonAnalysisCalculator, except the running
+ * average length and inner third intensity of the branches, which need their
+ * voxels. The longest shortest path of a skeleton with cycles is exact up to
+ * MaximumExactPathVertices vertices; above, it is the longest of repeated
+ * double Dijkstra sweeps, a lower bound.
+ */
+class SkeletonGraphStitcher : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SkeletonGraphStitcher         Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SkeletonGraphStitcher, Object);
+
+  /** One row of the per skeleton table. */
+  struct SkeletonStatistics
+  {
+    SizeValueType Branches;
+    SizeValueType Junctions;
+    SizeValueType EndPointVoxels;
+    SizeValueType JunctionVoxels;
+    SizeValueType SlabVoxels;
+    double        AverageBranchLength;
+    SizeValueType TriplePoints;
+    SizeValueType QuadruplePoints;
+    double        MaximumBranchLength;
+    double        LongestShortestPath;
+    double        ShortestPathStart[3];
+  };
+
+  /** One row of the per branch table; positions are in mm. */
+  struct BranchStatistics
+  {
+    SizeValueType Skeleton;
+    double        Length;
+    double        V1[3];
+    double        V2[3];
+    double        EuclideanDistance;
+    double        AverageIntensity;
+  };
+
+  typedef std::vector< SkeletonStatistics > SkeletonStatisticsContainerType;
+  typedef std::vector< BranchStatistics >   BranchStatisticsContainerType;
+
+  itkSetConstObjectMacro(Grid, ImageBlockGrid);
+
+  /** Graph files, one per block of the grid and in the same order. */
+  void SetGraphFileNames(const std::vector< std::string > & fileNames)
+  {
+    m_GraphFileNames = fileNames;
+    this->Modified();
+  }
+
+  /** Largest distance in voxels between matching crossings. */
+  itkGetConstMacro(Tolerance, double);
+  itkSetMacro(Tolerance, double);
+
+  itkGetConstMacro(MaximumExactPathVertices, SizeValueType);
+  itkSetMacro(MaximumExactPathVertices, SizeValueType);
+
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+
+  /** Crossings left without a match by the last Compute. */
+  itkGetConstMacro(NumberOfUnmatchedCrossings, SizeValueType);
+
+  /** Reads the block graphs, joins them and measures the result. */
+  void Compute();
+
+  /** Graph of the whole volume, without crossings, vertices in raster order. */
+  const SkeletonGraph * GetGraph() const
+  { return m_Graph; }
+
+  /** Skeletons are numbered from 1 in raster order of their first vertex. */
+  const SkeletonStatisticsContainerType & GetSkeletonStatistics() const
+  { return m_SkeletonStatistics; }
+
+  const BranchStatisticsContainerType & GetBranchStatistics() const
+  { return m_BranchStatistics; }
+
+protected:
+  SkeletonGraphStitcher()
+  {
+    m_Grid = NULL;
+    m_Tolerance = 2.0;
+    m_MaximumExactPathVertices = 5000;
+    m_NumberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+    m_NumberOfUnmatchedCrossings = 0;
+    m_Phase = READ;
+    m_Graph = SkeletonGraph::New();
+  }
+  ~SkeletonGraphStitcher() {}
+
+  void PrintSelf(std::ostream & os, Indent indent) const
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "Tolerance: " << m_Tolerance << std::endl;
+    os << indent << "MaximumExactPathVertices: " << m_MaximumExactPathVertices << std::endl;
+    os << indent << "NumberOfThreads: " << m_NumberOfThreads << std::endl;
+    os << indent << "NumberOfUnmatchedCrossings: " << m_NumberOfUnmatchedCrossings << std::endl;
+  }
+
+  typedef enum
+  {
+    READ = 0,
+    PATHS = 1
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  /** Crossing of a block graph, in volume coordinates. */
+  struct HalfEdge
+  {
+    SizeValueType  Vertex;
+    SizeValueType  Block;
+    /** Block owning the outside voxel. */
+    SizeValueType  Target;
+    IndexValueType Inside[3];
+    IndexValueType Outside[3];
+  };
+
+  /** Graph edge as seen from one of its vertices. */
+  struct Arc
+  {
+    SizeValueType Vertex;
+    double        Length;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Runs the current phase on m_NumberOfThreads threads. */
+  void Execute();
+
+  /** Pairs the crossings, merging junctions in m_Parent and adding branches. */
+  void MatchCrossings();
+
+  /** Merges the junctions, removes the boundary vertices and sorts the
+   * vertices in raster order. */
+  void MergeVertices();
+
+  /** Numbers the skeletons, fills m_Graph and the statistics but for the
+   * longest shortest paths. */
+  void BuildSkeletons();
+
+  void ThreadedLongestShortestPath(SizeValueType t);
+
+  /** Dijkstra from the vertex 'source' of skeleton t, both numbered within
+   * the skeleton; returns the farthest vertex. */
+  SizeValueType Dijkstra(SizeValueType t, SizeValueType source,
+                         std::vector< double > & distance) const;
+
+  SizeValueType FindRoot(SizeValueType v);
+
+  /** Hash bucket of a cell of the crossing midpoints. */
+  SizeValueType GetBucket(const IndexValueType cell[3]) const;
+
+  void GetPosition(const IndexValueType index[3], double position[3]) const
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+      position[d] = index[d] * m_Spacing[d];
+  }
+
+  static bool RasterLess(const IndexValueType a[3], const IndexValueType b[3])
+  {
+    for (int d = 2; d >= 0; --d)
+      if (a[d] != b[d])
+        return a[d] < b[d];
+    return false;
+  }
+
+private:
+  SkeletonGraphStitcher(const Self &); //purposely not implemented
+  void operator=(const Self &);        //purposely not implemented
+
+  ImageBlockGrid::ConstPointer m_Grid;
+  std::vector< std::string >   m_GraphFileNames;
+  double                       m_Tolerance;
+  SizeValueType                m_MaximumExactPathVertices;
+  ThreadIdType                 m_NumberOfThreads;
+  SizeValueType                m_NumberOfUnmatchedCrossings;
+
+  PhaseType                               m_Phase;
+  std::vector< std::string >              m_ThreadErrors;
+  std::vector< SkeletonGraph::Pointer >   m_BlockGraphs;
+  double                                  m_Spacing[3];
+
+  /** Graph being joined and the union-find forest of merged junctions. */
+  std::vector< SkeletonGraph::Vertex >    m_Vertices;
+  std::vector< SkeletonGraph::Edge >      m_Edges;
+  std::vector< HalfEdge >                 m_HalfEdges;
+  std::vector< SizeValueType >            m_Parent;
+  /** Spatial hash of the crossings: cell size and buckets of m_HalfEdges. */
+  IndexValueType                          m_CellSize;
+  std::vector< SizeValueType >            m_BucketStart;
+  std::vector< SizeValueType >            m_BucketEntries;
+
+  /** Skeleton, vertices and branches of the joined graph. */
+  std::vector< SizeValueType >                m_VertexLocal;
+  std::vector< std::vector< Arc > >           m_Adjacency;
+  std::vector< std::vector< SizeValueType > > m_TreeVertices;
+  std::vector< SizeValueType >                m_TreeBranches;
+
+  SkeletonStatisticsContainerType m_SkeletonStatistics;
+  BranchStatisticsContainerType   m_BranchStatistics;
+  SkeletonGraph::Pointer          m_Graph;
+};
+
+inline void
+SkeletonGraphStitcher::Compute()
+{
+  if ( !m_Grid )
+    itkExceptionMacro(<< "Grid must be set");
+  const SizeValueType numBlocks = m_Grid->GetNumberOfBlocks();
+  if ( m_GraphFileNames.size() != numBlocks )
+    itkExceptionMacro(<< "Expected " << numBlocks << " graphs, got " << m_GraphFileNames.size());
+
+  m_BlockGraphs.assign(numBlocks, SkeletonGraph::Pointer());
+  m_Phase = READ;
+  this->Execute();
+
+  m_Vertices.clear();
+  m_Edges.clear();
+  m_HalfEdges.clear();
+  for (SizeValueType b = 0; b < numBlocks; ++b)
+  {
+    const SkeletonGraph * graph = m_BlockGraphs[b];
+    const ImageBlockGrid::Block & block = m_Grid->GetBlock(b);
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      if (b == 0)
+        m_Spacing[d] = graph->GetSpacing()[d];
+      else if (fabs(graph->GetSpacing()[d] - m_Spacing[d]) > 1e-6 * m_Spacing[d])
+        itkExceptionMacro(<< "Spacing of " << m_GraphFileNames[b] << " differs from "
+                          << m_GraphFileNames[0]);
+    }
+
+    const SizeValueType first = m_Vertices.size();
+    for (SizeValueType v = 0; v < graph->GetNumberOfVertices(); ++v)
+    {
+      SkeletonGraph::Vertex vertex = graph->GetVertex(v);
+      for (unsigned int d = 0; d < 3; ++d)
+        vertex.Index[d] += block.Index[d];
+      m_Vertices.push_back(vertex);
+    }
+    for (SizeValueType e = 0; e < graph->GetNumberOfEdges(); ++e)
+    {
+      SkeletonGraph::Edge edge = graph->GetEdge(e);
+      edge.V1 += first;
+      edge.V2 += first;
+      m_Edges.push_back(edge);
+    }
+    for (SizeValueType c = 0; c < graph->GetNumberOfCrossings(); ++c)
+    {
+      const SkeletonGraph::Crossing & crossing = graph->GetCrossing(c);
+      HalfEdge half;
+      half.Vertex = crossing.Vertex + first;
+      half.Block = b;
+      for (unsigned int d = 0; d < 3; ++d)
+      {
+        half.Inside[d] = crossing.Inside[d] + block.Index[d];
+        half.Outside[d] = crossing.Outside[d] + block.Index[d];
+      }
+      half.Target = m_Grid->FindCoreBlock(half.Outside);
+      m_HalfEdges.push_back(half);
+    }
+    m_BlockGraphs[b] = NULL;
+  }
+  m_BlockGraphs.clear();
+
+  this->MatchCrossings();
+  this->MergeVertices();
+  this->BuildSkeletons();
+
+  m_Phase = PATHS;
+  this->Execute();
+
+  std::vector< SkeletonGraph::Vertex >().swap(m_Vertices);
+  std::vector< SkeletonGraph::Edge >().swap(m_Edges);
+  std::vector< HalfEdge >().swap(m_HalfEdges);
+  std::vector< SizeValueType >().swap(m_Parent);
+  std::vector< SizeValueType >().swap(m_VertexLocal);
+  std::vector< std::vector< Arc > >().swap(m_Adjacency);
+  std::vector< std::vector< SizeValueType > >().swap(m_TreeVertices);
+}
+
+inline void
+SkeletonGraphStitcher::Execute()
+{
+  ThreadStruct str;
+  str.Filter = this;
+  m_ThreadErrors.assign(m_NumberOfThreads, std::string());
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads(m_NumberOfThreads);
+  threader->SetSingleMethod(this->ThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  for (ThreadIdType t = 0; t < m_ThreadErrors.size(); ++t)
+    if (!m_ThreadErrors[t].empty())
+    {
+      m_BlockGraphs.clear();
+      itkExceptionMacro(<< m_ThreadErrors[t]);
+    }
+}
+
+inline ITK_THREAD_RETURN_TYPE
+SkeletonGraphStitcher::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  try
+  {
+    switch (filter->m_Phase)
+    {
+      case READ:
+        for (SizeValueType b = threadId; b < filter->m_BlockGraphs.size(); b += threadCount)
+        {
+          SkeletonGraph::Pointer graph = SkeletonGraph::New();
+          graph->Read(filter->m_GraphFileNames[b]);
+          filter->m_BlockGraphs[b] = graph;
+        }
+        break;
+      case PATHS:
+        for (SizeValueType t = threadId; t < filter->m_SkeletonStatistics.size(); t += threadCount)
+          filter->ThreadedLongestShortestPath(t);
+        break;
+    }
+  }
+  catch( ExceptionObject & err )
+  {
+    filter->m_ThreadErrors[threadId] = err.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+inline SizeValueType
+SkeletonGraphStitcher::FindRoot(SizeValueType v)
+{
+  SizeValueType root = v;
+  while (m_Parent[root] != root)
+    root = m_Parent[root];
+  while (m_Parent[v] != root)
+  {
+    const SizeValueType next = m_Parent[v];
+    m_Parent[v] = root;
+    v = next;
+  }
+  return root;
+}
+
+inline SizeValueType
+SkeletonGraphStitcher::GetBucket(const IndexValueType cell[3]) const
+{
+  const SizeValueType hash = static_cast< SizeValueType >(cell[0]) * 73856093u
+      ^ static_cast< SizeValueType >(cell[1]) * 19349663u
+      ^ static_cast< SizeValueType >(cell[2]) * 83492791u;
+  return hash % (m_BucketStart.size() - 1);
+}
+
+inline void
+SkeletonGraphStitcher::MatchCrossings()
+{
+  const SizeValueType none = NumericTraits< SizeValueType >::max();
+  const SizeValueType numBlocks = m_Grid->GetNumberOfBlocks();
+  const SizeValueType numCrossings = m_HalfEdges.size();
+  m_Parent.resize(m_Vertices.size());
+  for (SizeValueType v = 0; v < m_Vertices.size(); ++v)
+    m_Parent[v] = v;
+
+  //Midpoints are hashed in half voxels, in cells as large as the largest
+  //distance between the midpoints of matching crossings
+  m_CellSize = std::max< IndexValueType >(1, (IndexValueType)ceil(2 * m_Tolerance));
+  std::vector< IndexValueType > cells(3 * numCrossings);
+  m_BucketStart.assign(2 * numCrossings + 2, 0);
+  for (SizeValueType h = 0; h < numCrossings; ++h)
+  {
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      const IndexValueType m = m_HalfEdges[h].Inside[d] + m_HalfEdges[h].Outside[d];
+      cells[3 * h + d] = (m >= 0 ? m : m - m_CellSize + 1) / m_CellSize;
+    }
+    m_BucketStart[ this->GetBucket(&cells[3 * h]) + 1 ]++;
+  }
+  for (SizeValueType k = 1; k < m_BucketStart.size(); ++k)
+    m_BucketStart[k] += m_BucketStart[k-1];
+  m_BucketEntries.resize(numCrossings);
+  std::vector< SizeValueType > fill(m_BucketStart.begin(), m_BucketStart.end() - 1);
+  for (SizeValueType h = 0; h < numCrossings; ++h)
+    m_BucketEntries[ fill[ this->GetBucket(&cells[3 * h]) ]++ ] = h;
+
+  const double tolerance2 = m_Tolerance * m_Tolerance;
+  std::vector< bool > matched(numCrossings, false);
+  m_NumberOfUnmatchedCrossings = 0;
+  for (SizeValueType h = 0; h < numCrossings; ++h)
+  {
+    if (matched[h])
+      continue;
+    const HalfEdge & half = m_HalfEdges[h];
+    SizeValueType best = none;
+    double bestCost = 0;
+    if (half.Target < numBlocks)
+      for (int k = 0; k < 27; ++k)
+      {
+        const IndexValueType cell[3] = { cells[3 * h] + k % 3 - 1,
+                                         cells[3 * h + 1] + (k / 3) % 3 - 1,
+                                         cells[3 * h + 2] + k / 9 - 1 };
+        const SizeValueType bucket = this->GetBucket(cell);
+        for (SizeValueType i = m_BucketStart[bucket]; i < m_BucketStart[bucket + 1]; ++i)
+        {
+          const SizeValueType g = m_BucketEntries[i];
+          const HalfEdge & other = m_HalfEdges[g];
+          if (matched[g] || other.Block != half.Target || other.Target != half.Block)
+            continue;
+          double inside = 0, outside = 0;
+          for (unsigned int d = 0; d < 3; ++d)
+          {
+            inside += (double)(other.Inside[d] - half.Outside[d]) * (other.Inside[d] - half.Outside[d]);
+            outside += (double)(other.Outside[d] - half.Inside[d]) * (other.Outside[d] - half.Inside[d]);
+          }
+          if (inside > tolerance2 || outside > tolerance2)
+            continue;
+          if (best == none || inside + outside < bestCost)
+          {
+            best = g;
+            bestCost = inside + outside;
+          }
+        }
+      }
+    if (best == none)
+    {
+      m_NumberOfUnmatchedCrossings++;
+      continue;
+    }
+    matched[h] = true;
+    matched[best] = true;
+
+    const HalfEdge & other = m_HalfEdges[best];
+    if (m_Vertices[half.Vertex].Type == SkeletonGraph::JUNCTION
+        && m_Vertices[other.Vertex].Type == SkeletonGraph::JUNCTION)
+    {
+      const SizeValueType a = this->FindRoot(half.Vertex);
+      const SizeValueType b = this->FindRoot(other.Vertex);
+      if (a != b)
+        m_Parent[std::max(a, b)] = std::min(a, b);
+      continue;
+    }
+    double pa[3], pb[3];
+    this->GetPosition(half.Inside, pa);
+    this->GetPosition(other.Inside, pb);
+    SkeletonGraph::Edge edge;
+    edge.V1 = half.Vertex;
+    edge.V2 = other.Vertex;
+    edge.Length = sqrt( (pa[0] - pb[0]) * (pa[0] - pb[0]) + (pa[1] - pb[1]) * (pa[1] - pb[1])
+                        + (pa[2] - pb[2]) * (pa[2] - pb[2]) );
+    edge.SlabVoxels = 0;
+    edge.IntensitySum = 0;
+    m_Edges.push_back(edge);
+  }
+
+  std::vector< SizeValueType >().swap(m_BucketStart);
+  std::vector< SizeValueType >().swap(m_BucketEntries);
+}
+
+inline void
+SkeletonGraphStitcher::MergeVertices()
+{
+  const SizeValueType none = NumericTraits< SizeValueType >::max();
+  const SizeValueType numVertices = m_Vertices.size();
+  std::vector< bool > removed(numVertices, false);
+
+  //Junctions merged into their root, which takes the first voxel
+  for (SizeValueType v = 0; v < numVertices; ++v)
+  {
+    const SizeValueType root = this->FindRoot(v);
+    if (root == v)
+      continue;
+    removed[v] = true;
+    m_Vertices[root].Voxels += m_Vertices[v].Voxels;
+    if (RasterLess(m_Vertices[v].Index, m_Vertices[root].Index))
+    {
+      std::copy(m_Vertices[v].Index, m_Vertices[v].Index + 3, m_Vertices[root].Index);
+      m_Vertices[root].Intensity = m_Vertices[v].Intensity;
+    }
+  }
+  std::vector< std::vector< SizeValueType > > incident(numVertices);
+  for (SizeValueType e = 0; e < m_Edges.size(); ++e)
+  {
+    m_Edges[e].V1 = this->FindRoot(m_Edges[e].V1);
+    m_Edges[e].V2 = this->FindRoot(m_Edges[e].V2);
+    incident[ m_Edges[e].V1 ].push_back(e);
+    incident[ m_Edges[e].V2 ].push_back(e);
+  }
+
+  //Boundary vertices: their two branches joined into the first one
+  std::vector< bool > removedEdge(m_Edges.size(), false);
+  for (SizeValueType v = 0; v < numVertices; ++v)
+  {
+    SkeletonGraph::Vertex & vertex = m_Vertices[v];
+    if (removed[v] || vertex.Type != SkeletonGraph::BOUNDARY)
+      continue;
+    const std::vector< SizeValueType > & edges = incident[v];
+    if (edges.size() < 2)
+    {
+      vertex.Type = SkeletonGraph::END_POINT;
+      continue;
+    }
+    if (edges.size() > 2)
+      continue;
+    if (edges[0] == edges[1])
+    {
+      vertex.Type = SkeletonGraph::LOOP;
+      continue;
+    }
+    SkeletonGraph::Edge & kept = m_Edges[ edges[0] ];
+    const SkeletonGraph::Edge & joined = m_Edges[ edges[1] ];
+    const SizeValueType other = joined.V1 != v ? joined.V1 : joined.V2;
+    if (kept.V1 == v)
+      kept.V1 = other;
+    else
+      kept.V2 = other;
+    kept.Length += joined.Length;
+    kept.SlabVoxels += joined.SlabVoxels + vertex.Voxels;
+    kept.IntensitySum += joined.IntensitySum + vertex.Intensity * vertex.Voxels;
+    std::replace(incident[other].begin(), incident[other].end(), edges[1], edges[0]);
+    removedEdge[ edges[1] ] = true;
+    removed[v] = true;
+  }
+
+  //Vertices left, in raster order
+  std::vector< std::pair< std::vector< IndexValueType >, SizeValueType > > order;
+  for (SizeValueType v = 0; v < numVertices; ++v)
+    if (!removed[v])
+    {
+      const IndexValueType * index = m_Vertices[v].Index;
+      std::vector< IndexValueType > key(3);
+      key[0] = index[2];
+      key[1] = index[1];
+      key[2] = index[0];
+      order.push_back(std::make_pair(key, v));
+    }
+  std::sort(order.begin(), order.end());
+  std::vector< SizeValueType > newId(numVertices, none);
+  std::vector< SkeletonGraph::Vertex > vertices(order.size());
+  for (SizeValueType i = 0; i < order.size(); ++i)
+  {
+    newId[ order[i].second ] = i;
+    vertices[i] = m_Vertices[ order[i].second ];
+  }
+  m_Vertices.swap(vertices);
+
+  std::vector< SkeletonGraph::Edge > edges;
+  for (SizeValueType e = 0; e < m_Edges.size(); ++e)
+    if (!removedEdge[e])
+    {
+      SkeletonGraph::Edge edge = m_Edges[e];
+      edge.V1 = newId[ m_Edges[e].V1 ];
+      edge.V2 = newId[ m_Edges[e].V2 ];
+      if (edge.V1 > edge.V2)
+        std::swap(edge.V1, edge.V2);
+      edges.push_back(edge);
+    }
+  m_Edges.swap(edges);
+}
+
+inline void
+SkeletonGraphStitcher::BuildSkeletons()
+{
+  const SizeValueType none = NumericTraits< SizeValueType >::max();
+  const SizeValueType numVertices = m_Vertices.size();
+
+  //Skeletons, numbered in raster order of their first vertex
+  m_Parent.resize(numVertices);
+  for (SizeValueType v = 0; v < numVertices; ++v)
+    m_Parent[v] = v;
+  for (SizeValueType e = 0; e < m_Edges.size(); ++e)
+  {
+    const SizeValueType a = this->FindRoot(m_Edges[e].V1);
+    const SizeValueType b = this->FindRoot(m_Edges[e].V2);
+    if (a != b)
+      m_Parent[std::max(a, b)] = std::min(a, b);
+  }
+  std::vector< SizeValueType > vertexTree(numVertices, none);
+  m_VertexLocal.resize(numVertices);
+  m_TreeVertices.clear();
+  for (SizeValueType v = 0; v < numVertices; ++v)
+  {
+    const SizeValueType root = this->FindRoot(v);
+    if (vertexTree[root] == none)
+    {
+      vertexTree[root] = m_TreeVertices.size();
+      m_TreeVertices.push_back(std::vector< SizeValueType >());
+    }
+    vertexTree[v] = vertexTree[root];
+    m_VertexLocal[v] = m_TreeVertices[ vertexTree[v] ].size();
+    m_TreeVertices[ vertexTree[v] ].push_back(v);
+  }
+  const SizeValueType numTrees = m_TreeVertices.size();
+
+  //Branches, ordered by skeleton and first vertex
+  std::vector< std::pair< std::pair< SizeValueType, SizeValueType >, SizeValueType > > order;
+  for (SizeValueType e = 0; e < m_Edges.size(); ++e)
+    order.push_back(std::make_pair(std::make_pair(vertexTree[ m_Edges[e].V1 ], m_Edges[e].V1), e));
+  std::sort(order.begin(), order.end());
+
+  m_Graph->Clear();
+  m_Graph->SetSpacing(m_Spacing);
+  for (SizeValueType v = 0; v < numVertices; ++v)
+    m_Graph->AddVertex(m_Vertices[v]);
+
+  m_SkeletonStatistics.resize(numTrees);
+  m_TreeBranches.assign(numTrees, 0);
+  for (SizeValueType t = 0; t < numTrees; ++t)
+  {
+    SkeletonStatistics & s = m_SkeletonStatistics[t];
+    s.Branches = 0;
+    s.Junctions = 0;
+    s.EndPointVoxels = 0;
+    s.JunctionVoxels = 0;
+    s.SlabVoxels = 0;
+    s.AverageBranchLength = 0;
+    s.TriplePoints = 0;
+    s.QuadruplePoints = 0;
+    s.MaximumBranchLength = 0;
+    s.LongestShortestPath = 0;
+    this->GetPosition(m_Vertices[ m_TreeVertices[t][0] ].Index, s.ShortestPathStart);
+  }
+
+  m_Adjacency.assign(numVertices, std::vector< Arc >());
+  m_BranchStatistics.resize(order.size());
+  for (SizeValueType i = 0; i < order.size(); ++i)
+  {
+    const SkeletonGraph::Edge & edge = m_Edges[ order[i].second ];
+    m_Graph->AddEdge(edge);
+    const SizeValueType t = vertexTree[edge.V1];
+
+    BranchStatistics & branch = m_BranchStatistics[i];
+    branch.Skeleton = t + 1;
+    branch.Length = edge.Length;
+    this->GetPosition(m_Vertices[edge.V1].Index, branch.V1);
+    this->GetPosition(m_Vertices[edge.V2].Index, branch.V2);
+    branch.EuclideanDistance = sqrt( (branch.V1[0] - branch.V2[0]) * (branch.V1[0] - branch.V2[0])
+                                     + (branch.V1[1] - branch.V2[1]) * (branch.V1[1] - branch.V2[1])
+                                     + (branch.V1[2] - branch.V2[2]) * (branch.V1[2] - branch.V2[2]) );
+    branch.AverageIntensity = edge.SlabVoxels > 0 ? edge.IntensitySum / edge.SlabVoxels : 0;
+
+    SkeletonStatistics & s = m_SkeletonStatistics[t];
+    s.Branches++;
+    s.SlabVoxels += edge.SlabVoxels;
+    s.AverageBranchLength += edge.Length;
+    s.MaximumBranchLength = std::max(s.MaximumBranchLength, edge.Length);
+    m_TreeBranches[t]++;
+
+    Arc arc;
+    arc.Length = edge.Length;
+    arc.Vertex = edge.V2;
+    m_Adjacency[edge.V1].push_back(arc);
+    arc.Vertex = edge.V1;
+    m_Adjacency[edge.V2].push_back(arc);
+  }
+
+  for (SizeValueType v = 0; v < numVertices; ++v)
+  {
+    const SkeletonGraph::Vertex & vertex = m_Vertices[v];
+    SkeletonStatistics & s = m_SkeletonStatistics[ vertexTree[v] ];
+    if (vertex.Type == SkeletonGraph::END_POINT)
+      s.EndPointVoxels += vertex.Voxels;
+    else if (vertex.Type == SkeletonGraph::JUNCTION)
+    {
+      s.Junctions++;
+      s.JunctionVoxels += vertex.Voxels;
+      if (m_Adjacency[v].size() == 3)
+        s.TriplePoints++;
+      else if (m_Adjacency[v].size() == 4)
+        s.QuadruplePoints++;
+    }
+    else
+      s.SlabVoxels += vertex.Voxels;
+  }
+  for (SizeValueType t = 0; t < numTrees; ++t)
+    if (m_TreeBranches[t] > 0)
+      m_SkeletonStatistics[t].AverageBranchLength /= m_TreeBranches[t];
+}
+
+inline SizeValueType
+SkeletonGraphStitcher::Dijkstra(SizeValueType t, SizeValueType source,
+                                std::vector< double > & distance) const
+{
+  typedef std::pair< double, SizeValueType > QueueEntry;
+  const std::vector< SizeValueType > & vertices = m_TreeVertices[t];
+  distance.assign(vertices.size(), -1);
+
+  std::priority_queue< QueueEntry, std::vector< QueueEntry >, std::greater< QueueEntry > > queue;
+  std::vector< bool > done(vertices.size(), false);
+  distance[source] = 0;
+  queue.push(QueueEntry(0, source));
+  while (!queue.empty())
+  {
+    const SizeValueType u = queue.top().second;
+    queue.pop();
+    if (done[u])
+      continue;
+    done[u] = true;
+    const std::vector< Arc > & arcs = m_Adjacency[ vertices[u] ];
+    for (SizeValueType a = 0; a < arcs.size(); ++a)
+    {
+      const SizeValueType w = m_VertexLocal[ arcs[a].Vertex ];
+      const double d = distance[u] + arcs[a].Length;
+      if (distance[w] < 0 || d < distance[w])
+      {
+        distance[w] = d;
+        queue.push(QueueEntry(d, w));
+      }
+    }
+  }
+
+  SizeValueType farthest = source;
+  for (SizeValueType v = 0; v < vertices.size(); ++v)
+    if (distance[v] > distance[farthest])
+      farthest = v;
+  return farthest;
+}
+
+inline void
+SkeletonGraphStitcher::ThreadedLongestShortestPath(SizeValueType t)
+{
+  const std::vector< SizeValueType > & vertices = m_TreeVertices[t];
+  std::vector< double > distance;
+  SizeValueType bestSource = 0;
+  double best = 0;
+  if (m_TreeBranches[t] + 1 == vertices.size())
+  {
+    //On a tree the farthest vertex from anywhere ends a longest path
+    const SizeValueType a = this->Dijkstra(t, 0, distance);
+    const SizeValueType b = this->Dijkstra(t, a, distance);
+    bestSource = a;
+    best = distance[b];
+  }
+  else if (vertices.size() <= m_MaximumExactPathVertices)
+  {
+    for (SizeValueType s = 0; s < vertices.size(); ++s)
+    {
+      const SizeValueType b = this->Dijkstra(t, s, distance);
+      if (distance[b] > best)
+      {
+        best = distance[b];
+        bestSource = s;
+      }
+    }
+  }
+  else
+  {
+    //Sweeps from the farthest vertex of the previous one, while they get longer
+    SizeValueType a = this->Dijkstra(t, 0, distance);
+    for (unsigned int sweep = 0; sweep < 8; ++sweep)
+    {
+      const SizeValueType b = this->Dijkstra(t, a, distance);
+      if (distance[b] <= best)
+        break;
+      best = distance[b];
+      bestSource = a;
+      a = b;
+    }
+  }
+
+  SkeletonStatistics & s = m_SkeletonStatistics[t];
+  s.LongestShortestPath = best;
+  this->GetPosition(m_Vertices[ vertices[bestSource] ].Index, s.ShortestPathStart);
+}
+
+} //end namespace
+
+#endif // ITKSKELETONGRAPHSTITCHER_H
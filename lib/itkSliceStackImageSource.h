@@ -0,0 +1,170 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSLICESTACKIMAGESOURCE_H
+#define ITKSLICESTACKIMAGESOURCE_H
+
+#include <itkImage.h>
+#include <itkImageSource.h>
+#include <itkMultiThreader.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class SliceStackImageSource
+ * \brief Presents a directory of 2D slices, as piled by cardiovasc_pile, as
+ * a 3D image that is only decoded where it is requested.
+ *
+ * The output image must be 3D.
+ *
+ * Slice k of the volume is read from
+ * Directory/BaseName<FirstSlice + k, padded to 4 digits><Extension>. The
+ * settings can be read from the configuration files of cardiovasc_pile (see
+ * ReadConfiguration). The x and y geometry is that of the first slice, and
+ * slices are one unit apart unless VoxelSpacing sets an isotropic spacing.
+ *
+ * Only the slices the requested region touches are decoded, in parallel,
+ * and the last CacheSize decoded slices are kept, so that requests sharing
+ * slices (e.g. the rows of blocks of ImageBlockSplitter) decode them once.
+ */
+template< class TOutputImage >
+class ITK_EXPORT SliceStackImageSource : public ImageSource< TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef SliceStackImageSource         Self;
+  typedef ImageSource< TOutputImage >   Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SliceStackImageSource, ImageSource);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  typedef TOutputImage                             OutputImageType;
+  typedef typename OutputImageType::Pointer        OutputImagePointer;
+  typedef typename OutputImageType::PixelType      PixelType;
+  typedef typename OutputImageType::RegionType     RegionType;
+  typedef Image< PixelType, 2 >                    SliceImageType;
+  typedef typename SliceImageType::Pointer         SliceImagePointer;
+
+  itkGetStringMacro(Directory);
+  itkSetStringMacro(Directory);
+  itkGetStringMacro(BaseName);
+  itkSetStringMacro(BaseName);
+  /** Extension of the slices, which sets their format [.jpg]. */
+  itkGetStringMacro(Extension);
+  itkSetStringMacro(Extension);
+
+  itkGetConstMacro(FirstSlice, SizeValueType);
+  itkSetMacro(FirstSlice, SizeValueType);
+  itkGetConstMacro(NumberOfSlices, SizeValueType);
+  itkSetMacro(NumberOfSlices, SizeValueType);
+
+  /** Isotropic spacing of the volume, 0 to use that of the slices [0]. */
+  itkGetConstMacro(VoxelSpacing, double);
+  itkSetMacro(VoxelSpacing, double);
+
+  /** Decoded slices kept between updates [64]. */
+  itkGetConstMacro(CacheSize, SizeValueType);
+  itkSetMacro(CacheSize, SizeValueType);
+
+  /** Slices decoded since the source was created. */
+  itkGetConstMacro(NumberOfDecodedSlices, SizeValueType);
+
+  /** Sets BaseName, FirstSlice and NumberOfSlices from the FirstFile and
+   * LastFile entries of a cardiovasc_pile configuration file. The slice
+   * number follows the last "_" when pattern is "_", and pattern itself
+   * otherwise, in which case pattern is also the base name. */
+  void ReadConfiguration(const std::string & fileName, const std::string & pattern = "_");
+
+  /** File of slice k of the volume. */
+  std::string GetSliceFileName(SizeValueType k) const;
+
+  /** Releases the decoded slices. */
+  void ClearCache();
+
+protected:
+  SliceStackImageSource();
+  ~SliceStackImageSource() {}
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  virtual void GenerateOutputInformation();
+  virtual void GenerateData();
+
+  typedef enum
+  {
+    DECODE = 0,
+    COPY = 1
+  } PhaseType;
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void *arg );
+
+  /** Runs a phase over numJobs slices and rethrows the errors of the threads. */
+  void ExecutePhase(PhaseType phase, SizeValueType numJobs);
+  /** Reads the slice of m_Slices[m_Missing[i]]. */
+  void ThreadedDecode(SizeValueType i);
+  /** Copies m_Slices[k] into the output. */
+  void ThreadedCopy(SizeValueType k);
+
+  struct CacheEntry
+  {
+    SliceImagePointer                      Image;
+    std::list< SizeValueType >::iterator   Position;
+  };
+
+private:
+  SliceStackImageSource(const Self &); //purposely not implemented
+  void operator=(const Self &);        //purposely not implemented
+
+  std::string                   m_Directory;
+  std::string                   m_BaseName;
+  std::string                   m_Extension;
+  SizeValueType                 m_FirstSlice;
+  SizeValueType                 m_NumberOfSlices;
+  double                        m_VoxelSpacing;
+  SizeValueType                 m_CacheSize;
+  SizeValueType                 m_NumberOfDecodedSlices;
+
+  /** Slices by volume index, and their order of use, most recent first.
+   * The cache belongs to the files named by m_CacheFileName. */
+  std::map< SizeValueType, CacheEntry >   m_Cache;
+  std::list< SizeValueType >              m_CacheOrder;
+  std::string                             m_CacheFileName;
+
+  /** Slices of the region being generated, and those to decode. */
+  std::vector< SliceImagePointer >        m_Slices;
+  std::vector< SizeValueType >            m_Missing;
+  PhaseType                               m_Phase;
+  std::vector< std::string >              m_ThreadErrors;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSliceStackImageSource.txx"
+#endif
+
+#endif // ITKSLICESTACKIMAGESOURCE_H
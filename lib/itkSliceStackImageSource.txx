@@ -0,0 +1,323 @@
+#ifndef ITKSLICESTACKIMAGESOURCE_TXX
+#define ITKSLICESTACKIMAGESOURCE_TXX
+
+#include "itkSliceStackImageSource.h"
+#include <itkImageFileReader.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace itk {
+
+template< class TOutputImage >
+SliceStackImageSource< TOutputImage >
+::SliceStackImageSource()
+{
+  m_Extension = ".jpg";
+  m_FirstSlice = 0;
+  m_NumberOfSlices = 0;
+  m_VoxelSpacing = 0.0;
+  m_CacheSize = 64;
+  m_NumberOfDecodedSlices = 0;
+  m_Phase = DECODE;
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::ReadConfiguration(const std::string & fileName, const std::string & pattern)
+{
+  std::ifstream file(fileName.c_str());
+  if (!file)
+    itkExceptionMacro(<< "Cannot read " << fileName);
+
+  //The first line is a header, the rest are key=value
+  std::map< std::string, std::string > params;
+  std::string line;
+  std::getline(file, line);
+  while (std::getline(file, line))
+  {
+    const std::string::size_type separator = line.find('=');
+    if (separator != std::string::npos)
+      params.insert(std::make_pair(line.substr(0, separator), line.substr(separator + 1)));
+  }
+  if (params.find("FirstFile") == params.end() || params.find("LastFile") == params.end())
+    itkExceptionMacro(<< "No FirstFile or LastFile in " << fileName);
+
+  long numbers[2];
+  const std::string & firstFile = params["FirstFile"];
+  for (unsigned int f = 0; f < 2; ++f)
+  {
+    const std::string & s = params[f == 0 ? "FirstFile" : "LastFile"];
+    const std::string::size_type before = pattern == "_" ? s.find_last_of('_') : s.find(pattern);
+    if (before == std::string::npos)
+      itkExceptionMacro(<< "No " << pattern << " in " << s);
+    const std::string::size_type start = before + (pattern == "_" ? 1 : pattern.length());
+    numbers[f] = std::atol(s.substr(start, s.find('.', start) - start).c_str());
+  }
+  if (numbers[1] < numbers[0] || numbers[0] < 0)
+    itkExceptionMacro(<< "No slices between " << numbers[0] << " and " << numbers[1]);
+
+  if (pattern == "_")
+  {
+    const std::string::size_type slash = firstFile.find_last_of("/\\");
+    const std::string::size_type begin = slash == std::string::npos ? 0 : slash + 1;
+    m_BaseName = firstFile.substr(begin, firstFile.find_last_of('_') + 1 - begin);
+  }
+  else
+    m_BaseName = pattern;
+  m_FirstSlice = numbers[0];
+  m_NumberOfSlices = numbers[1] - numbers[0] + 1;
+  this->Modified();
+}
+
+template< class TOutputImage >
+std::string
+SliceStackImageSource< TOutputImage >
+::GetSliceFileName(SizeValueType k) const
+{
+  std::ostringstream fileName;
+  if (!m_Directory.empty())
+    fileName << m_Directory << "/";
+  fileName << m_BaseName << std::setw(4) << std::setfill('0') << m_FirstSlice + k << m_Extension;
+  return fileName.str();
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::ClearCache()
+{
+  m_Cache.clear();
+  m_CacheOrder.clear();
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::GenerateOutputInformation()
+{
+  typedef ImageFileReader< SliceImageType > ReaderType;
+
+  if (m_NumberOfSlices == 0)
+    itkExceptionMacro(<< "NumberOfSlices must be set");
+
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( this->GetSliceFileName(0) );
+  reader->UpdateOutputInformation();
+  const SliceImageType * slice = reader->GetOutput();
+  const typename SliceImageType::RegionType & sliceRegion = slice->GetLargestPossibleRegion();
+
+  typename OutputImageType::IndexType index;
+  typename OutputImageType::SizeType size;
+  typename OutputImageType::SpacingType spacing;
+  typename OutputImageType::PointType origin;
+  for (unsigned int d = 0; d < 2; ++d)
+  {
+    index[d] = sliceRegion.GetIndex(d);
+    size[d] = sliceRegion.GetSize(d);
+    spacing[d] = m_VoxelSpacing > 0.0 ? m_VoxelSpacing : slice->GetSpacing()[d];
+    origin[d] = slice->GetOrigin()[d];
+  }
+  index[2] = 0;
+  size[2] = m_NumberOfSlices;
+  spacing[2] = m_VoxelSpacing > 0.0 ? m_VoxelSpacing : 1.0;
+  origin[2] = 0.0;
+
+  OutputImageType * output = this->GetOutput();
+  output->SetLargestPossibleRegion( RegionType(index, size) );
+  output->SetSpacing( spacing );
+  output->SetOrigin( origin );
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::GenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+  const RegionType & region = output->GetRequestedRegion();
+
+  //Cached slices belong to other files once the settings change
+  const std::string fileName = this->GetSliceFileName(0);
+  if (fileName != m_CacheFileName)
+  {
+    this->ClearCache();
+    m_CacheFileName = fileName;
+  }
+
+  const SizeValueType first = region.GetIndex(2);
+  m_Slices.assign(region.GetSize(2), SliceImagePointer());
+  m_Missing.clear();
+  for (SizeValueType k = 0; k < m_Slices.size(); ++k)
+  {
+    typename std::map< SizeValueType, CacheEntry >::iterator it = m_Cache.find(first + k);
+    if (it == m_Cache.end())
+    {
+      m_Missing.push_back(k);
+      continue;
+    }
+    m_Slices[k] = it->second.Image;
+    m_CacheOrder.splice(m_CacheOrder.begin(), m_CacheOrder, it->second.Position);
+  }
+
+  try
+  {
+    this->ExecutePhase(DECODE, m_Missing.size());
+    m_NumberOfDecodedSlices += m_Missing.size();
+    this->ExecutePhase(COPY, m_Slices.size());
+  }
+  catch( ExceptionObject & )
+  {
+    m_Slices.clear();
+    throw;
+  }
+
+  if (m_CacheSize > 0)
+    for (SizeValueType i = 0; i < m_Missing.size(); ++i)
+    {
+      m_CacheOrder.push_front(first + m_Missing[i]);
+      CacheEntry & entry = m_Cache[first + m_Missing[i]];
+      entry.Image = m_Slices[ m_Missing[i] ];
+      entry.Position = m_CacheOrder.begin();
+    }
+  while (m_CacheOrder.size() > m_CacheSize)
+  {
+    m_Cache.erase(m_CacheOrder.back());
+    m_CacheOrder.pop_back();
+  }
+
+  m_Slices.clear();
+  m_Missing.clear();
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::ExecutePhase(PhaseType phase, SizeValueType numJobs)
+{
+  if (numJobs == 0)
+    return;
+
+  m_Phase = phase;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(this->GetNumberOfThreads(), numJobs));
+  m_ThreadErrors.assign(numThreads, std::string());
+
+  ThreadStruct str;
+  str.Filter = this;
+  this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+  this->GetMultiThreader()->SetSingleMethod(this->ThreaderCallback, &str);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  for (ThreadIdType t = 0; t < m_ThreadErrors.size(); ++t)
+    if (!m_ThreadErrors[t].empty())
+      itkExceptionMacro(<< m_ThreadErrors[t]);
+}
+
+template< class TOutputImage >
+ITK_THREAD_RETURN_TYPE
+SliceStackImageSource< TOutputImage >
+::ThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  Self * filter = str->Filter;
+  try
+  {
+    switch (filter->m_Phase)
+    {
+      case DECODE:
+        for (SizeValueType i = threadId; i < filter->m_Missing.size(); i += threadCount)
+          filter->ThreadedDecode(i);
+        break;
+      case COPY:
+        for (SizeValueType k = threadId; k < filter->m_Slices.size(); k += threadCount)
+          filter->ThreadedCopy(k);
+        break;
+    }
+  }
+  catch( ExceptionObject & err )
+  {
+    filter->m_ThreadErrors[threadId] = err.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::ThreadedDecode(SizeValueType i)
+{
+  typedef ImageFileReader< SliceImageType > ReaderType;
+
+  const SizeValueType k = m_Missing[i];
+  const std::string fileName = this->GetSliceFileName(
+      this->GetOutput()->GetRequestedRegion().GetIndex(2) + k);
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName );
+  reader->Update();
+  SliceImagePointer slice = reader->GetOutput();
+  slice->DisconnectPipeline();
+
+  const RegionType & largest = this->GetOutput()->GetLargestPossibleRegion();
+  const typename SliceImageType::RegionType & sliceRegion = slice->GetBufferedRegion();
+  for (unsigned int d = 0; d < 2; ++d)
+    if (sliceRegion.GetIndex(d) != largest.GetIndex(d) || sliceRegion.GetSize(d) != largest.GetSize(d))
+      itkExceptionMacro(<< fileName << " differs in size from the first slice");
+  m_Slices[k] = slice;
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::ThreadedCopy(SizeValueType k)
+{
+  OutputImageType * output = this->GetOutput();
+  const RegionType & region = output->GetRequestedRegion();
+  const SliceImageType * slice = m_Slices[k];
+
+  typename OutputImageType::IndexType index = region.GetIndex();
+  index[2] += k;
+  typename SliceImageType::IndexType sliceIndex;
+  sliceIndex[0] = index[0];
+
+  PixelType * out = output->GetBufferPointer() + output->ComputeOffset(index);
+  for (SizeValueType y = 0; y < region.GetSize(1); ++y)
+  {
+    sliceIndex[1] = index[1] + y;
+    const PixelType * in = slice->GetBufferPointer() + slice->ComputeOffset(sliceIndex);
+    std::copy(in, in + region.GetSize(0), out);
+    out += region.GetSize(0);
+  }
+}
+
+template< class TOutputImage >
+void
+SliceStackImageSource< TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Directory: " << m_Directory << std::endl;
+  os << indent << "BaseName: " << m_BaseName << std::endl;
+  os << indent << "Extension: " << m_Extension << std::endl;
+  os << indent << "FirstSlice: " << m_FirstSlice << std::endl;
+  os << indent << "NumberOfSlices: " << m_NumberOfSlices << std::endl;
+  os << indent << "VoxelSpacing: " << m_VoxelSpacing << std::endl;
+  os << indent << "CacheSize: " << m_CacheSize << std::endl;
+  os << indent << "NumberOfDecodedSlices: " << m_NumberOfDecodedSlices << std::endl;
+  os << indent << "CachedSlices: " << m_CacheOrder.size() << std::endl;
+}
+
+} // end namespace
+#endif //ITKSLICESTACKIMAGESOURCE_TXX
@@ -0,0 +1,175 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKSTREAMINGLABELOVERLAYIMAGEFILTER_H
+#define ITKSTREAMINGLABELOVERLAYIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkLabelOverlayFunctor.h>
+#include <itkMacro.h>
+#include <itkMultiThreader.h>
+#include <vector>
+
+namespace itk {
+
+/** \class StreamingLabelOverlayImageFilter
+ * \brief Rescales an image to [0, 255] and overlays a label image on it,
+ * one requested region at a time.
+ *
+ * The output is that of RescaleIntensityImageFilter (from InputMinimum and
+ * InputMaximum to [0, 255]) followed by LabelOverlayImageFilter, computed
+ * in one pass without the rescaled image. Unlike RescaleIntensityImageFilter
+ * the range is given, so the filter streams: a writer with stream divisions
+ * pulls the RGB volume slab by slab, and only the labels of each slab are
+ * read.
+ *
+ * In SLICE mode the output is the slice SliceIndex normal to Axis, with
+ * size 1 along Axis, and only that slice of the inputs is requested. In
+ * MAXIMUM_PROJECTION mode the output is the maximum intensity projection
+ * along Axis, tinted with the largest label of each ray. The inputs are
+ * pulled NumberOfSlicesPerSlab slices at a time, so the labels are never
+ * read in full.
+ */
+template < class TInputImage, class TLabelImage, class TOutputImage >
+class ITK_EXPORT StreamingLabelOverlayImageFilter :
+    public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef StreamingLabelOverlayImageFilter              Self;
+  typedef ImageToImageFilter<TInputImage,TOutputImage>  Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(StreamingLabelOverlayImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Inherit types from Superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::InputImagePointer      InputImagePointer;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename InputImageType::PixelType          InputPixelType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+  typedef typename OutputImageType::RegionType        RegionType;
+  typedef TLabelImage                                 LabelImageType;
+  typedef typename LabelImageType::PixelType          LabelPixelType;
+
+  /** Rescaled intensities, as LabelOverlayImageFilter receives them. */
+  typedef unsigned char                               IntensityType;
+  typedef Functor::LabelOverlayFunctor< IntensityType, LabelPixelType,
+                                        OutputPixelType > FunctorType;
+
+  typedef enum
+  {
+    VOLUME = 0,
+    SLICE = 1,
+    MAXIMUM_PROJECTION = 2
+  } ModeType;
+
+  void SetLabelImage(const LabelImageType * label);
+  const LabelImageType * GetLabelImage() const;
+
+  /** Range of the input mapped to [0, 255]. */
+  itkGetConstMacro(InputMinimum, InputPixelType);
+  itkSetMacro(InputMinimum, InputPixelType);
+  itkGetConstMacro(InputMaximum, InputPixelType);
+  itkSetMacro(InputMaximum, InputPixelType);
+
+  itkGetConstMacro(Opacity, double);
+  itkSetMacro(Opacity, double);
+  itkGetConstMacro(BackgroundValue, LabelPixelType);
+  itkSetMacro(BackgroundValue, LabelPixelType);
+
+  itkGetConstMacro(Mode, ModeType);
+  itkSetMacro(Mode, ModeType);
+  /** Dimension normal to the slice, or along which to project. */
+  itkGetConstMacro(Axis, unsigned int);
+  itkSetMacro(Axis, unsigned int);
+  itkGetConstMacro(SliceIndex, IndexValueType);
+  itkSetMacro(SliceIndex, IndexValueType);
+  itkGetConstMacro(NumberOfSlicesPerSlab, SizeValueType);
+  itkSetMacro(NumberOfSlicesPerSlab, SizeValueType);
+
+protected:
+  StreamingLabelOverlayImageFilter();
+  ~StreamingLabelOverlayImageFilter() {};
+  void PrintSelf(std::ostream&os, Indent indent) const;
+
+  /** Slices and projections have size 1 along Axis. */
+  virtual void GenerateOutputInformation();
+  virtual void GenerateInputRequestedRegion();
+
+  virtual void GenerateData();
+  virtual void BeforeThreadedGenerateData();
+  virtual void ThreadedGenerateData(const RegionType & outputRegionForThread,
+                                    ThreadIdType threadId);
+
+  struct ThreadStruct
+  {
+    Self *Filter;
+  };
+
+  static ITK_THREAD_RETURN_TYPE ProjectThreaderCallback( void *arg );
+
+  /** Maximum along Axis over m_Slab for the rows of the projection of
+   * threadId, across the dimension m_SplitAxis. */
+  void ThreadedProject(ThreadIdType threadId, ThreadIdType threadCount);
+
+  /** Input region of the slices [first, last) along Axis. */
+  RegionType GetSlabRegion(IndexValueType first, IndexValueType last) const;
+
+  /** Rescaled intensity of value, as IntensityLinearTransform gives it. */
+  IntensityType Rescale(InputPixelType value) const
+  {
+    const double v = static_cast<double>(value) * m_Scale + m_Shift;
+    return static_cast<IntensityType>(v < 0.0 ? 0.0 : (v > 255.0 ? 255.0 : v));
+  }
+
+private:
+  StreamingLabelOverlayImageFilter(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  InputPixelType                  m_InputMinimum;
+  InputPixelType                  m_InputMaximum;
+  double                          m_Opacity;
+  LabelPixelType                  m_BackgroundValue;
+  ModeType                        m_Mode;
+  unsigned int                    m_Axis;
+  IndexValueType                  m_SliceIndex;
+  SizeValueType                   m_NumberOfSlicesPerSlab;
+
+  double                          m_Scale;
+  double                          m_Shift;
+  FunctorType                     m_Functor;
+
+  /** State of the projection: the slab being read, the dimension split
+   * between threads and the maxima of every ray so far. */
+  RegionType                      m_Slab;
+  unsigned int                    m_SplitAxis;
+  std::vector< InputPixelType >   m_MaximumIntensity;
+  std::vector< LabelPixelType >   m_MaximumLabel;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkStreamingLabelOverlayImageFilter.txx"
+#endif
+
+#endif // ITKSTREAMINGLABELOVERLAYIMAGEFILTER_H
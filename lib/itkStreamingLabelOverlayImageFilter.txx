@@ -0,0 +1,268 @@
+#ifndef ITKSTREAMINGLABELOVERLAYIMAGEFILTER_TXX
+#define ITKSTREAMINGLABELOVERLAYIMAGEFILTER_TXX
+
+#include "itkStreamingLabelOverlayImageFilter.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
+#include <algorithm>
+
+namespace itk {
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::StreamingLabelOverlayImageFilter()
+{
+  this->SetNumberOfRequiredInputs(2);
+  m_InputMinimum = NumericTraits<InputPixelType>::ZeroValue();
+  m_InputMaximum = NumericTraits<InputPixelType>::max();
+  m_Opacity = 0.5;
+  m_BackgroundValue = NumericTraits<LabelPixelType>::ZeroValue();
+  m_Mode = VOLUME;
+  m_Axis = ImageDimension - 1;
+  m_SliceIndex = 0;
+  m_NumberOfSlicesPerSlab = 32;
+  m_Scale = 1.0;
+  m_Shift = 0.0;
+  m_SplitAxis = 0;
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::SetLabelImage(const LabelImageType * label)
+{
+  this->SetNthInput(1, const_cast< LabelImageType * >(label));
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+const typename StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>::LabelImageType *
+StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::GetLabelImage() const
+{
+  return static_cast< const LabelImageType * >(this->ProcessObject::GetInput(1));
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (m_Mode == VOLUME)
+    return;
+  if (m_Axis >= ImageDimension)
+    itkExceptionMacro(<< "Axis " << m_Axis << " is not a dimension of the image");
+
+  RegionType region = this->GetInput()->GetLargestPossibleRegion();
+  if (m_Mode == SLICE)
+  {
+    if (m_SliceIndex < region.GetIndex(m_Axis)
+        || m_SliceIndex >= region.GetIndex(m_Axis) + static_cast<IndexValueType>(region.GetSize(m_Axis)))
+      itkExceptionMacro(<< "Slice " << m_SliceIndex << " is outside the image along axis " << m_Axis);
+    region.SetIndex(m_Axis, m_SliceIndex);
+  }
+  region.SetSize(m_Axis, 1);
+  this->GetOutput()->SetLargestPossibleRegion(region);
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  //Both inputs get the requested region of the output, which is a slice
+  //in SLICE mode
+  Superclass::GenerateInputRequestedRegion();
+  if (m_Mode != MAXIMUM_PROJECTION)
+    return;
+
+  //The other slabs are pulled by GenerateData
+  const RegionType & largest = this->GetInput()->GetLargestPossibleRegion();
+  const IndexValueType first = largest.GetIndex(m_Axis);
+  const RegionType slab = this->GetSlabRegion(first, first + static_cast<IndexValueType>(
+      std::min(m_NumberOfSlicesPerSlab, largest.GetSize(m_Axis))));
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  input->SetRequestedRegion(slab);
+  LabelImageType * label = const_cast< LabelImageType * >( this->GetLabelImage() );
+  if ( label )
+    label->SetRequestedRegion(slab);
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+typename StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>::RegionType
+StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::GetSlabRegion(IndexValueType first, IndexValueType last) const
+{
+  RegionType slab = this->GetOutput()->GetRequestedRegion();
+  slab.SetIndex(m_Axis, first);
+  slab.SetSize(m_Axis, last - first);
+  return slab;
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  if (this->GetLabelImage()->GetLargestPossibleRegion() != this->GetInput()->GetLargestPossibleRegion())
+    itkExceptionMacro(<< "The label image does not have the size of the image");
+
+  //As RescaleIntensityImageFilter to [0, 255]
+  const double minimum = static_cast<double>(m_InputMinimum);
+  const double maximum = static_cast<double>(m_InputMaximum);
+  if (m_InputMinimum != m_InputMaximum)
+    m_Scale = 255.0 / (maximum - minimum);
+  else if (m_InputMaximum != NumericTraits<InputPixelType>::ZeroValue())
+    m_Scale = 255.0 / maximum;
+  else
+    m_Scale = 0.0;
+  m_Shift = -minimum * m_Scale;
+
+  m_Functor.SetOpacity(m_Opacity);
+  m_Functor.SetBackgroundValue(m_BackgroundValue);
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::ThreadedGenerateData(const RegionType & outputRegionForThread, ThreadIdType)
+{
+  ImageRegionConstIterator< InputImageType > it(this->GetInput(), outputRegionForThread);
+  ImageRegionConstIterator< LabelImageType > lt(this->GetLabelImage(), outputRegionForThread);
+  ImageRegionIterator< OutputImageType > ot(this->GetOutput(), outputRegionForThread);
+  for (; !ot.IsAtEnd(); ++it, ++lt, ++ot)
+    ot.Set( m_Functor(this->Rescale(it.Get()), lt.Get()) );
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::GenerateData()
+{
+  if (m_Mode != MAXIMUM_PROJECTION)
+  {
+    Superclass::GenerateData();
+    return;
+  }
+
+  this->AllocateOutputs();
+  this->BeforeThreadedGenerateData();
+
+  OutputImageType * output = this->GetOutput();
+  InputImagePointer input = const_cast< InputImageType * >( this->GetInput() );
+  LabelImageType * label = const_cast< LabelImageType * >( this->GetLabelImage() );
+  const SizeValueType numPixels = output->GetBufferedRegion().GetNumberOfPixels();
+  m_MaximumIntensity.assign(numPixels, NumericTraits<InputPixelType>::NonpositiveMin());
+  m_MaximumLabel.assign(numPixels, NumericTraits<LabelPixelType>::NonpositiveMin());
+
+  //Threads own whole rows of the projection, across the slowest other axis
+  m_SplitAxis = m_Axis == ImageDimension - 1 ? ImageDimension - 2 : ImageDimension - 1;
+  const ThreadIdType numThreads = std::max< SizeValueType >(1,
+      std::min< SizeValueType >(this->GetNumberOfThreads(),
+                                output->GetBufferedRegion().GetSize(m_SplitAxis)));
+
+  //1- Maxima of every ray, slab by slab, pulling each slab through the
+  //   pipeline of the inputs as StreamingImageFilter does
+  const RegionType & largest = input->GetLargestPossibleRegion();
+  const IndexValueType begin = largest.GetIndex(m_Axis);
+  const IndexValueType end = begin + static_cast<IndexValueType>(largest.GetSize(m_Axis));
+  const IndexValueType step = static_cast<IndexValueType>(std::max< SizeValueType >(1, m_NumberOfSlicesPerSlab));
+  for (IndexValueType first = begin; first < end; first += step)
+  {
+    m_Slab = this->GetSlabRegion(first, std::min(first + step, end));
+    input->SetRequestedRegion(m_Slab);
+    input->PropagateRequestedRegion();
+    input->UpdateOutputData();
+    label->SetRequestedRegion(m_Slab);
+    label->PropagateRequestedRegion();
+    label->UpdateOutputData();
+
+    ThreadStruct str;
+    str.Filter = this;
+    this->GetMultiThreader()->SetNumberOfThreads(numThreads);
+    this->GetMultiThreader()->SetSingleMethod(this->ProjectThreaderCallback, &str);
+    this->GetMultiThreader()->SingleMethodExecute();
+  }
+
+  //2- Overlay of the rays
+  OutputPixelType * out = output->GetBufferPointer();
+  for (SizeValueType i = 0; i < numPixels; ++i)
+    out[i] = m_Functor(this->Rescale(m_MaximumIntensity[i]), m_MaximumLabel[i]);
+
+  m_MaximumIntensity.clear();
+  m_MaximumLabel.clear();
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::ProjectThreaderCallback( void * arg )
+{
+  ThreadStruct * str;
+  int threadId, threadCount;
+
+  threadId = ((MultiThreader::ThreadInfoStruct *)(arg))->ThreadID;
+  threadCount = ((MultiThreader::ThreadInfoStruct *)(arg))->NumberOfThreads;
+  str = (ThreadStruct *)(((MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  str->Filter->ThreadedProject(threadId, threadCount);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::ThreadedProject(ThreadIdType threadId, ThreadIdType threadCount)
+{
+  const SizeValueType rows = m_Slab.GetSize(m_SplitAxis);
+  const SizeValueType firstRow = rows * threadId / threadCount;
+  const SizeValueType lastRow = rows * (threadId + 1) / threadCount;
+  if (firstRow == lastRow)
+    return;
+
+  RegionType region = m_Slab;
+  region.SetIndex(m_SplitAxis, m_Slab.GetIndex(m_SplitAxis) + static_cast<IndexValueType>(firstRow));
+  region.SetSize(m_SplitAxis, lastRow - firstRow);
+
+  const InputImageType * input = this->GetInput();
+  const LabelImageType * label = this->GetLabelImage();
+  const OutputImageType * output = this->GetOutput();
+  const IndexValueType outputIndex = output->GetBufferedRegion().GetIndex(m_Axis);
+
+  //One iteration per line along x. Projected along x, a whole line falls
+  //on a single ray
+  const SizeValueType length = region.GetSize(0);
+  const SizeValueType stride = m_Axis == 0 ? 0 : 1;
+  RegionType lines = region;
+  lines.SetSize(0, 1);
+  for (ImageRegionConstIteratorWithIndex< InputImageType > it(input, lines); !it.IsAtEnd(); ++it)
+  {
+    typename InputImageType::IndexType index = it.GetIndex();
+    const InputPixelType * in = input->GetBufferPointer() + input->ComputeOffset(index);
+    const LabelPixelType * lab = label->GetBufferPointer() + label->ComputeOffset(index);
+    index[m_Axis] = outputIndex;
+    const SizeValueType ray = output->ComputeOffset(index);
+    InputPixelType * maximum = &m_MaximumIntensity[ray];
+    LabelPixelType * maximumLabel = &m_MaximumLabel[ray];
+    for (SizeValueType x = 0; x < length; ++x)
+    {
+      maximum[x * stride] = std::max(maximum[x * stride], in[x]);
+      maximumLabel[x * stride] = std::max(maximumLabel[x * stride], lab[x]);
+    }
+  }
+}
+
+template<class TInputImage, class TLabelImage, class TOutputImage>
+void StreamingLabelOverlayImageFilter<TInputImage, TLabelImage, TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "InputMinimum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_InputMinimum) << std::endl;
+  os << indent << "InputMaximum: " << static_cast< typename NumericTraits< InputPixelType >::PrintType >(m_InputMaximum) << std::endl;
+  os << indent << "Opacity: " << m_Opacity << std::endl;
+  os << indent << "BackgroundValue: " << static_cast< typename NumericTraits< LabelPixelType >::PrintType >(m_BackgroundValue) << std::endl;
+  os << indent << "Mode: " << m_Mode << std::endl;
+  os << indent << "Axis: " << m_Axis << std::endl;
+  os << indent << "SliceIndex: " << m_SliceIndex << std::endl;
+  os << indent << "NumberOfSlicesPerSlab: " << m_NumberOfSlicesPerSlab << std::endl;
+}
+
+} // end namespace
+#endif //ITKSTREAMINGLABELOVERLAYIMAGEFILTER_TXX
@@ -0,0 +1,221 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKTEMPORARYIMAGEFILE_H
+#define ITKTEMPORARYIMAGEFILE_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class TemporaryImageFile
+ * \brief Name of a temporary image file to write to in place of FileName,
+ * and the renames that replace FileName with it once it is complete.
+ *
+ * A tool that reads and writes the same file slab by slab would overwrite
+ * the slabs not read yet. Writing to GetTemporaryFileName() instead keeps
+ * the streaming, and Replace() then moves the result over FileName.
+ *
+ * The temporary name is FileName with ".tmp" before its extension, so the
+ * writer picks the same format. Files with a separate data file are
+ * replaced together with it:
+ * - MetaImage .mhd: the data file written next to the temporary header
+ *   is renamed after FileName, and ElementDataFile is changed to match
+ *   before the header itself is renamed.
+ * - Analyze and NIfTI .hdr/.img pairs: the .img is renamed, then the
+ *   .hdr, which does not name its data file.
+ */
+class TemporaryImageFile : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef TemporaryImageFile            Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TemporaryImageFile, Object);
+
+  /** File to replace. */
+  itkGetStringMacro(FileName);
+  itkSetStringMacro(FileName);
+
+  std::string GetTemporaryFileName() const
+  {
+    const std::string extension = GetExtension(m_FileName);
+    return m_FileName.substr(0, m_FileName.size() - extension.size()) + ".tmp" + extension;
+  }
+
+  /** Moves the temporary file, and its data file, over FileName. */
+  void Replace()
+  {
+    if (m_FileName.empty())
+      itkExceptionMacro(<< "No file name");
+    const std::string temporary = this->GetTemporaryFileName();
+    const std::string extension = GetExtension(m_FileName);
+    if (extension == ".mhd")
+      this->ReplaceMetaImage(temporary);
+    else if (extension.compare(0, 4, ".hdr") == 0 || extension.compare(0, 4, ".img") == 0)
+    {
+      //Two renames, so the pair is only consistent again after the second
+      const std::string suffix = extension.substr(4);
+      this->Rename(GetStem(temporary) + ".img" + suffix, GetStem(m_FileName) + ".img" + suffix);
+      this->Rename(GetStem(temporary) + ".hdr" + suffix, GetStem(m_FileName) + ".hdr" + suffix);
+    }
+    else
+      this->Rename(temporary, m_FileName);
+  }
+
+  /** Deletes what was written of the temporary file, after a failure. */
+  void Remove() const
+  {
+    const std::string temporary = this->GetTemporaryFileName();
+    const std::string extension = GetExtension(m_FileName);
+    if (extension == ".mhd")
+    {
+      const std::string dataFile = GetDataFile(temporary);
+      if (!dataFile.empty())
+        std::remove(dataFile.c_str());
+    }
+    else if (extension.compare(0, 4, ".hdr") == 0 || extension.compare(0, 4, ".img") == 0)
+    {
+      const std::string suffix = extension.substr(4);
+      std::remove((GetStem(temporary) + ".img" + suffix).c_str());
+      std::remove((GetStem(temporary) + ".hdr" + suffix).c_str());
+      return;
+    }
+    std::remove(temporary.c_str());
+  }
+
+protected:
+  TemporaryImageFile() {}
+  ~TemporaryImageFile() {}
+
+  void PrintSelf(std::ostream & os, Indent indent) const
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "FileName: " << m_FileName << std::endl;
+  }
+
+  /** Extension of fileName, with a trailing ".gz" as in ".nii.gz". */
+  static std::string GetExtension(const std::string & fileName)
+  {
+    std::string::size_type dot = fileName.find_last_of('.');
+    if (dot == std::string::npos || fileName.find('/', dot) != std::string::npos)
+      return std::string();
+    if (fileName.substr(dot) == ".gz" && dot > 0)
+    {
+      const std::string::size_type previous = fileName.find_last_of('.', dot - 1);
+      if (previous != std::string::npos && fileName.find('/', previous) == std::string::npos)
+        dot = previous;
+    }
+    return fileName.substr(dot);
+  }
+
+  static std::string GetStem(const std::string & fileName)
+  { return fileName.substr(0, fileName.size() - GetExtension(fileName).size()); }
+
+  static std::string GetFolder(const std::string & fileName)
+  {
+    const std::string::size_type slash = fileName.find_last_of('/');
+    return slash == std::string::npos ? std::string() : fileName.substr(0, slash + 1);
+  }
+
+  static std::string GetKey(const std::string & line)
+  {
+    const std::string key = line.substr(0, line.find('='));
+    const std::string::size_type first = key.find_first_not_of(" \t");
+    return first == std::string::npos ? std::string() :
+                                        key.substr(first, key.find_last_not_of(" \t\r") - first + 1);
+  }
+
+  /** Data file named in the MetaImage header, empty if the data is not in
+   * a single other file. */
+  static std::string GetDataFile(const std::string & header)
+  {
+    std::ifstream file(header.c_str());
+    std::string line;
+    while (std::getline(file, line))
+      if (GetKey(line) == "ElementDataFile")
+      {
+        std::string value = line.substr(line.find('=') + 1);
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        if (value.empty() || value == "LOCAL" || value.compare(0, 4, "LIST") == 0 ||
+            value.find('%') != std::string::npos)
+          return std::string();
+        return value[0] == '/' ? value : GetFolder(header) + value;
+      }
+    return std::string();
+  }
+
+  void Rename(const std::string & from, const std::string & to)
+  {
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+      itkExceptionMacro(<< "Cannot replace " << to << " with " << from);
+  }
+
+  void ReplaceMetaImage(const std::string & temporary)
+  {
+    std::vector< std::string > lines;
+    std::ifstream file(temporary.c_str());
+    std::string line;
+    while (std::getline(file, line))
+      lines.push_back(line);
+    file.close();
+
+    //MetaImageIO names the data file after the header: it follows FileName
+    const std::string dataFile = GetDataFile(temporary);
+    const std::string oldDataFile = GetDataFile(m_FileName);
+    std::string newDataFile = dataFile;
+    const std::string temporaryStem = GetStem(temporary);
+    if (!dataFile.empty() && dataFile.compare(0, temporaryStem.size(), temporaryStem) == 0)
+    {
+      newDataFile = GetStem(m_FileName) + dataFile.substr(temporaryStem.size());
+      this->Rename(dataFile, newDataFile);
+      for (SizeValueType l = 0; l < lines.size(); ++l)
+        if (GetKey(lines[l]) == "ElementDataFile")
+          lines[l] = "ElementDataFile = " + newDataFile.substr(GetFolder(newDataFile).size());
+
+      std::ofstream header(temporary.c_str());
+      for (SizeValueType l = 0; l < lines.size(); ++l)
+        header << lines[l] << "\n";
+      header.close();
+      if (!header)
+        itkExceptionMacro(<< "Cannot write " << temporary);
+    }
+    this->Rename(temporary, m_FileName);
+    //The data of the replaced header, if it had another name (.zraw)
+    if (!oldDataFile.empty() && oldDataFile != newDataFile)
+      std::remove(oldDataFile.c_str());
+  }
+
+private:
+  TemporaryImageFile(const Self &); //purposely not implemented
+  void operator=(const Self &);     //purposely not implemented
+
+  std::string  m_FileName;
+};
+
+} //end namespace
+
+#endif // ITKTEMPORARYIMAGEFILE_H
@@ -0,0 +1,106 @@
+/*=============================================================================
+
+  NifTK: A software platform for medical image computing.
+
+  Copyright (c) University College London (UCL). All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.
+
+  See LICENSE.txt in the top level directory for details.
+
+=============================================================================*/
+#ifndef ITKVOLUMESTACKIMAGESOURCE_H
+#define ITKVOLUMESTACKIMAGESOURCE_H
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageSource.h>
+#include <string>
+#include <vector>
+
+namespace itk {
+
+/** \class VolumeStackImageSource
+ * \brief Presents a list of image files as one image, appended along the
+ * last dimension, that is only read where it is requested.
+ *
+ * The files must have the same size along the other dimensions. The
+ * output has the geometry of the first file, with an isotropic spacing if
+ * VoxelSpacing is set.
+ *
+ * Every file is read by its own reader, for the part of the requested
+ * region that falls in it, so a writer with stream divisions appends the
+ * files slab by slab when their format can be read in parts. Files that
+ * cannot are read whole once and kept while the requests fall in them;
+ * the data of the files outside the request is released.
+ */
+template< class TOutputImage >
+class ITK_EXPORT VolumeStackImageSource : public ImageSource< TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef VolumeStackImageSource        Self;
+  typedef ImageSource< TOutputImage >   Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(VolumeStackImageSource, ImageSource);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  typedef TOutputImage                             OutputImageType;
+  typedef typename OutputImageType::Pointer        OutputImagePointer;
+  typedef typename OutputImageType::PixelType      PixelType;
+  typedef typename OutputImageType::RegionType     RegionType;
+  typedef ImageFileReader< OutputImageType >       ReaderType;
+
+  void SetFileNames(const std::vector< std::string > & fileNames)
+  {
+    m_FileNames = fileNames;
+    this->Modified();
+  }
+  void AddFileName(const std::string & fileName)
+  {
+    m_FileNames.push_back(fileName);
+    this->Modified();
+  }
+  const std::vector< std::string > & GetFileNames() const
+  { return m_FileNames; }
+
+  /** Isotropic spacing of the output, 0 to use that of the first file [0]. */
+  itkGetConstMacro(VoxelSpacing, double);
+  itkSetMacro(VoxelSpacing, double);
+
+protected:
+  VolumeStackImageSource();
+  ~VolumeStackImageSource() {}
+  void PrintSelf(std::ostream & os, Indent indent) const;
+
+  virtual void GenerateOutputInformation();
+  virtual void GenerateData();
+
+private:
+  VolumeStackImageSource(const Self &); //purposely not implemented
+  void operator=(const Self &);         //purposely not implemented
+
+  std::vector< std::string >                  m_FileNames;
+  double                                      m_VoxelSpacing;
+
+  /** Reader of every file, and the first slice of the output it fills. */
+  std::vector< typename ReaderType::Pointer > m_Readers;
+  std::vector< IndexValueType >               m_FirstSlices;
+};
+
+} //end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkVolumeStackImageSource.txx"
+#endif
+
+#endif // ITKVOLUMESTACKIMAGESOURCE_H
@@ -0,0 +1,116 @@
+#ifndef ITKVOLUMESTACKIMAGESOURCE_TXX
+#define ITKVOLUMESTACKIMAGESOURCE_TXX
+
+#include "itkVolumeStackImageSource.h"
+#include <itkImageAlgorithm.h>
+#include <algorithm>
+
+namespace itk {
+
+template< class TOutputImage >
+VolumeStackImageSource< TOutputImage >
+::VolumeStackImageSource()
+{
+  m_VoxelSpacing = 0.0;
+}
+
+template< class TOutputImage >
+void
+VolumeStackImageSource< TOutputImage >
+::GenerateOutputInformation()
+{
+  if (m_FileNames.empty())
+    itkExceptionMacro(<< "No files to append");
+
+  const unsigned int last = ImageDimension - 1;
+  m_Readers.resize(m_FileNames.size());
+  m_FirstSlices.resize(m_FileNames.size());
+  RegionType region;
+  for (SizeValueType f = 0; f < m_FileNames.size(); ++f)
+  {
+    if (m_Readers[f].IsNull() || m_FileNames[f] != m_Readers[f]->GetFileName())
+    {
+      m_Readers[f] = ReaderType::New();
+      m_Readers[f]->SetFileName( m_FileNames[f] );
+    }
+    m_Readers[f]->UpdateOutputInformation();
+    const RegionType & fileRegion = m_Readers[f]->GetOutput()->GetLargestPossibleRegion();
+    if (f == 0)
+    {
+      region = fileRegion;
+      region.SetSize(last, 0);
+    }
+    for (unsigned int d = 0; d < last; ++d)
+      if (fileRegion.GetIndex(d) != region.GetIndex(d) || fileRegion.GetSize(d) != region.GetSize(d))
+        itkExceptionMacro(<< m_FileNames[f] << " differs in size from " << m_FileNames[0]);
+    m_FirstSlices[f] = region.GetIndex(last) + static_cast< IndexValueType >(region.GetSize(last));
+    region.SetSize(last, region.GetSize(last) + fileRegion.GetSize(last));
+  }
+
+  const OutputImageType * first = m_Readers[0]->GetOutput();
+  OutputImageType * output = this->GetOutput();
+  output->CopyInformation( first );
+  output->SetLargestPossibleRegion( region );
+  if (m_VoxelSpacing > 0.0)
+  {
+    typename OutputImageType::SpacingType spacing;
+    spacing.Fill( m_VoxelSpacing );
+    output->SetSpacing( spacing );
+  }
+}
+
+template< class TOutputImage >
+void
+VolumeStackImageSource< TOutputImage >
+::GenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+  const RegionType & region = output->GetRequestedRegion();
+
+  const unsigned int last = ImageDimension - 1;
+  const IndexValueType begin = region.GetIndex(last);
+  const IndexValueType end = begin + static_cast< IndexValueType >(region.GetSize(last));
+  for (SizeValueType f = 0; f < m_Readers.size(); ++f)
+  {
+    OutputImageType * input = m_Readers[f]->GetOutput();
+    const IndexValueType fileBegin = m_FirstSlices[f];
+    const IndexValueType fileEnd = fileBegin + static_cast< IndexValueType >(
+        input->GetLargestPossibleRegion().GetSize(last));
+    const IndexValueType first = std::max(begin, fileBegin);
+    const IndexValueType stop = std::min(end, fileEnd);
+    if (first >= stop)
+    {
+      //Only the files of the request stay in memory
+      input->ReleaseData();
+      continue;
+    }
+
+    RegionType outputRegion = region;
+    outputRegion.SetIndex(last, first);
+    outputRegion.SetSize(last, stop - first);
+    RegionType inputRegion = outputRegion;
+    inputRegion.SetIndex(last, first - fileBegin + input->GetLargestPossibleRegion().GetIndex(last));
+
+    input->SetRequestedRegion( inputRegion );
+    input->PropagateRequestedRegion();
+    input->UpdateOutputData();
+    ImageAlgorithm::Copy( input, output, inputRegion, outputRegion );
+  }
+}
+
+template< class TOutputImage >
+void
+VolumeStackImageSource< TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "FileNames: " << m_FileNames.size() << std::endl;
+  for (SizeValueType f = 0; f < m_FileNames.size(); ++f)
+    os << indent.GetNextIndent() << m_FileNames[f] << std::endl;
+  os << indent << "VoxelSpacing: " << m_VoxelSpacing << std::endl;
+}
+
+} // end namespace
+#endif //ITKVOLUMESTACKIMAGESOURCE_TXX
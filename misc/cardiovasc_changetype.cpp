@@ -2,29 +2,134 @@
   * change_datatype.cpp
   * Rescales and casts an image to be
   * unsigned char.
+  * The input is read in its own pixel type and streamed to the output
+  * SLAB_SLICES slices at a time, after a first streamed pass for its
+  * range, so memory does not grow with the volume when the formats allow
+  * reading and writing in parts.
   * @author M.A. Zuluaga
   */
 #include "itkImage.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
-#include "itkRescaleIntensityImageFilter.h"
-#include "itkCastImageFilter.h"
+#include "itkImageIOFactory.h"
+#include "itkSaturatingCastImageFilter.h"
+#include "itkTemporaryImageFile.h"
+
+#define SLAB_SLICES 32 //Slices read and written at a time
 
 void Usage(char *exec)
 {
   std::cout << " " << std::endl;
-  std::cout << "Changes from float to unsigned char" << std::endl;
-  std::cout << "TODO: Make it generic (data and dimension)" << std::endl;
+  std::cout << "Rescales a 2D or 3D image of any pixel type to unsigned char [0, 255]" << std::endl;
   std::cout << " " << std::endl;
-  std::cout << " " << exec << " [-i inputimage -o outputimage  ]" << std::endl;
+  std::cout << " " << exec << " [-i inputimage -o outputimage <options> ]" << std::endl;
   std::cout << "**********************************************************" <<std::endl;
+  std::cout << "Options:" <<std::endl;
+  std::cout << "-r <min> <max> \t Range of the input mapped to [0, 255]. By default the range of the" << std::endl;
+  std::cout << "\t\t image, found in a first pass" << std::endl;
+  std::cout << "NaN becomes 0" << std::endl;
+  std::cout << "When -i and -o are the same file, it is replaced once the output is written" << std::endl;
+  std::cout << " " << std::endl;
+
+}
+
+template<int Dim, typename InputPixelType>
+int ChangeTypeFunction( const std::string & inputImageName, const std::string & outputImageName,
+                        bool useRange, double minimum, double maximum )
+{
+  typedef unsigned char                             OutputPixelType;
+  typedef itk::Image< InputPixelType, Dim >         InputImageType;
+  typedef itk::Image< OutputPixelType, Dim >        OutputImageType;
+
+  typedef itk::ImageFileReader< InputImageType >  ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( inputImageName );
+
+  typedef itk::SaturatingCastImageFilter< InputImageType, OutputImageType > FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( reader->GetOutput() );
+  filter->RescaleOn();
+  filter->SetOutputMinimum( 0 );
+  filter->SetOutputMaximum( itk::NumericTraits< OutputPixelType >::max() );
+  filter->SetNumberOfSlicesPerSlab( SLAB_SLICES );
+
+  //Reading and writing the same file in parts would overwrite the slabs
+  //not read yet, so the output goes to a temporary file replacing the
+  //input at the end
+  itk::TemporaryImageFile::Pointer temporary = itk::TemporaryImageFile::New();
+  temporary->SetFileName( outputImageName );
+  const bool inPlace = inputImageName == outputImageName;
+  const std::string writeImageName = inPlace ? temporary->GetTemporaryFileName() : outputImageName;
+
+  typedef itk::ImageFileWriter< OutputImageType > WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName( writeImageName );
+  writer->SetInput( filter->GetOutput() );
+
+  try
+  {
+    reader->UpdateOutputInformation();
+    if (useRange)
+    {
+      filter->SetInputMinimum( static_cast< InputPixelType >(minimum) );
+      filter->SetInputMaximum( static_cast< InputPixelType >(maximum) );
+    }
+    else
+      filter->ComputeInputRange();
+
+    const unsigned int slices = reader->GetOutput()->GetLargestPossibleRegion().GetSize(Dim - 1);
+    writer->SetNumberOfStreamDivisions( (slices + SLAB_SLICES - 1) / SLAB_SLICES );
+    writer->Update();
+    if (inPlace)
+      temporary->Replace();
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    if (inPlace)
+      temporary->Remove();
+    std::cerr << "Error: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
 
+  return EXIT_SUCCESS;
+}
+
+template<int Dim>
+int ChangeTypeComponentFunction( itk::ImageIOBase::IOComponentType componentType,
+                                 const std::string & inputImageName, const std::string & outputImageName,
+                                 bool useRange, double minimum, double maximum )
+{
+  switch( componentType )
+  {
+  case itk::ImageIOBase::UCHAR:
+    return ChangeTypeFunction<Dim, unsigned char>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::CHAR:
+    return ChangeTypeFunction<Dim, char>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::USHORT:
+    return ChangeTypeFunction<Dim, unsigned short>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::SHORT:
+    return ChangeTypeFunction<Dim, short>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::UINT:
+    return ChangeTypeFunction<Dim, unsigned int>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::INT:
+    return ChangeTypeFunction<Dim, int>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::FLOAT:
+    return ChangeTypeFunction<Dim, float>(inputImageName, outputImageName, useRange, minimum, maximum);
+  case itk::ImageIOBase::DOUBLE:
+    return ChangeTypeFunction<Dim, double>(inputImageName, outputImageName, useRange, minimum, maximum);
+  default:
+    std::cerr << "Unknown and unsupported component type!" << std::endl;
+    return EXIT_FAILURE;
+  }
 }
 
 int main(int argc, char *argv[] )
 {
   std::string inputImageName;
   std::string outputImageName;
+  bool useRange = false;
+  double minimum = 0;
+  double maximum = 0;
 
   for(int i=1; i < argc; i++)
   {
@@ -45,6 +150,13 @@ int main(int argc, char *argv[] )
       outputImageName=argv[++i];
       std::cout << "Set -o=" << outputImageName << std::endl;
     }
+    else if(strcmp(argv[i], "-r") == 0)
+    {
+      useRange = true;
+      minimum = atof(argv[++i]);
+      maximum = atof(argv[++i]);
+      std::cout << "Set -r=" << minimum << " " << maximum << std::endl;
+    }
     else
     {
       std::cerr << argv[0] << ":\tParameter " << argv[i] << " unknown."
@@ -61,35 +173,17 @@ int main(int argc, char *argv[] )
     return EXIT_FAILURE;
   }
 
-  const unsigned int Dimension = 3;
-  typedef float                                     InputPixelType;
-  typedef unsigned char                             OutputPixelType;
-  typedef itk::Image< InputPixelType, Dimension >   InputImageType;
-  typedef itk::Image< OutputPixelType, Dimension >  OutputImageType;
-
-  typedef itk::ImageFileReader< InputImageType >  ReaderType;
-  ReaderType::Pointer reader = ReaderType::New();
-  reader->SetFileName( inputImageName );
-
-  typedef itk::RescaleIntensityImageFilter< InputImageType, InputImageType >
-      RescaleType;
-  RescaleType::Pointer rescale = RescaleType::New();
-  rescale->SetInput( reader->GetOutput() );
-  rescale->SetOutputMinimum( 0 );
-  rescale->SetOutputMaximum( itk::NumericTraits< OutputPixelType >::max() );
-
-  typedef itk::CastImageFilter< InputImageType, OutputImageType > FilterType;
-  FilterType::Pointer filter = FilterType::New();
-  filter->SetInput( rescale->GetOutput() );
-
-  typedef itk::ImageFileWriter< OutputImageType > WriterType;
-  WriterType::Pointer writer = WriterType::New();
-  writer->SetFileName( outputImageName );
-  writer->SetInput( filter->GetOutput() );
-
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+        inputImageName.c_str(), itk::ImageIOFactory::ReadMode);
+  if ( !imageIO )
+  {
+    std::cerr << "Could not read the image information of " << inputImageName << std::endl;
+    return EXIT_FAILURE;
+  }
   try
   {
-    writer->Update();
+    imageIO->SetFileName(inputImageName);
+    imageIO->ReadImageInformation();
   }
   catch( itk::ExceptionObject & e )
   {
@@ -97,7 +191,16 @@ int main(int argc, char *argv[] )
     return EXIT_FAILURE;
   }
 
-  return EXIT_SUCCESS;
+  switch ( imageIO->GetNumberOfDimensions() )
+  {
+  case 2:
+    return ChangeTypeComponentFunction<2>(imageIO->GetComponentType(), inputImageName, outputImageName,
+                                          useRange, minimum, maximum);
+  case 3:
+    return ChangeTypeComponentFunction<3>(imageIO->GetComponentType(), inputImageName, outputImageName,
+                                          useRange, minimum, maximum);
+  default:
+    std::cerr << "Unsupported dimension" << std::endl;
+    return EXIT_FAILURE;
+  }
 }
-
-
@@ -9,7 +9,6 @@
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkJoinSeriesImageFilter.h>
-#include <itkChangeInformationImageFilter.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -250,19 +249,10 @@ int main(int argc, char *argv[] )
     typedef itk::ImageFileWriter<OutImageType> WriterType;
     typedef itk::JoinSeriesImageFilter<ImageType, OutImageType>
             JoinSeriesFilterType;
-    typedef itk::ChangeInformationImageFilter< OutImageType > FilterType;
 
     ImageReaderType::Pointer reader = ImageReaderType::New();
     JoinSeriesFilterType::Pointer joinSeries = JoinSeriesFilterType::New();
-    FilterType::Pointer changeInfo = FilterType::New();
-
-    //Check if spacing info needs to be updated
-    if (change_spacing)
-    {
-        OutImageType::SpacingType spacing = ( scalingFactor );
-        changeInfo->SetOutputSpacing( spacing );
-        changeInfo->ChangeSpacingOn();
-    }
+    OutImageType::SpacingType spacing = ( scalingFactor );
 
     OutImageType::PointType::VectorType translation;
     translation[0] = 0;
@@ -294,21 +284,19 @@ int main(int argc, char *argv[] )
             WriterType::Pointer writer = WriterType::New();
             writer->SetFileName( final_out );
 
+            //The geometry of the block is set before it is written
+            OutImageType::Pointer block = joinSeries->GetOutput();
+            block->DisconnectPipeline();
             if (block_counter != 0 || change_spacing)
             {
                 translation[2] = block_counter * slice_counter * scalingFactor;
-                OutImageType::PointType origin = joinSeries->GetOutput()->GetOrigin();
+                OutImageType::PointType origin = block->GetOrigin();
                 origin += translation;
-                changeInfo->SetOutputOrigin( origin );
-                changeInfo->ChangeOriginOn();
-                changeInfo->SetInput( joinSeries->GetOutput() );
-                changeInfo->UpdateOutputInformation();
-                writer->SetInput( changeInfo->GetOutput() );
-            }
-            else
-            {
-                writer->SetInput( joinSeries->GetOutput() );
+                block->SetOrigin( origin );
+                if (change_spacing)
+                    block->SetSpacing( spacing );
             }
+            writer->SetInput( block );
 
             try
             {
@@ -331,21 +319,18 @@ int main(int argc, char *argv[] )
             WriterType::Pointer writer = WriterType::New();
             writer->SetFileName( final_out );
 
+            OutImageType::Pointer block = joinSeries->GetOutput();
+            block->DisconnectPipeline();
             if (block_counter != 0 || change_spacing)
             {
                 translation[2] = block_counter * i * scalingFactor;
-                OutImageType::PointType origin = joinSeries->GetOutput()->GetOrigin();
+                OutImageType::PointType origin = block->GetOrigin();
                 origin += translation;
-                changeInfo->SetOutputOrigin( origin );
-                changeInfo->ChangeOriginOn();
-                changeInfo->SetInput( joinSeries->GetOutput() );
-                changeInfo->UpdateOutputInformation();
-                writer->SetInput( changeInfo->GetOutput() );
-            }
-            else
-            {
-                writer->SetInput( joinSeries->GetOutput() );
+                block->SetOrigin( origin );
+                if (change_spacing)
+                    block->SetSpacing( spacing );
             }
+            writer->SetInput( block );
 
             try
             {
@@ -9,7 +9,6 @@
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkJoinSeriesImageFilter.h>
-#include <itkChangeInformationImageFilter.h>
 #include <itkExtractImageFilter.h>
 #include <iostream>
 #include <fstream>
@@ -23,7 +22,6 @@ const std::string end_tag = "LastFile";
 //typedef's required for functions
 typedef itk::Image<unsigned char,3> OutImageType;
 typedef itk::ImageFileWriter< OutImageType > WriterType;
-typedef itk::ChangeInformationImageFilter< OutImageType > FilterType;
 
 void Usage(char *exec)
 {
@@ -373,15 +371,7 @@ int main(int argc, char *argv[] )
 
     ImageReaderType::Pointer reader = ImageReaderType::New();
     JoinSeriesFilterType::Pointer joinSeries = JoinSeriesFilterType::New();
-    FilterType::Pointer changeInfo = FilterType::New();
-
-    //Check if spacing info needs to be updated
-    if (change_spacing)
-    {
-        OutImageType::SpacingType spacing = ( scalingFactor );
-        changeInfo->SetOutputSpacing( spacing );
-        changeInfo->ChangeSpacingOn();
-    }
+    OutImageType::SpacingType spacing = ( scalingFactor );
 
     OutImageType::PointType::VectorType translation;
     translation[0] = 0;
@@ -429,60 +419,35 @@ int main(int argc, char *argv[] )
         {
             joinSeries->Update();
             std::string final_out = outputFileName + padnumber(block_counter) + ext;
+            OutImageType::Pointer block = joinSeries->GetOutput();
+            block->DisconnectPipeline();
             if (block_counter != 0 || change_spacing)
             {
                 translation[2] = block_counter * slice_counter * scalingFactor;
-                OutImageType::PointType origin = joinSeries->GetOutput()->GetOrigin();
+                OutImageType::PointType origin = block->GetOrigin();
                 origin += translation;
-                changeInfo->SetOutputOrigin( origin );
-                changeInfo->ChangeOriginOn();
-                changeInfo->SetInput( joinSeries->GetOutput() );
-                changeInfo->UpdateOutputInformation();
-                if (margin != 0)
-                {
-                    crop_block(changeInfo->GetOutput(), x_dim, y_dim, slice_counter,
-                               margin, outputFileName + padnumber(block_counter) , ext);
-                }
-                else
-                {
-                    WriterType::Pointer writer = WriterType::New();
-                    writer->SetFileName( final_out );
-
-                    writer->SetInput( changeInfo->GetOutput() );
-                    try
-                    {
-                        writer->Update();
-
-                    }
-                    catch( itk::ExceptionObject & error )
-                    {
-                        std::cerr << "Error: " << error << std::endl;
-                        return EXIT_FAILURE;
-                    }
-                }
+                block->SetOrigin( origin );
+                if (change_spacing)
+                    block->SetSpacing( spacing );
+            }
+            if (margin != 0)
+            {
+                crop_block(block, x_dim, y_dim, slice_counter,
+                           margin, outputFileName + padnumber(block_counter) , ext);
             }
             else
             {
-                if (margin != 0)
+                WriterType::Pointer writer = WriterType::New();
+                writer->SetFileName( final_out );
+                writer->SetInput( block );
+                try
                 {
-                    crop_block(joinSeries->GetOutput(), x_dim, y_dim, slice_counter,
-                               margin, outputFileName + padnumber(block_counter) , ext);
+                    writer->Update();
                 }
-                else
+                catch( itk::ExceptionObject & error )
                 {
-                    WriterType::Pointer writer = WriterType::New();
-                                        writer->SetFileName( final_out );
-                    writer->SetInput( joinSeries->GetOutput() );
-                    try
-                    {
-                        writer->Update();
-
-                    }
-                    catch( itk::ExceptionObject & error )
-                    {
-                        std::cerr << "Error: " << error << std::endl;
-                        return EXIT_FAILURE;
-                    }
+                    std::cerr << "Error: " << error << std::endl;
+                    return EXIT_FAILURE;
                 }
             }
 
@@ -503,57 +468,35 @@ int main(int argc, char *argv[] )
             std::string final_out = outputFileName + padnumber(block_counter) + ext;
 
 
+            OutImageType::Pointer block = joinSeries->GetOutput();
+            block->DisconnectPipeline();
             if (block_counter != 0 || change_spacing)
             {
                 translation[2] = block_counter * i * scalingFactor;
-                OutImageType::PointType origin = joinSeries->GetOutput()->GetOrigin();
+                OutImageType::PointType origin = block->GetOrigin();
                 origin += translation;
-                changeInfo->SetOutputOrigin( origin );
-                changeInfo->ChangeOriginOn();
-                changeInfo->SetInput( joinSeries->GetOutput() );
-                changeInfo->UpdateOutputInformation();
-                if (margin != 0)
-                {
-                    crop_block(changeInfo->GetOutput(), x_dim, y_dim, slice_counter,
-                               margin, outputFileName + padnumber(block_counter) , ext);
-                }
-                else
-                {
-                    WriterType::Pointer writer = WriterType::New();
-                    writer->SetFileName( final_out );
-                    writer->SetInput( changeInfo->GetOutput() );
-                    try
-                    {
-                        writer->Update();
-                    }
-                    catch( itk::ExceptionObject & error )
-                    {
-                        std::cerr << "Error: " << error << std::endl;
-                        return EXIT_FAILURE;
-                    }
-                }
+                block->SetOrigin( origin );
+                if (change_spacing)
+                    block->SetSpacing( spacing );
+            }
+            if (margin != 0)
+            {
+                crop_block(block, x_dim, y_dim, slice_counter,
+                           margin, outputFileName + padnumber(block_counter) , ext);
             }
             else
             {
-                if (margin != 0)
+                WriterType::Pointer writer = WriterType::New();
+                writer->SetFileName( final_out );
+                writer->SetInput( block );
+                try
                 {
-                    crop_block(joinSeries->GetOutput(), x_dim, y_dim, slice_counter,
-                               margin, outputFileName + padnumber(block_counter) , ext);
+                    writer->Update();
                 }
-                else
+                catch( itk::ExceptionObject & error )
                 {
-                    WriterType::Pointer writer = WriterType::New();
-                    writer->SetFileName( final_out );
-                    writer->SetInput( joinSeries->GetOutput() );
-                    try
-                    {
-                        writer->Update();
-                    }
-                    catch( itk::ExceptionObject & error )
-                    {
-                        std::cerr << "Error: " << error << std::endl;
-                        return EXIT_FAILURE;
-                    }
+                    std::cerr << "Error: " << error << std::endl;
+                    return EXIT_FAILURE;
                 }
             }
 
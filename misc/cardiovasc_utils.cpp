@@ -3,32 +3,33 @@
   * Utility file that I use for different purposes
   * This has been developed through the years so, it might be that
   * some options that appear within the help that are not working
+  * Consecutive pointwise operations (--otsu, --inv, --ith, --mul) are fused
+  * and applied in a single pass over the image.
+  * Images are processed in the pixel type of the input file, and binary
+  * images (results of thresholds, or 0/1 masks read from a file) go
+  * through --dil, --ero and --holes as bit-packed masks (--dil
+  * and --ero as distance maps for radii above MAX_BALL_RADIUS).
   * @author M.A. Zuluaga
   */
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
-#include <itkOtsuThresholdImageFilter.h>
-#include <itkInvertIntensityImageFilter.h>
 #include <itkNumericTraits.h>
 #include <itkSmoothingRecursiveGaussianImageFilter.h>
-#include <itkConnectedComponentImageFilter.h>
-#include <itkLabelShapeKeepNObjectsImageFilter.h>
 #include <itkBinaryBallStructuringElement.h>
 #include <itkBinaryDilateImageFilter.h>
 #include <itkBinaryErodeImageFilter.h>
 #include <itkCastImageFilter.h>
-#include <itkBinaryThresholdImageFilter.h>
 #include <itkBinaryImageToLabelMapFilter.h>
 #include <itkLabelMapToLabelImageFilter.h>
-#include <itkLabelOverlayImageFilter.h>
-#include <itkRescaleIntensityImageFilter.h>
-#include <itkBinaryFillholeImageFilter.h>
-#include <itkMinimumMaximumImageCalculator.h>
-#if ITK_VERSION_MAJOR >= 4
-#include <itkMultiplyImageFilter.h>
-#else
-#include <itkMultiplyByConstantImageFilter.h>
-#endif
+#include <itkExtractImageFilter.h>
+#include "itkFusedPointwiseImageFilter.h"
+#include "itkParallelOtsuThresholdImageFilter.h"
+#include "itkPackedBinaryMask.h"
+#include "itkDistanceMorphologyImageFilter.h"
+#include "itkParallelConnectedComponentImageFilter.h"
+#include "itkStreamingLabelOverlayImageFilter.h"
+#include <algorithm>
+#include <cmath>
 #include <map>
 
 #define OTSU 1  //Otsu thresholding
@@ -47,6 +48,9 @@
 #define IN_VALUE 1
 #define OUT_VALUE 0
 
+#define MAX_BALL_RADIUS 4 //Larger --dil and --ero radii use a distance map
+#define OVERLAY_SLAB_SLICES 16 //Slices of --overlay computed at a time
+
 void Usage(char *exec)
 {
   std::cout << " " << std::endl;
@@ -58,6 +62,7 @@ void Usage(char *exec)
   std::cout << "--mask <file> \t\t Mask image to be potentially used for some operations" <<std::endl;
   std::cout << "** Thresholding operations **" <<std::endl;
   std::cout << "--otsu \t\t\t Otsu thresholding" << std::endl;
+  std::cout << "--motsu <n> \t\t Multi-level Otsu with <n> thresholds, labels the classes 0 to <n>" << std::endl;
   std::cout << "--lth <val> \t\t Threshold the image below <val>" <<std::endl;
   std::cout << "--uth <val> \t\t Threshold the image above <val>" <<std::endl;
   std::cout << "--ith <val1> <val2> \t Interval thresholding the image between <val1>-<val2>" <<std::endl;
@@ -65,7 +70,10 @@ void Usage(char *exec)
   std::cout << "** Morphological operations **" <<std::endl;
   std::cout << "--dil <val> \t\t Dilates the image using a spherical kernel of radius <val>" << std::endl;
   std::cout << "--ero <val> \t\t Erodes the image using a spherical kernel of radius <val>" << std::endl;
+  std::cout << "\t\t\t Above " << MAX_BALL_RADIUS << ", binary images use a distance map and the kernel"
+            << " follows the voxel spacing (<val> voxels along the finest axis)" << std::endl;
   std::cout << "--holes \t\t Hole filling operation" << std::endl;
+  std::cout << "--holes2d \t\t Hole filling operation, slice by slice along z" << std::endl;
   std::cout << "--lconcom \t\t Keeps the largest connected component " << std::endl;
   std::cout << " " << std::endl;
   std::cout << "** Arithmetical operations **" <<std::endl;
@@ -81,11 +89,155 @@ void Usage(char *exec)
   std::cout << "** Misc operations **" <<std::endl;
   std::cout << "--overlay <file> \t Overlays the working image with binary image provided in <file>." << std::endl;
   std::cout << "\t\t\t WARN: This operation cannot be chained" << std::endl;
+  std::cout << "\t\t\t The RGB volume is written " << OVERLAY_SLAB_SLICES << " slices at a time to formats"
+            << " that allow it (e.g. .mhd, .nrrd)" << std::endl;
+  std::cout << "--ovlslice <view> <n> \t Writes only slice <n> of the overlay as a 2D image (e.g. .png)."
+            << " <view> is axial, coronal or sagittal" << std::endl;
+  std::cout << "--ovlmip <view> \t Writes the maximum intensity projection onto <view> of the overlay"
+            << " as a 2D image, with the largest label along each ray" << std::endl;
   std::cout << " " << std::endl;
 }
 
-//template<int Dim>
-//void UtilsProcessingFunction<Dim>( int argc, char *argv[] );
+/**
+ * @brief The pointwise operations waiting to be applied, as one pass of
+ * FusedPointwiseImageFilter (null if there are none), and the range of the
+ * values they will produce when it is known without running them. Binary
+ * is set while the values are known to be IN_VALUE or OUT_VALUE only.
+ */
+template< class TImage >
+struct PointwisePlan
+{
+  typedef itk::FusedPointwiseImageFilter< TImage > FilterType;
+  typename FilterType::Pointer Pending;
+  bool RangeKnown;
+  bool Binary;
+  typename TImage::PixelType Minimum;
+  typename TImage::PixelType Maximum;
+
+  PointwisePlan() : RangeKnown(false), Binary(false) {}
+
+  FilterType * GetPending()
+  {
+    if (!Pending)
+      Pending = FilterType::New();
+    return Pending;
+  }
+};
+
+/**
+ * @brief RunPendingPass Applies the pending operations to image, in place.
+ * When computeRange is set the range of the result is gathered by the
+ * same pass, or by a pass that only reads the image if nothing is pending.
+ */
+template< class TImage >
+void RunPendingPass( PointwisePlan< TImage > & plan, typename TImage::Pointer & image,
+                     bool computeRange )
+{
+  if (!plan.Pending && !computeRange)
+    return;
+
+  typename PointwisePlan< TImage >::FilterType * pass = plan.GetPending();
+  pass->SetInput( image );
+  pass->InPlaceOn();
+  pass->SetComputeMinimumMaximum( computeRange );
+  pass->Update();
+  image = pass->GetOutput();
+  image->DisconnectPipeline();
+  if (computeRange)
+  {
+    plan.RangeKnown = true;
+    plan.Minimum = pass->GetMinimum();
+    plan.Maximum = pass->GetMaximum();
+  }
+  plan.Pending = 0;
+}
+
+/**
+ * @brief ThresholdInterval Bounds of the voxels lower <= v <= upper in
+ * PixelType. For integer types the bounds are rounded inwards and clamped
+ * to the range of the type; an interval without values of the type gives
+ * lowerBound > upperBound.
+ */
+template< typename PixelType >
+void ThresholdInterval( double lower, double upper, PixelType & lowerBound, PixelType & upperBound )
+{
+  if (itk::NumericTraits<PixelType>::is_integer)
+  {
+    lower = std::ceil(lower);
+    upper = std::floor(upper);
+  }
+  const double minimum = static_cast<double>(itk::NumericTraits<PixelType>::NonpositiveMin());
+  const double maximum = static_cast<double>(itk::NumericTraits<PixelType>::max());
+  if (lower > upper || lower > maximum || upper < minimum)
+  {
+    lowerBound = itk::NumericTraits<PixelType>::max();
+    upperBound = itk::NumericTraits<PixelType>::NonpositiveMin();
+    return;
+  }
+  lowerBound = static_cast<PixelType>(std::max(lower, minimum));
+  upperBound = static_cast<PixelType>(std::min(upper, maximum));
+}
+
+/**
+ * @brief IsBinaryImage Whether every voxel of image is IN_VALUE or
+ * OUT_VALUE, as in a mask read from a file. The scan stops at the first
+ * other value.
+ */
+template< class TImage >
+bool IsBinaryImage( const TImage * image )
+{
+  const typename TImage::PixelType * buffer = image->GetBufferPointer();
+  const itk::SizeValueType size = image->GetBufferedRegion().GetNumberOfPixels();
+  for (itk::SizeValueType i = 0; i < size; ++i)
+    if (buffer[i] != IN_VALUE && buffer[i] != OUT_VALUE)
+      return false;
+  return true;
+}
+
+/**
+ * @brief DistanceMorphology Dilates or erodes a binary image by thresholding
+ * a distance map, whose cost does not depend on the radius. The ball has
+ * radius + 0.5 voxels along the finest axis, as the ball kernel of the
+ * radii up to MAX_BALL_RADIUS has along every axis, and follows the spacing
+ * along the others, as the mask dilation of vessel_filter.
+ */
+template< class TImage >
+typename TImage::Pointer DistanceMorphology( const TImage * image, unsigned int radius,
+    typename itk::DistanceMorphologyImageFilter< TImage, TImage >::OperationType operation )
+{
+  typedef itk::DistanceMorphologyImageFilter< TImage, TImage > MorphologyFilterType;
+
+  double spacing = image->GetSpacing()[0];
+  for (unsigned int d = 1; d < TImage::ImageDimension; ++d)
+    spacing = std::min<double>(spacing, image->GetSpacing()[d]);
+
+  typename MorphologyFilterType::Pointer morph = MorphologyFilterType::New();
+  morph->SetInput( image );
+  morph->SetOperation( operation );
+  morph->SetRadius( (radius + 0.5) * spacing );
+  morph->UseImageSpacingOn();
+  morph->SetForegroundValue( IN_VALUE );
+  morph->SetInsideValue( IN_VALUE );
+  morph->Update();
+  typename TImage::Pointer result = morph->GetOutput();
+  result->DisconnectPipeline();
+  return result;
+}
+
+/**
+ * @brief ViewAxis Axis normal to an axial, coronal or sagittal view, or -1
+ * for any other name.
+ */
+int ViewAxis( const char * view )
+{
+  if (strcmp(view, "sagittal") == 0)
+    return 0;
+  if (strcmp(view, "coronal") == 0)
+    return 1;
+  if (strcmp(view, "axial") == 0)
+    return 2;
+  return -1;
+}
 
 template<int Dim, typename PixelType >
 int UtilsProcessingFunction( int argc, char *argv[] )
@@ -95,13 +247,18 @@ int UtilsProcessingFunction( int argc, char *argv[] )
   std::string maskImageName;
   bool isMask = false;
   std::string outputImageName;
+  //View --overlay writes: the volume, a slice or a projection along overlayAxis
+  bool overlaySlice = false;
+  bool overlayProjection = false;
+  int overlayAxis = Dim - 1;
+  long overlayIndex = 0;
   std::vector<float> operations;
 
   /**
    * @brief aux_operations
-   * Holds extra variables for different operations. Key is
-   * the operation id (as in the defines) and it maps to a vector of
-   * strings.
+   * Holds extra variables for different operations. Entry i holds
+   * the vector of strings of operations[i], so only options that add
+   * an operation add an entry.
    * Validation of correctly parsed arguments can be achieved by counting
    * the elements in the vector.
    */
@@ -127,14 +284,12 @@ int UtilsProcessingFunction( int argc, char *argv[] )
     else if(strcmp(argv[i], "-o") == 0)
     {
       outputImageName=argv[++i];
-      aux_operations.push_back(dummy);
       std::cout << "Set -o=" << outputImageName << std::endl;
     }
     else if(strcmp(argv[i], "--mask") == 0)
     {
       maskImageName=argv[++i];
       isMask = true;
-      aux_operations.push_back(dummy);
       std::cout << "Set --mask=" << maskImageName << std::endl;
     }
     else if(strcmp(argv[i], "--otsu") == 0)
@@ -143,6 +298,15 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       aux_operations.push_back(dummy);
       std::cout << "Set -otsu=ON" << std::endl;
     }
+    else if(strcmp(argv[i], "--motsu") == 0)
+    {
+      operations.push_back(OTSU);
+      std::vector<std::string> tmp_map;
+
+      tmp_map.push_back(std::string(argv[++i]));
+      aux_operations.push_back(tmp_map);
+      std::cout << "Set -motsu with: " << tmp_map[0] << std::endl;
+    }
     else if(strcmp(argv[i], "--inv") == 0)
     {
       operations.push_back(INV);
@@ -161,6 +325,15 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       aux_operations.push_back(dummy);
       std::cout << "Set -holes=ON" << std::endl;
     }
+    else if(strcmp(argv[i], "--holes2d") == 0)
+    {
+      operations.push_back(HOL);
+      std::vector<std::string> tmp_map;
+
+      tmp_map.push_back("2d");
+      aux_operations.push_back(tmp_map);
+      std::cout << "Set -holes2d=ON" << std::endl;
+    }
     else if(strcmp(argv[i], "--smo") == 0)
     {
       operations.push_back(SMO);
@@ -210,6 +383,20 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       aux_operations.push_back(tmp_map);
       std::cout << "Set -overlay with: " << overlay_file << std::endl;
     }
+    else if(strcmp(argv[i], "--ovlslice") == 0 || strcmp(argv[i], "--ovlmip") == 0)
+    {
+      overlaySlice = strcmp(argv[i], "--ovlslice") == 0;
+      overlayProjection = !overlaySlice;
+      overlayAxis = ViewAxis(argv[++i]);
+      if (overlayAxis < 0 || overlayAxis >= Dim)
+      {
+        std::cout << "Invalid view " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (overlaySlice)
+        overlayIndex = atol(argv[++i]);
+      std::cout << "Set " << (overlaySlice ? "-ovlslice" : "-ovlmip") << " with: " << argv[i] << std::endl;
+    }
     else if(strcmp(argv[i], "--mul") == 0)
     {
       operations.push_back(MUL);
@@ -232,13 +419,17 @@ int UtilsProcessingFunction( int argc, char *argv[] )
   typedef itk::Image<unsigned short,Dim> BinImageType;
   typedef itk::ImageFileReader<ImageType> ImageReaderType;
   typedef itk::ImageFileWriter<ImageType> WriterType;
+  typedef itk::PackedBinaryMask<Dim> PackedMaskType;
 
   typename ImageReaderType::Pointer reader = ImageReaderType::New();
   reader->SetFileName(inputImageNameOne);
   reader->Update();
   typename ImageType::Pointer in_img = reader->GetOutput();
-  typename ImageType::Pointer out_img = reader->GetOutput();
+  typename ImageType::Pointer out_img;
   typename ImageType::Pointer mask_img;
+  //Holds the working image instead of in_img while it is a packed mask
+  typename PackedMaskType::Pointer packed;
+  in_img->DisconnectPipeline();
 
   if (isMask == true)
   {
@@ -248,52 +439,108 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       mask_img = reader_mask->GetOutput();
   }
 
+  //Pointwise operations wait in the plan until an operation needs their values
+  PointwisePlan<ImageType> plan;
   for (size_t i = 0; i < operations.size(); ++i)
   {
     unsigned int option = static_cast<unsigned int>(operations[i]);
     //std::cout << "here " << op << std::endl;
+    //Binary images have their holes filled, and are dilated and eroded up
+    //to MAX_BALL_RADIUS, as packed masks
+    const bool onMask = option == HOL || ((option == DIL || option == ERO)
+        && atoi(aux_operations[i][0].c_str()) <= MAX_BALL_RADIUS);
+    if (packed && !onMask)
+    {
+      in_img = packed->template ToImage<ImageType>(IN_VALUE, OUT_VALUE);
+      packed = 0;
+    }
+    if (option != OTSU && option != INV && option != ITH && option != MUL && option != OVL)
+    {
+      RunPendingPass(plan, in_img, false);
+      plan.RangeKnown = false;
+    }
+    //The values of a mask read from a file are checked once they are needed
+    if ((option == HOL || option == DIL || option == ERO) && !packed && !plan.Binary)
+      plan.Binary = IsBinaryImage<ImageType>(in_img);
+    if (plan.Binary && !packed && onMask)
+    {
+      //The mask replaces the image until an operation needs the values
+      packed = PackedMaskType::New();
+      packed->template FromImage<ImageType>(in_img, IN_VALUE);
+      in_img = 0;
+      out_img = 0;
+    }
     switch(option)
     {
     case OTSU:
     {
-      typedef itk::OtsuThresholdImageFilter<ImageType,
-          ImageType> OtsuFilterType;
+      typedef itk::ParallelOtsuThresholdImageFilter<ImageType, ImageType> OtsuFilterType;
+      const unsigned int levels = aux_operations[i].empty() ? 1 : atoi(aux_operations[i][0].c_str());
+      if (levels < 1)
+      {
+        std::cout << "Invalid number of thresholds" << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      //The histogram needs the values of the pending operations. Their range
+      //comes from the same pass, or from the plan, and without either the
+      //Otsu filter finds it
+      RunPendingPass(plan, in_img, plan.Pending.IsNotNull() && !plan.RangeKnown && !isMask);
       typename OtsuFilterType::Pointer otsu = OtsuFilterType::New();
-      otsu->SetInput( in_img );
-      otsu->SetInsideValue(IN_VALUE);
-      otsu->SetOutsideValue(OUT_VALUE);
+      otsu->SetInput(in_img);
+      otsu->SetNumberOfThresholds(levels);
       if (isMask == true)
       {
-          otsu->SetMaskImage( mask_img );
-          otsu->SetMaskValue(IN_VALUE);
+        otsu->SetMaskImage(mask_img);
+        otsu->SetMaskValue(IN_VALUE);
       }
-      otsu->Update();
-      in_img = otsu->GetOutput();
-      out_img = otsu->GetOutput();
-      in_img->DisconnectPipeline();
+      else if (plan.RangeKnown)
+        otsu->SetRange(plan.Minimum, plan.Maximum);
 
+      if (levels > 1)
+      {
+        //Labels of the classes, 0 outside the mask
+        otsu->InPlaceOn();
+        otsu->Update();
+        in_img = otsu->GetOutput();
+        out_img = otsu->GetOutput();
+        in_img->DisconnectPipeline();
+        plan.RangeKnown = false;
+        plan.Binary = false;
+        break;
+      }
+
+      //A single threshold joins the pending pass, where OtsuThresholdImageFilter
+      //sets the values up to the threshold inside
+      otsu->ComputeThresholds();
+      const PixelType threshold = otsu->GetThreshold();
+      typename PointwisePlan<ImageType>::FilterType * pass = plan.GetPending();
+      pass->AddThreshold(itk::NumericTraits<PixelType>::NonpositiveMin(), threshold, IN_VALUE, OUT_VALUE);
+      plan.Binary = true;
+      if (isMask == true)
+      {
+        pass->AddMask(mask_img, IN_VALUE, OUT_VALUE);
+        plan.RangeKnown = false;
+      }
+      else
+      {
+        const bool inside = otsu->GetMinimum() <= threshold;
+        const bool outside = otsu->GetMaximum() > threshold;
+        plan.RangeKnown = true;
+        plan.Minimum = inside && outside ? std::min<PixelType>(IN_VALUE, OUT_VALUE) : (inside ? IN_VALUE : OUT_VALUE);
+        plan.Maximum = inside && outside ? std::max<PixelType>(IN_VALUE, OUT_VALUE) : (inside ? IN_VALUE : OUT_VALUE);
+      }
       break;
     }
     case INV:
     {
-      typedef itk::MinimumMaximumImageCalculator <ImageType>
-          ImageCalculatorFilterType;
-      typedef itk::InvertIntensityImageFilter <ImageType>
-          InvertIntensityImageFilterType;
-
-      typename ImageCalculatorFilterType::Pointer imageCalculatorFilter
-          = ImageCalculatorFilterType::New ();
-      imageCalculatorFilter->SetImage(in_img);
-      imageCalculatorFilter->ComputeMaximum();
-
-      typename InvertIntensityImageFilterType::Pointer invertIntensityFilter
-          = InvertIntensityImageFilterType::New();
-      invertIntensityFilter->SetInput(in_img);
-      invertIntensityFilter->SetMaximum(imageCalculatorFilter->GetMaximum());
-      invertIntensityFilter->Update();
-      in_img = invertIntensityFilter->GetOutput();
-      out_img = invertIntensityFilter->GetOutput();
-      in_img->DisconnectPipeline();
+      //The maximum comes from the operations before when they determine it
+      RunPendingPass(plan, in_img, !plan.RangeKnown);
+      const PixelType minimum = plan.Minimum;
+      const PixelType maximum = plan.Maximum;
+      plan.GetPending()->AddInvert(maximum);
+      plan.Minimum = static_cast<PixelType>(maximum - maximum);
+      plan.Maximum = static_cast<PixelType>(maximum - minimum);
       break;
     }
     case SMO:
@@ -318,6 +565,7 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       in_img = gauss->GetOutput();
       out_img = gauss->GetOutput();
       in_img->DisconnectPipeline();
+      plan.Binary = false;
 
       break;
     }
@@ -340,6 +588,19 @@ int UtilsProcessingFunction( int argc, char *argv[] )
         return EXIT_FAILURE;
       }
 
+      if (packed)
+      {
+        packed->Dilate(radius);
+        break;
+      }
+      if (plan.Binary)
+      {
+        in_img = DistanceMorphology<ImageType>(in_img, radius,
+            itk::DistanceMorphologyImageFilter<ImageType, ImageType>::DILATE);
+        out_img = in_img;
+        break;
+      }
+
       StructuringElementType structuringElement;
       structuringElement.SetRadius(radius);
       structuringElement.CreateStructuringElement();
@@ -379,6 +640,19 @@ int UtilsProcessingFunction( int argc, char *argv[] )
         return EXIT_FAILURE;
       }
 
+      if (packed)
+      {
+        packed->Erode(radius);
+        break;
+      }
+      if (plan.Binary)
+      {
+        in_img = DistanceMorphology<ImageType>(in_img, radius,
+            itk::DistanceMorphologyImageFilter<ImageType, ImageType>::ERODE);
+        out_img = in_img;
+        break;
+      }
+
       StructuringElementType structuringElement;
       structuringElement.SetRadius(radius);
       structuringElement.CreateStructuringElement();
@@ -402,36 +676,25 @@ int UtilsProcessingFunction( int argc, char *argv[] )
     }
     case CON:
     {
-      typedef itk::CastImageFilter<ImageType,BinImageType> CastToBinFilter;
-      typedef itk::ConnectedComponentImageFilter<BinImageType,
-          BinImageType> ConnectFilterType;
-      typedef itk::LabelShapeKeepNObjectsImageFilter< BinImageType >
-          LabelShapeKeepNObjectsImageFilterType;
+      //Foreground as the cast to unsigned short saw it (values from 1).
+      //Component sizes are counted while labelling and only the largest
+      //one is written, straight as the 0/1 mask
+      typedef itk::ParallelConnectedComponentImageFilter<ImageType,
+          ImageType> ConnectFilterType;
 
-      typename CastToBinFilter::Pointer casttobin = CastToBinFilter::New();
-      casttobin->SetInput(in_img);
-      casttobin->Update();
       typename ConnectFilterType::Pointer connectfilter = ConnectFilterType::New();
-      connectfilter->SetInput(casttobin->GetOutput());
-      connectfilter->SetBackgroundValue(0);
+      connectfilter->SetInput(in_img);
+      connectfilter->SetLowerThreshold(1);
+      connectfilter->SetUpperThreshold(itk::NumericTraits<PixelType>::max());
       connectfilter->FullyConnectedOn();
-      typename LabelShapeKeepNObjectsImageFilterType::Pointer labelfilter =
-          LabelShapeKeepNObjectsImageFilterType::New();
-      labelfilter->SetInput(connectfilter->GetOutput());
-      labelfilter->SetBackgroundValue( 0 );
-      labelfilter->SetNumberOfObjects( 1 );
-      labelfilter->SetAttribute(LabelShapeKeepNObjectsImageFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-      labelfilter->Update();
-
-      typedef itk::RescaleIntensityImageFilter< BinImageType, ImageType > RescaleFilterType;
-      typename RescaleFilterType::Pointer rescaleFilter = RescaleFilterType::New();
-      rescaleFilter->SetInput(labelfilter->GetOutput());
-      rescaleFilter->SetOutputMinimum(OUT_VALUE);
-      rescaleFilter->SetOutputMaximum(IN_VALUE);
-      rescaleFilter->Update();
-      in_img = rescaleFilter->GetOutput();
-      out_img = rescaleFilter->GetOutput();
+      connectfilter->SetNumberOfObjects(1);
+      connectfilter->BinaryOutputOn();
+      connectfilter->SetInsideValue(IN_VALUE);
+      connectfilter->Update();
+      in_img = connectfilter->GetOutput();
+      out_img = connectfilter->GetOutput();
       in_img->DisconnectPipeline();
+      plan.Binary = true;
       break;
     }
     case ITH:
@@ -442,43 +705,36 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       try
       {
         std::vector<std::string> params = aux_operations[i];
-        lowerThreshold = static_cast<PixelType>(atof(params[0].c_str()));
-        upperThreshold = static_cast<PixelType>(atof(params[1].c_str()));
+        ThresholdInterval<PixelType>(atof(params[0].c_str()), atof(params[1].c_str()),
+                                     lowerThreshold, upperThreshold);
       } catch (...)
       {
         std::cout << "Invalid threshold parameters" << std::endl;
         return EXIT_FAILURE;
       }
-      typedef itk::BinaryThresholdImageFilter<ImageType, ImageType>
-          BinaryThresholdImageFilterType;
-      typename BinaryThresholdImageFilterType::Pointer thresholdFilter
-          = BinaryThresholdImageFilterType::New();
-      thresholdFilter->SetInput(in_img);
-
-      thresholdFilter->SetLowerThreshold(lowerThreshold);
-      thresholdFilter->SetUpperThreshold(upperThreshold);
-      thresholdFilter->SetInsideValue(IN_VALUE);
-      thresholdFilter->SetOutsideValue(OUT_VALUE);
-      thresholdFilter->Update();
-      in_img = thresholdFilter->GetOutput();
-      out_img = thresholdFilter->GetOutput();
-      in_img->DisconnectPipeline();
+      plan.GetPending()->AddThreshold(lowerThreshold, upperThreshold, IN_VALUE, OUT_VALUE);
+      plan.RangeKnown = false;
+      plan.Binary = true;
       break;
     }
     case HOL:
     {
-      typedef itk::BinaryFillholeImageFilter<ImageType> BinaryFillholeImageFilterType;
-
-      typename BinaryFillholeImageFilterType::Pointer binholefilter;
-      binholefilter = BinaryFillholeImageFilterType::New();
-      binholefilter->SetInput(in_img);
-      binholefilter->SetForegroundValue(IN_VALUE);
-      binholefilter->FullyConnectedOn();
-      binholefilter->Update();
+      //The background the border of the volume (or of the slice) does not
+      //reach is set to IN_VALUE, as BinaryFillholeImageFilter (fully
+      //connected) does
+      const bool sliceWise = !aux_operations[i].empty();
+      if (packed)
+      {
+        packed->FillHoles(true, sliceWise);
+        break;
+      }
 
-      in_img = binholefilter->GetOutput();
-      out_img = binholefilter->GetOutput();
-      in_img->DisconnectPipeline();
+      //Values other than IN_VALUE are kept outside the holes
+      typename PackedMaskType::Pointer filled = PackedMaskType::New();
+      filled->template FromImage<ImageType>(in_img, IN_VALUE);
+      filled->FillHoles(true, sliceWise);
+      filled->template PaintImage<ImageType>(in_img, IN_VALUE);
+      out_img = in_img;
       break;
 
     }
@@ -506,29 +762,23 @@ int UtilsProcessingFunction( int argc, char *argv[] )
         mul_factor = false;
       }
 
-      typedef itk::MultiplyImageFilter <ImageType, ImageType >
-          MultiplyImageFilterType;
-      typename MultiplyImageFilterType::Pointer multiplyFilter
-          = MultiplyImageFilterType::New ();
-
+      plan.Binary = false;
       if (mul_factor)
       {
-        multiplyFilter->SetInput(in_img);
-        multiplyFilter->SetConstant(factor);
+        plan.GetPending()->AddMultiply(static_cast<PixelType>(factor));
+        const PixelType minimum = static_cast<PixelType>(plan.Minimum * static_cast<PixelType>(factor));
+        const PixelType maximum = static_cast<PixelType>(plan.Maximum * static_cast<PixelType>(factor));
+        plan.Minimum = std::min(minimum, maximum);
+        plan.Maximum = std::max(minimum, maximum);
       }
       else
       {
         typename ImageReaderType::Pointer mul_reader = ImageReaderType::New();
         mul_reader->SetFileName(mul_param);
         mul_reader->Update();
-        multiplyFilter->SetInput1(in_img);
-        multiplyFilter->SetInput2(mul_reader->GetOutput());
+        plan.GetPending()->AddMultiply(mul_reader->GetOutput());
+        plan.RangeKnown = false;
       }
-
-      multiplyFilter->Update();
-      in_img = multiplyFilter->GetOutput();
-      out_img = multiplyFilter->GetOutput();
-      in_img->DisconnectPipeline();
       break;
     }
     case OVL:
@@ -537,35 +787,70 @@ int UtilsProcessingFunction( int argc, char *argv[] )
 
       typedef itk::RGBPixel<unsigned char> RGBPixelType;
       typedef itk::Image<RGBPixelType,Dim> RGBImageType;
+      typedef itk::Image<RGBPixelType,(Dim > 2 ? Dim - 1 : Dim)> RGBViewImageType;
       typedef itk::ImageFileReader<BinImageType> BinImageReaderType;
-      typedef itk::LabelOverlayImageFilter<BinImageType, BinImageType, RGBImageType>
+      typedef itk::StreamingLabelOverlayImageFilter<ImageType, BinImageType, RGBImageType>
           LabelOverlayImageFilterType;
+      typedef itk::ExtractImageFilter<RGBImageType, RGBViewImageType> ExtractFilterType;
       typedef itk::ImageFileWriter<RGBImageType> RGBWriterType;
+      typedef itk::ImageFileWriter<RGBViewImageType> RGBViewWriterType;
 
+      if ((overlaySlice || overlayProjection) && Dim < 3)
+      {
+        std::cerr << "--ovlslice and --ovlmip need a 3D image" << std::endl;
+        return EXIT_FAILURE;
+      }
 
-      typedef itk::RescaleIntensityImageFilter< ImageType, BinImageType > RescaleFilterType;
-      typename RescaleFilterType::Pointer rescaleFilter = RescaleFilterType::New();
-      rescaleFilter->SetInput(in_img);
-      rescaleFilter->SetOutputMinimum(0);
-      rescaleFilter->SetOutputMaximum(255);
+      //The intensities are rescaled from the range of the working image,
+      //gathered by the pass of the pending operations if it is not known
+      RunPendingPass(plan, in_img, !plan.RangeKnown);
 
       typename BinImageReaderType::Pointer binreader = BinImageReaderType::New();
       binreader->SetFileName(overlay);
 
       typename LabelOverlayImageFilterType::Pointer labelOverlayImageFilter = LabelOverlayImageFilterType::New();
-      labelOverlayImageFilter->SetInput(rescaleFilter->GetOutput());
+      labelOverlayImageFilter->SetInput(in_img);
       labelOverlayImageFilter->SetLabelImage(binreader->GetOutput());
+      labelOverlayImageFilter->SetInputMinimum(plan.Minimum);
+      labelOverlayImageFilter->SetInputMaximum(plan.Maximum);
       labelOverlayImageFilter->SetOpacity(0.4);
       labelOverlayImageFilter->SetBackgroundValue( 0 );
-      // labelOverlayImageFilter->AddColor(0,255,0);
-      labelOverlayImageFilter->Update();
-
-      typename RGBWriterType::Pointer writer = RGBWriterType::New();
-      writer->SetInput(labelOverlayImageFilter->GetOutput());
-      writer->SetFileName(outputImageName);
+      labelOverlayImageFilter->SetAxis(overlayAxis);
+      labelOverlayImageFilter->SetSliceIndex(overlayIndex);
+      labelOverlayImageFilter->SetNumberOfSlicesPerSlab(OVERLAY_SLAB_SLICES);
+      if (overlaySlice)
+        labelOverlayImageFilter->SetMode(LabelOverlayImageFilterType::SLICE);
+      else if (overlayProjection)
+        labelOverlayImageFilter->SetMode(LabelOverlayImageFilterType::MAXIMUM_PROJECTION);
 
       try
       {
+        if (!overlaySlice && !overlayProjection)
+        {
+          //Slabs of the volume are pulled by the writer, and only the labels
+          //of each slab are read when their format allows it
+          binreader->UpdateOutputInformation();
+          const unsigned int slices = in_img->GetLargestPossibleRegion().GetSize(Dim - 1);
+          typename RGBWriterType::Pointer writer = RGBWriterType::New();
+          writer->SetInput(labelOverlayImageFilter->GetOutput());
+          writer->SetFileName(outputImageName);
+          writer->SetNumberOfStreamDivisions(binreader->GetImageIO()->CanStreamRead()
+              ? (slices + OVERLAY_SLAB_SLICES - 1) / OVERLAY_SLAB_SLICES : 1);
+          writer->Update();
+          return EXIT_SUCCESS;
+        }
+
+        labelOverlayImageFilter->UpdateOutputInformation();
+        typename RGBImageType::RegionType view = labelOverlayImageFilter->GetOutput()->GetLargestPossibleRegion();
+        view.SetSize(overlayAxis, 0);
+        typename ExtractFilterType::Pointer extract = ExtractFilterType::New();
+        extract->SetInput(labelOverlayImageFilter->GetOutput());
+        extract->SetExtractionRegion(view);
+        extract->SetDirectionCollapseToIdentity();
+
+        typename RGBViewWriterType::Pointer writer = RGBViewWriterType::New();
+        writer->SetInput(extract->GetOutput());
+        writer->SetFileName(outputImageName);
         writer->Update();
       }
       catch(itk::ExceptionObject & err)
@@ -577,9 +862,12 @@ int UtilsProcessingFunction( int argc, char *argv[] )
       return EXIT_SUCCESS;
 
     }
-
-    }
   }
+  if (packed)
+    in_img = packed->template ToImage<ImageType>(IN_VALUE, OUT_VALUE);
+  RunPendingPass(plan, in_img, false);
+  out_img = in_img;
+
   typename WriterType::Pointer writer = WriterType::New();
   writer->SetInput(out_img);
   writer->SetFileName(outputImageName);
@@ -597,6 +885,47 @@ int UtilsProcessingFunction( int argc, char *argv[] )
   return EXIT_SUCCESS;
 }
 
+/**
+ * @brief UtilsComponentFunction Runs the operations in the pixel type of the
+ * input file. --smo and --mul give values an integer type cannot hold, so
+ * integer images run in float when they are used, as every image did before.
+ */
+template<int Dim>
+int UtilsComponentFunction( itk::ImageIOBase::IOComponentType componentType, int argc, char *argv[] )
+{
+  if (componentType != itk::ImageIOBase::FLOAT && componentType != itk::ImageIOBase::DOUBLE)
+    for(int i=1; i < argc; i++)
+      if(strcmp(argv[i], "--smo") == 0 || strcmp(argv[i], "--mul") == 0)
+        componentType = itk::ImageIOBase::FLOAT;
+
+  switch( componentType )
+  {
+  case itk::ImageIOBase::UCHAR:
+    return UtilsProcessingFunction<Dim, unsigned char>(argc,argv);
+  case itk::ImageIOBase::CHAR:
+    return UtilsProcessingFunction<Dim, signed char>(argc,argv);
+  case itk::ImageIOBase::USHORT:
+    return UtilsProcessingFunction<Dim, unsigned short>(argc,argv);
+  case itk::ImageIOBase::SHORT:
+    return UtilsProcessingFunction<Dim, short>(argc,argv);
+  case itk::ImageIOBase::UINT:
+    return UtilsProcessingFunction<Dim, unsigned int>(argc,argv);
+  case itk::ImageIOBase::INT:
+    return UtilsProcessingFunction<Dim, int>(argc,argv);
+  case itk::ImageIOBase::ULONG:
+    return UtilsProcessingFunction<Dim, unsigned long>(argc,argv);
+  case itk::ImageIOBase::LONG:
+    return UtilsProcessingFunction<Dim, long>(argc,argv);
+  case itk::ImageIOBase::FLOAT:
+    return UtilsProcessingFunction<Dim, float>(argc,argv);
+  case itk::ImageIOBase::DOUBLE:
+    return UtilsProcessingFunction<Dim, double>(argc,argv);
+  default:
+    std::cerr << "Unknown and unsupported component type!" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
 int main( int argc, char *argv[] )
 {
   std::string inputImageNameOne;
@@ -650,10 +979,10 @@ int main( int argc, char *argv[] )
   switch ( imageIO->GetNumberOfDimensions() )
   {
   case 2:
-    resp = UtilsProcessingFunction<2, float>(argc,argv);
+    resp = UtilsComponentFunction<2>(imageIO->GetComponentType(), argc, argv);
     break;
   case 3:
-    resp = UtilsProcessingFunction<3, float>(argc,argv);
+    resp = UtilsComponentFunction<3>(imageIO->GetComponentType(), argc, argv);
     break;
   default:
     std::cout << "Unsuported dimension" << std::endl;
@@ -0,0 +1,230 @@
+/**
+  * block_components.cpp
+  * Given the blocks a segmentation was split into by split_volume (e.g. the
+  * seg_withhisto outputs of every block), it labels the connected components
+  * of the whole volume, so that vessels crossing block boundaries keep one
+  * label, without loading the whole volume. The blocks are placed from the
+  * descriptor written by split_volume, or else from the origin and spacing in
+  * their headers.
+  */
+#include <itkImageFileReader.h>
+#include <fstream>
+#include <cmath>
+
+#include "itkBlockConnectedComponentsCalculator.h"
+
+
+void Usage(char *exec)
+{
+  std::cout << " " << std::endl;
+  std::cout << "Labels the connected components of a volume split into (overlapping) blocks." << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << " " << exec << " [-i blockFileName [-i blockFileName ...] -o outputPrefix -s sizesFileName -t threshold -m minSize -largest -full]" << std::endl;
+  std::cout << " " << exec << " [-d descriptorFileName -p inputPrefix -o outputPrefix ...]" << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << "*** [options]" << std::endl;
+  std::cout << "    -d <file>    Descriptor of the blocks written by split_volume" << std::endl;
+  std::cout << "    -p <prefix>  With -d, reads <prefix> followed by the file name of every block" << std::endl;
+  std::cout << "    -o <prefix>  Every block is written to <prefix> followed by its file name" << std::endl;
+  std::cout << "    -s <file>    Writes the size in voxels of every component (csv)" << std::endl;
+  std::cout << "    -t <int>     Voxels >= threshold are foreground [1]" << std::endl;
+  std::cout << "    -m <int>     Drops the components smaller than this" << std::endl;
+  std::cout << "    -largest     Writes a binary mask of the largest component instead of the labels" << std::endl;
+  std::cout << "    -full        26-connectivity instead of 6-connectivity" << std::endl;
+  std::cout << " " << std::endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  std::vector< std::string > inputImageNames;
+  std::string descriptorFileName;
+  std::string inputPrefix;
+  std::string outputPrefix;
+  std::string sizesFileName;
+  int threshold = 1;
+  unsigned long minSize = 0;
+  bool largest = false;
+  bool fullyConnected = false;
+
+  for(int i=1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0)
+    {
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-i") == 0)
+    {
+      inputImageNames.push_back(argv[++i]);
+      std::cout << "Set -i=" << inputImageNames.back() << std::endl;
+    }
+    else if(strcmp(argv[i], "-d") == 0)
+    {
+      descriptorFileName=argv[++i];
+      std::cout << "Set -d=" << descriptorFileName << std::endl;
+    }
+    else if(strcmp(argv[i], "-p") == 0)
+    {
+      inputPrefix=argv[++i];
+      std::cout << "Set -p=" << inputPrefix << std::endl;
+    }
+    else if(strcmp(argv[i], "-o") == 0)
+    {
+      outputPrefix=argv[++i];
+      std::cout << "Set -o=" << outputPrefix << std::endl;
+    }
+    else if(strcmp(argv[i], "-s") == 0)
+    {
+      sizesFileName=argv[++i];
+      std::cout << "Set -s=" << sizesFileName << std::endl;
+    }
+    else if(strcmp(argv[i], "-t") == 0)
+    {
+      threshold=atoi(argv[++i]);
+      std::cout << "Set -t=" << threshold << std::endl;
+    }
+    else if(strcmp(argv[i], "-m") == 0)
+    {
+      minSize=atol(argv[++i]);
+      std::cout << "Set -m=" << minSize << std::endl;
+    }
+    else if(strcmp(argv[i], "-largest") == 0)
+    {
+      largest=true;
+      std::cout << "Set -largest" << std::endl;
+    }
+    else if(strcmp(argv[i], "-full") == 0)
+    {
+      fullyConnected=true;
+      std::cout << "Set -full" << std::endl;
+    }
+    else
+    {
+      std::cout << "Error in arguments" << std::endl;
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Validate command line args
+  if ((inputImageNames.empty() == descriptorFileName.empty()) || (outputPrefix.length() == 0 && sizesFileName.length() == 0))
+  {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const unsigned int Dimension = 3;
+  typedef short InputPixelType;
+  typedef unsigned int LabelPixelType;
+  typedef unsigned char MaskPixelType;
+
+  typedef itk::Image< InputPixelType, Dimension > InputImageType;
+  typedef itk::Image< LabelPixelType, Dimension > LabelImageType;
+  typedef itk::Image< MaskPixelType, Dimension > MaskImageType;
+  typedef itk::ImageFileReader< InputImageType > ReaderType;
+  typedef itk::BlockConnectedComponentsCalculator< InputImageType, LabelImageType > LabelCalculatorType;
+  typedef itk::BlockConnectedComponentsCalculator< InputImageType, MaskImageType > MaskCalculatorType;
+
+  try
+  {
+    itk::ImageBlockGrid::Pointer grid = itk::ImageBlockGrid::New();
+    if (descriptorFileName.length() > 0)
+    {
+      itk::ImageBlockGrid::Pointer descriptor = itk::ImageBlockGrid::New();
+      descriptor->ReadDescriptor( descriptorFileName );
+      for (unsigned int b = 0; b < descriptor->GetNumberOfBlocks(); ++b)
+      {
+        const itk::ImageBlockGrid::Block & block = descriptor->GetBlock(b);
+        const std::string::size_type slash = block.FileName.find_last_of("/\\");
+        inputImageNames.push_back(inputPrefix + block.FileName.substr(slash == std::string::npos ? 0 : slash + 1));
+        grid->AddBlock(inputImageNames.back(), block.Index, block.Size);
+      }
+    }
+    else
+    {
+      //Only the headers are read here, the blocks are placed relative to the first one
+      InputImageType::PointType origin;
+      InputImageType::SpacingType spacing;
+      for (unsigned int b = 0; b < inputImageNames.size(); ++b)
+      {
+        ReaderType::Pointer reader = ReaderType::New();
+        reader->SetFileName( inputImageNames[b] );
+        reader->UpdateOutputInformation();
+        const InputImageType * image = reader->GetOutput();
+        if (b == 0)
+        {
+          origin = image->GetOrigin();
+          spacing = image->GetSpacing();
+        }
+        itk::IndexValueType index[3];
+        itk::SizeValueType size[3];
+        for (unsigned int d = 0; d < Dimension; ++d)
+        {
+          index[d] = (itk::IndexValueType)floor((image->GetOrigin()[d] - origin[d]) / spacing[d] + 0.5);
+          size[d] = image->GetLargestPossibleRegion().GetSize()[d];
+        }
+        grid->AddBlock(inputImageNames[b], index, size);
+      }
+    }
+    grid->ComputeCores();
+
+    std::vector< std::string > outputImageNames;
+    for (unsigned int b = 0; b < inputImageNames.size(); ++b)
+    {
+      const std::string::size_type slash = inputImageNames[b].find_last_of("/\\");
+      outputImageNames.push_back(outputPrefix + inputImageNames[b].substr(slash == std::string::npos ? 0 : slash + 1));
+      if (outputPrefix.length() > 0 && outputImageNames[b] == inputImageNames[b])
+      {
+        std::cerr << "Failed: " << inputImageNames[b] << " would be overwritten" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    itk::SizeValueType numberOfObjects;
+    std::vector< itk::SizeValueType > sizes;
+    if (largest)
+    {
+      MaskCalculatorType::Pointer calculator = MaskCalculatorType::New();
+      calculator->SetGrid( grid );
+      calculator->SetLowerThreshold( threshold );
+      calculator->SetFullyConnected( fullyConnected );
+      calculator->SetMinimumObjectSize( minSize );
+      calculator->SetNumberOfObjects( 1 );
+      calculator->SetBinaryOutput( true );
+      calculator->SetInsideValue( 255 );
+      calculator->Compute();
+      if (outputPrefix.length() > 0)
+        calculator->WriteBlocks( outputImageNames );
+      numberOfObjects = calculator->GetOriginalNumberOfObjects();
+      sizes = calculator->GetSizeOfObjectsInPixels();
+    }
+    else
+    {
+      LabelCalculatorType::Pointer calculator = LabelCalculatorType::New();
+      calculator->SetGrid( grid );
+      calculator->SetLowerThreshold( threshold );
+      calculator->SetFullyConnected( fullyConnected );
+      calculator->SetMinimumObjectSize( minSize );
+      calculator->Compute();
+      if (outputPrefix.length() > 0)
+        calculator->WriteBlocks( outputImageNames );
+      numberOfObjects = calculator->GetOriginalNumberOfObjects();
+      sizes = calculator->GetSizeOfObjectsInPixels();
+    }
+    std::cout << "Number of objects: " << numberOfObjects << std::endl;
+
+    if (sizesFileName.length() > 0)
+    {
+      std::ofstream sizesFile(sizesFileName.c_str());
+      sizesFile << "Label,Size" << std::endl;
+      for (unsigned int k = 0; k < sizes.size(); ++k)
+        sizesFile << k + 1 << "," << sizes[k] << std::endl;
+    }
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << "Failed: " << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
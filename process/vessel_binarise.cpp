@@ -7,6 +7,9 @@
 #include <itkImageFileWriter.h>
 
 #include "itkBinariseVesselResponseFilter.h"
+#include "itkBinariseVesselResponseSweepFilter.h"
+#include <sstream>
+#include <vector>
 
 
 void Usage(char *exec)
@@ -15,6 +18,10 @@ void Usage(char *exec)
   std::cout << "Binarises vesselness response." << std::endl;
   std::cout << " " << std::endl;
   std::cout << " " << exec << " [-i inputFileName -o outputFileName -t threshold (4 default)]" << std::endl;
+  std::cout << "    [-s seedThreshold] Hysteresis: keep only the objects reaching seedThreshold." << std::endl;
+  std::cout << "    [-sweep t1,t2,...] Binarise at every threshold in one run. One output is" << std::endl;
+  std::cout << "                       written per threshold, named outputFileName_t<threshold>." << std::endl;
+  std::cout << "                       It cannot be combined with -s." << std::endl;
   std::cout << " " << std::endl;
 }
 
@@ -23,6 +30,10 @@ int main( int argc, char *argv[] )
   std::string inputImageName;
   std::string outputImageName;
   float thresh=4;
+  float seed=0;
+  bool hysteresis=false;
+  std::vector<double> sweep;
+  std::vector<std::string> sweepNames;
 
   for(int i=1; i < argc; i++)
   {
@@ -46,6 +57,25 @@ int main( int argc, char *argv[] )
       thresh=atof(argv[++i]);
       std::cout << "Set -t=" << (thresh) << std::endl;
     }
+    else if(strcmp(argv[i], "-s") == 0)
+    {
+      seed=atof(argv[++i]);
+      hysteresis=true;
+      std::cout << "Set -s=" << (seed) << std::endl;
+    }
+    else if(strcmp(argv[i], "-sweep") == 0)
+    {
+      std::stringstream list(argv[++i]);
+      std::string item;
+      while (std::getline(list, item, ','))
+      {
+        if (item.length() == 0)
+          continue;
+        sweep.push_back(atof(item.c_str()));
+        sweepNames.push_back(item);
+      }
+      std::cout << "Set -sweep=" << argv[i] << std::endl;
+    }
   }
 
   // Validate command line args
@@ -54,6 +84,12 @@ int main( int argc, char *argv[] )
     Usage(argv[0]);
     return EXIT_FAILURE;
   }
+  if (hysteresis && !sweep.empty())
+  {
+    std::cout << "-s cannot be combined with -sweep" << std::endl;
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
 
   //Check for the extension
   std::size_t found_nii = outputImageName.rfind(".nii");
@@ -61,7 +97,11 @@ int main( int argc, char *argv[] )
   if ((found_nii == std::string::npos) && (found_mhd == std::string::npos))
   {
     outputImageName += ".nii";
+    found_nii = outputImageName.rfind(".nii");
   }
+  std::size_t found_ext = (found_nii != std::string::npos) ? found_nii : found_mhd;
+  std::string extension = outputImageName.substr(found_ext);
+  std::string outputBaseName = outputImageName.substr(0, found_ext);
 
   const unsigned int Dimension = 3;
   typedef float InputPixelType;
@@ -76,10 +116,41 @@ int main( int argc, char *argv[] )
   reader->SetFileName( inputImageName );
   reader->Update();
 
+  if (!sweep.empty())
+  {
+    typedef itk::BinariseVesselResponseSweepFilter<InputImageType,OutputImageType> SweepFilter;
+    SweepFilter::Pointer sweeper = SweepFilter::New();
+    sweeper->SetInput( reader->GetOutput() );
+    sweeper->SetThresholds( sweep );
+
+    try
+    {
+      sweeper->Update();
+      for (unsigned int t = 0; t < sweep.size(); ++t)
+      {
+        WriterType::Pointer writer = WriterType::New();
+        writer->SetInput( sweeper->GetOutput(t) );
+        writer->SetFileName( outputBaseName + "_t" + sweepNames[t] + extension );
+        writer->Update();
+      }
+    }
+    catch( itk::ExceptionObject & err )
+    {
+      std::cerr << "Failed: " << err << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
   typedef itk::BinariseVesselResponseFilter<InputImageType,OutputImageType> BinariseFilter;
   BinariseFilter::Pointer binarise = BinariseFilter::New();
   binarise->SetInput( reader->GetOutput() );
   binarise->SetLowThreshold(thresh);
+  if (hysteresis)
+  {
+    binarise->SetSeedThreshold(seed);
+    binarise->UseSeedThresholdOn();
+  }
 
   WriterType::Pointer writer = WriterType::New();
   writer->SetInput( binarise->GetOutput() );
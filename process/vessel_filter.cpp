@@ -5,6 +5,7 @@
   * I strongly recommend the use of the mask as the results improve significantly.
   * How to get a mask? Do some Otsu thresholding. If no mask, you need to provide
   * a dummy image.
+  * The input can also be a directory of jpg slices, as piled by cardiovasc_pile.
   * Note: Current help of this file (i.e. if -h is run) does not show all the options
   * as many are not relevant for the placenta problem or have been deprecated.
   * @author M.A. Zuluaga
@@ -13,6 +14,9 @@
 #include <itkImageFileWriter.h>
 #include "itkMultiScaleVesselnessFilter.h"
 #include "itkBrainMaskFromCTFilter.h"
+#include "itkDistanceMorphologyImageFilter.h"
+#include "itkSliceStackImageSource.h"
+#include <algorithm>
 
 void Usage(char *exec)
 {
@@ -26,6 +30,11 @@ void Usage(char *exec)
   std::cout << "--max <float> \t Maximum scale value (default 3.09). Set min and max the same for single scale)" << std::endl;
   std::cout << "--aone <float> \t Alpha one of Sato filter (default 0.5)" << std::endl;
   std::cout << "--atwo <float> \t Alpha two of Sato filter (default 0.5)" << std::endl;
+  std::cout << "--scale <filename> \t Also write the index (from 1) of the best scale per voxel" << std::endl;
+  std::cout << "--radius <filename> \t Also write the vessel radius (mm) given by the best scale" << std::endl;
+  std::cout << "--slices <config> <dir> \t Reads the input from the jpg slices of <dir> named as in the cardiovasc_pile configuration file <config>, instead of -i" << std::endl;
+  std::cout << "--pattern <str> \t File pattern on the slices (default _)" << std::endl;
+  std::cout << "--spacing <float> \t Isotropic voxel spacing of the slices (default: spacing of the slices and 1 between them)" << std::endl;
   std::cout << " " << std::endl;
   std::cout << " " << std::endl;
 }
@@ -35,6 +44,12 @@ int main( int argc, char *argv[] )
   std::string inputImageName;
   std::string outputImageName;
   std::string brainImageName;
+  std::string scaleImageName;
+  std::string radiusImageName;
+  std::string sliceConfigName;
+  std::string sliceDirectory;
+  std::string slicePattern = "_";
+  double sliceSpacing = 0.0;
   unsigned int mod = 0;
   float max = 3.09375;
   float min = 1;
@@ -95,15 +110,41 @@ int main( int argc, char *argv[] )
       isCT=true;
       std::cout << "Set -ct=ON" << std::endl;
     }
+    else if(strcmp(argv[i], "--scale") == 0)
+    {
+      scaleImageName=argv[++i];
+      std::cout << "Set -scale=" << scaleImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "--radius") == 0)
+    {
+      radiusImageName=argv[++i];
+      std::cout << "Set -radius=" << radiusImageName << std::endl;
+    }
     else if(strcmp(argv[i], "--cast") == 0)
     {
       iscast=true;
       std::cout << "Set -cast=ON" << std::endl;
     }
+    else if(strcmp(argv[i], "--slices") == 0)
+    {
+      sliceConfigName=argv[++i];
+      sliceDirectory=argv[++i];
+      std::cout << "Set -slices=" << sliceConfigName << " " << sliceDirectory << std::endl;
+    }
+    else if(strcmp(argv[i], "--pattern") == 0)
+    {
+      slicePattern=argv[++i];
+      std::cout << "Set -pattern=" << slicePattern << std::endl;
+    }
+    else if(strcmp(argv[i], "--spacing") == 0)
+    {
+      sliceSpacing=atof(argv[++i]);
+      std::cout << "Set -spacing=" << sliceSpacing << std::endl;
+    }
   }
 
   // Validate command line args
-  if (inputImageName.length() == 0 || outputImageName.length() == 0)
+  if ((inputImageName.length() == 0 && sliceConfigName.length() == 0) || outputImageName.length() == 0)
   {
     Usage(argv[0]);
     return EXIT_FAILURE;
@@ -124,12 +165,29 @@ int main( int argc, char *argv[] )
   typedef itk::Image< InputPixelType, Dimension > InputImageType;
   typedef itk::Image< InternalPixelType, Dimension > VesselImageType;
   typedef itk::MultiScaleVesselnessFilter< InputImageType, VesselImageType >  VesselnessFilterType;
+  typedef VesselnessFilterType::ScaleImageType ScaleImageType;
   typedef itk::ImageFileReader< InputImageType > ReaderType;
+  typedef itk::SliceStackImageSource< InputImageType > SliceSourceType;
 
-  ReaderType::Pointer reader = ReaderType::New();
-  reader->SetFileName( inputImageName );
-  reader->Update();
-  InputImageType::Pointer in_image = reader->GetOutput();
+  InputImageType::Pointer in_image;
+  if (sliceConfigName.length() > 0)
+  {
+    //The slices are decoded in parallel, without piling them into a volume first
+    SliceSourceType::Pointer slices = SliceSourceType::New();
+    slices->ReadConfiguration( sliceConfigName, slicePattern );
+    slices->SetDirectory( sliceDirectory );
+    slices->SetVoxelSpacing( sliceSpacing );
+    slices->SetCacheSize( 0 );
+    slices->Update();
+    in_image = slices->GetOutput();
+  }
+  else
+  {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( inputImageName );
+    reader->Update();
+    in_image = reader->GetOutput();
+  }
   InputImageType::SpacingType spacing = in_image->GetSpacing();
   InputImageType::SizeType size_in = in_image->GetLargestPossibleRegion().GetSize();
 
@@ -206,14 +264,20 @@ int main( int argc, char *argv[] )
     }
     else
     {
-      structuringElement.SetRadius(8);
-      structuringElement.CreateStructuringElement();
-      typedef itk::BinaryDilateImageFilter<InputImageType,InputImageType,StructuringElementType> DilateFilter;
-      DilateFilter::Pointer dilate = DilateFilter::New();
+      //The radius 8 ball as a thresholded distance map, whose cost does not
+      //depend on the radius. The ball has 8.5 voxels along the finest axis
+      //and follows the spacing along the others
+      typedef itk::DistanceMorphologyImageFilter<InputImageType,InputImageType> MorphologyFilterType;
+      const InputImageType::SpacingType & spacing = mask_reader->GetOutput()->GetSpacing();
+      double minSpacing = spacing[0];
+      for (unsigned int d = 1; d < Dimension; ++d)
+        minSpacing = std::min<double>(minSpacing, spacing[d]);
+      MorphologyFilterType::Pointer dilate = MorphologyFilterType::New();
       dilate->SetInput( mask_reader->GetOutput() );
-      dilate->SetKernel(structuringElement);
-      dilate->SetDilateValue(1);
-      dilate->SetBackgroundValue(0);
+      dilate->SetOperation( MorphologyFilterType::DILATE );
+      dilate->SetRadius( 8.5 * minSpacing );
+      dilate->UseImageSpacingOn();
+      dilate->SetInsideValue(1);
       dilate->Update();
       mask_image = dilate->GetOutput();
     }
@@ -227,6 +291,8 @@ int main( int argc, char *argv[] )
   vesselnessFilter->SetMinScale( min );
   vesselnessFilter->SetMaxScale( max );
   vesselnessFilter->SetScaleMode(static_cast<VesselnessFilterType::ScaleModeType>(mod));
+  vesselnessFilter->SetGenerateScaleOutput( scaleImageName.length() > 0 );
+  vesselnessFilter->SetGenerateRadiusOutput( radiusImageName.length() > 0 );
   vesselnessFilter->Update();
   VesselImageType::Pointer maxImage = vesselnessFilter->GetOutput();
   maxImage->DisconnectPipeline();
@@ -262,6 +328,50 @@ int main( int argc, char *argv[] )
     }
   }
 
+  //The best scale only means something where the response was kept
+  if (scaleImageName.length() > 0 || radiusImageName.length() > 0)
+  {
+    ScaleImageType::Pointer scaleImage = vesselnessFilter->GetScaleOutput();
+    VesselImageType::Pointer radiusImage = vesselnessFilter->GetRadiusOutput();
+    if (useMask)
+    {
+      itk::ImageRegionConstIterator<VesselImageType> maskedIterator(maxImage,maxImage->GetLargestPossibleRegion());
+      for (std::size_t i = 0; !maskedIterator.IsAtEnd(); ++maskedIterator, ++i)
+      {
+        if (maskedIterator.Get() != 0)
+          continue;
+        if (scaleImageName.length() > 0)
+          scaleImage->GetBufferPointer()[i] = 0;
+        if (radiusImageName.length() > 0)
+          radiusImage->GetBufferPointer()[i] = 0;
+      }
+    }
+    try
+    {
+      if (scaleImageName.length() > 0)
+      {
+        typedef itk::ImageFileWriter< ScaleImageType > ScaleWriterType;
+        ScaleWriterType::Pointer scaleWriter = ScaleWriterType::New();
+        scaleWriter->SetInput(scaleImage);
+        scaleWriter->SetFileName( scaleImageName );
+        scaleWriter->Update();
+      }
+      if (radiusImageName.length() > 0)
+      {
+        typedef itk::ImageFileWriter< VesselImageType > RadiusWriterType;
+        RadiusWriterType::Pointer radiusWriter = RadiusWriterType::New();
+        radiusWriter->SetInput(radiusImage);
+        radiusWriter->SetFileName( radiusImageName );
+        radiusWriter->Update();
+      }
+    }
+    catch( itk::ExceptionObject & err )
+    {
+      std::cerr << "Failed: " << err << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   if (iscast)
   {
     typedef unsigned short OutputPixelType;
@@ -0,0 +1,83 @@
+/**
+  * vessel_skeleton.cpp
+  * Given a binary vessel segmentation (e.g. the output of seg_withhisto), it
+  * extracts its centrelines by 3D topology preserving thinning. This is the
+  * same thinning as Fiji's "Skeletonize (2D/3D)", without the JVM.
+  */
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+
+#include "itkBinaryThinning3DImageFilter.h"
+
+
+void Usage(char *exec)
+{
+  std::cout << " " << std::endl;
+  std::cout << "Extracts the centrelines of a binary segmentation (any non-zero voxel is foreground)." << std::endl;
+  std::cout << " " << std::endl;
+  std::cout << " " << exec << " [-i inputFileName -o outputFileName]" << std::endl;
+  std::cout << " " << std::endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  std::string inputImageName;
+  std::string outputImageName;
+
+  for(int i=1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-help")==0 || strcmp(argv[i], "-Help")==0 || strcmp(argv[i], "-HELP")==0 || strcmp(argv[i], "-h")==0 || strcmp(argv[i], "--h")==0)
+    {
+      Usage(argv[0]);
+      return -1;
+    }
+    else if(strcmp(argv[i], "-i") == 0)
+    {
+      inputImageName=argv[++i];
+      std::cout << "Set -i=" << inputImageName << std::endl;
+    }
+    else if(strcmp(argv[i], "-o") == 0)
+    {
+      outputImageName=argv[++i];
+      std::cout << "Set -o=" << outputImageName << std::endl;
+    }
+  }
+
+  // Validate command line args
+  if (inputImageName.length() == 0 || outputImageName.length() == 0)
+  {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const unsigned int Dimension = 3;
+  typedef unsigned char PixelType;
+
+  typedef itk::Image< PixelType, Dimension > ImageType;
+  typedef itk::ImageFileReader< ImageType > ReaderType;
+  typedef itk::ImageFileWriter< ImageType > WriterType;
+  typedef itk::BinaryThinning3DImageFilter< ImageType, ImageType > ThinningFilterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( inputImageName );
+
+  ThinningFilterType::Pointer thinning = ThinningFilterType::New();
+  thinning->SetInput( reader->GetOutput() );
+  thinning->SetInsideValue( 255 );
+
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( thinning->GetOutput() );
+  writer->SetFileName( outputImageName );
+
+  try
+  {
+    writer->Update();
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << "Failed: " << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Thinned in " << thinning->GetNumberOfIterations() << " iterations" << std::endl;
+  return EXIT_SUCCESS;
+}
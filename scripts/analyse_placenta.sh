@@ -14,25 +14,24 @@ vessel_tools_source_dir="${HOME}/Code/vessel-tools"
 # Set location of vessel-tools build directory - this is the one you set in CMake before building vessel-tools
 vessel_tools_build_dir="${HOME}/Code/vessel-tools-build"
 
-# Set location of ImageJ
-fiji_bin="/Applications/Fiji.app/Contents/MacOS/ImageJ-macosx"
-
-# The original microCT volume - should point to the .vge file
-input_file="${HOME}/Data/input_file.vge"
+# The original microCT volume, in a format ITK can read (e.g. the raw volume of the .vge project as MetaImage)
+input_file="${HOME}/Data/input_file.mhd"
 short_patient_id="Plac51"
 
 # The root folder where all the output files will be saved
 output_dir="${HOME}/imagesplit/$short_patient_id"
 
 # Executables
+split_bin="${vessel_tools_build_dir}/IO/split_volume"
+recombine_bin="${vessel_tools_build_dir}/IO/recombine_volume"
 cardiovasc_utils_bin="${vessel_tools_build_dir}/misc/cardiovasc_utils"
 change_type_bin="${vessel_tools_build_dir}/misc/cardiovasc_changetype"
 stats_bin="${vessel_tools_build_dir}/analysis/compute_statistics"
 seg_with_histo_bin="${vessel_tools_build_dir}/process/seg_withhisto"
-
-# ImageJ scripts
-skeleton_script="${vessel_tools_source_dir}/ImageJ/SkeletonScript.bsh"
-thickness_script="${vessel_tools_source_dir}/ImageJ/ThicknessScript.bsh"
+skeleton_bin="${vessel_tools_build_dir}/process/vessel_skeleton"
+skeleton_analysis_bin="${vessel_tools_build_dir}/analysis/skeleton_analysis"
+skeleton_stitch_bin="${vessel_tools_build_dir}/analysis/skeleton_stitch"
+thickness_bin="${vessel_tools_build_dir}/analysis/local_thickness"
 
 
 
@@ -79,13 +78,13 @@ echo ---SPLITTING FILES---
 # histogram fitting, but it would neded to robust to artefacts such as implants which will skew the histograms in some datasets,
 
 # Split the input volume into smaller subvolumes, with specified size, format and maximum overlap
-imagesplit --input "${input_file}" --out "${split_data_dir}/${short_patient_id}" --format mhd --overlap 50 --max 300
+"${split_bin}" -i "${input_file}" -o "${split_data_dir}/${short_patient_id}" --ext .mhd --overlap 50 --max 300
 
 # Alternative split command for rescaling the data; however the histo command might not work with this datatype
-# imagesplit --input "$input_file" --out "$split_data_dir/${short_patient_id}" --format mhd --rescale -20 60 --type MET_UCHAR --overlap 50 --max 600
+# "${split_bin}" -i "${input_file}" -o "${split_data_dir}/${short_patient_id}" --ext .mhd --rescale -20 60 --uchar --overlap 50 --max 600
 
-# The descriptor file is generated by imagesplit and used to recombine subvolumes into volumes later
-descriptor_filename="${split_data_dir}/${short_patient_id}__info.imagesplit"
+# The descriptor file is generated by split_volume and used to recombine subvolumes into volumes later
+descriptor_filename="${split_data_dir}/${short_patient_id}_info.txt"
 
 
 
@@ -115,23 +114,21 @@ do
     echo Writing vessel segmentation file to:"${vessel_segmentation_filename}"
     "${seg_with_histo_bin}" -i "${input_filename}" -o "${vessel_segmentation_filename}" -m "${placental_mask_filename}"
 
-    # Extract centerline and get statistics (see http://imagej.net/AnalyzeSkeleton#Table_of_results)
-    # Note: This ImageJ plugin currently does not work in headless mode
-    # Note: This ImageJ plugin currently does not accept spaces in the output filename parameteres
+    # Extract centerline and get statistics (same tables as http://imagej.net/AnalyzeSkeleton#Table_of_results)
     centerline_filename="${centerline_folder}/centerline_${base_filename}.mhd"
-    general_stats_filename="${centerline_stats_folder}/centerline_stats_one_${base_filename}.xls"
-    detailed_stats_filename="${centerline_stats_folder}/centerline_stats_two_${base_filename}.xls"
+    general_stats_filename="${centerline_stats_folder}/centerline_stats_one_${base_filename}.csv"
+    detailed_stats_filename="${centerline_stats_folder}/centerline_stats_two_${base_filename}.csv"
+    graph_filename="${centerline_stats_folder}/graph_${base_filename}.skg"
     echo Writing centerline file to:"${centerline_filename}" and stats to "${general_stats_filename}" and "${detailed_stats_filename}"
-    # Run the ImageJ script.
-    "${fiji_bin}" --ij2 --run "${skeleton_script}" "input_file=\"${vessel_segmentation_filename}\", output_file=\"${centerline_filename}\", output_statsOne=\"${general_stats_filename}\", output_statsTwo=\"${detailed_stats_filename}\""
+    "${skeleton_bin}" -i "${vessel_segmentation_filename}" -o "${centerline_filename}"
+    "${skeleton_analysis_bin}" -i "${centerline_filename}" -s "${general_stats_filename}" -b "${detailed_stats_filename}" \
+        -d "${descriptor_filename}" -graph "${graph_filename}"
 
     # Thickness estimation
-    # Note: This ImageJ plugin currently does not work in headless mode
-    # Note: This ImageJ plugin currently does not accept spaces in the output filename parameteres
-    # threshold=254 #This parameter could be also be given as an input
-    # thickness_filename="${thickness_folder}/thickvolume_${base_filename}.mhd"
-    # echo Writing thickness file to:"${thickness_filename}"
-    "${fiji_bin}" --ij2 --run "${thickness_script}" "input_file=\"${vessel_segmentation_filename}\", threshold=${threshold}, output_file=\"${thickness_filename}\""
+    threshold=254 #This parameter could be also be given as an input
+    thickness_filename="${thickness_folder}/thickvolume_${base_filename}.mhd"
+    echo Writing thickness file to:"${thickness_filename}"
+    "${thickness_bin}" -i "${vessel_segmentation_filename}" -t ${threshold} -o "${thickness_filename}"
 
     # Run statistics
     #   Computes some basic statistics over the thickness image and displays them.
@@ -153,11 +150,14 @@ done
 echo ---RECOMBINING SPLIT FILES---
 
 
-# Merge placental mask components into single output file
-imagesplit --input "${placental_mask_folder}/mask_${short_patient_id}_.mhd" --out "${recombined_folder}/${short_patient_id}_placenta" --format mhd --descriptor "${descriptor_filename}"
-
-# Merge vessel segmentation components into single output file
-imagesplit --input "${vessel_segmentation_folder}/segmented_${short_patient_id}_.mhd" --out "${recombined_folder}/${short_patient_id}_vessels" --format mhd --descriptor "${descriptor_filename}"
+# Merge the placental mask, vessel segmentation and centerline components into single output files, in one pass
+"${recombine_bin}" -d "${descriptor_filename}" --policy crop \
+    -i "${placental_mask_folder}/mask_" -o "${recombined_folder}/${short_patient_id}_placenta.mhd" \
+    -i "${vessel_segmentation_folder}/segmented_" -o "${recombined_folder}/${short_patient_id}_vessels.mhd" \
+    -i "${centerline_folder}/centerline_" -o "${recombined_folder}/${short_patient_id}_centerline.mhd"
 
-# Merge vessel segmentation components into single output file
-imagesplit --input "${centerline_folder}/centerline_${short_patient_id}_.mhd" --out "${recombined_folder}/${short_patient_id}_centerline" --format mhd --descriptor "${descriptor_filename}"
+# Statistics of the whole centerline, from the graphs of the blocks
+"${skeleton_stitch_bin}" -d "${descriptor_filename}" -p "${centerline_stats_folder}/graph_" \
+    -o "${recombined_folder}/${short_patient_id}_centerline.skg" \
+    -s "${recombined_folder}/${short_patient_id}_centerline_stats_one.csv" \
+    -b "${recombined_folder}/${short_patient_id}_centerline_stats_two.csv"
@@ -5,13 +5,16 @@
 #          M.A. Zuluaga
 # Copyright UCL 2017
 #================================================================================
-input_file="~/Medical_Imaging_Data/GIFT-Surg/Placenta/Control Imaging/Placenta 51/Plac51_Whole [2017-02-13 09.50.04]/Plac51_Whole_01/[vg-project] Plac51_Whole/76670764455363.vge"
+# The raw volume of the .vge project, in a format ITK can read (e.g. MetaImage)
+input_file="~/Medical_Imaging_Data/GIFT-Surg/Placenta/Control Imaging/Placenta 51/Plac51_Whole [2017-02-13 09.50.04]/Plac51_Whole_01/[vg-project] Plac51_Whole/76670764455363.mhd"
 output_dir="~/Medical_Imaging_Data/Output/Plac51"
+tools_dir="${HOME}/bin/roz_tools"
 
 split_data_dir="${output_dir}/split"
+split_bin="${tools_dir}/bin/split_volume"
 
 mkdir -p "$split_data_dir"
-imagesplit --input "$input_file" --out "$split_data_dir/Plac51_" --format mhd --rescale -20 60 --type MET_UCHAR --overlap 50 --max 600
+"${split_bin}" -i "$input_file" -o "$split_data_dir/Plac51" --ext .mhd --rescale -20 60 --uchar --overlap 50 --max 600
 
 #Example on how to call this: ./process_whole_placenta.sh 0.088767678
 
@@ -7,7 +7,6 @@
 #================================================================================
 #Example on how to call this: ./process_whole_placenta.sh 0.088767678
 
-imagej_bin="/home/mzuluaga/bin/Fiji.app/ImageJ-linux64" #ImageJ + options + script
 repo_dir="/home/mzuluaga/Code/source/roz_tools"
 tools_dir="/home/mzuluaga/bin/roz_tools"
 input_dir="/home/mzuluaga/data/placenta"
@@ -17,10 +16,9 @@ split_data_dir="${output_dir}/input_split"
 seg_with_histogram_bin="${tools_dir}/bin/seg_withhisto"
 stats_bin="${tools_dir}/bin/compute_statistics"
 change_type_bin="${tools_dir}/bin/cardiovasc_changetype"
-
-# ImageJ scripts
-skeleton_script="${repo_dir}/ImageJ/SkeletonScript.bsh"
-thickness_script="${repo_dir}/ImageJ/ThicknessScript.bsh"
+skeleton_bin="${tools_dir}/bin/vessel_skeleton"
+skeleton_analysis_bin="${tools_dir}/bin/skeleton_analysis"
+thickness_bin="${tools_dir}/bin/local_thickness"
 
 # Set up output folders
 mask_folder=${output_dir}/mask
@@ -46,19 +44,17 @@ do
     segmented_filename=${segmented_folder}/${base_filename}_segmented.mhd
     ${seg_with_histogram_bin}  -i  ${input_filename} -o ${segmented_filename} -m  ${mask_filename}
 
-    # Extract centerline and get statistics (see http://imagej.net/AnalyzeSkeleton#Table_of_results)
-    # Note: This ImageJ plugin is strongly connected to the GUI. It will return a Java Headless Exception if run in headless mode
-    centerline_filename=${centerline_folder}/${base_filename}_centerline.mhd
-    general_stats_filename=${centerline_folder}/${base_filename}_stats_one.xls
-    detailed_stats_filename=${centerline_folder}/${base_filename}_stats_two.xls
+    # Extract centerline and get statistics (same tables as http://imagej.net/AnalyzeSkeleton#Table_of_results)
     centerline_filename=${centerline_folder}/${base_filename}_centerline.mhd
-    eval ${imagej_bin} --ij2 --run ${skeleton_script} \'input_file=\"${segmented_filename}\", output_file=\"${centerline_filename}\", output_statsOne=\"${general_stats_filename}\", output_statsTwo=\"${detailed_stats_filename}\"\'
+    general_stats_filename=${centerline_folder}/${base_filename}_stats_one.csv
+    detailed_stats_filename=${centerline_folder}/${base_filename}_stats_two.csv
+    ${skeleton_bin} -i ${segmented_filename} -o ${centerline_filename}
+    ${skeleton_analysis_bin} -i ${centerline_filename} -s ${general_stats_filename} -b ${detailed_stats_filename}
 
     # Thickness estimation
-    # Note: This ImageJ plugin is strongly connected to the GUI. It will return a Java Headless Exception if run in headless mode
     threshold=254 #This parameter could be also be given as an input
     thickness_filename=${centerline_folder}/${base_filename}_thickvolume.mhd
-    eval ${imagej_bin} --ij2 --run ${thickness_script} \'input_file=\"${segmented_filename}\", threshold=\"${threshold}\", output_file=\"${thickness_filename}\"\'
+    ${thickness_bin} -i ${segmented_filename} -t ${threshold} -o ${thickness_filename}
 
     # Run statistics
     #   Computes some basic statistics over the thickness image and displays them.